@@ -198,6 +198,12 @@ namespace crab {
         this->run (inv);         
       }      
 
+      //! Set the table where the transformers record the calling
+      //! contexts of the callees.
+      void set_call_table (call_tbl_t* call_tbl) {
+        m_call_tbl = call_tbl;
+      }
+
       //! Propagate inv through statements
       abs_tr_ptr get_abs_transformer (abs_dom_t &inv) {
         // pass inv by ref to avoid copies
@@ -5,6 +5,10 @@
 #include <boost/unordered_map.hpp>
 #include <boost/shared_ptr.hpp>
 #include <boost/noncopyable.hpp>
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <vector>
 
 #include <crab/cfg/Cfg.hpp>
 
@@ -25,27 +29,85 @@ namespace crab {
       typedef AbsDomain abs_domain_t;
 
      private:
-      typedef boost::unordered_map <std::size_t, AbsDomain> call_table_t;
+      typedef boost::unordered_map <std::size_t, std::vector<AbsDomain> > call_table_t;
+      // The contexts found by each analysis of a caller, keyed by the
+      // caller and the index of the calling context it was analyzed
+      // with.
+      typedef std::pair<std::size_t, unsigned> caller_key_t;
+      typedef std::map<caller_key_t, std::vector<AbsDomain> > caller_ctxs_t;
+      typedef boost::unordered_map <std::size_t, caller_ctxs_t> caller_table_t;
+
+      // The table is split into shards, each with its own lock, so
+      // that callers analyzed by different threads can add their
+      // calling contexts concurrently unless they call functions in
+      // the same shard.
+      struct shard {
+        mutable std::mutex m_mutex;
+        call_table_t m_call_table;
+        caller_table_t m_caller_table;
+      };
+
+      static const std::size_t num_shards = 16;
       
-      call_table_t m_call_table;
+      shard m_shards [num_shards];
+      unsigned m_max_ctxs; // max number of contexts per function
 
-      // Assume context-insensitive analysis so it will merge all
-      // calling contexts using abstract domain's join keeping a
-      // single calling context per function.
-      void insert_helper (std::size_t func_key, AbsDomain inv) {
-        auto it = m_call_table.find (func_key);
-        if (it != m_call_table.end ()) {
+      shard& get_shard (std::size_t func_key) {
+        return m_shards [func_key % num_shards];
+      }
+
+      const shard& get_shard (std::size_t func_key) const {
+        return m_shards [func_key % num_shards];
+      }
+
+      // Add inv to ctxs keeping up to max_ctxs calling contexts. A
+      // context included in one already stored is not added, so the
+      // callee is analyzed once for both, and contexts included in
+      // the new one are removed. The latter happens with the
+      // intermediate contexts of call sites inside loops. Once the
+      // bound is reached the remaining contexts are merged using
+      // abstract domain's join into the last one. With max_ctxs = 1
+      // the analysis is context-insensitive.
+      static void add_ctx (std::vector<AbsDomain> &ctxs, AbsDomain inv,
+                           unsigned max_ctxs) {
+        if (max_ctxs > 1) {
+          for (auto &ctx: ctxs) {
+            if (inv <= ctx) {
+              crab::CrabStats::count ("Inter.count.ctx_reused");
+              return;
+            }
+          }
+          ctxs.erase (std::remove_if (ctxs.begin (), ctxs.end (), 
+                                      [&inv] (AbsDomain &ctx) { return ctx <= inv; }),
+                      ctxs.end ());
+        }
+        if (ctxs.size () < max_ctxs)
+          ctxs.push_back (inv);
+        else {
           crab::CrabStats::count ("Domain.count.join");
           crab::ScopedCrabStats __st__("Domain.join");
-          it->second = it->second | inv;
+          ctxs.back () = ctxs.back () | inv;
         }
-        else
-          m_call_table.insert (make_pair (func_key, inv));
+      }
+
+      void insert_helper (std::size_t func_key, AbsDomain inv) {
+        shard& sh = get_shard (func_key);
+        std::lock_guard<std::mutex> lock (sh.m_mutex);
+        add_ctx (sh.m_call_table [func_key], inv, m_max_ctxs);
       }
 
      public:
       
-      CallCtxTable () { }
+      CallCtxTable (): m_max_ctxs (1) { }
+
+      //! Must be called before any context is inserted
+      void set_max_contexts (unsigned max_ctxs) {
+        m_max_ctxs = std::max (max_ctxs, 1U);
+      }
+
+      unsigned get_max_contexts () const {
+        return m_max_ctxs;
+      }
 
       void insert (callsite_t cs, AbsDomain inv) {
         insert_helper (CfgHasher<CFG>::hash (cs), inv);
@@ -55,12 +117,57 @@ namespace crab {
         insert_helper (CfgHasher<CFG>::hash (d), inv);
       }
 
+      //! Add the contexts found in callee_ctxs by the analysis of
+      //! caller with its ctx_id-th calling context. The contexts of
+      //! the callers are merged in a fixed order when they are read,
+      //! so the result does not depend on the order in which the
+      //! callers were analyzed.
+      void insert (fdecl_t caller, unsigned ctx_id, 
+                   const CallCtxTable &callee_ctxs) {
+        caller_key_t key (CfgHasher<CFG>::hash (caller), ctx_id);
+        for (auto const &callee_sh: callee_ctxs.m_shards) {
+          std::lock_guard<std::mutex> callee_lock (callee_sh.m_mutex);
+          for (auto const &kv: callee_sh.m_call_table) {
+            shard& sh = get_shard (kv.first);
+            std::lock_guard<std::mutex> lock (sh.m_mutex);
+            std::vector<AbsDomain> &ctxs = sh.m_caller_table [kv.first][key];
+            ctxs.insert (ctxs.end (), kv.second.begin (), kv.second.end ());
+          }
+        }
+      }
+
+      //! Return the distinct calling contexts of d
+      std::vector<AbsDomain> get_call_ctxs (fdecl_t d) const {
+        std::size_t func_key = CfgHasher<CFG>::hash (d);
+        const shard& sh = get_shard (func_key);
+        std::lock_guard<std::mutex> lock (sh.m_mutex);
+        std::vector<AbsDomain> res;
+        auto it = sh.m_caller_table.find (func_key);
+        if (it != sh.m_caller_table.end ()) {
+          for (auto const &kv: it->second)
+            for (auto const &ctx: kv.second)
+              add_ctx (res, ctx, m_max_ctxs);
+        }
+        auto it2 = sh.m_call_table.find (func_key);
+        if (it2 != sh.m_call_table.end ()) {
+          for (auto const &ctx: it2->second)
+            add_ctx (res, ctx, m_max_ctxs);
+        }
+        if (res.empty ())
+          res.push_back (AbsDomain::top ());
+        return res;
+      }
+
+      //! Return the join of all calling contexts of d
       AbsDomain get_call_ctx (fdecl_t d) const {
-        auto it = m_call_table.find (CfgHasher<CFG>::hash (d));
-        if (it != m_call_table.end ())
-          return it->second;
-        else 
-          return AbsDomain::top ();
+        std::vector<AbsDomain> ctxs = get_call_ctxs (d);
+        AbsDomain res = ctxs [0];
+        for (unsigned i = 1; i < ctxs.size (); i++) {
+          crab::CrabStats::count ("Domain.count.join");
+          crab::ScopedCrabStats __st__("Domain.join");
+          res = res | ctxs [i];
+        }
+        return res;
       }
 
     };
@@ -127,6 +234,9 @@ namespace crab {
       typedef boost::unordered_map <std::size_t, summary_ptr> summary_table_t;
       
       summary_table_t m_sum_table;
+      // the bottom-up phase can insert and look up summaries from
+      // several threads
+      mutable std::mutex m_mutex;
       
      public:
 
@@ -140,22 +250,26 @@ namespace crab {
 
         std::vector<varname_t> ps (params.begin(), params.end ());
         summary_ptr sum_tuple (new Summary (d, sum, ret, ps));
+        std::lock_guard<std::mutex> lock (m_mutex);
         m_sum_table.insert (std::make_pair (CfgHasher<CFG>::hash (d), sum_tuple));
       }
 
       // return true if there is a summary
       bool hasSummary (callsite_t cs) const {
+        std::lock_guard<std::mutex> lock (m_mutex);
         auto it = m_sum_table.find (CfgHasher<CFG>::hash (cs));
         return (it != m_sum_table.end ());
       }
 
       bool hasSummary (fdecl_t d) const {
+        std::lock_guard<std::mutex> lock (m_mutex);
         auto it = m_sum_table.find (CfgHasher<CFG>::hash (d));
         return (it != m_sum_table.end ());
       }
 
       // get the summary
       Summary& get (callsite_t cs) const {
+        std::lock_guard<std::mutex> lock (m_mutex);
         auto it = m_sum_table.find (CfgHasher<CFG>::hash (cs));
         assert (it != m_sum_table.end ());
         
@@ -163,6 +277,7 @@ namespace crab {
       }
 
       Summary& get (fdecl_t d) const {
+        std::lock_guard<std::mutex> lock (m_mutex);
         auto it = m_sum_table.find (CfgHasher<CFG>::hash (d));
         assert (it != m_sum_table.end ());
         
@@ -170,6 +285,7 @@ namespace crab {
       }
 
       void write (std::ostream&o) const {
+        std::lock_guard<std::mutex> lock (m_mutex);
         o << "--- Begin summary table: \n";
         for (auto const &p: m_sum_table) {
           p.second->write (o);
@@ -21,6 +21,16 @@
 #include <crab/analysis/FwdAnalyzer.hpp>
 #include <crab/analysis/Liveness.hpp>
 #include <crab/analysis/InterDS.hpp>
+#include <crab/analysis/SummaryDB.hpp>
+
+#include <condition_variable>
+#include <algorithm>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <typeinfo>
 
 namespace crab {
 
@@ -56,6 +66,7 @@ namespace crab {
 
       typedef BottomUpSummNumAbsTransformer<summ_tbl_t, call_tbl_t> bu_abs_tr;
       typedef TopDownSummNumAbsTransformer<summ_tbl_t, call_tbl_t> td_abs_tr;
+      typedef SummaryDB<cfg_t, BU_Dom> summ_db_t;
       typedef boost::shared_ptr<td_abs_tr> td_abs_tr_ptr;
       typedef FwdAnalyzer <cfg_t, bu_abs_tr, VarFactory> bu_analyzer;
       typedef FwdAnalyzer <cfg_t, td_abs_tr, VarFactory> td_analyzer;
@@ -66,10 +77,15 @@ namespace crab {
       typedef TD_Dom abs_dom_t;
       typedef td_abs_tr_ptr abs_tr_ptr;
 
+      // called with each cfg as soon as its top-down analysis is done
+      typedef std::function<void (cfg_t)> fun_callback_t;
+
      private:
 
       typedef boost::shared_ptr <td_analyzer> td_analyzer_ptr;
-      typedef boost::unordered_map <std::size_t, td_analyzer_ptr> invariant_map_t;
+      // one analysis per calling context of the function
+      typedef std::vector <td_analyzer_ptr> td_analyzers_t;
+      typedef boost::unordered_map <std::size_t, td_analyzers_t> invariant_map_t;
 
       CG m_cg;
       VarFactory&  m_vfac;
@@ -80,6 +96,14 @@ namespace crab {
       unsigned int m_widening_delay;
       unsigned int m_descending_iters;
       size_t m_jump_set_size; // max size of the jump set (=0 if jump set disabled)
+      unsigned m_num_threads; // threads used by both phases
+      mutable std::mutex m_inv_map_mutex;
+      std::vector<fun_callback_t> m_callbacks;
+      std::mutex m_callbacks_mutex;
+      bool m_streaming; // drop the invariants after the callbacks run
+      summ_db_t* m_summ_db; // on-disk summaries (=nullptr if disabled)
+      // database key of each function, indexed by CfgHasher
+      boost::unordered_map<std::size_t, typename summ_db_t::key_t> m_summ_keys;
       
       const liveness_t* get_live (const cfg_t& c) {
         if (m_live) {
@@ -90,16 +114,353 @@ namespace crab {
         return nullptr;
       }
       
+      //! Compute the database key of each function that is
+      //  summarized. The key of an SCC combines the analysis
+      //  parameters, the contents of its members and the keys of the
+      //  SCCs it calls, so it changes whenever any of them does.
+      //  The domain is identified by its type: domains with the same
+      //  name but different parameters (e.g. the Params of SplitDBM)
+      //  do not share summaries.
+      void compute_summary_keys (SccGraph <CG> &Scc_g, 
+                                 const std::vector<cg_node_t> &rev_order) {
+        typedef typename summ_db_t::key_t key_t;
+        std::ostringstream params;
+        params << BU_Dom::getDomainName () << " " << typeid (BU_Dom).name () << " "
+               << m_widening_delay << " " 
+               << m_descending_iters << " " << m_jump_set_size;
+        key_t params_key = summ_db_t::hash (params.str ());
+
+        boost::unordered_map<cg_node_t, key_t> scc_keys;
+        for (auto n: rev_order) {
+          vector<cg_node_t> &scc_mems = Scc_g.getComponentMembers (n);
+          std::vector<key_t> cfg_keys;
+          key_t k = params_key;
+          for (auto m: scc_mems) {
+            cfg_keys.push_back (summ_db_t::hash_cfg (m.getCfg ()));
+            k = summ_db_t::hash_combine (k, cfg_keys.back ());
+          }
+          // callees are visited before their callers
+          std::vector<key_t> callee_keys;
+          for (auto e: boost::make_iterator_range (Scc_g.succs (n)))
+            callee_keys.push_back (scc_keys [e.Dest ()]);
+          std::sort (callee_keys.begin (), callee_keys.end ());
+          for (auto ck: callee_keys)
+            k = summ_db_t::hash_combine (k, ck);
+          scc_keys [n] = k;
+
+          for (unsigned i = 0; i < scc_mems.size (); i++) {
+            auto fdecl = scc_mems [i].getCfg ().get_func_decl ();
+            assert (fdecl);
+            m_summ_keys [CfgHasher<cfg_t>::hash (*fdecl)] = 
+                summ_db_t::hash_combine (k, cfg_keys [i]);
+          }
+        }
+      }
+
+      //! Compute the summary of cfg and store it in m_summ_tbl.
+      //  Only reads the summaries of its callees.
+      void summarize (cfg_t cfg) {
+        auto fdecl = cfg.get_func_decl ();            
+        assert (fdecl);
+
+        std::string fun_name = (*fdecl).get_func_name ().str();
+        if (fun_name != "main" && cfg.has_exit ()) {
+          // --- the formal parameters and return of the summary
+          std::vector<varname_t> formals;
+          formals.reserve ((*fdecl).get_num_params());
+          for (unsigned i=0; i < (*fdecl).get_num_params();i++)
+            formals.push_back ((*fdecl).get_param_name (i));
+          auto ret_val_opt = findReturnVar (cfg);
+          if (ret_val_opt) 
+            formals.push_back (*ret_val_opt);
+
+          // --- reuse the summary from a previous run if any
+          typename summ_db_t::key_t key = 0;
+          auto key_it = m_summ_keys.find (CfgHasher<cfg_t>::hash (*fdecl));
+          if (m_summ_db && key_it != m_summ_keys.end ()) {
+            key = key_it->second;
+            BU_Dom inv = BU_Dom::top ();
+            if (m_summ_db->load (key, formals, inv)) {
+              CRAB_LOG ("inter", 
+                        crab::outs() << "--- Loaded summary of " 
+                                     << (*fdecl).get_func_name () << "\n");
+              if (ret_val_opt) 
+                formals.pop_back ();
+              m_summ_tbl.insert (*fdecl, inv, ret_val_opt, formals);
+              return;
+            }
+          }
+
+          CRAB_LOG ("inter", 
+                    crab::outs() << "--- Analyzing " << (*fdecl).get_func_name () << "\n");
+          // --- run the analysis
+          bu_analyzer a (cfg, m_vfac, get_live (cfg), 
+                         &m_summ_tbl, &m_call_tbl,
+                         m_widening_delay, m_descending_iters,
+                         m_jump_set_size) ; 
+          a.Run (BU_Dom::top ());
+          // --- project onto formal parameters and return 
+          auto inv = a.get_post (cfg.exit ());
+          crab::CrabStats::count ("Domain.count.project");
+          domains::domain_traits<BU_Dom>::project (inv,
+                                                   formals.begin (), 
+                                                   formals.end ());            
+          if (m_summ_db && key_it != m_summ_keys.end ())
+            m_summ_db->store (key, formals, inv);
+          if (ret_val_opt) 
+            formals.pop_back ();
+          m_summ_tbl.insert (*fdecl, inv, ret_val_opt, formals);
+        }
+      }
+
+      //! Analyze cfg with the calling contexts in m_call_tbl, or
+      //  with init if it is the root of the call graph, and store its
+      //  invariants in m_inv_map. cfg is analyzed once per distinct
+      //  context in m_call_tbl so its callees get as many contexts.
+      //  Each analysis collects the contexts of the callees in its
+      //  own table, which is added to m_call_tbl and released once it
+      //  is done. The analyzer kept in m_inv_map then records the
+      //  contexts of its transformers in m_call_tbl, as
+      //  get_abs_transformer does.
+      void analyze_top_down (cfg_t cfg, bool is_recursive, bool is_root, 
+                             TD_Dom init) {
+        auto fdecl = cfg.get_func_decl ();
+        assert (fdecl);
+        CRAB_LOG ("inter", 
+                  crab::outs() << "--- Analyzing " 
+                               << (*fdecl).get_func_name () << "\n");
+        if (is_recursive) {
+          // If the node is recursive then what we have in m_call_tbl
+          // is incomplete and therefore it is unsound to use it. To
+          // remedy it, we insert another calling context with top
+          // value that approximates all the possible calling
+          // contexts during the recursive calls.
+          m_call_tbl.insert (*fdecl, TD_Dom::top ());
+        }
+        
+        std::vector<TD_Dom> ctxs;
+        if (is_root) 
+          ctxs.push_back (init);
+        else
+          ctxs = m_call_tbl.get_call_ctxs (*fdecl);
+
+        td_analyzers_t as;
+        for (unsigned i = 0; i < ctxs.size (); i++) {
+          CRAB_LOG("inter",
+                   crab::outs() << "Starting analysis of "
+                                << *fdecl <<  " with "
+                                << ctxs [i] << "\n");
+          call_tbl_t calls;
+          calls.set_max_contexts (m_call_tbl.get_max_contexts ());
+          auto a = boost::make_shared<td_analyzer> (cfg, m_vfac, get_live (cfg), 
+                                                    &m_summ_tbl, &calls,
+                                                    m_widening_delay,
+                                                    m_descending_iters);           
+          a->Run (ctxs [i]);
+          m_call_tbl.insert (*fdecl, i, calls);
+          a->set_call_table (&m_call_tbl);
+          as.push_back (a);
+        }
+        crab::CrabStats::count_max ("Inter.max_contexts", as.size ());
+        publish (cfg, as);
+      }
+
+      //! Make the invariants of cfg computed by a available to
+      //  get_pre/get_post and run the callbacks on cfg. In streaming
+      //  mode the invariants are released afterwards so only the
+      //  functions being analyzed are kept in memory.
+      void publish (cfg_t cfg, td_analyzers_t as) {
+        auto fdecl = cfg.get_func_decl ();
+        assert (fdecl);
+        std::size_t k = CfgHasher<cfg_t>::hash(*fdecl);
+        {
+          std::lock_guard<std::mutex> lock (m_inv_map_mutex);
+          m_inv_map.insert (make_pair (k, as));
+        }
+        if (!m_callbacks.empty ()) {
+          // callbacks are not required to be thread-safe
+          std::lock_guard<std::mutex> lock (m_callbacks_mutex);
+          for (auto &f: m_callbacks) 
+            f (cfg);
+        }
+        if (m_streaming) {
+          std::lock_guard<std::mutex> lock (m_inv_map_mutex);
+          m_inv_map.erase (k);
+        }
+      }
+
+      //! Join the invariants at the entry (if pre) or exit of b over
+      //  all the calling contexts
+      static TD_Dom join_contexts (const td_analyzers_t &as, 
+                                   typename cfg_t::basic_block_label_t b,
+                                   bool pre) {
+        if (as.empty ())
+          return TD_Dom::top ();
+        auto const &a0 = as [0];
+        TD_Dom inv = pre ? a0->get_pre (b) : a0->get_post (b);
+        for (unsigned i = 1; i < as.size (); i++) {
+          auto const &a = as [i];
+          crab::CrabStats::count ("Domain.count.join");
+          crab::ScopedCrabStats __st__("Domain.join");
+          inv = inv | (pre ? a->get_pre (b) : a->get_post (b));
+        }
+        return inv;
+      }
+
+      //! Return the analyses of cfg, one per calling context
+      td_analyzers_t get_analyses (const cfg_t &cfg) const {
+        if (auto fdecl = cfg.get_func_decl ()) {
+          std::lock_guard<std::mutex> lock (m_inv_map_mutex);
+          auto const it = m_inv_map.find (CfgHasher<cfg_t>::hash(*fdecl));
+          if (it != m_inv_map.end ())
+            return it->second;
+        }
+        return td_analyzers_t ();
+      }
+
+      //! Process the SCCs of the call graph on m_num_threads
+      //  threads. In bottom-up mode an SCC is scheduled as soon as all
+      //  the SCCs it calls are done, and in top-down mode as soon as
+      //  all the SCCs that call it are done. f is called with the
+      //  representative and the members of each SCC.
+      //
+      //  The summaries and calling contexts computed by one worker
+      //  are read by the others, so BU_Dom and TD_Dom must not share
+      //  mutable state between values (see the constructor).
+      template<typename F>
+      void parallel_scc_walk (SccGraph <CG> &Scc_g, 
+                              const std::vector<cg_node_t> &rev_order,
+                              bool bottom_up, F f) {
+        // -- number the SCCs, in the order they are processed
+        //    sequentially, and count how many SCCs each of them waits
+        //    for. The SCC graph is not accessed by the workers.
+        std::vector<cg_node_t> order (rev_order);
+        if (!bottom_up)
+          std::reverse (order.begin (), order.end ());
+        std::size_t num_sccs = order.size ();
+        boost::unordered_map<cg_node_t, std::size_t> scc_ids;
+        for (std::size_t i = 0; i < num_sccs; i++)
+          scc_ids.insert (make_pair (order [i], i));
+        std::vector<std::vector<cg_node_t> > members (num_sccs);
+        std::vector<std::vector<std::size_t> > waiting (num_sccs);
+        std::vector<std::size_t> pending (num_sccs, 0);
+        std::deque<std::size_t> ready;
+        for (std::size_t i = 0; i < num_sccs; i++) {
+          members [i] = Scc_g.getComponentMembers (order [i]);
+          // edges go from callers to callees
+          for (auto e: boost::make_iterator_range (Scc_g.succs (order [i]))) {
+            std::size_t j = scc_ids [e.Dest ()];
+            if (bottom_up) {
+              waiting [j].push_back (i);
+              pending [i]++;
+            } else {
+              waiting [i].push_back (j);
+              pending [j]++;
+            }
+          }
+        }
+        for (std::size_t i = 0; i < num_sccs; i++) {
+          if (pending [i] == 0)
+            ready.push_back (i);
+        }
+
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::size_t done = 0;
+        auto worker = [&] () {
+          std::unique_lock<std::mutex> lock (mutex);
+          while (true) {
+            cv.wait (lock, [&] () { return !ready.empty () || done == num_sccs; });
+            if (ready.empty ()) break;
+            std::size_t i = ready.front ();
+            ready.pop_front ();
+            lock.unlock ();
+            {
+              // the time of the workers only (Inter.* also counts
+              // the time of the thread that waits for them)
+              crab::ScopedThreadCrabStats __st__(bottom_up ? "Inter.BottomUp.workers" : 
+                                                             "Inter.TopDown.workers");
+              f (order [i], members [i]);
+            }
+            lock.lock ();
+            ++done;
+            for (auto c: waiting [i]) {
+              if (--pending [c] == 0)
+                ready.push_back (c);
+            }
+            cv.notify_all ();
+          }
+        };
+
+        std::size_t n = std::min<std::size_t> (m_num_threads, num_sccs);
+        std::vector<std::thread> threads;
+        for (std::size_t t = 1; t < n; t++)
+          threads.push_back (std::thread (worker));
+        worker ();
+        for (auto &t : threads) t.join ();
+      }
+      
      public:
       
+      // If num_threads > 1 then independent SCCs of the call graph are
+      // analyzed concurrently in both phases. Only domains whose
+      // values can be copied and read from several threads can be
+      // used then: intervals, disjunctive intervals, the DBM domains,
+      // the term domains, nullity, the array graph, and array
+      // smashing or reduced products of them. Several of these share
+      // their representation between copies and update it in place
+      // once a copy finds itself its only owner (unique ()). That is
+      // safe: the values the threads exchange are copied under the
+      // analyzer's locks, so each copy is used by one thread at a
+      // time, and boost::shared_ptr reads the count with acquire and
+      // drops references with acq_rel, so an owner that finds itself
+      // unique sees every access made through the copies that were
+      // released. Boxes cannot be used: a value of another thread is
+      // imported by reading the ldd manager of its context, which
+      // that thread may be updating. Neither can the Apron domains,
+      // which share one manager.
       InterFwdAnalyzer (CG cg, VarFactory& vfac, const liveness_map_t* live,
                         unsigned int widening_delay=1,
                         unsigned int descending_iters=UINT_MAX,
-                        size_t jump_set_size=0): 
+                        size_t jump_set_size=0,
+                        unsigned num_threads=1): 
           m_cg (cg), m_vfac (vfac), m_live (live),
           m_widening_delay (widening_delay), 
           m_descending_iters (descending_iters),
-          m_jump_set_size (jump_set_size) { }
+          m_jump_set_size (jump_set_size),
+          m_num_threads (num_threads),
+          m_streaming (false),
+          m_summ_db (nullptr) { }
+
+      //! Load the summaries that are already in db instead of
+      //! computing them, and store there the ones that are computed.
+      void set_summary_db (summ_db_t* db) {
+        m_summ_db = db;
+      }
+
+      //! Analyze each function once per distinct calling context, up
+      //! to max_ctxs contexts; the rest are joined. The default (=1)
+      //! is context-insensitive. The contexts do not depend on the
+      //! number of threads. get_pre and get_post return the join over
+      //! all contexts unless a context is given.
+      void set_max_contexts (unsigned max_ctxs) {
+        m_call_tbl.set_max_contexts (max_ctxs);
+      }
+
+      //! Call f with each cfg once its top-down analysis is
+      //! done. get_pre and get_post can be used from f.
+      void add_callback (fun_callback_t f) {
+        m_callbacks.push_back (f);
+      }
+
+      //! If streaming then the invariants of each function are
+      //! released after the callbacks run on it, and get_pre/get_post
+      //! return top once Run finishes. Peak memory is then bounded by
+      //! the functions analyzed at the same time rather than by the
+      //! whole program.
+      void set_streaming (bool streaming) {
+        m_streaming = streaming;
+      }
       
       //! Trigger the whole analysis
       void Run (TD_Dom init = TD_Dom::top ())  {
@@ -135,7 +496,7 @@ namespace crab {
                                                       m_descending_iters,
                                                       m_jump_set_size);           
             a->Run (init);
-            m_inv_map.insert (make_pair (CfgHasher<cfg_t>::hash(*fdecl), a));
+            publish (cfg, td_analyzers_t (1, a));
           }
           return;
         }
@@ -146,86 +507,50 @@ namespace crab {
         rev_topo_sort < SccGraph <CG> > (Scc_g, rev_order);
        
         CRAB_LOG("inter",crab::outs() << "Bottom-up phase ...\n");
-        for (auto n: rev_order) {
+        if (m_summ_db)
+          compute_summary_keys (Scc_g, rev_order);
+        if (m_num_threads > 1) {
           crab::ScopedCrabStats __st__("Inter.BottomUp");
-          vector<cg_node_t> &scc_mems = Scc_g.getComponentMembers (n);
-          for (auto m: scc_mems) {
-
-            auto cfg = m.getCfg ();
-            auto fdecl = cfg.get_func_decl ();            
-            assert (fdecl);
-
-            std::string fun_name = (*fdecl).get_func_name ().str();
-            if (fun_name != "main" && cfg.has_exit ()) {
-              CRAB_LOG ("inter", 
-                        crab::outs() << "--- Analyzing " << (*fdecl).get_func_name () << "\n");
-              // --- run the analysis
-              bu_analyzer a (cfg, m_vfac, get_live (cfg), 
-                             &m_summ_tbl, &m_call_tbl,
-                             m_widening_delay, m_descending_iters,
-                             m_jump_set_size) ; 
-              a.Run (BU_Dom::top ());
-              // --- build the summary
-              std::vector<varname_t> formals;
-              formals.reserve ((*fdecl).get_num_params());
-              for (unsigned i=0; i < (*fdecl).get_num_params();i++)
-                formals.push_back ((*fdecl).get_param_name (i));
-              auto ret_val_opt = findReturnVar (cfg);
-              if (ret_val_opt) 
-                formals.push_back (*ret_val_opt);
-              // --- project onto formal parameters and return 
-              auto inv = a.get_post (cfg.exit ());
-              crab::CrabStats::count ("Domain.count.project");
-              domains::domain_traits<BU_Dom>::project (inv,
-                                                       formals.begin (), 
-                                                       formals.end ());            
-              if (ret_val_opt) 
-                formals.pop_back ();
-              m_summ_tbl.insert (*fdecl, inv, ret_val_opt, formals);
-            }
-          }
-        } 
+          parallel_scc_walk (Scc_g, rev_order, true /*bottom-up*/,
+                             [this] (cg_node_t, vector<cg_node_t> &scc_mems) {
+                               for (auto m: scc_mems) 
+                                 summarize (m.getCfg ());
+                             });
+        }
+        else {
+          for (auto n: rev_order) {
+            crab::ScopedCrabStats __st__("Inter.BottomUp");
+            vector<cg_node_t> &scc_mems = Scc_g.getComponentMembers (n);
+            for (auto m: scc_mems) 
+              summarize (m.getCfg ());
+          } 
+        }
 
         CRAB_LOG ("inter", crab::outs() << "Top-down phase ...\n");
-        bool is_root = true;
-        for (auto n: boost::make_iterator_range (rev_order.rbegin(),
-                                                 rev_order.rend ())) {
+        if (m_num_threads > 1) {
           crab::ScopedCrabStats __st__("Inter.TopDown");
-          vector<cg_node_t> &scc_mems = Scc_g.getComponentMembers (n);
-          for (auto m: scc_mems) {
-            auto cfg = m.getCfg ();
-            auto fdecl = cfg.get_func_decl ();
-            assert (fdecl);
-            CRAB_LOG ("inter", 
-                      crab::outs() << "--- Analyzing " 
-                                << (*fdecl).get_func_name () << "\n");
-            if (scc_mems.size () > 1) {
-              // If the node is recursive then what we have in m_call_tbl
-              // is incomplete and therefore it is unsound to use it. To
-              // remedy it, we insert another calling context with top
-              // value that approximates all the possible calling
-              // contexts during the recursive calls.
-              m_call_tbl.insert (*fdecl, TD_Dom::top ());
-            }
-            
-            auto a = boost::make_shared<td_analyzer> (cfg, m_vfac, get_live (cfg), 
-                                                      &m_summ_tbl, &m_call_tbl,
-                                                      m_widening_delay,
-                                                      m_descending_iters);           
-            if (is_root) {
-              a->Run (init);
+          // the first SCC in topological order starts from init
+          cg_node_t root = rev_order.back ();
+          parallel_scc_walk (Scc_g, rev_order, false /*top-down*/,
+                             [&] (cg_node_t n, vector<cg_node_t> &scc_mems) {
+                               bool is_root = (n == root);
+                               for (auto m: scc_mems) {
+                                 analyze_top_down (m.getCfg (), scc_mems.size () > 1,
+                                                   is_root, init);
+                                 is_root = false;
+                               }
+                             });
+        }
+        else {
+          bool is_root = true;
+          for (auto n: boost::make_iterator_range (rev_order.rbegin(),
+                                                   rev_order.rend ())) {
+            crab::ScopedCrabStats __st__("Inter.TopDown");
+            vector<cg_node_t> &scc_mems = Scc_g.getComponentMembers (n);
+            for (auto m: scc_mems) {
+              analyze_top_down (m.getCfg (), scc_mems.size () > 1, is_root, init);
               is_root = false;
             }
-            else {
-              CRAB_LOG("inter",
-                       auto init_ctx = m_call_tbl.get_call_ctx (*fdecl);
-                       crab::outs() << "Starting analysis of "
-                                    << *fdecl <<  " with "
-                                    << init_ctx << "\n");
-              a->Run (m_call_tbl.get_call_ctx (*fdecl));
-            }
-            
-            m_inv_map.insert (make_pair (CfgHasher<cfg_t>::hash(*fdecl), a));
           }
         }
       }
@@ -238,27 +563,42 @@ namespace crab {
       //! Return the invariants that hold at the entry of b in cfg
       TD_Dom get_pre (const cfg_t &cfg, 
                       typename cfg_t::basic_block_label_t b) const { 
+        return join_contexts (get_analyses (cfg), b, true /*pre*/);
+      }
+      
+      //! Return the invariants that hold at the exit of b in cfg
+      TD_Dom get_post (const cfg_t &cfg, 
+                       typename cfg_t::basic_block_label_t b) const {
+        return join_contexts (get_analyses (cfg), b, false /*post*/);
+      }
 
-        if (auto fdecl = cfg.get_func_decl ()) {
-          auto const it = m_inv_map.find (CfgHasher<cfg_t>::hash(*fdecl));
-          if (it != m_inv_map.end ())
-            return it->second->get_pre (b);
-        }
+      //! Return the invariants that hold at the entry of b in cfg
+      //! when called with its ctx-th calling context
+      TD_Dom get_pre (const cfg_t &cfg, 
+                      typename cfg_t::basic_block_label_t b,
+                      std::size_t ctx) const { 
+        td_analyzers_t as = get_analyses (cfg);
+        if (ctx < as.size ())
+          return as [ctx]->get_pre (b);
         return TD_Dom::top ();
       }
       
       //! Return the invariants that hold at the exit of b in cfg
+      //! when called with its ctx-th calling context
       TD_Dom get_post (const cfg_t &cfg, 
-                       typename cfg_t::basic_block_label_t b) const {
-        
-        if (auto fdecl = cfg.get_func_decl ()) {
-          auto const it = m_inv_map.find (CfgHasher<cfg_t>::hash(*fdecl));
-          if (it != m_inv_map.end ())
-            return it->second->get_post (b);
-        }
+                       typename cfg_t::basic_block_label_t b,
+                       std::size_t ctx) const {
+        td_analyzers_t as = get_analyses (cfg);
+        if (ctx < as.size ())
+          return as [ctx]->get_post (b);
         return TD_Dom::top ();
       }
 
+      //! Return the number of calling contexts cfg was analyzed with
+      std::size_t get_num_contexts (const cfg_t &cfg) const {
+        return get_analyses (cfg).size ();
+      }
+
       //! Propagate inv through statements
       td_abs_tr_ptr get_abs_transformer (TD_Dom &inv) {
         // pass inv by ref to avoid copies
@@ -11,6 +11,11 @@
 #include <crab/analysis/graphs/TopoOrder.hpp>
 
 #include <boost/noncopyable.hpp>
+#include <boost/dynamic_bitset.hpp>
+#include <boost/unordered_set.hpp>
+#include <functional>
+#include <queue>
+#include <stdint.h>
 
 namespace crab {
 
@@ -347,6 +352,11 @@ namespace crab {
    #endif 
 
    //! Live variable analysis
+   //
+   //  Variables and blocks are numbered densely so that live sets and
+   //  per-block kill/gen sets are bit-vectors. The fixpoint uses a
+   //  worklist of blocks ordered by post-order number, so that a
+   //  block is processed after its successors whenever possible.
    template<typename CFG>
    class Liveness: boost::noncopyable {
 
@@ -359,17 +369,25 @@ namespace crab {
     private:
      typedef boost::shared_ptr <set_t> set_ptr;
      typedef boost::unordered_map< basic_block_label_t, set_ptr > liveness_map_t;
-     typedef std::pair< liveness_domain_t, liveness_domain_t >   kill_gen_t;
-     typedef boost::unordered_map< basic_block_label_t, kill_gen_t>  kill_gen_map_t;
      typedef typename liveness_map_t::value_type l_binding_t;
-     typedef typename kill_gen_map_t::value_type kg_binding_t;
+     typedef boost::dynamic_bitset<uint64_t> bitset_t;
 
      CFG m_cfg;
-     boost::unordered_map< basic_block_label_t, set_t> m_in_map;
-     boost::unordered_map< basic_block_label_t, set_t> m_out_map;
+
+     // dense numbering of variables
+     std::vector<varname_t> m_vars;
+     boost::unordered_map< varname_t, unsigned> m_var_ids;
+     // dense numbering of blocks in post-order
+     std::vector<basic_block_label_t> m_blocks;
+     boost::unordered_map< basic_block_label_t, unsigned> m_block_ids;
+     std::vector<std::vector<unsigned> > m_preds;
+     std::vector<std::vector<unsigned> > m_succs;
 
      // for internal use
-     kill_gen_map_t m_kill_gen_map;
+     std::vector<bitset_t> m_kill;
+     std::vector<bitset_t> m_gen;
+     std::vector<bitset_t> m_in;
+     std::vector<bitset_t> m_out;
      // for external queries
      liveness_map_t m_dead_map;
 
@@ -383,28 +401,101 @@ namespace crab {
 
     private:
 
+     unsigned get_var_id (const varname_t& v) {
+       auto it = m_var_ids.find (v);
+       if (it != m_var_ids.end ()) return it->second;
+       unsigned id = m_vars.size ();
+       m_var_ids.insert (std::make_pair (v, id));
+       m_vars.push_back (v);
+       return id;
+     }
+
+     // number the blocks in post-order of a depth-first search from
+     // the entry, followed by the blocks not reachable from it.
+     void number_blocks () {
+       boost::unordered_set<basic_block_label_t> visited;
+       std::vector<std::pair<basic_block_label_t, unsigned> > stack;
+       auto dfs = [&] (basic_block_label_t root) {
+         if (!visited.insert (root).second) return;
+         stack.push_back (std::make_pair (root, 0));
+         while (!stack.empty ()) {
+           basic_block_label_t b = stack.back ().first;
+           auto succs = m_cfg.next_nodes (b);
+           auto it = succs.begin ();
+           std::advance (it, stack.back ().second);
+           if (it == succs.end ()) {
+             stack.pop_back ();
+             m_block_ids.insert (std::make_pair (b, m_blocks.size ()));
+             m_blocks.push_back (b);
+           } else {
+             stack.back ().second++;
+             if (visited.insert (*it).second)
+               stack.push_back (std::make_pair (*it, 0));
+           }
+         }
+       };
+       dfs (m_cfg.entry ());
+       for (auto &b: boost::make_iterator_range(m_cfg.begin(),m_cfg.end()))
+         dfs (b.label ());
+
+       m_preds.resize (m_blocks.size ());
+       m_succs.resize (m_blocks.size ());
+       for (unsigned i = 0; i < m_blocks.size (); i++) {
+         for (auto s: m_cfg.next_nodes (m_blocks [i])) {
+           unsigned j = m_block_ids [s];
+           m_succs [i].push_back (j);
+           m_preds [j].push_back (i);
+         }
+       }
+     }
+
      // precompute use/def sets
      void init() {
+       number_blocks ();
+
+       // number all the variables first so that the bit-vectors have
+       // a fixed size
        for (auto &b: boost::make_iterator_range(m_cfg.begin(),m_cfg.end())) {
-         
-         liveness_domain_t kill, gen;
+         for (auto &s: b) {
+           auto live = s.getLive();
+           for (auto d: boost::make_iterator_range(live.defs_begin(), 
+                                                   live.defs_end()))
+             get_var_id (d);
+           for (auto u: boost::make_iterator_range(live.uses_begin(), 
+                                                   live.uses_end()))
+             get_var_id (u);
+         }
+       }
+
+       bitset_t empty (m_vars.size ());
+       m_kill.assign (m_blocks.size (), empty);
+       m_gen.assign (m_blocks.size (), empty);
+       for (unsigned i = 0; i < m_blocks.size (); i++) {
+         auto &b = m_cfg.get_node (m_blocks [i]);
+         bitset_t &kill = m_kill [i];
+         bitset_t &gen = m_gen [i];
          for (auto &s: boost::make_iterator_range(b.rbegin(),b.rend())) { 
-                                                   
            auto live = s.getLive();
            for (auto d: boost::make_iterator_range(live.defs_begin(), 
                                                    live.defs_end())) {
-             kill += d; 
-             gen -= d;
+             unsigned v = m_var_ids [d];
+             kill.set (v); 
+             gen.reset (v);
            }
            for (auto u: boost::make_iterator_range(live.uses_begin(), 
                                                    live.uses_end())) {
-             gen  += u; 
+             gen.set (m_var_ids [u]); 
            }
          }
-         m_kill_gen_map.insert ( kg_binding_t (b.label (), 
-                                               kill_gen_t (kill, gen)));
        }
      }
+
+     set_t to_set (const bitset_t& bits) const {
+       set_t res;
+       for (auto v = bits.find_first (); v != bitset_t::npos; v = bits.find_next (v))
+         res += m_vars [v];
+       return res;
+     }
      
     public:
 
@@ -423,46 +514,53 @@ namespace crab {
          return;
        }
 
-       std::vector<typename CFG::node_t> rev_sccg_order;
-       crab::analyzer::graph_algo::SccGraph <CFG> Scc_g (m_cfg);
-       crab::analyzer::graph_algo::rev_topo_sort (Scc_g, rev_sccg_order);
-
-       std::vector<typename CFG::node_t> order;
-       for (auto &n : rev_sccg_order) {
-         auto &members = Scc_g.getComponentMembers (n);
-         order.insert (order.end (), members.begin (), members.end ());
-       }
-
-       assert (order.size () == std::distance(m_cfg.begin(), m_cfg.end()));
+       assert (m_blocks.size () == std::distance(m_cfg.begin(), m_cfg.end()));
 
        CRAB_LOG("liveness", 
                 crab::outs()  << "\tFixpoint ordering of the CFG {"; 
-                for (auto &v : order)
+                for (auto &v : m_blocks)
                   crab::outs() << cfg_impl::get_label_str(v) << " -- "; 
                 crab::outs() << "}\n";); 
 
-       bool change = true;
+       bitset_t empty (m_vars.size ());
+       m_in.assign (m_blocks.size (), empty);
+       m_out.assign (m_blocks.size (), empty);
+
+       // the worklist pops the block with the smallest post-order
+       // number first
+       std::priority_queue<unsigned, std::vector<unsigned>, 
+                           std::greater<unsigned> > worklist;
+       std::vector<bool> queued (m_blocks.size (), true);
+       for (unsigned i = 0; i < m_blocks.size (); i++)
+         worklist.push (i);
+
        unsigned iterations = 0;
-       while (change) {
-         change = false;
+       bitset_t in (m_vars.size ());
+       while (!worklist.empty ()) {
+         unsigned n = worklist.top ();
+         worklist.pop ();
+         queued [n] = false;
          ++iterations;
-         for (auto &n : order) {
-           liveness_domain_t out = liveness_domain_t::bottom();
-           for (auto p: m_cfg.next_nodes (n))
-             out = out | m_in_map [p]; 
-           liveness_domain_t in = analyze (n, out);
-           liveness_domain_t old_in = m_in_map [n];
-           if (!(in <= old_in)) {
-             m_in_map [n] = in | old_in;
-             change = true;
+
+         bitset_t &out = m_out [n];
+         for (auto s: m_succs [n])
+           out |= m_in [s];
+         in = out;
+         in -= m_kill [n];
+         in |= m_gen [n];
+         if (in != m_in [n]) {
+           m_in [n].swap (in);
+           for (auto p: m_preds [n]) {
+             if (!queued [p]) {
+               queued [p] = true;
+               worklist.push (p);
+             }
            }
-           else
-             m_out_map [n] = out;
          }
        }
        
-       for (auto &n : order) {
-         process_post (n, m_out_map [n]);
+       for (unsigned i = 0; i < m_blocks.size (); i++) {
+         process_post (i);
        }
 
       CRAB_LOG("liveness", 
@@ -472,17 +570,20 @@ namespace crab {
        
       CRAB_LOG("liveness", 
                crab::outs() << "Liveness sets: \n";
-               for (auto n: boost::make_iterator_range (m_cfg.label_begin (),
-                                                        m_cfg.label_end ())) {
-                 crab::outs() << cfg_impl::get_label_str(n) << " "
-                              << "OUT=" << m_out_map [n]  << " "
-                              << "IN=" << m_in_map [n] << "\n";
+               for (unsigned i = 0; i < m_blocks.size (); i++) {
+                 set_t out = to_set (m_out [i]);
+                 set_t in = to_set (m_in [i]);
+                 crab::outs() << cfg_impl::get_label_str(m_blocks [i]) << " "
+                              << "OUT=" << out  << " "
+                              << "IN=" << in << "\n";
                }
                crab::outs() << "\n";);
        
        // --- Keep a small memory footprint in client analyses
-       m_in_map.clear ();
-       m_out_map.clear ();
+       std::vector<bitset_t> ().swap (m_in);
+       std::vector<bitset_t> ().swap (m_out);
+       std::vector<bitset_t> ().swap (m_kill);
+       std::vector<bitset_t> ().swap (m_gen);
      }
 
      //! return the set of dead variables at the exit of block bb
@@ -507,31 +608,24 @@ namespace crab {
      
     private:
 
-      
-     liveness_domain_t analyze (basic_block_label_t bb_id, 
-                                liveness_domain_t live_out) {
-       auto it = m_kill_gen_map.find (bb_id);
-       assert(it != m_kill_gen_map.end ());
-
-       // --- compute live_in
-       live_out -= it->second.first;
-       live_out += it->second.second;
-       return live_out;
-     }
-
-     void process_post (basic_block_label_t bb, 
-                        liveness_domain_t live_out) {
+     void process_post (unsigned n) {
 
        // --- Collect dead variables at the exit of bb
-       if (!live_out.is_bottom ()) {
-         auto dead_set = boost::make_shared<set_t>(m_cfg.get_node (bb).live ());
-         *dead_set -= live_out;
+       const bitset_t &live_out = m_out [n];
+       if (live_out.any ()) {
+         basic_block_label_t bb = m_blocks [n];
+         auto dead_set = boost::make_shared<set_t>();
+         for (auto v: m_cfg.get_node (bb).live ()) {
+           auto it = m_var_ids.find (v);
+           if (it == m_var_ids.end () || !live_out.test (it->second))
+             *dead_set += v;
+         }
          m_dead_map.insert (l_binding_t (bb, dead_set));
 
-
          // update statistics
-         m_total_live += live_out.size ();
-         m_max_live = std::max (m_max_live, live_out.size ());
+         unsigned num_live = live_out.count ();
+         m_total_live += num_live;
+         m_max_live = std::max (m_max_live, num_live);
          m_total_blks ++;
        }
      }
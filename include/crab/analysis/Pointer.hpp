@@ -15,6 +15,10 @@
 #include <crab/domains/intervals.hpp> 
 #include <crab/domains/discrete_domains.hpp>
 
+#include <atomic>
+#include <thread>
+#include <vector>
+
 namespace crab {
 
   namespace analyzer {
@@ -46,7 +50,42 @@ namespace crab {
 
       typedef typename CFG::varname_t varname_t;
       typedef interval <z_number> interval_t;
-      
+
+      //! A pointer in a constraint: a variable, or a parameter or the
+      //! return value of a function.
+      struct ptr_term {
+        typedef enum { VAR, PARAM, RETURN } kind_t;
+
+        kind_t m_kind;
+        varname_t m_name; // variable or function name
+        unsigned m_param;
+
+        ptr_term (kind_t kind, varname_t name, unsigned param = 0)
+            : m_kind (kind), m_name (name), m_param (param) { }
+
+        bool is_var () const { return m_kind == VAR; }
+      };
+
+      //! A points-to constraint before its pointers are mapped to
+      //! pointer variables. Objects and functions are stored in
+      //! m_addr, and m_rhs is unused for them.
+      struct ptr_cst {
+        typedef enum { ASSIGN, OBJECT, FUNCTION, LOAD, STORE } kind_t;
+
+        kind_t m_kind;
+        ptr_term m_lhs;
+        ptr_term m_rhs;
+        interval_t m_offset;
+        index_t m_addr;
+
+        ptr_cst (kind_t kind, ptr_term lhs, ptr_term rhs,
+                 interval_t offset, index_t addr = 0)
+            : m_kind (kind), m_lhs (lhs), m_rhs (rhs),
+              m_offset (offset), m_addr (addr) { }
+      };
+
+      typedef std::vector<ptr_cst> ptr_cst_vector;
+
       //! Generate points-to constraints from statements using
       //! invariants to resolve offsets.
       template < typename NumInvGen>
@@ -70,57 +109,36 @@ namespace crab {
         using typename abs_tr_t::ptr_function_t;
         
         typedef FunctionDecl<varname_t> FunctionDecl_t;
-        typedef boost::unordered_map< varname_t, pointer_var > pt_var_map_t;
         
-        VariableFactory& m_vfac;
-        pta_system* m_cs; 
+        ptr_cst_vector* m_csts; 
         NumDom m_inv;
         NumInvGen* m_inv_gen; 
-        pt_var_map_t*m_pt_map; 
         boost::optional<varname_t> m_func_name; 
         
         //! Return the interval [0,0]
         interval <z_number> zero() const { return interval <z_number> (0,0);}
         
-        //! Create a pointer variable
-        pointer_var new_pointer_var (varname_t v) {
-          auto it = m_pt_map->find(v);
-          if (it != m_pt_map->end())
-            return it->second;
-          
-          pointer_var pt = ikos::mk_pointer_var (v.index());
-          m_pt_map->insert (make_pair (v, pt));
-          return pt;
+        static ptr_term var (varname_t v) { return ptr_term (ptr_term::VAR, v); }
+        
+        static ptr_term param (varname_t fname, unsigned param) { 
+          return ptr_term (ptr_term::PARAM, fname, param); 
         }
         
-        //! Create a new parameter
-        pointer_var new_param_ref (varname_t fname, unsigned param) {
-          auto par_ref = ikos::mk_param_ref(new_pointer_var(fname), param);
-          // FIXME: really big assumption that the variable factory
-          // understands strings. For instance, this is not true if the
-          // factory is created by Crab-llvm.
-          pointer_var p = new_pointer_var (m_vfac[par_ref->get_str()]);
-          return p;
+        static ptr_term ret (varname_t fname) { 
+          return ptr_term (ptr_term::RETURN, fname); 
         }
         
-        //! Create a new return
-        pointer_var new_return_ref (varname_t fname) {
-          auto ret_ref = ikos::mk_return_ref(new_pointer_var(fname));
-          // FIXME: really big assumption that the variable factory
-          // understands strings. For instance, this is not true if the
-          // factory is created by Crab-llvm.
-          pointer_var p = new_pointer_var (m_vfac[ret_ref->get_str()]);
-          return p;
+        void add (typename ptr_cst::kind_t kind, ptr_term lhs, ptr_term rhs,
+                  interval_t offset, index_t addr = 0) {
+          m_csts->push_back (ptr_cst (kind, lhs, rhs, offset, addr));
         }
         
-        PtrOffsetCstGen (VariableFactory& vfac,
-                         pta_system* cs, 
+        PtrOffsetCstGen (ptr_cst_vector* csts, 
                          NumDom inv, 
                          NumInvGen* inv_gen, 
-                         pt_var_map_t* pt_map,
                          boost::optional<varname_t> func_name): 
-            m_vfac (vfac), m_cs (cs), m_inv (inv), m_inv_gen (inv_gen), 
-            m_pt_map (pt_map), m_func_name (func_name)
+            m_csts (csts), m_inv (inv), m_inv_gen (inv_gen), 
+            m_func_name (func_name)
         { }
         
         
@@ -129,8 +147,8 @@ namespace crab {
           for (unsigned i=0; i<num_params; i++) {
             if (decl.get_param_type (i) == PTR_TYPE)
             {
-              pointer_var fp = new_pointer_var (decl.get_param_name (i));
-            (*m_cs) += fp == (new_param_ref (decl.get_func_name (), i) + zero());              
+              add (ptr_cst::ASSIGN, var (decl.get_param_name (i)),
+                   param (decl.get_func_name (), i), zero ());
             }
           }
         }
@@ -140,17 +158,16 @@ namespace crab {
           for (unsigned i=0; i<num_args; i++) {
             if (stmt.get_arg_type (i) == PTR_TYPE)
             {
-              pointer_var ap = new_pointer_var (stmt.get_arg_name (i));
-              pointer_var fp = new_param_ref (stmt.get_func_name (), i);
-              (*m_cs) += fp == (ap + zero());              
+              add (ptr_cst::ASSIGN, param (stmt.get_func_name (), i),
+                   var (stmt.get_arg_name (i)), zero ());
             }
           }
           
           auto lhs_name = stmt.get_lhs_name ();
           if (lhs_name && (stmt.get_lhs_type () == PTR_TYPE))
           {
-            pointer_var p = new_pointer_var (*lhs_name);
-            (*m_cs) += (p == new_return_ref (stmt.get_func_name ()) + zero ());
+            add (ptr_cst::ASSIGN, var (*lhs_name), 
+                 ret (stmt.get_func_name ()), zero ());
           }
           
         }
@@ -158,26 +175,22 @@ namespace crab {
         void visit (return_t & stmt) { 
           if (stmt.get_ret_type () == PTR_TYPE && (m_func_name))
           {
-            pointer_var p = new_pointer_var (stmt.get_ret_var ());
-            (*m_cs) += (new_return_ref (*m_func_name) == p + zero ());
+            add (ptr_cst::ASSIGN, ret (*m_func_name), 
+                 var (stmt.get_ret_var ()), zero ());
           }
         }
       
         void visit (ptr_object_t & stmt) { 
-          pointer_var lhs = new_pointer_var (stmt.lhs ());
-          auto ref = ikos::mk_object_ref (stmt.rhs (), zero());
-          (*m_cs) += lhs == ref;
+          add (ptr_cst::OBJECT, var (stmt.lhs ()), var (stmt.lhs ()),
+               zero (), stmt.rhs ());
         }
         
         void visit (ptr_function_t & stmt) { 
-          pointer_var lhs = new_pointer_var (stmt.lhs ());
-          auto ref = ikos::mk_function_ref (stmt.rhs ().index());
-          (*m_cs) += lhs == ref;
+          add (ptr_cst::FUNCTION, var (stmt.lhs ()), var (stmt.lhs ()), 
+               interval_t::top (), stmt.rhs ().index ());
         }
         
         void visit (ptr_assign_t & stmt) { 
-          pointer_var lhs = new_pointer_var (stmt.lhs ());
-          pointer_var rhs = new_pointer_var (stmt.rhs ());
           interval_t  offset = interval_t::top ();
           if (stmt.offset().get_variable ())
             offset = m_inv [(*stmt.offset().get_variable ()).name ()];
@@ -185,21 +198,15 @@ namespace crab {
             offset = interval_t (stmt.offset ().constant ());
           else
             CRAB_ERROR("Pointer arithmetic does not allow arbitrary index expressions");
-          (*m_cs) += lhs == (rhs + offset );
+          add (ptr_cst::ASSIGN, var (stmt.lhs ()), var (stmt.rhs ()), offset);
         }
         
         void visit (ptr_load_t & stmt) {
-          pointer_var lhs = new_pointer_var (stmt.lhs ());
-          pointer_var rhs = new_pointer_var (stmt.rhs ());
-          interval_t size = stmt.size ();
-          (*m_cs) += lhs *= (rhs + size);
+          add (ptr_cst::LOAD, var (stmt.lhs ()), var (stmt.rhs ()), stmt.size ());
         }
         
         void visit (ptr_store_t & stmt) { 
-          pointer_var lhs = new_pointer_var (stmt.lhs ());
-          pointer_var rhs = new_pointer_var (stmt.rhs ());
-          interval_t size = stmt.size ();
-          (*m_cs) += (lhs + size) << rhs;          
+          add (ptr_cst::STORE, var (stmt.lhs ()), var (stmt.rhs ()), stmt.size ());
         }
         
         void visit (z_bin_op_t& stmt) {
@@ -237,7 +244,7 @@ namespace crab {
 
       typedef typename NumFwdAnalyzer<CFG,NumDom,VariableFactory>::type num_inv_gen_t;
       typedef typename num_inv_gen_t::liveness_t liveness_t;
-      typedef typename PtrOffsetCstGen < num_inv_gen_t>::pt_var_map_t pt_var_map_t;
+      typedef boost::unordered_map< varname_t, pointer_var > pt_var_map_t;
       
       //! for external queries
       typedef boost::unordered_map< varname_t,
@@ -252,38 +259,57 @@ namespace crab {
       
       typedef PtrOffsetCstGen <num_inv_gen_t> const_gen_t;
       
-     public:
+      //! Create a pointer variable
+      pointer_var new_pointer_var (varname_t v) {
+        auto it = m_pt_var_map.find(v);
+        if (it != m_pt_var_map.end())
+          return it->second;
+        
+        pointer_var pt = ikos::mk_pointer_var (v.index());
+        m_pt_var_map.insert (make_pair (v, pt));
+        return pt;
+      }
       
-      Pointer (VariableFactory &vfac): m_vfac (vfac) { }
+      //! Create a new parameter
+      pointer_var new_param_ref (varname_t fname, unsigned param) {
+        auto par_ref = ikos::mk_param_ref(new_pointer_var(fname), param);
+        // FIXME: really big assumption that the variable factory
+        // understands strings. For instance, this is not true if the
+        // factory is created by Crab-llvm.
+        pointer_var p = new_pointer_var (m_vfac[par_ref->get_str()]);
+        return p;
+      }
       
-      //////
-      // Generation of constraints for functions
-      //////
-      // for each function definition "func(p1,...,pn){...}" do
-      //   p1 >= param(func,1) 
-      //   ...
-      //   pn >= param(func,n) 
-      //
-      // for each call site "x = func(a1,,...an);"
-      //   param (func,1) >= a1
-      //   ...
-      //   param (func,1) >= an
-      //   x >= ret (func)
-      //
-      // for each given return statement "ret p"
-      //   ret (func) >= p
-      ///////
-    
-      void gen_constraints (CFG cfg) 
+      //! Create a new return
+      pointer_var new_return_ref (varname_t fname) {
+        auto ret_ref = ikos::mk_return_ref(new_pointer_var(fname));
+        // FIXME: really big assumption that the variable factory
+        // understands strings. For instance, this is not true if the
+        // factory is created by Crab-llvm.
+        pointer_var p = new_pointer_var (m_vfac[ret_ref->get_str()]);
+        return p;
+      }
+      
+      pointer_var new_pointer_var (const ptr_term& t) {
+        switch (t.m_kind) {
+          case ptr_term::PARAM:  return new_param_ref (t.m_name, t.m_param);
+          case ptr_term::RETURN: return new_return_ref (t.m_name);
+          default:               return new_pointer_var (t.m_name);
+        }
+      }
+      
+      //! Numerical analysis and constraint generation for one
+      //! CFG. Only reads the state shared with other CFGs.
+      void gen_cfg_constraints (CFG cfg, ptr_cst_vector& csts) 
       {
         // 1) Run a numerical analysis to infer numerical invariants
         //    about offsets.
         
         const bool run_live = true; // XXX: make this a parameter
 
+        liveness_t ls (cfg);
         liveness_t* live = nullptr;
         if (run_live) {
-          liveness_t ls (cfg);
           ls.exec ();
           live = &ls;
         }
@@ -296,20 +322,115 @@ namespace crab {
         boost::optional<varname_t> func_name;
         if (func_decl)
         {
-          const_gen_t vis (m_vfac, &m_cs, NumDom::top (), 
-                           &It, &m_pt_var_map, func_name);
+          const_gen_t vis (&csts, NumDom::top (), &It, func_name);
           vis.gen_func_decl_cons (*func_decl);
           func_name = (*func_decl).get_func_name ();
         }
 
         for (auto &b : cfg)
         {
-          const_gen_t vis (m_vfac, &m_cs, It [b.label ()], 
-                           &It, &m_pt_var_map, func_name);
+          const_gen_t vis (&csts, It [b.label ()], &It, func_name);
           for (auto &s: b) { s.accept (&vis); }
         }
       }
 
+      //! Add the constraints of a CFG to the system. Pointer
+      //! variables are created in the order the constraints were
+      //! generated, variables before parameters and return values.
+      void add_constraints (const ptr_cst_vector& csts) 
+      {
+        for (auto const& c : csts)
+        {
+          switch (c.m_kind) {
+            case ptr_cst::ASSIGN: {
+              bool rhs_first = !c.m_lhs.is_var () && c.m_rhs.is_var ();
+              pointer_var first  = new_pointer_var (rhs_first ? c.m_rhs : c.m_lhs);
+              pointer_var second = new_pointer_var (rhs_first ? c.m_lhs : c.m_rhs);
+              pointer_var lhs = (rhs_first ? second : first);
+              pointer_var rhs = (rhs_first ? first : second);
+              m_cs += lhs == (rhs + c.m_offset);
+              break;
+            }
+            case ptr_cst::OBJECT: {
+              pointer_var lhs = new_pointer_var (c.m_lhs);
+              m_cs += lhs == ikos::mk_object_ref (c.m_addr, c.m_offset);
+              break;
+            }
+            case ptr_cst::FUNCTION: {
+              pointer_var lhs = new_pointer_var (c.m_lhs);
+              m_cs += lhs == ikos::mk_function_ref (c.m_addr);
+              break;
+            }
+            case ptr_cst::LOAD: {
+              pointer_var lhs = new_pointer_var (c.m_lhs);
+              pointer_var rhs = new_pointer_var (c.m_rhs);
+              m_cs += lhs *= (rhs + c.m_offset);
+              break;
+            }
+            case ptr_cst::STORE: {
+              pointer_var lhs = new_pointer_var (c.m_lhs);
+              pointer_var rhs = new_pointer_var (c.m_rhs);
+              m_cs += (lhs + c.m_offset) << rhs;
+              break;
+            }
+          }
+        }
+      }
+      
+     public:
+      
+      Pointer (VariableFactory &vfac): m_vfac (vfac) { }
+      
+      //////
+      // Generation of constraints for functions
+      //////
+      // for each function definition "func(p1,...,pn){...}" do
+      //   p1 >= param(func,1) 
+      //   ...
+      //   pn >= param(func,n) 
+      //
+      // for each call site "x = func(a1,,...an);"
+      //   param (func,1) >= a1
+      //   ...
+      //   param (func,1) >= an
+      //   x >= ret (func)
+      //
+      // for each given return statement "ret p"
+      //   ret (func) >= p
+      ///////
+    
+      void gen_constraints (CFG cfg) 
+      {
+        ptr_cst_vector csts;
+        gen_cfg_constraints (cfg, csts);
+        add_constraints (csts);
+      }
+
+      //! Generate the constraints of several CFGs using up to
+      //! num_threads threads. Each CFG is analyzed into its own
+      //! buffer, and the buffers are added in the order of cfgs so the
+      //! result does not depend on the number of threads.
+      void gen_constraints (const std::vector<CFG>& cfgs, 
+                            unsigned num_threads = std::thread::hardware_concurrency ()) 
+      {
+        std::vector<ptr_cst_vector> csts (cfgs.size ());
+        std::atomic<std::size_t> next (0);
+        auto worker = [&] () {
+          for (std::size_t i = next++; i < cfgs.size (); i = next++)
+            gen_cfg_constraints (cfgs [i], csts [i]);
+        };
+
+        std::size_t n = std::min<std::size_t> (std::max (num_threads, 1U), cfgs.size ());
+        std::vector<std::thread> threads;
+        for (std::size_t t = 1; t < n; t++)
+          threads.push_back (std::thread (worker));
+        worker ();
+        for (auto &t : threads) t.join ();
+
+        for (auto const& c : csts)
+          add_constraints (c);
+      }
+
       void solve () {
         
         // 3) Solve points-to set constraints
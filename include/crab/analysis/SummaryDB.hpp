@@ -0,0 +1,220 @@
+#ifndef SUMMARY_DATABASE_HPP
+#define SUMMARY_DATABASE_HPP
+
+/*
+   On-disk database of function summaries for the bottom-up phase of
+   InterFwdAnalyzer.
+
+   Each summary is stored in its own file named after a 64-bit key.
+   The key is computed by the analyzer from the printed Cfg of the
+   function, the domain name, the analysis parameters and the keys of
+   its callees, so a summary is invalidated whenever the function or
+   anything it calls changes.
+
+   A summary is stored as the linear constraints of the abstract value
+   over the formal parameters and the return variable, numbered by
+   position so the file does not depend on variable ids. Loading a
+   summary therefore keeps only what AbsDomain can express as linear
+   constraints, which is an over-approximation for non-convex
+   domains.
+*/
+
+#include <boost/noncopyable.hpp>
+#include <crab/common/debug.hpp>
+#include <crab/common/stats.hpp>
+#include <crab/common/bignums.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <stdint.h>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+namespace crab {
+
+  namespace analyzer {
+
+    template<typename CFG, typename AbsDomain>
+    class SummaryDB: boost::noncopyable {
+
+     public:
+
+      typedef uint64_t key_t;
+      typedef typename CFG::varname_t varname_t;
+
+     private:
+
+      typedef typename AbsDomain::linear_constraint_system_t linear_constraint_system_t;
+      typedef typename linear_constraint_system_t::linear_constraint_t linear_constraint_t;
+      typedef typename linear_constraint_t::linear_expression_t linear_expression_t;
+      typedef typename linear_constraint_t::variable_t variable_t;
+
+      std::string m_dir;
+      std::atomic<unsigned> m_num_loaded;
+      std::atomic<unsigned> m_num_stored;
+
+      static const char* magic () { return "crab-summary-1"; }
+
+      std::string path (key_t key) const {
+        char buf [32];
+        snprintf (buf, sizeof (buf), "%016llx", (unsigned long long) key);
+        return m_dir + "/" + buf + ".sum";
+      }
+
+      static const char* kind_str (const linear_constraint_t& c) {
+        if (c.is_equality ()) return "=";
+        if (c.is_inequality ()) return "<=";
+        return "!=";
+      }
+
+      // parse a number as written by store: an optional minus sign
+      // followed by decimal digits
+      static bool parse_number (const std::string& s, ikos::z_number& n) {
+        std::size_t i = (!s.empty () && s [0] == '-' ? 1 : 0);
+        if (i == s.size ()) return false;
+        for (; i < s.size (); i++) {
+          if (s [i] < '0' || s [i] > '9') return false;
+        }
+        n = ikos::z_number (s);
+        return true;
+      }
+
+     public:
+
+      //! Store summaries in directory dir, creating it if needed.
+      SummaryDB (std::string dir)
+          : m_dir (dir), m_num_loaded (0), m_num_stored (0) {
+        ::mkdir (m_dir.c_str (), 0755);
+      }
+
+      //! FNV-1a hash of a string. Unlike boost::hash it is the same
+      //! on every run and platform.
+      static key_t hash (const std::string& s, key_t seed = 14695981039346656037ULL) {
+        key_t h = seed;
+        for (unsigned char c: s) {
+          h ^= c;
+          h *= 1099511628211ULL;
+        }
+        return h;
+      }
+
+      static key_t hash_combine (key_t seed, key_t v) {
+        for (unsigned i = 0; i < 8; i++) {
+          seed ^= (v >> (8 * i)) & 0xff;
+          seed *= 1099511628211ULL;
+        }
+        return seed;
+      }
+
+      //! Hash the contents of a Cfg
+      static key_t hash_cfg (const CFG& cfg) {
+        std::ostringstream o;
+        o << cfg;
+        return hash (o.str ());
+      }
+
+      //! Load the summary with key over vars (formals followed by the
+      //! return variable, if any) into sum. Return false if there is
+      //! none, it does not match or it is malformed.
+      bool load (key_t key, const std::vector<varname_t>& vars, AbsDomain& sum) {
+        std::ifstream in (path (key).c_str ());
+        if (!in) return false;
+
+        std::string line;
+        if (!std::getline (in, line) || line != magic ()) return false;
+        if (!std::getline (in, line) || line != AbsDomain::getDomainName ()) return false;
+        std::size_t num_vars, num_csts;
+        if (!(in >> num_vars >> num_csts) || num_vars != vars.size ()) return false;
+
+        linear_constraint_system_t csts;
+        for (std::size_t i = 0; i < num_csts; i++) {
+          std::string kind, cst;
+          std::size_t num_terms;
+          ikos::z_number n;
+          if (!(in >> kind >> cst >> num_terms) || !parse_number (cst, n)) return false;
+          linear_expression_t e (n);
+          for (std::size_t j = 0; j < num_terms; j++) {
+            std::string coef;
+            std::size_t v;
+            if (!(in >> coef >> v) || v >= vars.size () || !parse_number (coef, n)) 
+              return false;
+            e = e + linear_expression_t (n, variable_t (vars [v]));
+          }
+          if (kind == "=")
+            csts += linear_constraint_t (e, linear_constraint_t::EQUALITY);
+          else if (kind == "<=")
+            csts += linear_constraint_t (e, linear_constraint_t::INEQUALITY);
+          else if (kind == "!=")
+            csts += linear_constraint_t (e, linear_constraint_t::DISEQUATION);
+          else
+            return false;
+        }
+
+        sum = AbsDomain::top ();
+        sum += csts;
+        ++m_num_loaded;
+        crab::CrabStats::count ("SummaryDB.loaded");
+        return true;
+      }
+
+      //! Store sum, a summary over vars, under key. Constraints over
+      //! other variables are dropped.
+      void store (key_t key, const std::vector<varname_t>& vars, AbsDomain sum) {
+        std::ostringstream body;
+        std::size_t num_csts = 0;
+        for (auto const& c: sum.to_linear_constraint_system ()) {
+          std::ostringstream terms;
+          std::size_t num_terms = 0;
+          bool ok = true;
+          for (auto const& t: c) {
+            auto it = std::find (vars.begin (), vars.end (), t.second.name ());
+            if (it == vars.end ()) { ok = false; break; }
+            terms << " " << t.first.get_str () << " " << (it - vars.begin ());
+            num_terms++;
+          }
+          if (!ok) continue;
+          body << kind_str (c) << " " << c.expression ().constant ().get_str ()
+               << " " << num_terms << terms.str () << "\n";
+          num_csts++;
+        }
+
+        // write to a temporary file first so that readers never see a
+        // partial summary. Its name is unique among the threads of all
+        // the processes sharing the directory.
+        std::ostringstream tmp;
+        tmp << path (key) << ".tmp." << ::getpid () << "." << std::this_thread::get_id ();
+        {
+          std::ofstream out (tmp.str ().c_str ());
+          if (!out) {
+            CRAB_WARN ("cannot write summary to ", tmp.str ());
+            return;
+          }
+          out << magic () << "\n" << AbsDomain::getDomainName () << "\n"
+              << vars.size () << " " << num_csts << "\n" << body.str ();
+        }
+        if (std::rename (tmp.str ().c_str (), path (key).c_str ()) != 0) {
+          std::remove (tmp.str ().c_str ());
+          return;
+        }
+        ++m_num_stored;
+        crab::CrabStats::count ("SummaryDB.stored");
+      }
+
+      //! Number of summaries loaded from disk
+      unsigned num_loaded () const { return m_num_loaded; }
+
+      //! Number of summaries written to disk
+      unsigned num_stored () const { return m_num_stored; }
+    };
+
+  } // end namespace
+} // end namespace
+
+#endif /* SUMMARY_DATABASE_HPP */
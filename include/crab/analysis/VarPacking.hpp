@@ -0,0 +1,164 @@
+#ifndef VAR_PACKING_ANALYSIS_HPP
+#define VAR_PACKING_ANALYSIS_HPP
+
+/*
+ * Syntactic pre-analysis that groups variables into packs for
+ * crab::domains::var_packing_domain. Two variables are packed
+ * together if they appear in the same assignment, arithmetic
+ * operation, select, assume or assertion, as long as the pack does
+ * not grow beyond a given size. The pairs that occur most often are
+ * packed first. Variables that are not related to any other are left
+ * out of all packs.
+ */
+
+#include <crab/common/stats.hpp>
+#include <crab/common/debug.hpp>
+#include <crab/cfg/Cfg.hpp>
+#include <crab/domains/var_packing.hpp>
+
+#include <boost/noncopyable.hpp>
+#include <boost/unordered_map.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/range/iterator_range.hpp>
+#include <algorithm>
+#include <map>
+#include <vector>
+
+namespace crab {
+
+  namespace analyzer {
+
+   using namespace cfg;
+
+   template<typename CFG>
+   class VarPacking: boost::noncopyable {
+
+    public:
+     typedef typename CFG::varname_t varname_t;
+     typedef domains::var_packs<varname_t> var_packs_t;
+     typedef boost::shared_ptr<var_packs_t> var_packs_ptr;
+
+    private:
+     typedef typename CFG::basic_block_t::statement_t statement_t;
+
+     CFG m_cfg;
+     std::size_t m_max_pack_size;
+     var_packs_ptr m_packs;
+
+     // union-find over the variables of the cfg, by insertion order
+     std::vector<varname_t> m_vars;
+     boost::unordered_map<varname_t, unsigned> m_ids;
+     std::vector<unsigned> m_parent;
+     std::vector<std::size_t> m_size;
+
+     unsigned get_id (const varname_t& v) {
+       auto it = m_ids.find (v);
+       if (it != m_ids.end ()) return it->second;
+       unsigned id = m_vars.size ();
+       m_ids.insert (std::make_pair (v, id));
+       m_vars.push_back (v);
+       m_parent.push_back (id);
+       m_size.push_back (1);
+       return id;
+     }
+
+     unsigned find (unsigned i) {
+       while (m_parent[i] != i) {
+         m_parent[i] = m_parent[m_parent[i]];
+         i = m_parent[i];
+       }
+       return i;
+     }
+
+     void merge (unsigned i, unsigned j) {
+       i = find (i); j = find (j);
+       if (i == j || m_size[i] + m_size[j] > m_max_pack_size) return;
+       if (m_size[i] < m_size[j]) std::swap (i, j);
+       m_parent[j] = i;
+       m_size[i] += m_size[j];
+     }
+
+     static bool is_relational (const statement_t& s) {
+       return s.isBinOp () || s.isAssign () || s.isAssume () ||
+              s.isSelect () || s.isAssert ();
+     }
+
+    public:
+
+     VarPacking (CFG cfg, std::size_t max_pack_size = 8)
+         : m_cfg (cfg), m_max_pack_size (max_pack_size) { }
+
+     void exec () {
+       crab::ScopedCrabStats __st__("VarPacking");
+
+       // -- weight each pair of variables that occur together. A
+       //    statement with k variables gives 1/(k-1) to each of its
+       //    pairs, so small statements are packed first.
+       std::map<std::pair<unsigned,unsigned>, double> weights;
+       for (auto &b: boost::make_iterator_range (m_cfg.begin (), m_cfg.end ())) {
+         for (auto &s: b) {
+           if (!is_relational (s)) continue;
+           auto live = s.getLive ();
+           std::vector<unsigned> ids;
+           for (auto v: boost::make_iterator_range (live.defs_begin (), live.defs_end ()))
+             ids.push_back (get_id (v));
+           for (auto v: boost::make_iterator_range (live.uses_begin (), live.uses_end ()))
+             ids.push_back (get_id (v));
+           std::sort (ids.begin (), ids.end ());
+           ids.erase (std::unique (ids.begin (), ids.end ()), ids.end ());
+           if (ids.size () < 2) continue;
+           double w = 1.0 / (ids.size () - 1);
+           for (unsigned p = 0; p < ids.size (); p++)
+             for (unsigned q = p + 1; q < ids.size (); q++)
+               weights[std::make_pair (ids[p], ids[q])] += w;
+         }
+       }
+
+       // -- merge the heaviest pairs first
+       typedef std::pair<std::pair<unsigned,unsigned>, double> weighted_pair_t;
+       std::vector<weighted_pair_t> pairs (weights.begin (), weights.end ());
+       std::stable_sort (pairs.begin (), pairs.end (),
+                         [](const weighted_pair_t& a, const weighted_pair_t& b) {
+                           return a.second > b.second;
+                         });
+       for (auto const& p: pairs)
+         merge (p.first.first, p.first.second);
+
+       // -- one pack per class with at least two variables
+       std::vector<std::vector<varname_t> > classes (m_vars.size ());
+       for (unsigned i = 0; i < m_vars.size (); i++)
+         classes[find (i)].push_back (m_vars[i]);
+
+       m_packs.reset (new var_packs_t ());
+       unsigned num_packed = 0;
+       for (auto &c: classes) {
+         if (c.size () < 2) continue;
+         m_packs->add_pack (c);
+         num_packed += c.size ();
+       }
+
+       crab::CrabStats::count_max ("VarPacking.max_packs", m_packs->size ());
+       CRAB_LOG ("packing",
+                 crab::outs () << "Packs: " << *m_packs << "\n"
+                               << num_packed << " of " << m_vars.size ()
+                               << " variables packed\n";);
+     }
+
+     var_packs_ptr get_packs () const { return m_packs; }
+
+     void write (std::ostream& o) const {
+       if (m_packs) o << *m_packs;
+     }
+   };
+
+   template <typename CFG>
+   ostream& operator << (ostream& o, const VarPacking<CFG> &p) {
+     p.write (o);
+     return o;
+   }
+
+  } // end namespace analyzer
+
+} // end namespace crab
+
+#endif
@@ -13,6 +13,7 @@
 #include <boost/shared_ptr.hpp>
 #include <boost/make_shared.hpp>
 #include <boost/range/iterator_range.hpp>
+#include <mutex>
 
 using namespace std;
 
@@ -36,6 +37,9 @@ namespace crab {
        // 
        // The factory uses a counter of type index_t to generate variable
        // id's that always increases.
+       //
+       // The factory can be shared by threads that analyze different
+       // CFGs.
        template< class T>
        class VariableFactory : public boost::noncopyable
        {
@@ -137,6 +141,7 @@ namespace crab {
          t_map_t _map;
          shadow_map_t _shadow_map;
          vector<IndexedString> _shadow_vars;
+         std::mutex _mutex;
          
         public:
          typedef IndexedString variable_t;
@@ -159,6 +164,7 @@ namespace crab {
          // associated with a particular T (w/o caching).
          IndexedString get ()
          {
+           std::lock_guard<std::mutex> lock (_mutex);
            IndexedString is (_next_id++, this);
            _shadow_vars.push_back (is);
            return is;
@@ -168,6 +174,7 @@ namespace crab {
          // associated with a particular T (w/ caching).
          IndexedString get (index_t key)
          {
+           std::lock_guard<std::mutex> lock (_mutex);
            auto it = _shadow_map.find (key);
            if (it == _shadow_map.end()) 
            {
@@ -182,6 +189,7 @@ namespace crab {
          
          IndexedString operator[](T s) 
          {
+           std::lock_guard<std::mutex> lock (_mutex);
            auto it = _map.find (s);
            if (it == _map.end()) 
            {
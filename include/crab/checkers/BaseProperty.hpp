@@ -29,6 +29,20 @@ namespace crab {
     unsigned m_total_err;
     unsigned m_total_unreach;
     unsigned m_total_warn;
+    // the checks of each calling context, in order, until they are
+    // combined (see begin_context)
+    std::vector<std::vector<check_t> > m_ctx_checks;
+
+    void record (check_kind_t status, DebugInfo dbg) {
+      switch (status) {
+        case _SAFE: m_total_safe++;break;
+        case _ERR : m_total_err++;break;
+        case _UNREACH: m_total_unreach++;break;
+        default: m_total_warn++;
+      }
+      if (dbg.has_debug ())
+        m_db.insert (check_t (dbg, status));
+    }
 
    public:
 
@@ -38,14 +52,45 @@ namespace crab {
     
     // add an entry in the database
     void add (check_kind_t status, DebugInfo dbg = DebugInfo () ) {
-      switch (status) {
-        case _SAFE: m_total_safe++;break;
-        case _ERR : m_total_err++;break;
-        case _UNREACH: m_total_unreach++;break;
-        default: m_total_warn++;
+      if (!m_ctx_checks.empty ())
+        m_ctx_checks.back ().push_back (check_t (dbg, status));
+      else
+        record (status, dbg);
+    }
+
+    // The same checks are made once per calling context of a
+    // function. The checks added after begin_context belong to a new
+    // context, and all the contexts must add the same checks in the
+    // same order. end_contexts adds one entry per check: unreachable
+    // if it is in all the contexts, safe (error) if it is safe (an
+    // error) in all the contexts where it is reachable, and a warning
+    // otherwise.
+    void begin_context () {
+      m_ctx_checks.push_back (std::vector<check_t> ());
+    }
+
+    void end_contexts () {
+      std::vector<std::vector<check_t> > ctx_checks;
+      ctx_checks.swap (m_ctx_checks);
+      if (ctx_checks.empty ()) return;
+      // every context makes the same checks, in the same order: the
+      // checkers add one entry per check even if it is unreachable
+      std::size_t n = ctx_checks [0].size ();
+      for (auto const& checks: ctx_checks) {
+        if (checks.size () != n)
+          CRAB_ERROR ("calling contexts made different numbers of checks");
+      }
+      for (std::size_t i = 0; i < n; i++) {
+        DebugInfo dbg;
+        check_kind_t status = _UNREACH;
+        for (auto const& checks: ctx_checks) {
+          const check_t& c = checks [i];
+          if (c.first.has_debug ()) dbg = c.first;
+          if (c.second == _UNREACH || c.second == status) continue;
+          status = (status == _UNREACH ? c.second : _WARN);
+        }
+        record (status, dbg);
       }
-      if (dbg.has_debug ())
-        m_db.insert (check_t (dbg, status));
     }
     
     // merge two databases
@@ -359,6 +404,13 @@ namespace crab {
       m_abs_tr = abs_tr;
     }
     
+    //! Start another calling context of the same checks (see
+    //! ChecksDB::begin_context)
+    void begin_context () { m_db.begin_context (); }
+
+    //! Count the checks made in all the contexts once
+    void end_contexts () { m_db.end_contexts (); }
+
     const ChecksDB& get_db () const { return m_db; }
     
     ChecksDB get_db () { return m_db; }
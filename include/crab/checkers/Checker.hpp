@@ -112,11 +112,25 @@ namespace crab {
       crab::ScopedCrabStats __st__("Checker");
       cg_t& cg = m_analyzer.get_call_graph (); 
       for (auto &v: boost::make_iterator_range (vertices (cg))) {
-        cfg_t& cfg = v.getCfg ();
+        cfg_t cfg = v.getCfg ();
+        check (cfg);
+      }
+    }
+
+    // Check only cfg. This can be called from a callback of the
+    // analyzer before the invariants of cfg are released. If cfg was
+    // analyzed with several calling contexts then it is checked once
+    // with each of them, and each check is counted once with the
+    // results of all the contexts.
+    void check (cfg_t& cfg) {
+      std::size_t num_ctxs = std::max<std::size_t> (m_analyzer.get_num_contexts (cfg), 1);
+      for (std::size_t ctx = 0; ctx < num_ctxs; ctx++) {
+        for (auto checker: this->m_checkers)
+          checker->begin_context ();
         for (auto &bb: cfg) {
           for (auto checker: this->m_checkers) {
             crab::ScopedCrabStats __st__("Checker." + checker->get_property_name());
-            abs_dom_t inv = m_analyzer.get_pre (cfg, bb.label ());
+            abs_dom_t inv = m_analyzer.get_pre (cfg, bb.label (), ctx);
             abs_tr_ptr abs_tr = m_analyzer.get_abs_transformer (inv);
             // propagate forward the invariants from the block entry 
             // while checking the property
@@ -126,6 +140,8 @@ namespace crab {
           }
         }
       }
+      for (auto checker: this->m_checkers)
+        checker->end_contexts ();
     }
   };
 
@@ -4,6 +4,7 @@
 /* Code from SeaHorn */
 
 #include <map>
+#include <time.h>
 #include <sys/time.h>
 #include <sys/resource.h>
 
@@ -20,18 +21,29 @@ namespace crab
     long started;
     long finished;
     long timeElapsed;
+    bool perThread;
 
+    // CPU time in microseconds of the process, or of the calling
+    // thread if perThread. A per-thread stopwatch must be started
+    // and stopped by the same thread.
     long systemTime () const
     {
+#ifdef CLOCK_THREAD_CPUTIME_ID
+      if (perThread)
+	{
+	  struct timespec ts;
+	  clock_gettime (CLOCK_THREAD_CPUTIME_ID, &ts);
+	  return ts.tv_sec * 1000000L + ts.tv_nsec / 1000L;
+	}
+#endif
       struct rusage ru;
       getrusage (RUSAGE_SELF, &ru);
       long r = ru.ru_utime.tv_sec * 1000000L + ru.ru_utime.tv_usec;
       return r;
-
     }
 
   public:
-    Stopwatch () { start (); }
+    Stopwatch (bool per_thread = false) : perThread (per_thread) { start (); }
 
     void start ()
     {
@@ -68,6 +80,8 @@ namespace crab
 
     void Print (std::ostream &out) const;
 
+    static void PrintTime (std::ostream &out, long time);
+
     double toSeconds(){
       double time = ((double) getTimeElapsed () / 1000000) ;
       return time;
@@ -92,13 +106,20 @@ namespace crab
       return avg;
     }
 
+    void merge (const Averager &o)
+    {
+      if (o.count == 0) return;
+      avg = (avg * count + o.avg * o.count) / (count + o.count);
+      count += o.count;
+    }
+
     void Print (std::ostream &out) const;
 
   };
 #else
   struct Stopwatch
   {
-    Stopwatch () {}
+    Stopwatch (bool per_thread = false) {}
     void start () {}
     void stop () {}
     void resume () {}
@@ -136,21 +157,27 @@ namespace crab
     return OS;
   }
 
+  /** 
+      Each thread updates its own counters, stopwatches and averages
+      without locking. They are merged when they are read (get,
+      Print and PrintBrunch), which must not happen while other
+      threads are still updating them: counters and times are added
+      up and count_max values take the maximum. uset and sset keep
+      the last value set by any thread.
+
+      start/stop/resume measure the CPU time of the process, which
+      includes the time of the other threads meanwhile. The _thread
+      variants only measure the calling thread.
+   */
   class CrabStats
   {
-  private:
-    static std::map<std::string,unsigned> counters;
-    static std::map<std::string,Stopwatch> sw;
-    static std::map<std::string,Averager> av;
-    static std::map<std::string,std::string> ss;
-
   public:
     static unsigned  get (const std::string &n);
     static double avg (const std::string &n, double v);
     static unsigned uset (const std::string &n, unsigned v);
 
     static void sset (const std::string &n, std::string v);
-    static std::string& sget (const std::string &n);
+    static std::string sget (const std::string &n);
     
     static void count (const std::string &name);
     static void count_max (const std::string &name, unsigned v);
@@ -159,6 +186,10 @@ namespace crab
     static void stop (const std::string &name);
     static void resume (const std::string &name);
 
+    static void start_thread (const std::string &name);
+    static void stop_thread (const std::string &name);
+    static void resume_thread (const std::string &name);
+
     /** Outputs all statistics to std output */
     static void Print (std::ostream &OS);
     static void PrintBrunch (std::ostream &OS);
@@ -217,6 +248,16 @@ namespace crab
     }
     ~ScopedCrabStats () { CrabStats::stop (m_name); }
   };  
+
+  /** As ScopedCrabStats but only the time of the calling thread */
+  class ScopedThreadCrabStats 
+  {
+    std::string m_name;
+  public:
+    ScopedThreadCrabStats (const std::string &name) : m_name(name) 
+    { CrabStats::resume_thread (m_name); }
+    ~ScopedThreadCrabStats () { CrabStats::stop_thread (m_name); }
+  };  
 #else
   inline std::ostream &operator<< (std::ostream &OS, const Stopwatch &sw){ return OS;}
   inline std::ostream &operator<< (std::ostream &OS, const Averager &av){ return OS;}
@@ -226,13 +267,16 @@ namespace crab
     static double avg (const std::string &n, double v){ return 0.0;}
     static unsigned uset (const std::string &n, unsigned v){return 0;}
     static void sset (const std::string &n, std::string v){}
-    static std::string& sget (const std::string &n)
+    static std::string sget (const std::string &n)
     { CRAB_ERROR("Stats::sget not implemented");}
     static void count (const std::string &name){}
     static void count_max (const std::string &name, unsigned v){}
     static void start (const std::string &name){}
     static void stop (const std::string &name){}
     static void resume (const std::string &name){}
+    static void start_thread (const std::string &name){}
+    static void stop_thread (const std::string &name){}
+    static void resume_thread (const std::string &name){}
     static void Print (std::ostream &OS){}
     static void PrintBrunch (std::ostream &OS){}
   };
@@ -245,6 +289,10 @@ namespace crab
   {
     ScopedCrabStats (const std::string &name, bool reset = false) {}
   };  
+  struct ScopedThreadCrabStats 
+  {
+    ScopedThreadCrabStats (const std::string &name) {}
+  };  
 #endif 
 }
 
@@ -144,6 +144,8 @@ namespace crab {
 
 #include <crab/domains/apron/apron.hpp>
 #include <boost/bimap.hpp>
+#include <boost/bimap/support/lambda.hpp>
+#include <algorithm>
 
 namespace crab {
    namespace domains {
@@ -210,17 +212,78 @@ namespace crab {
           return get_var_dim (m_var_map, v);
         }
 
-        ap_dim_t get_var_dim_insert (VariableName v) {
-          assert (m_var_map.size () == get_dims ());
-          if (auto dim = get_var_dim (v))
-            return *dim;
-          else {
-            ap_dim_t i = m_var_map.size ();
-            m_var_map.insert (binding_t (v, i));
-            add_dimensions (m_apstate, 1);
-            assert (m_var_map.size () == get_dims ());
-            return i;
+        // The dimensions of a state follow the order of VariableName,
+        // so a map is determined by its set of variables and two
+        // states over the same variables are already aligned.
+        //
+        // Position of v in m if it was added
+        static ap_dim_t canonical_dim (const var_map_t& m, VariableName v) {
+          auto it = m.left.lower_bound (v);
+          return (it == m.left.end () ? m.size () : it->second);
+        }
+
+        // Insert the sorted variables vs, none of them in m, at their
+        // positions. Each variable of m is shifted once, by the number
+        // of variables of vs before it.
+        static void insert_vars (var_map_t& m, const vector<VariableName>& vs) {
+          vector<ap_dim_t> dims;
+          dims.reserve (vs.size ());
+          for (unsigned j=0; j < vs.size (); j++)
+            dims.push_back (canonical_dim (m, vs[j]) + j);
+          // from the last dimension so that they stay unique
+          size_t k = vs.size ();
+          for (auto it = m.left.end (); it != m.left.begin () && k > 0; ) {
+            --it;
+            while (k > 0 && it->first < vs[k-1]) 
+              --k;
+            if (k > 0)
+              m.left.modify_data (it, boost::bimaps::_data = it->second + k);
           }
+          for (unsigned j=0; j < vs.size (); j++)
+            m.insert (binding_t (vs[j], dims[j]));
+        }
+
+        static bool same_vars (const var_map_t& m_x, const var_map_t& m_y) {
+          return m_x.size () == m_y.size () &&
+              std::equal (m_x.left.begin (), m_x.left.end (), m_y.left.begin (),
+                          [](const typename var_map_t::left_value_type& px,
+                             const typename var_map_t::left_value_type& py) {
+                            return px.first == py.first;
+                          });
+        }
+
+        // Add the variables of vs that are not in the state with a
+        // single change of dimensions. Adding a variable shifts the
+        // dimensions after it, so an operation adds all its variables
+        // before it builds its apron expressions.
+        void add_vars (vector<VariableName> vs) {
+          assert (m_var_map.size () == get_dims ());
+          vs.erase (std::remove_if (vs.begin (), vs.end (),
+                                    [this](const VariableName& v) { 
+                                      return (bool) get_var_dim (v); }),
+                    vs.end ());
+          if (vs.empty ()) return;
+          std::sort (vs.begin (), vs.end ());
+          vs.erase (std::unique (vs.begin (), vs.end ()), vs.end ());
+          vector<ap_dim_t> dims;
+          dims.reserve (vs.size ());
+          for (auto const& v: vs)
+            dims.push_back (canonical_dim (m_var_map, v));
+          add_dimensions (m_apstate, dims);
+          insert_vars (m_var_map, vs);
+          assert (m_var_map.size () == get_dims ());
+        }
+
+        template<typename VariableSet>
+        void add_vars (const VariableSet& vars, vector<VariableName> vs) {
+          for (auto const& v: vars)
+            vs.push_back (v.name ());
+          add_vars (vs);
+        }
+
+        ap_dim_t get_var_dim_insert (VariableName v) {
+          add_vars (vector<VariableName> (1, v));
+          return *get_var_dim (v);
         }
         
         bool has_var_name (const var_map_t& m, ap_dim_t i) const {
@@ -242,12 +305,16 @@ namespace crab {
           return get_var_name (m_var_map, i);
         }
 
-        void add_dimensions (ap_state_ptr& s, size_t dims) const {
-          if (dims <= 0) return;
+        // Add one dimension before each of the (old) dimensions in
+        // dims, which must be in ascending order. An old dimension
+        // equal to the number of dimensions adds at the end.
+        void add_dimensions (ap_state_ptr& s, const vector<ap_dim_t>& dims) const {
+          if (dims.empty ()) return;
 
-          ap_dimchange_t* dimchange =  ap_dimchange_alloc (dims, 0);
-          for (unsigned i=0 ; i<dims ; i++)
-            dimchange->dim[i] = get_dims (s); // add dimension at the end
+          assert (std::is_sorted (dims.begin (), dims.end ()));
+          ap_dimchange_t* dimchange =  ap_dimchange_alloc (dims.size (), 0);
+          for (unsigned i=0 ; i<dims.size () ; i++)
+            dimchange->dim[i] = dims[i]; 
 
           s = apPtr (get_man (), 
                      ap_abstract0_add_dimensions(get_man (), false, 
@@ -281,123 +348,47 @@ namespace crab {
           #endif           
         }
 
-        bool check_perm (ap_dimperm_t* perm, size_t size){
-          // it does not check injectivity
-          if (perm->size != size) return false;
-          for (unsigned i=0; i<perm->size; i++){
-            if (perm->dim[i]>=size){
-              return false;
-            }
-          }
-          return true;
-        }
-
+        // Align s_x and s_y and return the map of both. Each state
+        // only gets the dimensions of the variables it lacks, inserted
+        // in place with a single call, so no permutation is needed.
         var_map_t merge_var_map (const var_map_t& m_x, ap_state_ptr& s_x,
-                                   const var_map_t& m_y, ap_state_ptr& s_y) {
+                                 const var_map_t& m_y, ap_state_ptr& s_y) {
 
           assert (m_x.size () == get_dims (s_x));
           assert (m_y.size () == get_dims (s_y));
 
-          // -- collect all vars from the two maps
-          std::set<VariableName> vars;
-          for (auto const& px: m_x.left)
-            vars.insert (px.first);
-          for (auto const& py: m_y.left)
-            vars.insert (py.first);
-
-          assert (vars.size () >= get_dims (s_x));
-          assert (vars.size () >= get_dims (s_y));
-
-          add_dimensions (s_x, vars.size () - get_dims (s_x));
-          add_dimensions (s_y, vars.size () - get_dims (s_y));
-
-          assert (get_dims (s_x) == get_dims (s_y));
-
-          // -- create a fresh map 
-          var_map_t res;
-          for (auto v: vars) {
-            ap_dim_t i = res.size ();
-            assert (i < get_dims (s_x));
-            res.insert (binding_t (v, i));
-          }
-          
-          // build the permutations maps
-          ap_dimperm_t* perm_x = ap_dimperm_alloc (get_dims (s_x));
-          ap_dimperm_t* perm_y = ap_dimperm_alloc (get_dims (s_x));
-          char * xmap1 = (char *)calloc (get_dims (s_x), sizeof(char));
-          if (!xmap1) CRAB_ERROR ("calloc does not have more available memory");
-          char * xmap2 = (char *)calloc (get_dims (s_x), sizeof(char));
-          if (!xmap2) CRAB_ERROR ("calloc does not have more available memory");
-          for (auto const &px: m_x.left) {
-            ap_dim_t ind = res.left.at (px.first);
-            perm_x->dim [px.second] = ind;
-            // This sets 1 if the index that has been assigned
-            assert (px.second < get_dims(s_x));
-            xmap1[px.second] = 1;
-            // This sets 1 if the value has been assigned
-            assert (ind < get_dims(s_x));
-            xmap2[ind] = 1;
-          }
-          ap_dim_t i, counter = 0;
-          for(i=0; i < get_dims (s_x); i++){
-            // If the index has been assigned, skip
-            if(xmap1[i]) continue;
-            // Find the next available element that has not been assigned
-            while(xmap2[counter])
-              counter++;
-            perm_x->dim[i] = counter;
-            counter++;
-          }
-          free (xmap1);
-          free (xmap2);
-
-          char * ymap1 = (char *)calloc (get_dims (s_x), sizeof(char));
-          if (!ymap1) CRAB_ERROR ("calloc does not have more available memory");
-          char * ymap2 = (char *)calloc (get_dims (s_x), sizeof(char));
-          if (!ymap2) CRAB_ERROR ("calloc does not have more available memory");
-          for (auto const &py: m_y.left) {
-            ap_dim_t ind = res.left.at (py.first);
-            perm_y->dim [py.second] = ind;
-            assert (py.second < get_dims(s_x));
-            ymap1[py.second] = 1;
-            assert (ind < get_dims(s_x));
-            ymap2[ind] = 1; 
-          }
-
-          counter = 0;
-          for(i=0; i < get_dims (s_x); i++){
-            if(ymap1[i]) continue;
-            while(ymap2[counter])
-              counter++;
-            perm_y->dim[i] = counter;
-            counter++;
+          if (same_vars (m_x, m_y)) 
+            return m_x;
+
+          vector<VariableName> only_x, only_y;
+          vector<ap_dim_t> new_x, new_y;
+          auto ix = m_x.left.begin (), ex = m_x.left.end ();
+          auto iy = m_y.left.begin (), ey = m_y.left.end ();
+          ap_dim_t dx = 0, dy = 0;
+          while (ix != ex || iy != ey) {
+            if (iy == ey || (ix != ex && ix->first < iy->first)) {
+              only_x.push_back (ix->first);
+              new_y.push_back (dy);
+              ++ix; ++dx;
+            } else if (ix == ex || iy->first < ix->first) {
+              only_y.push_back (iy->first);
+              new_x.push_back (dx);
+              ++iy; ++dy;
+            } else {
+              ++ix; ++dx; ++iy; ++dy;
+            }
           }
 
-          free (ymap1);
-          free (ymap2);
-
-          #if 0          
-          crab::outs() << "Permutations \n";
-          ap_dimperm_fprint(stdout, perm_x);          
-          crab::outs() << "Permutations \n";
-          ap_dimperm_fprint(stdout, perm_y);          
-          #endif 
-
-          assert (check_perm (perm_x, get_dims (s_x)));
-          assert (check_perm (perm_y, get_dims (s_x)));
+          add_dimensions (s_x, new_x);
+          add_dimensions (s_y, new_y);
 
-          // apply the permutations
-          s_x = apPtr (get_man (), 
-                       ap_abstract0_permute_dimensions(get_man (), false, &*s_x, perm_x));
-          s_y = apPtr (get_man (), 
-                       ap_abstract0_permute_dimensions(get_man (), false, &*s_y, perm_y));
-
-          ap_dimperm_free (perm_x);
-          ap_dimperm_free (perm_y);
+          // the map of the state that gains fewer variables is
+          // extended with them
+          var_map_t res (only_y.size () <= only_x.size () ? m_x : m_y);
+          insert_vars (res, only_y.size () <= only_x.size () ? only_y : only_x);
 
           assert (res.size () == get_dims (s_x));
           assert (res.size () == get_dims (s_y));
-
           return res;
         }
         
@@ -420,8 +411,11 @@ namespace crab {
 
         // --- from crab to apron
 
+        // pre: v was added (add_vars)
         inline ap_texpr0_t* var2texpr (VariableName v) { 
-          return ap_texpr0_dim (get_var_dim_insert (v));
+          auto dim = get_var_dim (v);
+          assert (dim);
+          return ap_texpr0_dim (*dim);
         }
 
         inline ap_texpr0_t* num2texpr (Number i) const {  
@@ -951,6 +945,7 @@ namespace crab {
         void operator += (linear_constraint_system_t csts) {
           if(is_bottom()) return;
 
+          add_vars (csts.variables (), vector<VariableName> ());
           ap_tcons0_array_t array = ap_tcons0_array_make (csts.size ());
           unsigned i=0;
           for (auto cst : csts) { 
@@ -971,9 +966,10 @@ namespace crab {
         void assign (VariableName x, linear_expression_t e) {
           if(is_bottom()) return;
 
+          add_vars (e.variables (), vector<VariableName> (1, x));
           ap_texpr0_t* t = expr2texpr (e);
           assert (t);
-          auto dim_x = get_var_dim_insert (x);
+          auto dim_x = *get_var_dim (x);
           m_apstate = apPtr (get_man (), 
                              ap_abstract0_assign_texpr(get_man (), false, 
                                                        &*m_apstate, 
@@ -987,6 +983,7 @@ namespace crab {
         void apply (operation_t op, VariableName x, VariableName y, Number z) {
           if(is_bottom()) return;
 
+          add_vars ({ x, y });
           ap_texpr0_t* a = var2texpr (y);
           ap_texpr0_t* b = num2texpr (z);
           ap_texpr0_t* res = nullptr;
@@ -1013,6 +1010,7 @@ namespace crab {
         void apply(operation_t op, VariableName x, VariableName y, VariableName z) {
           if(is_bottom()) return;
 
+          add_vars ({ x, y, z });
           ap_texpr0_t* a = var2texpr (y);
           ap_texpr0_t* b = var2texpr (z);
           ap_texpr0_t* res = nullptr;
@@ -1039,6 +1037,7 @@ namespace crab {
         void apply(operation_t op, VariableName x, Number k) {
           if(is_bottom()) return;
 
+          add_vars ({ x });
           ap_texpr0_t* a = var2texpr (x);
           ap_texpr0_t* b = num2texpr (k);
           ap_texpr0_t* res = nullptr;
@@ -1175,8 +1174,20 @@ namespace crab {
                              ap_abstract0_expand(get_man (), false, &* m_apstate, 
                                                  dim_x, 1));
           // --- the additional dimension is put at the end of integer
-          //     dimensions.
-          m_var_map.insert (binding_t (dup, get_dims () - 1));            
+          //     dimensions: move it to its place.
+          ap_dim_t last = get_dims () - 1;
+          ap_dim_t pos = canonical_dim (m_var_map, dup);
+          if (pos != last) {
+            ap_dimperm_t* perm = ap_dimperm_alloc (get_dims ());
+            for (ap_dim_t i=0; i < last; i++)
+              perm->dim[i] = (i < pos ? i : i + 1);
+            perm->dim[last] = pos;
+            m_apstate = apPtr (get_man (), 
+                               ap_abstract0_permute_dimensions(get_man (), false, 
+                                                               &*m_apstate, perm));
+            ap_dimperm_free (perm);
+          }
+          insert_vars (m_var_map, vector<VariableName> (1, dup));
         }
 
         void normalize () {
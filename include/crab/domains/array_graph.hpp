@@ -28,15 +28,8 @@
 
   FIXMEs:
 
-  - Use AdaptGraph instead of boost::graph
-  - Have a flag is_normalized and normalize only if the flag is false
-  - Perform incremental Floyd-Warshall by keeping track of changed edges.
   - array_graph::widening is normalizing both operands. The first
     operand cannot be normalized.
-  - perform common renaming before binary operations (join/widening/narrowing/meet)
-  - Do no use shared_ptr because we are doing deep copies Use magic
-    move semantics and also shared references with copy-on-write to
-    avoid unnecessary copies.
   - etc.
 
  */
@@ -44,18 +37,18 @@
 #ifndef ARRAY_GRAPH_HPP
 #define ARRAY_GRAPH_HPP
 
+#include <algorithm>
 #include <boost/optional.hpp>
 #include <boost/shared_ptr.hpp>
 #include <boost/tuple/tuple.hpp>
-#include <boost/graph/graph_traits.hpp> 
-#include <boost/graph/adjacency_list.hpp>
-#include <boost/graph/copy.hpp>
+#include <boost/unordered_map.hpp>
 #include <boost/lexical_cast.hpp>
 
 #include <crab/common/types.hpp>
 #include <crab/common/debug.hpp>
 #include <crab/common/stats.hpp>
 #include <crab/domains/patricia_trees.hpp>
+#include <crab/domains/graphs/adapt_sgraph.hpp>
 #include <crab/domains/numerical_domains_api.hpp>
 #include <crab/domains/bitwise_operators_api.hpp>
 #include <crab/domains/division_operators_api.hpp>
@@ -69,6 +62,89 @@ namespace crab {
 
   namespace domains {
 
+     /* 
+        Upper bounds of x - y implied by a scalar value, extracted once
+        from its constraints so that many queries do not need to copy
+        the value and add constraints to it. They are exact for
+        domains whose constraints are closed (see
+        diff_constraints_traits) but may miss bounds of any other
+        domain, so callers must then fall back on querying the value.
+      */
+     template<typename ScalarNumDomain>
+     class scalar_diff_bounds {
+       typedef typename ScalarNumDomain::number_t Number;
+       typedef typename ScalarNumDomain::varname_t VariableName;
+       typedef typename ScalarNumDomain::linear_constraint_t linear_constraint_t;
+       typedef bound<Number> bound_t;
+       typedef std::pair<index_t,index_t> diff_key_t;
+
+       boost::unordered_map<index_t, Number> _ub;
+       boost::unordered_map<index_t, Number> _lb;
+       boost::unordered_map<diff_key_t, Number> _diff; // x - y <= k
+
+       template<typename Map, typename Key>
+       static void tighten (Map &m, const Key &key, Number k) {
+         auto it = m.find (key);
+         if (it == m.end ()) 
+           m.insert (std::make_pair (key, k));
+         else if (k < it->second) 
+           it->second = k;
+       }
+
+       // e <= k
+       void add_leq (const linear_constraint_t &cst, bool negate) {
+         Number k = negate ? -cst.constant () : cst.constant ();
+         auto it = cst.begin ();
+         if (cst.size () == 1) {
+           Number c = negate ? -(it->first) : it->first;
+           index_t x = it->second.name ().index ();
+           if (c == 1) tighten (_ub, x, k);
+           else if (c == -1) tighten (_lb, x, -k);
+         } else if (cst.size () == 2) {
+           Number c1 = negate ? -(it->first) : it->first;
+           index_t x1 = it->second.name ().index ();
+           ++it;
+           Number c2 = negate ? -(it->first) : it->first;
+           index_t x2 = it->second.name ().index ();
+           if (c1 == 1 && c2 == -1) tighten (_diff, std::make_pair (x1, x2), k);
+           else if (c1 == -1 && c2 == 1) tighten (_diff, std::make_pair (x2, x1), k);
+         }
+       }
+
+       bound_t ub (index_t x) const {
+         auto it = _ub.find (x);
+         return (it == _ub.end () ? bound_t::plus_infinity () : bound_t (it->second));
+       }
+
+       bound_t lb (index_t x) const {
+         auto it = _lb.find (x);
+         return (it == _lb.end () ? bound_t::minus_infinity () : bound_t (it->second));
+       }
+
+      public:
+
+       scalar_diff_bounds (ScalarNumDomain scalar) {
+         for (auto const &cst : scalar.to_linear_constraint_system ()) {
+           if (cst.is_inequality () || cst.is_equality ()) 
+             add_leq (cst, false);
+           if (cst.is_equality ()) 
+             add_leq (cst, true);
+         }
+       }
+
+       //! Return an upper bound of x - y
+       bound_t ub_diff (const VariableName &x, const VariableName &y) const {
+         index_t ix = x.index ();
+         index_t iy = y.index ();
+         if (ix == iy) return bound_t (0);
+         bound_t res = ub (ix) - lb (iy);
+         auto it = _diff.find (std::make_pair (ix, iy));
+         if (it != _diff.end ()) 
+           res = bound_t::min (res, bound_t (it->second));
+         return res;
+       }
+     };
+
      /*
        A weighted array graph is a graph (V,E,L) where V is the set of
        vertices, E the edges and L is a label function: E -> W such that:
@@ -90,89 +166,116 @@ namespace crab {
        friend class array_graph_domain;
        
        typedef index_t key_t;
-       typedef boost::shared_ptr<VertexName> VertexNamePtr;
-       typedef boost::shared_ptr<Weight>     WeightPtr;
-       struct  graph_vertex_t { VertexNamePtr name; };
-       struct  graph_edge_t   { WeightPtr weight; }; 
        
       public:
        typedef array_graph<VertexName,Weight,ScalarNumDomain,IsDistWeight> array_graph_t;
        typedef boost::tuple<VertexName, VertexName, Weight> edge_t;
        
       private:
-       typedef adjacency_list<listS,listS,bidirectionalS,graph_vertex_t,graph_edge_t> graph_t;
-       
-       typedef typename graph_traits<graph_t>::edge_iterator     edge_iterator;
-       typedef typename graph_traits<graph_t>::vertex_iterator   vertex_iterator;
-       typedef typename graph_traits<graph_t>::edge_descriptor   edge_descriptor_t;
-       typedef typename graph_traits<graph_t>::vertex_descriptor vertex_descriptor_t;
-       typedef typename graph_traits<graph_t>::out_edge_iterator out_edge_iterator;  
-       typedef typename graph_traits<graph_t>::in_edge_iterator  in_edge_iterator;  
+       typedef AdaptGraph<Weight> graph_t;
+       typedef typename graph_t::vert_id vert_id;
        
        typedef typename ScalarNumDomain::linear_constraint_t     linear_constraint_t;
        typedef typename ScalarNumDomain::variable_t              variable_t;
        
-       typedef boost::unordered_map<key_t, vertex_descriptor_t >  vertex_map_t;
+       typedef boost::unordered_map<key_t, vert_id>  vertex_map_t;
+       typedef std::vector<boost::optional<VertexName> > rev_map_t;
        
        typedef std::set<VertexName> vertex_names_set_t;
        
-       typedef boost::shared_ptr <graph_t> graph_ptr;
-       typedef boost::shared_ptr< vertex_map_t > vertex_map_ptr;
-       typedef boost::shared_ptr< vertex_names_set_t > vertex_names_set_ptr;
+       typedef std::vector<std::pair<vert_id, vert_id> > edge_vector_t;
        
+       struct graph_rep {
+         graph_t graph; 
+         vertex_map_t vertex_map;   //! map a VertexName to a graph vertex
+         rev_map_t rev_map;         //! map a graph vertex to its VertexName
+         vertex_names_set_t vertices_set;
+         // Edges whose weight changed since the graph was last closed.
+         // The graph is in canonical form iff it is empty.
+         edge_vector_t changed;
+       };
+       typedef boost::shared_ptr<graph_rep> graph_rep_ptr;
+
        bool _is_bottom;
-       graph_ptr  _graph; 
-       vertex_map_ptr _vertex_map;   //! map a VertexName to a graph vertex
-       vertex_names_set_ptr _vertices_set;
+       // Shared between copies and cloned before the first update
+       // (see detach).
+       graph_rep_ptr _rep;
        
        bool find_vertex_map (VertexName v) {
-         return (_vertex_map->find(v.index()) != _vertex_map->end()); 
+         return (_rep->vertex_map.find(v.index()) != _rep->vertex_map.end()); 
        }
        
-       void insert_vertex_map (VertexName key, vertex_descriptor_t value)
+       void insert_vertex_map (VertexName key, vert_id value)
        {
          if (find_vertex_map(key))
            CRAB_ERROR (key," already in the vertex map");
          
-         _vertex_map->insert (make_pair(key.index(), value));
-         _vertices_set->insert (key);
+         _rep->vertex_map.insert (make_pair(key.index(), value));
+         _rep->vertices_set.insert (key);
+         if (value >= _rep->rev_map.size())
+           _rep->rev_map.resize (value + 1);
+         _rep->rev_map[value] = key;
        }
        
        void remove_vertex_map (VertexName key)
        {
-         _vertex_map->erase (key.index());
-         _vertices_set->erase (key);
+         auto it = _rep->vertex_map.find(key.index());
+         if (it != _rep->vertex_map.end()) {
+           _rep->rev_map[it->second] = boost::none;
+           _rep->vertex_map.erase (it);
+         }
+         _rep->vertices_set.erase (key);
        }
     
-       vertex_descriptor_t lookup_vertex_map (VertexName key) const
+       vert_id lookup_vertex_map (VertexName key) const
        {
-         auto it = _vertex_map->find(key.index());
-         if (it != _vertex_map->end())
+         auto it = _rep->vertex_map.find(key.index());
+         if (it != _rep->vertex_map.end())
            return it->second;
       
          CRAB_ERROR ("No vertex with name ",key," found in the graph");
        }
+
+       const VertexName& vertex_name (vert_id v) const
+       {
+         assert (v < _rep->rev_map.size() && _rep->rev_map[v]);
+         return *(_rep->rev_map[v]);
+       }
     
+       // Make sure this is the only owner of the graph before
+       // updating it.
+       void detach ()
+       {
+         if (!_rep.unique())
+           _rep.reset (new graph_rep(*_rep));
+       }
+
+       void mark_changed (vert_id u, vert_id v) 
+       {
+         _rep->changed.push_back (std::make_pair(u, v));
+       }
+
        // All methods that add new vertices should call this one.
        void add (vector<VertexName> vertices, vector<edge_t> edges) 
        {
+         detach();
          for(auto v: vertices)
          {
-           vertex_descriptor_t u = add_vertex(*_graph);
-           (*_graph)[u].name = VertexNamePtr (new VertexName(v));
+           vert_id u = _rep->graph.new_vertex();
            insert_vertex_map(v, u);
          }
       
          for(auto e: edges)
          {
-           vertex_descriptor_t u =  lookup_vertex_map(e.template get<0>());
-           vertex_descriptor_t v =  lookup_vertex_map(e.template get<1>());
-           edge_descriptor_t k; bool b;
-           boost::tie(k,b) = add_edge(u, v, *_graph);
-           if (!b)
+           vert_id u = lookup_vertex_map(e.template get<0>());
+           vert_id v = lookup_vertex_map(e.template get<1>());
+           if (_rep->graph.elem(u, v))
              CRAB_ERROR ("edge is already in the graph");
         
-           (*_graph)[k].weight = WeightPtr(new Weight(e.template get<2>()));
+           _rep->graph.add_edge(u, e.template get<2>(), v);
+           // A top edge cannot tighten anything
+           if (!e.template get<2>().is_top())
+             mark_changed(u, v);
          }
       
          canonical();
@@ -184,13 +287,11 @@ namespace crab {
          if (!find_vertex_map (v)) return ;
       
          canonical(); 
-         vertex_descriptor_t u = lookup_vertex_map(v);
-      
-         // remove all in and out edges to/from u
-         clear_vertex(u, *_graph);
+         detach();
+         vert_id u = lookup_vertex_map(v);
       
-         // remove the vertex
-         remove_vertex(u, *_graph);
+         // remove the vertex and all its in and out edges
+         _rep->graph.forget(u);
          remove_vertex_map(v);
        }
     
@@ -198,55 +299,113 @@ namespace crab {
        // For our canonical form, we would like to compute the greatest
        // fixed point to the set of inequalities:
        //    \forall i,j,k. G[i,j] \subseteq G[i,k] \cup G[k,j]
-       // If the weight domain is distributive we can solve this set of
-       // inequations by solving:
+       // by solving:
        //    \forall i,j,k. G[i,j] = G[i,j] \cap G[i,k] \cup G[k,j]
-       // The Floyd-Warshall algorithm does exactly that.
-       // Otherwise, we iterate the Floyd-Warshall algorithm until no change.
+       //
+       // Once the graph is closed, an inequation can only be violated
+       // if one of its edges changed. We keep the changed edges in a
+       // worklist and, for each of them, only revisit the inequations
+       // where it occurs. Edges tightened along the way are pushed
+       // back. This reaches the same fixpoint as iterating
+       // Floyd-Warshall until no change, whether or not the weight
+       // domain is distributive.
        ///////////////////////////////////////////////////////////////////////
-       bool oneStep()
+
+       // G[i,j] = G[i,j] \cap w
+       void tighten (vert_id i, vert_id j, Weight& w)
+       {
+         binary_meet_op meet;
+         Weight& old_w = _rep->graph.edge_val(i, j);
+         if (old_w <= w)
+           return;
+         Weight new_w = meet(old_w, w);
+         if (!(old_w <= new_w))
+         {
+           old_w = new_w;
+           mark_changed(i, j);
+         }
+       }
+
+       void close_over_edge (vert_id a, vert_id b)
        {
          binary_join_op join;
          binary_meet_op meet;
-         vertex_iterator ki, ke, ii, ie, ji, je;
-         bool change = false;
-         for (tie(ki, ke) = vertices(*_graph); ki != ke; ++ki)
+
+         // Joins with a top edge are top and tighten nothing, so top
+         // edges are skipped. Most edges are top until the first
+         // array writes.
+
+         // G[a,b] may have been weakened: G[a,b] \subseteq G[a,k] \cup G[k,b]
+         Weight& w = _rep->graph.edge_val(a, b);
+         for (auto e : _rep->graph.e_succs(a))
+         {
+           if (w.is_bottom())
+             break;
+           vert_id k = e.vert;
+           if (k == b || e.val.is_top() || !_rep->graph.elem(k, b))
+             continue;
+           Weight& w_kb = _rep->graph.edge_val(k, b);
+           if (w_kb.is_top())
+             continue;
+           Weight w_akb = join(e.val, w_kb);
+           if (!(w <= w_akb))
+             w = meet(w, w_akb);
+         }
+         if (w.is_top())
+           return;
+
+         // Bottom edges cannot be tightened, and joins with a bottom
+         // G[a,b] need not be computed.
+         // G[a,b] is not changed below
+         Weight& w_ab = w;
+         bool ab_is_bot = w_ab.is_bottom();
+         // G[a,j] \subseteq G[a,b] \cup G[b,j]
+         for (auto e : _rep->graph.e_succs(b))
+         {
+           vert_id j = e.vert;
+           if (j == a || e.val.is_top() || !_rep->graph.elem(a, j) ||
+               _rep->graph.edge_val(a, j).is_bottom())
+             continue;
+           if (ab_is_bot)
+             tighten (a, j, e.val);
+           else
+           {
+             Weight w_abj = join(w_ab, e.val);
+             tighten (a, j, w_abj);
+           }
+         }
+         // G[i,b] \subseteq G[i,a] \cup G[a,b]
+         for (auto e : _rep->graph.e_preds(a))
          {
-           for (tie(ii, ie) = vertices(*_graph); ii != ie; ++ii)
+           vert_id i = e.vert;
+           if (i == b || e.val.is_top() || !_rep->graph.elem(i, b) ||
+               _rep->graph.edge_val(i, b).is_bottom())
+             continue;
+           if (ab_is_bot)
+             tighten (i, b, e.val);
+           else
            {
-             if (edge(*ii, *ki, *_graph).second)
-             {
-               for (tie(ji, je) = vertices(*_graph); ji != je; ++ji)
-               {
-                 if (edge(*ii, *ji, (*_graph)).second && 
-                     edge(*ki, *ji, (*_graph)).second) 
-                 {
-                   auto e_ij = edge(*ii, *ji, (*_graph)).first;
-                   auto e_ik = edge(*ii, *ki, (*_graph)).first;
-                   auto e_kj = edge(*ki, *ji, (*_graph)).first;
-                   auto Old = (*_graph)[e_ij].weight;
-                   auto New = meet((*_graph)[e_ij].weight,
-                                   (join((*_graph)[e_ik].weight,
-                                         (*_graph)[e_kj].weight)));
-                   change |= (!(*Old <= *New && *New <= *Old));
-                   (*_graph)[e_ij].weight = New;
-                 }
-               }
-             }
+             Weight w_iab = join(e.val, w_ab);
+             tighten (i, b, w_iab);
            }
          }
-         return change;
        }
     
+       // Closing does not change the meaning of the graph but it
+       // writes the weights, so a shared graph is copied first: other
+       // copies may be read or closed at the same time.
        void canonical()
        {
-         if (IsDistWeight)
-           oneStep ();
-         else
+         if (_rep->changed.empty())
+           return;
+         detach();
+         while (!_rep->changed.empty())
          {
-           bool change = true;
-           while (change)
-             change = oneStep ();
+           vert_id a = _rep->changed.back().first;
+           vert_id b = _rep->changed.back().second;
+           _rep->changed.pop_back();
+           if (_rep->graph.elem(a, b))
+             close_over_edge (a, b);
          }
        }
     
@@ -257,13 +416,12 @@ namespace crab {
            vector<VertexName> new_vertices;
            new_vertices.push_back(u);
            vector<edge_t> new_edges;
-           vertex_iterator i, e;
-           for (tie(i, e) = vertices(*_graph); i != e; ++i)
+           for (vert_id i : _rep->graph.verts())
            {
-             VertexNamePtr v = (*_graph)[*i].name;
+             const VertexName& v = vertex_name(i);
              // add two edges in both directions
-             new_edges.push_back(edge_t(u, *v, val));
-             new_edges.push_back(edge_t(*v, u, val));
+             new_edges.push_back(edge_t(u, v, val));
+             new_edges.push_back(edge_t(v, u, val));
            }
            add(new_vertices, new_edges);
          }
@@ -281,10 +439,13 @@ namespace crab {
        {
          if (!is_bottom ())
          {      
-           vertex_descriptor_t u = lookup_vertex_map(v);
-           in_edge_iterator in_it, in_et;
-           for (tie(in_it, in_et) = in_edges(u, *_graph); in_it != in_et; ++in_it)
-             (*_graph)[*in_it].weight = WeightPtr( new Weight(weight));
+           detach();
+           vert_id u = lookup_vertex_map(v);
+           for (auto e : _rep->graph.e_preds(u))
+           {
+             e.val = weight;
+             mark_changed(e.vert, u);
+           }
          }
        }
     
@@ -293,98 +454,154 @@ namespace crab {
        {
          if (!is_bottom ())
          {
-           vertex_descriptor_t u = lookup_vertex_map(v);
-           out_edge_iterator out_it, out_et;
-           for (tie(out_it, out_et) = out_edges(u, *_graph); 
-                out_it != out_et; ++out_it)
-             (*_graph)[*out_it].weight = WeightPtr( new Weight(weight));
+           detach();
+           vert_id u = lookup_vertex_map(v);
+           for (auto e : _rep->graph.e_succs(u))
+           {
+             e.val = weight;
+             mark_changed(u, e.vert);
+           }
          }
        }
+
+       // Forget v in all the weights. Projection distributes over
+       // join so this preserves the canonical form.
+       void forget_in_weights (const VertexName &v)
+       {
+         detach();
+         for (vert_id u : _rep->graph.verts())
+           for (auto e : _rep->graph.e_succs(u))
+             e.val -= v;
+       }
     
+       // The operands are taken by reference to save copies of the
+       // weights in the closure.
        struct binary_join_op{
-         WeightPtr operator()(WeightPtr w1, WeightPtr w2) {
-           return WeightPtr(new Weight(*w1 | *w2));
+         enum { upper_bound = 1 };
+         enum { preserves_closure = 1 };
+         Weight operator()(Weight& w1, Weight& w2) {
+           return w1 | w2;
          }
        };
     
        struct binary_meet_op{
-         WeightPtr operator()(WeightPtr w1, WeightPtr w2) {
-           return WeightPtr(new Weight(*w1 & *w2));
+         enum { upper_bound = 0 };
+         enum { preserves_closure = 0 };
+         Weight operator()(Weight& w1, Weight& w2) {
+           return w1 & w2;
          }
        };
     
        struct binary_widening_op{
-         WeightPtr operator()(WeightPtr w1, WeightPtr w2) {
-           return WeightPtr(new Weight(*w1 || *w2));
+         enum { upper_bound = 1 };
+         enum { preserves_closure = 0 };
+         Weight operator()(Weight& w1, Weight& w2) {
+           return w1 || w2;
          }
        };
     
        struct binary_narrowing_op{
-         WeightPtr operator()(WeightPtr w1, WeightPtr w2) {
-           return WeightPtr(new Weight(*w1 && *w2));
+         enum { upper_bound = 0 };
+         enum { preserves_closure = 0 };
+         Weight operator()(Weight& w1, Weight& w2) {
+           return w1 && w2;
          }
        };
     
     
+       // Common renaming: make g1 and g2 have the same vertices. A
+       // vertex missing in one graph is unconstrained there. If
+       // upper_bound then the vertices that are not in both graphs are
+       // removed since they would be unconstrained in the result
+       // anyway. Otherwise, they are added to the other graph with
+       // unconstrained edges.
+       static void unify_vertices (array_graph_t &g1, array_graph_t &g2, 
+                                   bool upper_bound)
+       {
+         if (g1._rep == g2._rep || 
+             g1._rep->vertices_set == g2._rep->vertices_set)
+           return;
+
+         vector<VertexName> only_g1, only_g2;
+         std::set_difference (g1._rep->vertices_set.begin(), g1._rep->vertices_set.end(),
+                              g2._rep->vertices_set.begin(), g2._rep->vertices_set.end(),
+                              std::back_inserter(only_g1));
+         std::set_difference (g2._rep->vertices_set.begin(), g2._rep->vertices_set.end(),
+                              g1._rep->vertices_set.begin(), g1._rep->vertices_set.end(),
+                              std::back_inserter(only_g2));
+         if (upper_bound)
+         {
+           for (auto v: only_g1)
+             g1 -= v;
+           for (auto v: only_g2)
+             g2 -= v;
+         }
+         else
+         {
+           for (auto v: only_g2)
+             g1.insert_vertex (v);
+           for (auto v: only_g1)
+             g2.insert_vertex (v);
+         }
+       }
+
+       // pre: g1 and g2 have the same vertices.
+       // Return the vertex of g2 for each vertex of g1.
+       static vector<vert_id> common_renaming (array_graph_t &g1, array_graph_t &g2)
+       {
+         vector<vert_id> perm (g1._rep->graph.size(), 0);
+         for (vert_id u_1 : g1._rep->graph.verts())
+           perm[u_1] = g2.lookup_vertex_map(g1.vertex_name(u_1));
+         return perm;
+       }
+    
        template<typename Op>
-       void pointwise_binop_helper (array_graph_t &g1, 
-                                    const array_graph_t &g2)
+       static void pointwise_binop_helper (array_graph_t &g1, 
+                                           array_graph_t &g2)
        {
          // pre: g1 and g2 have the same adjacency structure
-         edge_iterator it_1, et_1;
-         for(tie(it_1,et_1) = edges(*g1._graph); it_1 != et_1; ++it_1)
+         vector<vert_id> perm = common_renaming (g1, g2);
+         g1.detach();
+         Op op;
+         for (vert_id u_1 : g1._rep->graph.verts())
          {
-           edge_descriptor_t e_1   = *it_1;
-           vertex_descriptor_t u_1 = source(e_1, *g1._graph);
-           vertex_descriptor_t v_1 = target(e_1, *g1._graph);
-           VertexNamePtr u_name_1  = (*g1._graph)[u_1].name;
-           VertexNamePtr v_name_1  = (*g1._graph)[v_1].name;
-           WeightPtr     weight_1  = (*g1._graph)[e_1].weight;
-           vertex_descriptor_t u_2 = g2.lookup_vertex_map(*u_name_1);
-           vertex_descriptor_t v_2 = g2.lookup_vertex_map(*v_name_1);
-           if (edge(u_2, v_2, *g2._graph).second)
+           vert_id u_2 = perm[u_1];
+           for (auto e_1 : g1._rep->graph.e_succs(u_1))
            {
-             Op op;
-             edge_descriptor_t e_2 = edge(u_2, v_2, *g2._graph).first;
-             (*g1._graph)[e_1].weight = 
-                 op((*g1._graph)[e_1].weight, (*g2._graph)[e_2].weight);
+             vert_id v_2 = perm[e_1.vert];
+             if (!g2._rep->graph.elem(u_2, v_2))
+               CRAB_ERROR("unreachable");
+             Weight w = op(e_1.val, g2._rep->graph.edge_val(u_2, v_2));
+             // The pointwise join of two closed graphs is closed.
+             // Otherwise, only the edges that changed must be closed
+             // again.
+             if (!Op::preserves_closure && 
+                 (!(e_1.val <= w) || !(w <= e_1.val)))
+               g1.mark_changed(u_1, e_1.vert);
+             e_1.val = w;
            }
-           else
-             CRAB_ERROR("unreachable");
-         } 
+         }
        }
     
        template<typename Op>
-       array_graph_t pointwise_binop (array_graph_t g1, 
-                                      array_graph_t g2)
+       static array_graph_t pointwise_binop (array_graph_t g1, 
+                                             array_graph_t g2)
        {
+         // The operators are idempotent.
+         if (g1._rep == g2._rep)
+           return g1;
+
          g1.canonical();
          g2.canonical();
+         unify_vertices (g1, g2, Op::upper_bound);
       
-         // if (*(g1._vertices_set) != *(g2._vertices_set)){
-         //   set<VertexName> all_vs;
-         //   set_union(g1._vertices_set->begin(), g1._vertices_set->end(), 
-         //             g2._vertices_set->begin(), g2._vertices_set->end(), inserter(all_vs, all_vs.end()));
-         //   vector<VertexName> new_g1, new_g2;
-         //   set_difference(all_vs.begin(), all_vs.end(),
-         //                  g1._vertices_set->begin(), g1._vertices_set->end(), inserter(new_g1, new_g1.end()));
-         //   set_difference(all_vs.begin(), all_vs.end(),
-         //                  g2._vertices_set->begin(), g2._vertices_set->end(), inserter(new_g2, new_g2.end()));
-         //   insert_vertices<typename vector<VertexName>::iterator>(g1, new_g1.begin(), new_g1.end());
-         //   insert_vertices<typename vector<VertexName>::iterator>(g2, new_g2.begin(), new_g2.end());
-         // }
-      
-         // pre: g1 and g2 have the same set of vertices and edges at this
-         // point
          pointwise_binop_helper<Op>(g1,g2);
          return g1;
        }
     
        array_graph(bool is_bot): 
-           _is_bottom(is_bot), 
-           _graph(new graph_t(0)), 
-           _vertex_map(new vertex_map_t()), 
-           _vertices_set(new vertex_names_set_t()) 
+           _is_bottom(is_bot),
+           _rep(new graph_rep())
        {  }
     
       public:
@@ -393,58 +610,22 @@ namespace crab {
     
        static array_graph_t top() { return array_graph(false); }
     
-       // Deep copy of the array graph
+       // Copies share the graph until one of them is updated.
        array_graph(const array_graph_t &other): 
            writeable(), 
            _is_bottom(other._is_bottom), 
-           //_graph(new graph_t(*other._graph)),
-           //_vertex_map(new vertex_map_t(*other._vertex_map)),
-           //_vertices_set( new vertex_names_set_t(*other._vertices_set))
-           _graph (new graph_t(0)),
-           _vertex_map (new vertex_map_t()), 
-           _vertices_set (new vertex_names_set_t())
+           _rep(other._rep)
        {
          crab::CrabStats::count ("Domain.count.copy");
-         crab::ScopedCrabStats __st__("Domain.copy");
-
-         if (!is_bottom ())
-         {
-           // copy vertices, _vertex_map and _vertices_set
-           vertex_iterator i, e;
-           for (tie(i, e) = vertices(*other._graph); i != e; ++i)
-           {
-             vertex_descriptor_t u  = add_vertex(*_graph);
-             VertexName u_name = *((*other._graph)[*i].name);
-             (*_graph)[u].name = VertexNamePtr(new VertexName(u_name));
-             insert_vertex_map(u_name, u);
-           }
-        
-           // copy edges
-           edge_iterator ie, ee;
-           for(tie(ie,ee) = edges(*other._graph); ie != ee; ++ie)
-           {
-             VertexName u = *((*other._graph)[source(*ie, *other._graph)].name);
-             VertexName v = *((*other._graph)[target(*ie, *other._graph)].name);
-             Weight     w = *((*other._graph)[*ie].weight);
-             vertex_descriptor_t _u = lookup_vertex_map(u);
-             vertex_descriptor_t _v = lookup_vertex_map(v);
-             edge_descriptor_t _e; bool b;
-             boost::tie(_e,b) = add_edge(_u, _v, *_graph);
-             (*_graph)[_e].weight = WeightPtr(new Weight(w));      
-           }
-         }
        }
     
        array_graph_t& operator=(const array_graph_t &other)
        {
          crab::CrabStats::count ("Domain.count.copy");
-         crab::ScopedCrabStats __st__("Domain.copy");
          if (this != &other)
          {
-           _is_bottom      = other._is_bottom;
-           _graph          = other._graph;
-           _vertex_map     = other._vertex_map;
-           _vertices_set   = other._vertices_set;
+           _is_bottom = other._is_bottom;
+           _rep       = other._rep;
          }
          return *this;
        }
@@ -457,15 +638,11 @@ namespace crab {
            return false;
          else
          {
-           // FIXME: speedup this operation
            canonical();
-           edge_iterator it, et;
-           for(tie(it,et) = edges(*_graph); it != et; ++it)
-           {
-             edge_descriptor_t e = *it;
-             if (!(*(*_graph)[e].weight).is_top ()) 
-               return false;
-           }
+           for (vert_id u : _rep->graph.verts())
+             for (auto e : _rep->graph.e_succs(u))
+               if (!e.val.is_top ()) 
+                 return false;
            return true;
          }
        }
@@ -476,19 +653,37 @@ namespace crab {
       
          canonical();
       
-         edge_iterator it, et;
-         for(tie(it,et) = edges(*_graph); it != et; ++it)
+         scalar_diff_bounds<ScalarNumDomain> diffs (scalar);
+         vector<std::pair<vert_id, vert_id> > empty_edges;
+         for (vert_id u : _rep->graph.verts())
          {
-           edge_descriptor_t e   = *it;
-           VertexNamePtr u = (*_graph)[source(e, *_graph)].name;
-           VertexNamePtr v = (*_graph)[target(e, *_graph)].name;
-           ScalarNumDomain tmp(scalar);
-           linear_constraint_t cst ( variable_t(*u) <= variable_t(*v) - 1);
-           tmp += cst;
-           if (tmp.is_bottom())
-             (*_graph)[e].weight = WeightPtr(new Weight(Weight::bottom()));         
+           for (auto e : _rep->graph.e_succs(u))
+           {
+             if (e.val.is_bottom())
+               continue;
+             // u <= v - 1 is unsatisfiable if scalar implies v - u <= 0
+             bool empty = (diffs.ub_diff (vertex_name(e.vert), vertex_name(u)) <= 0);
+             if (!empty && !diff_constraints_traits<ScalarNumDomain>::closed)
+             {
+               ScalarNumDomain tmp(scalar);
+               tmp += linear_constraint_t ( variable_t(vertex_name(u)) <= 
+                                            variable_t(vertex_name(e.vert)) - 1);
+               empty = tmp.is_bottom();
+             }
+             if (empty)
+               empty_edges.push_back (std::make_pair (u, e.vert));
+           }
+         }
+         // the graph is only copied if it is shared and changes
+         if (empty_edges.empty ())
+           return;
+
+         detach();
+         for (auto p : empty_edges)
+         {
+           _rep->graph.edge_val(p.first, p.second) = Weight::bottom();
+           mark_changed(p.first, p.second);
          }
-      
          canonical();
        }
     
@@ -501,29 +696,28 @@ namespace crab {
            return false;
          else
          {
-           canonical();
+           if (_rep == other._rep)
+             return true;
+
+           array_graph_t g1 (*this);
+           g1.canonical();
            other.canonical();
-           edge_iterator it_1, et_1;
-           edge_iterator it_2, et_2;
-           for(tie(it_1,et_1) = edges(*_graph); it_1 != et_1; ++it_1)
+           unify_vertices (g1, other, false);
+           vector<vert_id> perm = common_renaming (g1, other);
+           for (vert_id u_1 : g1._rep->graph.verts())
            {
-             edge_descriptor_t e_1 = *it_1;
-             vertex_descriptor_t u_1 = source(e_1, *_graph);
-             vertex_descriptor_t v_1 = target(e_1, *_graph);
-             VertexNamePtr u_name_1 = (*_graph)[u_1].name;
-             VertexNamePtr v_name_1 = (*_graph)[v_1].name;
-             WeightPtr     weight_1 = (*_graph)[e_1].weight;
-             vertex_descriptor_t u_2 = other.lookup_vertex_map(*u_name_1);
-             vertex_descriptor_t v_2 = other.lookup_vertex_map(*v_name_1);
-             if (edge(u_2,v_2, *other._graph).second)
+             vert_id u_2 = perm[u_1];
+             for (auto e_1 : g1._rep->graph.e_succs(u_1))
              {
-               edge_descriptor_t e_2 = edge(u_2,v_2, *other._graph).first;
-               WeightPtr weight_2 = (*other._graph)[e_2].weight;
-               if (!(*weight_1 <= *weight_2))
-                 return false;
+               vert_id v_2 = perm[e_1.vert];
+               if (other._rep->graph.elem(u_2, v_2))
+               {
+                 if (!(e_1.val <= other._rep->graph.edge_val(u_2, v_2)))
+                   return false;
+               }
+               else
+                 CRAB_ERROR ("operator<= with graphs with different adjacency structure");
              }
-             else
-               CRAB_ERROR ("operator<= with graphs with different adjacency structure");
            }
            return true;
          }
@@ -533,7 +727,7 @@ namespace crab {
        {
          if (is_bottom()) return other.is_bottom();
          else
-           return (*(_vertices_set) == *(other._vertices_set) && 
+           return (_rep->vertices_set == other._rep->vertices_set && 
                    ( *this <= other && other <= *this));
        }
     
@@ -598,12 +792,13 @@ namespace crab {
        {
          if (find_vertex_map(src) && find_vertex_map(dest))
          {
-           vertex_descriptor_t u = lookup_vertex_map(src);
-           vertex_descriptor_t v = lookup_vertex_map(dest);
-           if (edge(u,v,*_graph).second) {
-             edge_descriptor_t e = edge(u,v,*_graph).first;
-             Weight meet = weight & (*(*_graph)[e].weight);
-             (*_graph)[e].weight = WeightPtr(new Weight(meet));
+           detach();
+           vert_id u = lookup_vertex_map(src);
+           vert_id v = lookup_vertex_map(dest);
+           if (_rep->graph.elem(u,v)) {
+             Weight& w = _rep->graph.edge_val(u,v);
+             w = weight & w;
+             mark_changed(u, v);
            }
            else {
              vector<VertexName> vertices;
@@ -619,11 +814,12 @@ namespace crab {
        {
          if (find_vertex_map(src) && find_vertex_map(dest))
          {
-           vertex_descriptor_t u = lookup_vertex_map(src);
-           vertex_descriptor_t v = lookup_vertex_map(dest);
-           if (edge(u,v,*_graph).second) {
-             edge_descriptor_t e = edge(u,v,*_graph).first;
-             (*_graph)[e].weight = WeightPtr(new Weight(weight));
+           detach();
+           vert_id u = lookup_vertex_map(src);
+           vert_id v = lookup_vertex_map(dest);
+           if (_rep->graph.elem(u,v)) {
+             _rep->graph.edge_val(u,v) = weight;
+             mark_changed(u, v);
            }
            else {
              vector<VertexName> vertices;
@@ -634,17 +830,14 @@ namespace crab {
          }
        }
     
-       Weight& get_weight (const VertexName &src, const VertexName &dest) 
+       Weight get_weight (const VertexName &src, const VertexName &dest) 
        {
          if (find_vertex_map(src) && find_vertex_map(dest))
          {
-           vertex_descriptor_t u = lookup_vertex_map(src);
-           vertex_descriptor_t v = lookup_vertex_map(dest);
-           if (edge(u,v,*_graph).second)
-           {
-             edge_descriptor_t e = edge(u,v,*_graph).first;
-             return *((*_graph)[e].weight);
-           }
+           vert_id u = lookup_vertex_map(src);
+           vert_id v = lookup_vertex_map(dest);
+           if (_rep->graph.elem(u,v))
+             return _rep->graph.edge_val(u,v);
          }
          CRAB_ERROR ("No edge found with given vertices");
        }
@@ -655,32 +848,25 @@ namespace crab {
            o << "_|_";
          else
          {
+           o << "(V={";
+           for (auto &u_name : _rep->vertices_set)
+             o << u_name << " ";
+           o << "},";
+           o << "E={";
+           for (auto &u_name : _rep->vertices_set)
            {
-             vertex_iterator it, et;
-             o << "(V={";
-             for (tie(it, et) = vertices(*_graph); it != et; ++it){
-               vertex_descriptor_t u = *it;
-               VertexNamePtr u_name  = (*_graph)[u].name;          
-               o << *u_name << " ";
-             }
-             o << "},";
-           }
-           {
-             edge_iterator it, et;
-             o << "E={";
-             for(tie(it,et) = edges(*_graph); it!= et; ++it)
+             vert_id u = lookup_vertex_map(u_name);
+             for (auto &v_name : _rep->vertices_set)
              {
-               edge_descriptor_t e   = *it;
-               vertex_descriptor_t u = source(e, *_graph);
-               vertex_descriptor_t v = target(e, *_graph);
-               VertexNamePtr u_name = (*_graph)[u].name;
-               VertexNamePtr v_name = (*_graph)[v].name;
-               WeightPtr     weight = (*_graph)[e].weight;
-               if (!weight->is_bottom())
-                 o << "(" << *u_name << "," << *v_name << "," << *weight << ") ";
+               vert_id v = lookup_vertex_map(v_name);
+               if (!_rep->graph.elem(u, v))
+                 continue;
+               Weight& weight = _rep->graph.edge_val(u, v);
+               if (!weight.is_bottom())
+                 o << "(" << u_name << "," << v_name << "," << weight << ") ";
              }
-             o << "})";
            }
+           o << "})";
          }
        }
      }; // end class array_graph
@@ -848,6 +1034,22 @@ namespace crab {
         return (*_succ_idx_map)[v];
       }
 
+      succ_index_map_ptr join_succ_idx_map (const array_graph_domain_t& other) const
+      {
+        if (_succ_idx_map == other._succ_idx_map)
+          return _succ_idx_map;
+        return succ_index_map_ptr(new succ_index_map_t(*_succ_idx_map | 
+                                                       *other._succ_idx_map));
+      }
+
+      // The map is shared between copies: copy it before modifying it.
+      succ_index_map_t& succ_idx_map_mut ()
+      {
+        if (!_succ_idx_map.unique())
+          _succ_idx_map.reset(new succ_index_map_t(*_succ_idx_map));
+        return *_succ_idx_map;
+      }
+
       template <typename VariableFactory>
       VariableName add_variable (Number n, VariableFactory &vfac)
       {
@@ -873,7 +1075,7 @@ namespace crab {
 
           _g.insert_vertex (v);
           _g.insert_vertex (v_succ);
-          _succ_idx_map->set (v, v_succ);
+          succ_idx_map_mut().set (v, v_succ);
       
           /// FIXME: assume that the array element size is 1.
 
@@ -937,7 +1139,7 @@ namespace crab {
         VariableName x_old_succ = x.getVarFactory ().get (); /*fresh var*/
         _g.insert_vertex(x_old);
         _g.insert_vertex(x_old_succ);
-        _succ_idx_map->set(x_old, x_old_succ);
+        succ_idx_map_mut().set(x_old, x_old_succ);
 
         /// --- Enforce the following relationships:
         ///     { x_old = x, x_old+ = x+, x_old+ = x_old + 1} 
@@ -1008,7 +1210,7 @@ namespace crab {
         /// step 4: delete x_old
         _g -= x_old;
         _g -= x_old_succ;
-        (*_succ_idx_map) -= x_old;
+        succ_idx_map_mut() -= x_old;
         _scalar -= x_old;
         _scalar -= x_old_succ;
 
@@ -1050,32 +1252,43 @@ namespace crab {
         if (!i_succ) 
           CRAB_ERROR ("There is no successor index associated with ",i);
 
-        WeightDomain& old_w = _g.get_weight(i, *i_succ);
+        WeightDomain old_w = _g.get_weight(i, *i_succ);
         old_w -= arr;
+        _g.set_weight(i, *i_succ, old_w);
         _g.meet_weight(i, *i_succ, w);
         WeightDomain new_w = _g.get_weight(i, *i_succ);
     
         //--- weak update: 
         // An edge (p,q) must be weakened if p <= i <= q and p < q
-        typename array_graph_t::edge_iterator it, et;
-        for(tie(it,et) = edges(*_g._graph); it!= et; ++it)
+        typename array_graph_t::binary_join_op join;
+        _g.detach();
+        scalar_diff_bounds<ScalarNumDomain> diffs (_scalar);
+        for (auto u : _g._rep->graph.verts())
         {
-          typename array_graph_t::edge_descriptor_t e = *it;
-          typename array_graph_t::VertexNamePtr  p = (*_g._graph)[source(e, *_g._graph)].name;
-          typename array_graph_t::VertexNamePtr  q = (*_g._graph)[target(e, *_g._graph)].name;
-          typename array_graph_t::WeightPtr weight = (*_g._graph)[e].weight;
-          if ( ((*p == i) &&  (*q == *i_succ)) || weight->is_bottom())
-            continue;
-          // p < q 
-          ScalarNumDomain tmp(_scalar);
-          tmp += linear_constraint_t( variable_t(*p) <= variable_t(i));      
-          tmp += linear_constraint_t( variable_t(*i_succ)  <= variable_t(*q));     
-          if (tmp.is_bottom())
-            continue;
-          // p <= i <= q and p < q
-          typename array_graph_t::binary_join_op join;
-          (*_g._graph)[e].weight = join (weight, 
-                                         typename array_graph_t::WeightPtr (new WeightDomain(new_w)));
+          for (auto e : _g._rep->graph.e_succs(u))
+          {
+            const VariableName& p = _g.vertex_name(u);
+            const VariableName& q = _g.vertex_name(e.vert);
+            if ( ((p == i) &&  (q == *i_succ)) || e.val.is_bottom())
+              continue;
+            // p < q 
+            // p <= i and i_succ <= q is unsatisfiable if scalar
+            // implies i < p, q < i_succ, or (q - p) + (i - i_succ) < 0
+            if (diffs.ub_diff (i, p) < 0 || diffs.ub_diff (q, *i_succ) < 0 ||
+                diffs.ub_diff (q, p) + diffs.ub_diff (i, *i_succ) < 0)
+              continue;
+            if (!diff_constraints_traits<ScalarNumDomain>::closed)
+            {
+              ScalarNumDomain tmp(_scalar);
+              tmp += linear_constraint_t( variable_t(p) <= variable_t(i));      
+              tmp += linear_constraint_t( variable_t(*i_succ)  <= variable_t(q));     
+              if (tmp.is_bottom())
+                continue;
+            }
+            // p <= i <= q and p < q
+            e.val = join (e.val, new_w);
+            _g.mark_changed(u, e.vert);
+          }
         }
         _g.canonical();
 
@@ -1086,7 +1299,7 @@ namespace crab {
         _is_bottom = true;
         _scalar = ScalarNumDomain::bottom();
         _g = array_graph_t::bottom();
-        _succ_idx_map->clear();
+        _succ_idx_map.reset(new succ_index_map_t());
       }
 
       array_graph_domain(ScalarNumDomain scalar, 
@@ -1096,7 +1309,7 @@ namespace crab {
           _is_bottom(false), 
           _scalar(scalar), 
           _g(g), 
-          _succ_idx_map(new succ_index_map_t(*map)) 
+          _succ_idx_map(map) 
       { 
         if (_scalar.is_bottom() || _g.is_bottom())
           set_to_bottom();
@@ -1133,7 +1346,7 @@ namespace crab {
           _is_bottom(other._is_bottom),
           _scalar(other._scalar) , 
           _g(other._g), 
-          _succ_idx_map(new succ_index_map_t(*other._succ_idx_map))
+          _succ_idx_map(other._succ_idx_map)
       { }
   
       array_graph_domain_t& operator=(array_graph_domain_t other) 
@@ -1190,8 +1403,7 @@ namespace crab {
         } else if (other.is_bottom ()) {
           return *this;
         } else {
-          succ_index_map_ptr map(new succ_index_map_t(*(_succ_idx_map) | 
-                                                      *(other._succ_idx_map)));
+          succ_index_map_ptr map = join_succ_idx_map (other);
           return array_graph_domain_t(_scalar | other._scalar, 
                                       _g | other._g, map); 
         }
@@ -1202,8 +1414,7 @@ namespace crab {
         if (is_bottom () || other.is_bottom ()) {
           return bottom();
         } else {
-          succ_index_map_ptr map(new succ_index_map_t(*(_succ_idx_map) | 
-                                                      *(other._succ_idx_map)));
+          succ_index_map_ptr map = join_succ_idx_map (other);
           return array_graph_domain_t(_scalar & other._scalar, 
                                       _g & other._g, map);
         }
@@ -1215,8 +1426,7 @@ namespace crab {
         else if (other.is_bottom ())  return *this;
         else 
         {
-          succ_index_map_ptr map (new succ_index_map_t(*(_succ_idx_map) | 
-                                                       *(other._succ_idx_map)));
+          succ_index_map_ptr map = join_succ_idx_map (other);
           array_graph_domain_t widen (_scalar || other._scalar, 
                                       _g || other._g, map);
           CRAB_LOG("array-graph" , crab::outs() << "Widening: " << *this<<"\n";);
@@ -1236,8 +1446,7 @@ namespace crab {
           return bottom();
         else 
         {
-          succ_index_map_ptr map (new succ_index_map_t(*(_succ_idx_map) | 
-                                                       *(other._succ_idx_map)));
+          succ_index_map_ptr map = join_succ_idx_map (other);
           return array_graph_domain_t (_scalar && other._scalar, 
                                        _g && other._g, map);
         }
@@ -1254,16 +1463,11 @@ namespace crab {
         if (var_succ) {
           _scalar -= *var_succ;
           _g -= *var_succ;        
-          (*_succ_idx_map) -= var;
+          succ_idx_map_mut() -= var;
         }
 
         // graph domain
-        typename array_graph_t::edge_iterator it, et;
-        for(tie(it,et) = edges(*(_g._graph)); it!= et; ++it) {
-          auto e  = *it;
-          auto weight = (*(_g._graph))[e].weight;
-          (*weight) -= var;
-        }      
+        _g.forget_in_weights(var);
         // this->reduce();
       }
   
@@ -148,7 +148,9 @@ namespace crab {
 #include <crab/domains/ldd/ldd_print.hpp>
 #include <crab/domains/domain_traits.hpp>
 #include <boost/bimap.hpp>
+#include <boost/unordered_map.hpp>
 #include <boost/shared_ptr.hpp>
+#include <boost/noncopyable.hpp>
 #include <boost/range/algorithm/set_algorithm.hpp>
 
 namespace crab {
@@ -157,14 +159,155 @@ namespace crab {
 
       using namespace crab::domains::ldd;       
 
+      struct ldd_context_params {
+        // maximum number of variables
+        size_t ldd_size;
+        // initial number of slots of each CUDD unique subtable
+        unsigned int unique_slots;
+        // initial number of entries of the CUDD computed table
+        unsigned int cache_slots;
+        // CUDD memory target in bytes (0: CUDD chooses)
+        unsigned long max_memory;
+        // number of operations between two checks for dead nodes
+        // and two updates of the statistics (0: only CUDD collects
+        // garbage and statistics are recorded at the end)
+        unsigned int gc_period;
+        // dynamic reordering method (CUDD_REORDER_NONE disables it)
+        Cudd_ReorderingType reorder_method;
+        // number of live nodes that triggers the first reordering
+        // (0: CUDD default). After each reordering the next one is
+        // triggered when the number of nodes doubles.
+        unsigned int reorder_threshold;
+        // sifting stops moving a variable once the ldd grows by
+        // this factor (0: CUDD default)
+        double reorder_max_growth;
+
+        ldd_context_params (size_t sz)
+          : ldd_size (sz), unique_slots (CUDD_UNIQUE_SLOTS), 
+            cache_slots (127), max_memory (0), gc_period (1000),
+            reorder_method (CUDD_REORDER_GROUP_SIFT), 
+            reorder_threshold (0), reorder_max_growth (0) { }
+      };
+
+      /*
+       * An ldd manager and a map from VariableName to ldd
+       * dimension. When boxes_domain combines values of two contexts
+       * the result is in the context of the left operand, where the
+       * right one is first copied. Each boxes_domain value keeps its
+       * context alive, so the manager is released after the last
+       * value that uses it. Contexts are not thread-safe: use one per
+       * thread.
+       */
+      template<typename VariableName>
+      class ldd_context: public boost::noncopyable {
+       public:
+        typedef boost::bimap< VariableName , int > var_bimap_t;
+        typedef typename var_bimap_t::value_type binding_t;
+
+       private:
+        ldd_context_params m_params;
+        LddManager* m_ldd_man;
+        var_bimap_t m_var_map;
+        unsigned int m_ops;
+
+       public:
+        ldd_context (ldd_context_params params)
+          : m_params (params), m_ldd_man (nullptr), m_ops (0) {
+          DdManager* cudd = Cudd_Init (0, 0, m_params.unique_slots, 
+                                       m_params.cache_slots, m_params.max_memory);
+          theory_t* theory = tvpi_create_boxz_theory (m_params.ldd_size);
+          CRAB_LOG ("boxes",crab::outs() << "Created a ldd of size " << m_params.ldd_size <<"\n";);
+          m_ldd_man = Ldd_Init (cudd, theory);
+          if (m_params.reorder_method != CUDD_REORDER_NONE) {
+            Cudd_AutodynEnable (cudd, m_params.reorder_method);
+            if (m_params.reorder_threshold > 0)
+              Cudd_SetNextReordering (cudd, m_params.reorder_threshold);
+            if (m_params.reorder_max_growth > 0)
+              Cudd_SetMaxGrowth (cudd, m_params.reorder_max_growth);
+          } else {
+            Cudd_AutodynDisable (cudd);
+          }
+        }
+
+        ~ldd_context () {
+          record_stats ();
+          DdManager *cudd = Ldd_GetCudd (m_ldd_man);
+          theory_t *theory = Ldd_GetTheory (m_ldd_man);
+          Ldd_Quit (m_ldd_man);
+          tvpi_destroy_theory (theory);
+          Cudd_Quit (cudd);
+        }
+
+        LddManager* ldd_man () const { return m_ldd_man; }
+
+        const ldd_context_params& params () const { return m_params; }
+
+        var_bimap_t& var_map () { return m_var_map; }
+
+        int num_of_vars () const { return m_var_map.left.size (); }
+
+        int get_var_dim (VariableName v) {
+          auto it = m_var_map.left.find (v);
+          if (it != m_var_map.left.end ()) {
+            return it->second;
+          } else {
+            int id = m_var_map.size ();
+            if (id >= (int) m_params.ldd_size) {
+              CRAB_ERROR ("The Ldd size of ", m_params.ldd_size, " needs to be larger");
+            }
+            m_var_map.insert (binding_t (v, id));
+            return id;
+          }
+        }
+
+        // Reorder the ldd variables now, regardless of the triggers.
+        void reorder (Cudd_ReorderingType method = CUDD_REORDER_GROUP_SIFT) {
+          crab::ScopedCrabStats __st__("Boxes.reorder");
+          Cudd_ReduceHeap (Ldd_GetCudd (m_ldd_man), method, 0);
+        }
+
+        // The node counts, reorderings and cache hit rate of the
+        // context that recorded them last, and the highest memory in
+        // use over all the contexts.
+        void record_stats () const {
+          DdManager *cudd = Ldd_GetCudd (m_ldd_man);
+          unsigned live = Cudd_ReadKeys (cudd) - Cudd_ReadDead (cudd);
+          crab::CrabStats::uset ("Boxes.nodes.live", live);
+          crab::CrabStats::uset ("Boxes.nodes.peak", Cudd_ReadPeakNodeCount (cudd));
+          crab::CrabStats::count_max ("Boxes.memory.peak_kb", 
+                                      Cudd_ReadMemoryInUse (cudd) / 1024);
+          crab::CrabStats::uset ("Boxes.count.reorderings", Cudd_ReadReorderings (cudd));
+          double lookups = Cudd_ReadCacheLookUps (cudd);
+          if (lookups > 0) {
+            crab::CrabStats::uset ("Boxes.cache.hit_rate_pct", 
+                                   (unsigned) (100.0 * Cudd_ReadCacheHits (cudd) / lookups));
+          }
+        }
+
+        // Called after each operation. CUDD only collects garbage
+        // when its unique table is full: collect periodically if at
+        // least half of the nodes are dead.
+        void tick () {
+          if (m_params.gc_period == 0 || ++m_ops < m_params.gc_period) 
+            return;
+          m_ops = 0;
+          DdManager *cudd = Ldd_GetCudd (m_ldd_man);
+          if (Cudd_ReadDead (cudd) > Cudd_ReadKeys (cudd) / 2) {
+            CRAB_LOG ("boxes", crab::outs() << "Collecting " << Cudd_ReadDead (cudd) 
+                                            << " dead nodes\n";);
+            crab::CrabStats::count ("Boxes.count.gc");
+            cuddGarbageCollect (cudd, 1);
+          }
+          record_stats ();
+        }
+      };
+
       /*
-       * The wrapper has two global datastructures:
-       * 1) a ldd manager and 
-       * 2) a map from VariableName to ldd dimension.
-       *
-       * FIXME: since the ldd manager is shared we need to fix a
-       * single size for all ldds. Since ldds are sparse we can fix a
-       * size big enough for our programs.
+       * The ldds are created in the context of the current thread,
+       * created on demand with LddSize variables unless set_context
+       * installs another one. Binary operations return a value in
+       * the context of their left operand, so the invariants computed
+       * by several threads can be joined by any of them.
        */
       template<typename Number, typename VariableName, size_t LddSize = 3000>
       class boxes_domain: 
@@ -185,52 +328,92 @@ namespace crab {
         typedef boxes_domain <Number, VariableName, LddSize> boxes_domain_t;
         typedef interval <Number> interval_t;
 
+        typedef ldd_context<VariableName> context_t;
+        typedef boost::shared_ptr<context_t> context_ptr;
+
        private:
-        // --- map from crab variable index to ldd term index
-        typedef boost::bimap< VariableName , int > var_bimap_t;
-        typedef boost::shared_ptr<var_bimap_t> var_map_ptr;
-        typedef typename var_bimap_t::value_type binding_t;
+        typedef typename context_t::var_bimap_t var_bimap_t;
 
+        // m_ctx is declared first so that m_ldd is released before
+        // its manager.
+        context_ptr m_ctx;
         LddNodePtr m_ldd;
-        static LddManager* m_ldd_man;
-        static var_map_ptr m_var_map;
 
-        static LddManager* get_ldd_man () {
-          if (!m_ldd_man) {
-            DdManager* cudd = Cudd_Init (0, 0, CUDD_UNIQUE_SLOTS, 127, 0);
-            theory_t* theory = tvpi_create_boxz_theory (LddSize);
-            CRAB_LOG ("boxes",crab::outs() << "Created a ldd of size " << LddSize <<"\n";);
-            m_ldd_man = Ldd_Init (cudd, theory);
-            Cudd_AutodynEnable (cudd, CUDD_REORDER_GROUP_SIFT);
-          }
-          return m_ldd_man;
+        static context_ptr& current_context () {
+          static thread_local context_ptr ctx;
+          if (!ctx) 
+            ctx.reset (new context_t (ldd_context_params (LddSize)));
+          return ctx;
         }
 
-        static int num_of_vars () {
-          if (!m_var_map) return 0;
-          
-          return (*m_var_map).left.size ();
+        LddManager* get_ldd_man () const {
+          return m_ctx->ldd_man ();
         }
 
-        static var_map_ptr get_var_map () {
-          if (!m_var_map) {
-            m_var_map = var_map_ptr (new var_bimap_t ());            
-          }
-          return m_var_map;
+        int num_of_vars () const {
+          return m_ctx->num_of_vars ();
+        }
+
+        var_bimap_t& get_var_map () const {
+          return m_ctx->var_map ();
         }
        
         int get_var_dim (VariableName v) const {
-          auto it = get_var_map()->left.find (v);
-          if (it != get_var_map()->left.end ()) {
-            return it->second;
+          return m_ctx->get_var_dim (v);
+        }
+
+        typedef boost::unordered_map<LddNode*, LddNodePtr> import_cache_t;
+
+        // The ldd of other in the context of this value. If the
+        // contexts differ, the ldd is rebuilt node by node and the
+        // variables are matched by name. The context of other is
+        // read, so no other thread may use it meanwhile.
+        LddNodePtr import (const boxes_domain_t& other) const {
+          if (m_ctx == other.m_ctx) 
+            return other.m_ldd;
+          crab::CrabStats::count ("Boxes.count.import");
+          crab::ScopedCrabStats __st__("Boxes.import");
+          import_cache_t cache;
+          return import (other, &*other.m_ldd, cache);
+        }
+
+        LddNodePtr import (const boxes_domain_t& other, LddNode* n, 
+                           import_cache_t& cache) const {
+          LddManager* man = get_ldd_man ();
+          LddManager* other_man = other.get_ldd_man ();
+          LddNode* N = Ldd_Regular (n);
+          LddNodePtr res;
+          auto it = cache.find (N);
+          if (it != cache.end ()) {
+            res = it->second;
+          } else if (N == Ldd_GetTrue (other_man)) {
+            res = lddPtr (man, Ldd_GetTrue (man));
           } else {
-            int id = get_var_map ()->size ();
-            if (id >= LddSize) {
-              CRAB_ERROR ("The Ldd size of ", LddSize, " needs to be larger");
+            theory_t* theory = Ldd_GetTheory (man);
+            theory_t* other_theory = Ldd_GetTheory (other_man);
+            lincons_t other_cons = Ldd_GetCons (other_man, N);
+            linterm_t other_term = other_theory->get_term (other_cons);
+            // the terms of the boxes theory have unit coefficients
+            size_t sz = other_theory->term_size (other_term);
+            std::vector<int> vars (sz), coeffs (sz);
+            for (size_t i = 0; i < sz; i++) {
+              vars [i] = get_var_dim (other.getVarName (other_theory->term_get_var (other_term, i)));
+              coeffs [i] = other_theory->sgn_cst (other_theory->term_get_coeff (other_term, i));
             }
-            get_var_map ()->insert (binding_t (v, id));
-            return id;
+            lincons_t cons = 
+                theory->create_cons (theory->create_linterm_sparse_si (&vars [0], &coeffs [0], sz),
+                                     other_theory->is_strict (other_cons),
+                                     theory->dup_cst (other_theory->get_constant (other_cons)));
+            LddNodePtr c = lddPtr (man, theory->to_ldd (man, cons));
+            theory->destroy_lincons (cons);
+            LddNodePtr t = import (other, Ldd_T (N), cache);
+            LddNodePtr e = import (other, Ldd_E (N), cache);
+            res = lddPtr (man, Ldd_Ite (man, &*c, &*t, &*e));
           }
+          cache [N] = res;
+          if (Cudd_IsComplement (n)) 
+            res = lddPtr (man, Ldd_Not (&*res));
+          return res;
         }
 
         inline constant_t mkCst (Number k) {
@@ -245,7 +428,7 @@ namespace crab {
 
         // pre: ldd is not either true or false
         void project (LddNodePtr& ldd, VariableName v) const {
-          for (auto p: (*m_var_map).left) {
+          for (auto p: get_var_map ().left) {
             if (!(p.first == v)) {
               int id = get_var_dim (p.first);
               ldd = lddPtr (get_ldd_man(), 
@@ -262,7 +445,7 @@ namespace crab {
             return m_ldd;
                                   
           LddNodePtr res = lddPtr (get_ldd_man(), Ldd_GetTrue (get_ldd_man()));
-          for (auto p: (*m_var_map).left) {
+          for (auto p: get_var_map ().left) {
             LddNodePtr tmp (m_ldd);
             project (tmp, p.first);
             res = lddPtr (get_ldd_man(), Ldd_And (get_ldd_man(), &*res, &*tmp));
@@ -284,23 +467,29 @@ namespace crab {
           return term; 
         }
         
+        /** m_ldd := m_ldd[t := a*r + [kmin,kmax]]. Takes ownership
+            of the terms and constants (any of them but t can be NULL). 
+            The nodes that Ldd_TermReplace leaves dead are reclaimed
+            by the context garbage collection. */
+        void term_replace (linterm_t t, linterm_t r, constant_t a,
+                           constant_t kmin, constant_t kmax) {
+          theory_t* theory = Ldd_GetTheory (get_ldd_man());
+          m_ldd = lddPtr(get_ldd_man(), 
+                         Ldd_TermReplace(get_ldd_man(), &(*m_ldd), t, r, a, kmin, kmax));
+          theory->destroy_term (t);
+          if (r) theory->destroy_term (r);
+          if (a) theory->destroy_cst (a);
+          if (kmin) theory->destroy_cst (kmin);
+          if (kmax && kmax != kmin) theory->destroy_cst (kmax);
+        }
+
         /** v := a * x + k, where a, k are constants and x variable */
         void apply (VariableName v, VariableName x, Number a, Number k) {
           if (is_top () || is_bottom ()) return ;
+          m_ctx->tick ();
 
-          linterm_t t = termForVal (v);
-          linterm_t r = termForVal (x);
-
-          constant_t c1 = mkCst (a);
           constant_t c2 = mkCst (k);
-          // FIXME: Ldd_TermReplace seems to leak memory
-          m_ldd = lddPtr(get_ldd_man(), 
-                         Ldd_TermReplace(get_ldd_man(), &(*m_ldd), t, r, c1, c2, c2));
-
-          Ldd_GetTheory (get_ldd_man())->destroy_term(t);
-          Ldd_GetTheory (get_ldd_man())->destroy_term(r);              
-          Ldd_GetTheory (get_ldd_man())->destroy_cst(c1);
-          Ldd_GetTheory (get_ldd_man())->destroy_cst(c2);
+          term_replace (termForVal (v), termForVal (x), mkCst (a), c2, c2);
         }
 
         Number numFromLddCst (constant_t cst, theory_t *theory) {
@@ -422,7 +611,8 @@ namespace crab {
           }
         } 
 
-        boxes_domain (LddNodePtr ldd): m_ldd (ldd) {
+        boxes_domain (context_ptr ctx, LddNodePtr ldd): m_ctx (ctx), m_ldd (ldd) {
+          m_ctx->tick ();
 #if 1
           const int CST_FACTOR = 10; /* JN: some magic constant factor */
           int threshold = num_of_vars () * CST_FACTOR;
@@ -460,40 +650,50 @@ namespace crab {
         }
 
         VariableName getVarName (int v) const {
-          auto it = get_var_map ()->right.find (v);
-          if (it != get_var_map ()->right.end ())
+          auto it = get_var_map ().right.find (v);
+          if (it != get_var_map ().right.end ())
              return it->second;
           else {
              CRAB_ERROR ("Index ", v, " cannot be mapped back to a variable name");
           }
         }
 
-        boxes_domain(): ikos::writeable() { 
-          m_ldd = lddPtr (get_ldd_man(), Ldd_GetTrue (get_ldd_man()));
+        // The context of the values created from now on by this
+        // thread. The values created before keep their context.
+        static context_ptr get_context () {
+          return current_context ();
         }
-        
-        ~boxes_domain () { 
-          // DdManager *cudd = nullptr;
-          // theory_t *theory = nullptr;
-          // if (m_ldd_man)  {
-	//   cudd = Ldd_GetCudd (m_ldd_man);
-	//   theory = Ldd_GetTheory (m_ldd_man);
-	//   Ldd_Quit (m_ldd_man);
-	// }
-          // if (theory) tvpi_destroy_theory(theory);
-          // if (cudd) Cudd_Quit(cudd);
+
+        static void set_context (context_ptr ctx) {
+          current_context () = ctx;
+        }
+
+        static context_ptr make_context (ldd_context_params params) {
+          return context_ptr (new context_t (params));
+        }
+
+        boxes_domain(): ikos::writeable(), m_ctx (current_context ()) { 
+          m_ldd = lddPtr (get_ldd_man(), Ldd_GetTrue (get_ldd_man()));
         }
                 
         static boxes_domain_t top() { 
-          return boxes_domain_t (lddPtr (get_ldd_man(), Ldd_GetTrue (get_ldd_man())));
+          return top (current_context ());
         }
         
         static boxes_domain_t bottom() {
-          return boxes_domain_t (lddPtr (get_ldd_man(), Ldd_GetFalse (get_ldd_man())));
+          return bottom (current_context ());
+        }
+
+        static boxes_domain_t top(context_ptr ctx) { 
+          return boxes_domain_t (ctx, lddPtr (ctx->ldd_man (), Ldd_GetTrue (ctx->ldd_man ())));
+        }
+        
+        static boxes_domain_t bottom(context_ptr ctx) {
+          return boxes_domain_t (ctx, lddPtr (ctx->ldd_man (), Ldd_GetFalse (ctx->ldd_man ())));
         }
         
         boxes_domain (const boxes_domain_t& other): 
-            ikos::writeable(), m_ldd (other.m_ldd) { 
+            ikos::writeable(), m_ctx (other.m_ctx), m_ldd (other.m_ldd) { 
           crab::CrabStats::count ("Domain.count.copy");
           crab::ScopedCrabStats __st__("Domain.copy");
         }
@@ -501,8 +701,11 @@ namespace crab {
         boxes_domain_t& operator=(const boxes_domain_t& other) {
           crab::CrabStats::count ("Domain.count.copy");
           crab::ScopedCrabStats __st__("Domain.copy");
-          if (this != &other) 
+          if (this != &other) {
+            // release the old ldd while its manager is still alive
             m_ldd = other.m_ldd;
+            m_ctx = other.m_ctx;
+          }
           return *this;
         }
         
@@ -515,7 +718,8 @@ namespace crab {
         }
         
         bool operator<=(boxes_domain_t other) {
-          bool res = Ldd_TermLeq (get_ldd_man(), &(*m_ldd), &(*other.m_ldd));
+          LddNodePtr o = import (other);
+          bool res = Ldd_TermLeq (get_ldd_man(), &(*m_ldd), &(*o));
 
           CRAB_LOG ("boxes", 
                     crab::outs() << "Check if " <<  *this << " <= " <<  other 
@@ -528,19 +732,21 @@ namespace crab {
         }
         
         boxes_domain_t operator|(boxes_domain_t other) {
-          return boxes_domain_t (join (m_ldd, other.m_ldd));
+          return boxes_domain_t (m_ctx, join (m_ldd, import (other)));
         }
         
         boxes_domain_t operator&(boxes_domain_t other) {
-          return boxes_domain_t (lddPtr (get_ldd_man(), 
-                                         Ldd_And (get_ldd_man(), &*m_ldd, &*other.m_ldd)));
+          LddNodePtr o = import (other);
+          return boxes_domain_t (m_ctx, lddPtr (get_ldd_man(), 
+                                         Ldd_And (get_ldd_man(), &*m_ldd, &*o)));
         }
 
         boxes_domain_t operator||(boxes_domain_t other) {
           // It is not necessarily true that the new value is bigger
           // than the old value so we apply 
           // widen(old, new) = widen (old, (join (old,new)))
-          LddNodePtr v = join (m_ldd, other.m_ldd); 
+          LddNodePtr o = import (other);
+          LddNodePtr v = join (m_ldd, o); 
           LddNodePtr w = lddPtr (get_ldd_man (), 
                                  Ldd_BoxWiden2 (get_ldd_man (), &*m_ldd, &*v));
 
@@ -551,9 +757,9 @@ namespace crab {
           w = lddPtr (get_ldd_man (), 
                       Ldd_And (get_ldd_man (), &*w, Ldd_Not (&*m_ldd)));
           /** ensure the output is at least as big as newV */
-          w = lddPtr (get_ldd_man (), Ldd_Or (get_ldd_man (), &*w, &*other.m_ldd));
+          w = lddPtr (get_ldd_man (), Ldd_Or (get_ldd_man (), &*w, &*o));
 #endif 
-          boxes_domain_t res (w); 
+          boxes_domain_t res (m_ctx, w); 
 
           CRAB_LOG ("boxes",
                     crab::outs() << "Widening " <<  *this << " and " <<  other 
@@ -579,6 +785,7 @@ namespace crab {
         
         void operator-=(VariableName var) {
           if (is_bottom ()) return;
+          m_ctx->tick ();
 
           int id = get_var_dim (var);
           m_ldd =  lddPtr (get_ldd_man(), 
@@ -600,7 +807,7 @@ namespace crab {
           if (is_bottom ()) return;
 
           std::set<VariableName> s1,s2,s3;
-          for (auto p: (*m_var_map).left) s1.insert (p.first);
+          for (auto p: get_var_map ().left) s1.insert (p.first);
           s2.insert (begin, end);
           boost::set_difference (s1,s2,std::inserter (s3, s3.end ()));
           forget (s3.begin (), s3.end ());
@@ -610,6 +817,7 @@ namespace crab {
         {
           if (is_bottom () || cst.is_tautology ())  
             return;
+          m_ctx->tick ();
 
           if (cst.is_contradiction ())  {
             m_ldd = lddPtr (get_ldd_man(), Ldd_GetFalse (get_ldd_man()));
@@ -651,6 +859,7 @@ namespace crab {
         void set (VariableName v, interval_t ival) {
           
           if (is_bottom ()) return ;
+          m_ctx->tick ();
 
           constant_t kmin = NULL, kmax = NULL;       
           if (boost::optional <Number> l = ival.lb ().number ())
@@ -658,14 +867,7 @@ namespace crab {
           if (boost::optional <Number> u = ival.ub ().number ())
             kmax = mkCst (*u);
           
-          linterm_t t = termForVal(v);
-          // FIXME: Ldd_TermReplace seems to leak memory
-          m_ldd = lddPtr(get_ldd_man(), 
-                         Ldd_TermReplace(get_ldd_man(), &(*m_ldd), t, NULL, NULL, kmin, kmax));
-              
-          if (kmin) Ldd_GetTheory (get_ldd_man())->destroy_cst(kmin);
-          if (kmax) Ldd_GetTheory (get_ldd_man())->destroy_cst(kmax);
-          Ldd_GetTheory (get_ldd_man())->destroy_term(t);
+          term_replace (termForVal(v), NULL, NULL, kmin, kmax);
         }
 
         // FIXME: expensive operation
@@ -680,7 +882,7 @@ namespace crab {
           // make convex the ldd
           LddNodePtr tmp = convex_approx ();
           // forget any variable that is not v
-          for (auto p: (*m_var_map).left) {
+          for (auto p: get_var_map ().left) {
             if (! (p.first == v)) {
               int id = get_var_dim (p.first);
               tmp =  lddPtr (get_ldd_man(), 
@@ -699,14 +901,11 @@ namespace crab {
         void assign (VariableName x, linear_expression_t e) {
           if (is_bottom ()) 
             return;
+          m_ctx->tick ();
 
           if (e.is_constant ()) {
             constant_t c = mkCst (e.constant ());
-            linterm_t t = termForVal (x);
-            m_ldd = lddPtr(get_ldd_man(), 
-                           Ldd_TermReplace(get_ldd_man(), &(*m_ldd), t, NULL, NULL, c, c));
-            Ldd_GetTheory (get_ldd_man())->destroy_cst (c);
-            Ldd_GetTheory (get_ldd_man())->destroy_term(t);
+            term_replace (termForVal (x), NULL, NULL, c, c);
           }
           else if (optional<variable_t> v = e.get_variable()){
             VariableName y = (*v).name();
@@ -959,12 +1158,6 @@ namespace crab {
         
       }; 
 
-     template<typename N, typename V, size_t S>
-     LddManager* boxes_domain<N,V,S>::m_ldd_man = nullptr;
-
-     template<typename N, typename V, size_t S>
-     typename boxes_domain<N,V,S>::var_map_ptr boxes_domain<N,V,S>::m_var_map = nullptr;
-
      template<typename Number, typename VariableName, size_t LddSize>
      class domain_traits <boxes_domain<Number,VariableName, LddSize> > {
       public:
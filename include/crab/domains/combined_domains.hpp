@@ -27,7 +27,12 @@ namespace crab {
 
     // This domain is similar to numerical_domain_product2 but it uses
     // a customized reduction operation.
-    template<typename Domain1, typename Domain2 >
+    //
+    // If LazyReduction then the variables modified by a transfer
+    // function are only marked and they are reduced when the value is
+    // observed (queries, inclusion and binary operators). A variable
+    // modified several times in between is reduced once.
+    template<typename Domain1, typename Domain2, bool LazyReduction = false>
     class reduced_numerical_domain_product2: 
        public writeable,
        public numerical_domain<typename Domain1::number_t, typename Domain1::varname_t>,
@@ -48,7 +53,7 @@ namespace crab {
       using typename numerical_domain< Number, VariableName >::varname_t;
       
       typedef interval<number_t> interval_t;
-      typedef reduced_numerical_domain_product2<Domain1,Domain2> reduced_numerical_domain_product2_t;
+      typedef reduced_numerical_domain_product2<Domain1,Domain2,LazyReduction> reduced_numerical_domain_product2_t;
       
      private:
       
@@ -56,6 +61,8 @@ namespace crab {
       typedef numerical_domain_product2<Number, VariableName, Domain1, Domain2> domain_product2_t; 
       
       domain_product2_t _product;
+      // variables not reduced yet (only if LazyReduction)
+      variable_set_t _dirty;
       
       reduced_numerical_domain_product2(const domain_product2_t& product):
           _product(product) {}
@@ -115,6 +122,24 @@ namespace crab {
           crab::domains::product_domain_traits<Domain2,Domain1>::push (v, inv2, inv1);
         }
       }
+
+      // v has been modified by a transfer function
+      void modified(const VariableName& v) {
+        if (LazyReduction)
+          _dirty += v;
+        else
+          reduce_variable(v);
+      }
+
+      // reduce the pending variables before the value is observed
+      void reduce() {
+        if (!LazyReduction || _dirty.size () == 0) return;
+        crab::CrabStats::count ("Domain.count.reduce.lazy");
+        variable_set_t dirty;
+        std::swap (dirty, _dirty);
+        for (auto v: dirty)
+          reduce_variable(v);
+      }
       
      public:
     
@@ -140,50 +165,71 @@ namespace crab {
           numerical_domain<number_t,varname_t>(),
           bitwise_operators<number_t,varname_t>(),
           division_operators<number_t,varname_t>(),
-          _product(other._product) { }
+          _product(other._product), _dirty(other._dirty) { }
       
       reduced_numerical_domain_product2_t& operator=(const reduced_numerical_domain_product2_t& other) {
-        if (this != &other)
+        if (this != &other) {
           this->_product = other._product;
+          this->_dirty = other._dirty;
+        }
         
          return *this;
       }
       
-      bool is_bottom() { return this->_product.is_bottom(); }
+      bool is_bottom() { 
+        reduce();
+        return this->_product.is_bottom(); 
+      }
       
-      bool is_top() { return this->_product.is_top(); }
+      bool is_top() { 
+        reduce();
+        return this->_product.is_top(); 
+      }
       
-      Domain1& first() { return this->_product.first(); }
+      Domain1& first() { 
+        reduce();
+        return this->_product.first(); 
+      }
       
-      Domain2& second() { return this->_product.second(); }
+      Domain2& second() { 
+        reduce();
+        return this->_product.second(); 
+      }
       
       bool operator<=(reduced_numerical_domain_product2_t other) {
+        reduce(); other.reduce();
         return this->_product <= other._product;
       }
       
       void operator|=(reduced_numerical_domain_product2_t other) {
+        reduce(); other.reduce();
         this->_product |= other._product;
       }
       
       reduced_numerical_domain_product2_t operator|(reduced_numerical_domain_product2_t other) {
+        reduce(); other.reduce();
         return reduced_numerical_domain_product2_t(this->_product | other._product);
       }
       
       reduced_numerical_domain_product2_t operator&(reduced_numerical_domain_product2_t other) {
+        reduce(); other.reduce();
         return reduced_numerical_domain_product2_t(this->_product & other._product);
       }
       
       reduced_numerical_domain_product2_t operator||(reduced_numerical_domain_product2_t other) {
+        reduce(); other.reduce();
         return reduced_numerical_domain_product2_t(this->_product || other._product);
       }
       
       template<typename Thresholds>
       reduced_numerical_domain_product2_t widening_thresholds 
       (reduced_numerical_domain_product2_t other, const Thresholds& ts) {
+        reduce(); other.reduce();
         return reduced_numerical_domain_product2_t(this->_product.widening_thresholds (other._product, ts));
       }
       
       reduced_numerical_domain_product2_t operator&&(reduced_numerical_domain_product2_t other) {
+        reduce(); other.reduce();
         return reduced_numerical_domain_product2_t(this->_product && other._product);
       }
       
@@ -193,6 +239,7 @@ namespace crab {
       }
       
       interval_t operator[](varname_t v) {
+        reduce();
         // We can choose either first or second domain
         return this->_product.second()[v];
       }
@@ -200,65 +247,69 @@ namespace crab {
       void operator+=(linear_constraint_system_t csts) {
         this->_product += csts;
         for (auto v: csts.variables()) {
-          reduce_variable(v.name());
+          modified(v.name());
         }
       }
       
-      void operator-=(varname_t v) { this->_product -= v; }
+      void operator-=(varname_t v) { 
+        this->_product -= v; 
+        if (LazyReduction) _dirty -= v;
+      }
             
       void assign(varname_t x, linear_expression_t e) {
         this->_product.assign(x, e);
-        this->reduce_variable(x);
+        this->modified(x);
       }
       
       void apply(operation_t op, varname_t x, varname_t y, varname_t z) {
         this->_product.apply(op, x, y, z);
-        this->reduce_variable(x);
+        this->modified(x);
       }
       
       void apply(operation_t op, varname_t x, varname_t y, number_t k) {
         this->_product.apply(op, x, y, k);
-        this->reduce_variable(x);
+        this->modified(x);
       }
       
       // bitwise_operators_api
       
       void apply(conv_operation_t op, varname_t x, varname_t y, unsigned width) {
         this->_product.apply(op, x, y, width);
-        this->reduce_variable(x);
+        this->modified(x);
       }
       
       void apply(conv_operation_t op, varname_t x, number_t k, unsigned width) {
         this->_product.apply(op, x, k, width);
-        this->reduce_variable(x);
+        this->modified(x);
       }
       
       void apply(bitwise_operation_t op, varname_t x, varname_t y, varname_t z) {
         this->_product.apply(op, x, y, z);
-        this->reduce_variable(x);
+        this->modified(x);
       }
       
       void apply(bitwise_operation_t op, varname_t x, varname_t y, number_t k) {
         this->_product.apply(op, x, y, k);
-        this->reduce_variable(x);
+        this->modified(x);
       }
       
       // division_operators_api
       
       void apply(div_operation_t op, varname_t x, varname_t y, varname_t z) {
         this->_product.apply(op, x, y, z);
-        this->reduce_variable(x);
+        this->modified(x);
       }
       
       void apply(div_operation_t op, varname_t x, varname_t y, number_t k) {
         this->_product.apply(op, x, y, k);
-        this->reduce_variable(x);
+        this->modified(x);
       }
       
       
       // domain_traits_api
       
       void expand(VariableName x, VariableName new_x) {
+        if (LazyReduction && _dirty[x]) _dirty += new_x;
         crab::domains::domain_traits<Domain1>::expand (this->_product.first(), 
                                                        x, new_x);
         crab::domains::domain_traits<Domain2>::expand (this->_product.second(), 
@@ -266,12 +317,16 @@ namespace crab {
       }
       
       void normalize() {
+        reduce();
         crab::domains::domain_traits<Domain1>::normalize(this->_product.first());
         crab::domains::domain_traits<Domain2>::normalize(this->_product.second());
       }
       
       template <typename Range>
       void forget(Range vars){
+        if (LazyReduction) {
+          for (auto v: vars) _dirty -= v;
+        }
         crab::domains::domain_traits<Domain1>::forget(this->_product.first(), 
                                                       vars.begin (), vars.end());
         crab::domains::domain_traits<Domain2>::forget(this->_product.second(), 
@@ -280,6 +335,7 @@ namespace crab {
       
       template <typename Range>
       void project(Range vars) {
+        reduce();
         crab::domains::domain_traits<Domain1>::project(this->_product.first(), 
                                                        vars.begin(), vars.end());
         crab::domains::domain_traits<Domain2>::project(this->_product.second(), 
@@ -287,10 +343,12 @@ namespace crab {
       }
       
       void write(std::ostream& o) { 
+        reduce();
         this->_product.write(o); 
       }
       
       linear_constraint_system_t to_linear_constraint_system() {
+        reduce();
         // We can choose either first or second domain
         return this->_product.second().to_linear_constraint_system();
       }
@@ -808,11 +866,11 @@ namespace crab {
       
     }; // class numerical_congruence_domain
 
-    template<typename Domain1, typename Domain2>
-    class domain_traits <reduced_numerical_domain_product2<Domain1,Domain2> > {
+    template<typename Domain1, typename Domain2, bool LazyReduction>
+    class domain_traits <reduced_numerical_domain_product2<Domain1,Domain2,LazyReduction> > {
      public:
 
-      typedef reduced_numerical_domain_product2<Domain1,Domain2> product_t;
+      typedef reduced_numerical_domain_product2<Domain1,Domain2,LazyReduction> product_t;
       typedef typename product_t::varname_t VariableName;
 
       static void normalize (product_t& inv) {
@@ -30,6 +30,7 @@
 #include <boost/unordered_set.hpp>
 #include <boost/unordered_map.hpp>
 #include <boost/range/iterator_range_core.hpp>
+#include <boost/noncopyable.hpp>
 
 using namespace boost;
 using namespace std;
@@ -51,6 +52,22 @@ namespace crab {
          // will complain.
          return (val_t) k;
        }     
+
+       // Scratch space used by the C library. There is one per
+       // thread so that DBM values can be manipulated concurrently
+       // from different threads.
+       class scratch_ctx: public boost::noncopyable {
+         dbm_ctx m_ctx;
+        public:
+         scratch_ctx(): m_ctx(dbm_ctx_alloc()) { }
+         ~scratch_ctx() { dbm_ctx_dealloc(m_ctx); }
+         dbm_ctx get() { return m_ctx; }
+       };
+
+       inline dbm_ctx thread_ctx() {
+         static thread_local scratch_ctx ctx;
+         return ctx.get();
+       }
      }; // end namespace DBM_impl
 
     template< class Number, class VariableName, 
@@ -141,7 +158,7 @@ namespace crab {
           _rev_map.insert (make_pair (p.second, p.first));
         // rename the this' dbm
         dbm ret = NULL;
-        ret= dbm_rename (&subs_x[0], subs_x.size(), _dbm);
+        ret= dbm_rename (DBM_impl::thread_ctx(), &subs_x[0], subs_x.size(), _dbm);
         dbm_dealloc(_dbm);
         swap(_dbm, ret);
 
@@ -243,7 +260,7 @@ namespace crab {
       void assign(VariableName x, exp_t exp) {
         dbm ret = NULL;      
         id_t i = get_dbm_index(x); 
-        ret = dbm_assign(i, exp, _dbm);
+        ret = dbm_assign(DBM_impl::thread_ctx(), i, exp, _dbm);
         dbm_dealloc(_dbm);
         std::swap(_dbm, ret);
         exp_dealloc(exp);
@@ -267,28 +284,28 @@ namespace crab {
 
       void apply_cond(ucon con) {    
         dbm ret = NULL;
-        ret = dbm_cond(con, _dbm);
+        ret = dbm_cond(DBM_impl::thread_ctx(), con, _dbm);
         dbm_dealloc(_dbm);
         std::swap(_dbm, ret);
       }
 
       void apply_dexpr(dexpr d) {
         dbm ret = NULL;
-        ret = dbm_apply_dexpr(d, _dbm);
+        ret = dbm_apply_dexpr(DBM_impl::thread_ctx(), d, _dbm);
         dbm_dealloc(_dbm);
         std::swap(_dbm, ret);
       }
 
       void forget(id_t idx) {
         dbm ret = NULL;
-        ret = dbm_forget(idx, _dbm);
+        ret = dbm_forget(DBM_impl::thread_ctx(), idx, _dbm);
         dbm_dealloc(_dbm);
         std::swap(_dbm, ret);
       }
     
       void forget(vector<int> idxs) {
         dbm ret = NULL;
-        ret = dbm_forget_array(&idxs[0], idxs.size(), _dbm);
+        ret = dbm_forget_array(DBM_impl::thread_ctx(), &idxs[0], idxs.size(), _dbm);
         dbm_dealloc(_dbm);
         std::swap(_dbm, ret);
       }
@@ -298,7 +315,7 @@ namespace crab {
         idxs.push_back (get_zero ());
 
         dbm ret = NULL;
-        ret = dbm_extract (&idxs[0], idxs.size(), _dbm);
+        ret = dbm_extract (DBM_impl::thread_ctx(), &idxs[0], idxs.size(), _dbm);
         dbm_dealloc(_dbm);
         std::swap(_dbm, ret);
       }
@@ -541,7 +558,7 @@ namespace crab {
         vector<rmap>  subs;
         subs.push_back (rmap {d->sz-1,sz-1});
         dbm ret = NULL;
-        ret= dbm_rename (&subs[0], subs.size(), x);
+        ret= dbm_rename (DBM_impl::thread_ctx(), &subs[0], subs.size(), x);
         dbm_dealloc (x);
         return ret;
       }
@@ -657,13 +674,13 @@ namespace crab {
           }
           assert (dbm_x->sz == dbm_y->sz && dbm_y->sz == max_sz);
 
-          dbm dbm_xx = dbm_rename (&subs_x[0], subs_x.size(), dbm_x);
-          dbm dbm_yy = dbm_rename (&subs_y[0], subs_y.size(), dbm_y);
+          dbm dbm_xx = dbm_rename (DBM_impl::thread_ctx(), &subs_x[0], subs_x.size(), dbm_x);
+          dbm dbm_yy = dbm_rename (DBM_impl::thread_ctx(), &subs_y[0], subs_y.size(), dbm_y);
 
           dbm_dealloc(dbm_x);
           dbm_dealloc(dbm_y);
 
-          bool res = dbm_is_leq (dbm_xx, dbm_yy);
+          bool res = dbm_is_leq (DBM_impl::thread_ctx(), dbm_xx, dbm_yy);
 
           dbm_dealloc(dbm_xx);
           dbm_dealloc(dbm_yy);
@@ -719,8 +736,8 @@ namespace crab {
 
           assert (dbm_x->sz == dbm_y->sz && dbm_y->sz == max_sz);
 
-          dbm dbm_xx = dbm_rename (&subs_x[0], subs_x.size(), dbm_x);
-          dbm dbm_yy = dbm_rename (&subs_y[0], subs_y.size(), dbm_y);
+          dbm dbm_xx = dbm_rename (DBM_impl::thread_ctx(), &subs_x[0], subs_x.size(), dbm_x);
+          dbm dbm_yy = dbm_rename (DBM_impl::thread_ctx(), &subs_y[0], subs_y.size(), dbm_y);
 
           dbm_dealloc(dbm_x);
           dbm_dealloc(dbm_y);
@@ -728,7 +745,7 @@ namespace crab {
 #if 0     
           cout << "After resizing DBMs: \n";
           cout << "DBM 1:\n";
-          dbm_print_to(cout, dbm_xx);
+          dbm_print_to(DBM_impl::thread_ctx(), cout, dbm_xx);
           cout << "subs map {";
           for (auto p: subs_x)
             cout << "(" << p.r_from << "-" << p.r_to << ");";
@@ -738,10 +755,10 @@ namespace crab {
           for (auto p: subs_y)
             cout << "(" << p.r_from << "-" << p.r_to << ");";
           cout << "}\n";
-          dbm_print_to(cout, dbm_yy);
+          dbm_print_to(DBM_impl::thread_ctx(), cout, dbm_yy);
 #endif      
 
-          DBM_t res (dbm_join(dbm_xx, dbm_yy), 
+          DBM_t res (dbm_join(DBM_impl::thread_ctx(), dbm_xx, dbm_yy), 
                      id, var_map, rev_map);
 
           dbm_dealloc(dbm_xx);
@@ -797,13 +814,13 @@ namespace crab {
 
           assert (dbm_x->sz == dbm_y->sz && dbm_y->sz == max_sz);
 
-          dbm dbm_xx = dbm_rename (&subs_x[0], subs_x.size(), dbm_x);
-          dbm dbm_yy = dbm_rename (&subs_y[0], subs_y.size(), dbm_y);
+          dbm dbm_xx = dbm_rename (DBM_impl::thread_ctx(), &subs_x[0], subs_x.size(), dbm_x);
+          dbm dbm_yy = dbm_rename (DBM_impl::thread_ctx(), &subs_y[0], subs_y.size(), dbm_y);
 
           dbm_dealloc(dbm_x);
           dbm_dealloc(dbm_y);
 
-          DBM_t res (dbm_widen(dbm_xx, dbm_yy), 
+          DBM_t res (dbm_widen(DBM_impl::thread_ctx(), dbm_xx, dbm_yy), 
                      id, var_map, rev_map);
 
           dbm_dealloc(dbm_xx);
@@ -866,13 +883,13 @@ namespace crab {
 
           assert (dbm_x->sz == dbm_y->sz && dbm_y->sz == max_sz);
 
-          dbm dbm_xx = dbm_rename (&subs_x[0], subs_x.size(), dbm_x);
-          dbm dbm_yy = dbm_rename (&subs_y[0], subs_y.size(), dbm_y);
+          dbm dbm_xx = dbm_rename (DBM_impl::thread_ctx(), &subs_x[0], subs_x.size(), dbm_x);
+          dbm dbm_yy = dbm_rename (DBM_impl::thread_ctx(), &subs_y[0], subs_y.size(), dbm_y);
 
           dbm_dealloc(dbm_x);
           dbm_dealloc(dbm_y);
 
-          DBM_t res (dbm_meet(dbm_xx, dbm_yy), 
+          DBM_t res (dbm_meet(DBM_impl::thread_ctx(), dbm_xx, dbm_yy), 
                      id, var_map, rev_map);
 
           dbm_dealloc(dbm_xx);
@@ -926,13 +943,13 @@ namespace crab {
 
           assert (dbm_x->sz == dbm_y->sz && dbm_y->sz == max_sz);
 
-          dbm dbm_xx = dbm_rename (&subs_x[0], subs_x.size(), dbm_x);
-          dbm dbm_yy = dbm_rename (&subs_y[0], subs_y.size(), dbm_y);
+          dbm dbm_xx = dbm_rename (DBM_impl::thread_ctx(), &subs_x[0], subs_x.size(), dbm_x);
+          dbm dbm_yy = dbm_rename (DBM_impl::thread_ctx(), &subs_y[0], subs_y.size(), dbm_y);
 
           dbm_dealloc(dbm_x);
           dbm_dealloc(dbm_y);
 
-          DBM_t res (dbm_narrowing(dbm_xx, dbm_yy), 
+          DBM_t res (dbm_narrowing(DBM_impl::thread_ctx(), dbm_xx, dbm_yy), 
                      id, var_map, rev_map);
 
           dbm_dealloc(dbm_xx);
@@ -945,7 +962,7 @@ namespace crab {
       }	
 
       void normalize() {
-        dbm_canonical(_dbm);
+        dbm_canonical(DBM_impl::thread_ctx(), _dbm);
       }
 
       void operator-=(VariableName v) {
@@ -1379,7 +1396,7 @@ namespace crab {
             cout << p.first << "->" << p.second << ";";
           cout << "}\n";
           cout << "matrix:\n";
-          dbm_print_to(cout, _dbm);
+          dbm_print_to(DBM_impl::thread_ctx(), cout, _dbm);
 #endif 
 
           linear_constraint_system_t inv = to_linear_constraint_system ();
@@ -23,16 +23,20 @@
 typedef val_t dbm_val_t;
 typedef int dbm_var_t;
 
+// Vertex identifiers are 32 bits so a dbm is not limited to 32767
+// variables.
+typedef int dbm_vert_t;
+
 typedef struct {
-  unsigned short i_inv;
-  unsigned short j_inv;
+  unsigned int i_inv;
+  unsigned int j_inv;
   val_t val;
 } einfo;
 
 typedef struct {
-  unsigned short inv;    // Cross reference into live_{srcs,dests}
-  short sz;     // Number of elements
-  short elt[0]; // Values
+  unsigned int inv;   // Cross reference into live_{srcs,dests}
+  dbm_vert_t sz;      // Number of elements
+  dbm_vert_t elt[0];  // Values
 } adjlist;
 
 typedef struct {
@@ -47,15 +51,15 @@ typedef struct {
   val_t* pi;
 
   // Live sources & dests
-  short num_srcs;
-  short* live_srcs;
+  dbm_vert_t num_srcs;
+  dbm_vert_t* live_srcs;
 
-  short num_dests;
-  short* live_dests;
+  dbm_vert_t num_dests;
+  dbm_vert_t* live_dests;
 
   // The array of adjacency lists.
-  short* srcs;
-  short* dests;
+  dbm_vert_t* srcs;
+  dbm_vert_t* dests;
   
   // Matrix of edges
   einfo* mtx;  
@@ -63,6 +67,25 @@ typedef struct {
 
 typedef dbm_data *dbm;
 
+// Scratch space used by consistency checking and transitive
+// closure. It is owned by the caller rather than being global so
+// that different threads can operate on different dbms at the same
+// time. A context can be reused by any number of dbms but must not
+// be shared between concurrent calls.
+typedef struct {
+  int sz;
+  val_t* gamma;
+  val_t* pi_prime;
+  val_t* fwd_dist;
+  // Always initialized to 0.
+  char* var_flags;
+} dbm_ctx_data;
+
+typedef dbm_ctx_data *dbm_ctx;
+
+dbm_ctx dbm_ctx_alloc();
+void dbm_ctx_dealloc(dbm_ctx ctx);
+
 dbm dbm_copy(dbm abs);
 
 dbm dbm_bottom();
@@ -70,29 +93,29 @@ dbm dbm_top(unsigned int sz);
 int dbm_is_bottom(dbm abs);
 int dbm_is_top(dbm abs);
 
-int dbm_is_leq(dbm x, dbm y);
+int dbm_is_leq(dbm_ctx ctx, dbm x, dbm y);
 
-int dbm_implies(dbm x, dexpr c);
+int dbm_implies(dbm_ctx ctx, dbm x, dexpr c);
 
-dbm dbm_join(dbm x, dbm y);
-dbm dbm_meet(dbm x, dbm y);
-dbm dbm_widen(dbm x, dbm y);
-dbm dbm_narrowing(dbm x, dbm y);
+dbm dbm_join(dbm_ctx ctx, dbm x, dbm y);
+dbm dbm_meet(dbm_ctx ctx, dbm x, dbm y);
+dbm dbm_widen(dbm_ctx ctx, dbm x, dbm y);
+dbm dbm_narrowing(dbm_ctx ctx, dbm x, dbm y);
 
-void dbm_canonical(dbm x);
+void dbm_canonical(dbm_ctx ctx, dbm x);
  
-void dbm_print_to(std::ostream &o, dbm x);
+void dbm_print_to(dbm_ctx ctx, std::ostream &o, dbm x);
 
-dbm dbm_assign(int v, exp_t expr, dbm x);
+dbm dbm_assign(dbm_ctx ctx, int v, exp_t expr, dbm x);
 
-dbm dbm_cond(ucon con, dbm x);
+dbm dbm_cond(dbm_ctx ctx, ucon con, dbm x);
 
-dbm dbm_apply_dexpr(dexpr d, dbm x);
+dbm dbm_apply_dexpr(dbm_ctx ctx, dexpr d, dbm x);
 
-dbm dbm_forget(int v, dbm x);
-dbm dbm_forget_array(int* vs, int sz, dbm x);
-dbm dbm_rename(rmap* subs, int sz, dbm x);
-dbm dbm_extract(int* vs, int sz, dbm x);
+dbm dbm_forget(dbm_ctx ctx, int v, dbm x);
+dbm dbm_forget_array(dbm_ctx ctx, int* vs, int sz, dbm x);
+dbm dbm_rename(dbm_ctx ctx, rmap* subs, int sz, dbm x);
+dbm dbm_extract(dbm_ctx ctx, int* vs, int sz, dbm x);
 
 void dbm_dealloc(dbm d);
 void dbm_dealloc_ptr(dbm* d);
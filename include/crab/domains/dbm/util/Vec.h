@@ -23,11 +23,14 @@ OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWA
 #include <cstdlib>
 #include <cassert>
 #include <new>
+#include <type_traits>
+#include <utility>
 
 //=================================================================================================
 // Automatically resizable arrays
 //
-// NOTE! Don't use this vector on datatypes that cannot be re-located in memory (with realloc)
+// NOTE! The storage of trivially copyable datatypes is re-located with realloc. Other
+// datatypes are moved to the new storage.
 
 template<class T>
 class vec {
@@ -37,6 +40,9 @@ class vec {
 
     void     init(int size, const T& pad);
     void     grow(int min_cap);
+    void     relocate(int new_cap) { relocate(new_cap, std::integral_constant<bool, std::is_trivially_copyable<T>::value>()); }
+    void     relocate(int new_cap, std::true_type);
+    void     relocate(int new_cap, std::false_type);
 
     // Don't allow copying (error prone):
     vec<T>&  operator = (vec<T>& other) { assert(0); return *this; }
@@ -118,10 +124,10 @@ public:
 
     // Stack interface:
 #if 1
-    void     push  (void)              { if (sz == cap) { cap = imax(2, (cap*3+1)>>1); data = (T*)realloc(data, cap * sizeof(T)); } new (&data[sz]) T(); sz++; }
-    //void     push  (const T& elem)     { if (sz == cap) { cap = imax(2, (cap*3+1)>>1); data = (T*)realloc(data, cap * sizeof(T)); } new (&data[sz]) T(elem); sz++; }
-    void     push  (const T& elem)     { if (sz == cap) { cap = imax(2, (cap*3+1)>>1); data = (T*)realloc(data, cap * sizeof(T)); } data[sz++] = elem; }
-    void     push_ (const T& elem)     { assert(sz < cap); data[sz++] = elem; }
+    void     push  (void)              { if (sz == cap) relocate(imax(2, (cap*3+1)>>1)); new (&data[sz]) T(); sz++; }
+    // elem may be in the vector, so it is copied before the storage is relocated
+    void     push  (const T& elem)     { if (sz == cap) { T e(elem); relocate(imax(2, (cap*3+1)>>1)); new (&data[sz]) T(std::move(e)); } else new (&data[sz]) T(elem); sz++; }
+    void     push_ (const T& elem)     { assert(sz < cap); new (&data[sz]) T(elem); sz++; }
 #else
     void     push  (void)              { if (sz == cap) grow(sz+1); new (&data[sz]) T()    ; sz++; }
     void     push  (const T& elem)     { if (sz == cap) grow(sz+1); new (&data[sz]) T(elem); sz++; }
@@ -143,9 +149,25 @@ public:
 template<class T>
 void vec<T>::grow(int min_cap) {
     if (min_cap <= cap) return;
-    if (cap == 0) cap = (min_cap >= 2) ? min_cap : 2;
-    else          do cap = (cap*3+1) >> 1; while (cap < min_cap);
-    data = (T*)realloc(data, cap * sizeof(T)); }
+    int new_cap = cap;
+    if (new_cap == 0) new_cap = (min_cap >= 2) ? min_cap : 2;
+    else              do new_cap = (new_cap*3+1) >> 1; while (new_cap < min_cap);
+    relocate(new_cap); }
+
+template<class T>
+void vec<T>::relocate(int new_cap, std::true_type) {
+    data = (T*)realloc(data, new_cap * sizeof(T));
+    cap = new_cap; }
+
+template<class T>
+void vec<T>::relocate(int new_cap, std::false_type) {
+    T* new_data = (T*)malloc(new_cap * sizeof(T));
+    for (int i = 0; i < sz; i++) {
+        new (&new_data[i]) T(std::move(data[i]));
+        data[i].~T(); }
+    free(data);
+    data = new_data;
+    cap = new_cap; }
 
 template<class T>
 void vec<T>::growTo(int size, const T& pad) {
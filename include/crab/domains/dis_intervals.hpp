@@ -8,6 +8,8 @@
   implementation available in CodeContracts.
 */
 
+#include <boost/container/small_vector.hpp>
+
 #include <crab/config.h>
 #include <crab/common/debug.hpp>
 #include <crab/common/stats.hpp>
@@ -26,19 +28,27 @@ using namespace std;
 namespace crab {
    namespace domains {
 
-   template< typename Number >
+   // A value has fewer than MaxDisjuncts intervals. When join or
+   // meet reach the limit, the closest consecutive intervals are
+   // merged. When widening reaches it, all the intervals are merged
+   // (see widening).
+   template< typename Number, std::size_t MaxDisjuncts = 50 >
    class dis_interval: public writeable {
     
     public:
 
      typedef bound< Number > bound_t;
      typedef interval< Number > interval_t;
-     typedef dis_interval <Number> dis_interval_t;
+     typedef dis_interval <Number, MaxDisjuncts> dis_interval_t;
+
+     static_assert (MaxDisjuncts >= 2, "a value has fewer than MaxDisjuncts intervals");
 
     private:
 
      typedef enum { BOT, FINITE, TOP } state_t;
-     typedef vector<interval_t> list_intervals_t;
+     // Most values have few disjuncts: keep them inline to avoid
+     // allocating on each copy.
+     typedef boost::container::small_vector<interval_t, 4> list_intervals_t;
     
     public:
 
@@ -136,7 +146,9 @@ namespace crab {
        }
        
        IsOnTheLeft comp;
-       std::sort (l.begin (), l.end(), comp);
+       // the results of join, meet and widening are already sorted
+       if (!std::is_sorted (l.begin (), l.end (), comp))
+         std::sort (l.begin (), l.end(), comp);
        
        list_intervals_t res;
        interval_t prev = interval_t::top (); 
@@ -209,12 +221,9 @@ namespace crab {
      
      dis_interval(state_t state): _state (state) { }
 
-     dis_interval(list_intervals_t l, bool Normalize = true): 
+     dis_interval(list_intervals_t l, bool Normalize = true, bool MergeAll = false): 
          _state (FINITE), _list (l) { 
 
-       // TODO: make it a template parameter
-       const std::size_t max_num_disjunctions = 50;
-
        if (Normalize) {
          bool is_bottom = false;
          list_intervals_t res = normalize (_list, is_bottom);
@@ -231,21 +240,43 @@ namespace crab {
        }
 
 
-       if (is_finite () && _list.size () >= max_num_disjunctions) {
-         // TODO: rather than merging all intervals do a more graceful
-         // degradation e.g., start by merging the nearest intervals.
-         CRAB_WARN (" reached maximum allowed number of disjunctions. ",
-                    "Merging all intervals ... ");
-         interval_t alljoined = approx (_list);
-         _list.clear ();
-         _list.push_back (alljoined);
+       if (is_finite () && _list.size () >= MaxDisjuncts) {
+         CRAB_LOG ("disint", crab::outs() << "-- Reached maximum number of disjunctions " 
+                                          << MaxDisjuncts << "\n");
+         if (MergeAll) {
+           interval_t alljoined = approx (_list);
+           _list.clear ();
+           _list.push_back (alljoined);
+         } else {
+           merge_closest (_list);
+         }
        }
 
        assert (check_well_formed (*this));
      }
+
+     // pre: x is normalized
+     // Merge the two consecutive intervals with the smallest gap
+     // until there are fewer than MaxDisjuncts intervals.
+     static void merge_closest (list_intervals_t& x) {
+       while (x.size () >= MaxDisjuncts) {
+         // the gaps between consecutive intervals are finite
+         unsigned int best = 0;
+         bound_t best_gap = x[1].lb () - x[0].ub ();
+         for (unsigned int i=1; i < x.size () - 1; ++i) {
+           bound_t gap = x[i+1].lb () - x[i].ub ();
+           if (gap < best_gap) {
+             best = i;
+             best_gap = gap;
+           }
+         }
+         x[best] = x[best] | x[best+1];
+         x.erase (x.begin () + best + 1);
+       }
+     }
           
      // pre: x is normalized
-     interval_t approx (list_intervals_t x) const {
+     interval_t approx (const list_intervals_t& x) const {
        if (x.empty ()) 
          CRAB_ERROR ("list should not be empty");
        
@@ -573,15 +604,22 @@ namespace crab {
          list_intervals_t res;
          res.reserve (_list.size () + o._list.size ());
 
+         // Both lists are sorted and their intervals are disjoint:
+         // an interval can only overlap with the intervals of the
+         // other list until the first one that ends after it.
          bool is_bot = true;
-         for (unsigned int i=0; i< _list.size (); ++i){
-           for (unsigned int j=0; j< o._list.size (); ++j){
-             auto meet = _list[i] & o._list[j];
-             if (!meet.is_bottom ()) {
-               res.push_back (meet);
-               is_bot = false;
-             }
+         unsigned int i=0;
+         unsigned int j=0;
+         while (i < _list.size () && j < o._list.size ()) {
+           auto meet = _list[i] & o._list[j];
+           if (!meet.is_bottom ()) {
+             res.push_back (meet);
+             is_bot = false;
            }
+           if (_list[i].ub () <= o._list[j].ub ())
+             i++;
+           else
+             j++;
          }
 
          if (is_bot) {
@@ -675,7 +713,13 @@ namespace crab {
 
          res.push_back (ub_widen);
 
-         return dis_interval_t (res); 
+         // At the limit all the intervals are merged, not only the
+         // closest ones. Merging the closest ones may keep creating
+         // new intervals between the extremes, e.g., over rationals.
+         // A single interval stays single with any further widening
+         // (see the cases above), and then the interval widening
+         // stabilizes.
+         return dis_interval_t (res, true, true); 
        }
      }
 
@@ -1004,8 +1048,8 @@ namespace crab {
      
    };//  class dis_interval
 
-   template<typename N>
-   std::ostream& operator<<(std::ostream& o, dis_interval<N> i) {
+   template<typename N, std::size_t M>
+   std::ostream& operator<<(std::ostream& o, dis_interval<N, M> i) {
      i.write (o);
      return o;
    }
@@ -1017,47 +1061,52 @@ namespace ikos {
   namespace intervals_impl {
      /// --- for interval solver of disequalities
 
-     typedef crab::domains::dis_interval <z_number> dis_z_interval_t;
-     typedef crab::domains::dis_interval <q_number> dis_q_interval_t;
+     template<std::size_t N>
+     struct trim_bound_impl <crab::domains::dis_interval <z_number, N>, z_number> {
+       typedef crab::domains::dis_interval <z_number, N> dis_z_interval_t;
 
-     template<>
-     inline dis_z_interval_t trim_bound(dis_z_interval_t  x, z_number c) {
+       static dis_z_interval_t trim(dis_z_interval_t x, z_number c) {
 
-       if (x.is_bottom ())
-         return x;
+         if (x.is_bottom ())
+           return x;
 
-       dis_z_interval_t res = dis_z_interval_t::bottom ();
+         dis_z_interval_t res = dis_z_interval_t::bottom ();
 
-       if (x.is_top ()) {
-         res = res | dis_z_interval_t (z_interval(c-1).lower_half_line ());
-         res = res | dis_z_interval_t (z_interval(c+1).upper_half_line ());
-       }
-       else {
-         for (auto i: boost::make_iterator_range (x.begin (), x.end ())) {
-           if (!(z_interval (c) <= i)) {
-             res = res | i;
-             continue;
-           }
+         if (x.is_top ()) {
+           res = res | dis_z_interval_t (z_interval(c-1).lower_half_line ());
+           res = res | dis_z_interval_t (z_interval(c+1).upper_half_line ());
+         }
+         else {
+           for (auto i: boost::make_iterator_range (x.begin (), x.end ())) {
+             if (!(z_interval (c) <= i)) {
+               res = res | i;
+               continue;
+             }
 
-           if (i.lb() == c) {
-             res = res | dis_z_interval_t (z_interval(c + 1, i.ub()));
-           } else if (i.ub() == c) {
-             res = res | dis_z_interval_t (z_interval(i.lb(), c - 1));
-           } else {
-             res = res | dis_z_interval_t (z_interval(i.lb(), c - 1));
-             res = res | dis_z_interval_t (z_interval(c + 1, i.ub()));
+             if (i.lb() == c) {
+               res = res | dis_z_interval_t (z_interval(c + 1, i.ub()));
+             } else if (i.ub() == c) {
+               res = res | dis_z_interval_t (z_interval(i.lb(), c - 1));
+             } else {
+               res = res | dis_z_interval_t (z_interval(i.lb(), c - 1));
+               res = res | dis_z_interval_t (z_interval(c + 1, i.ub()));
+             }
            }
          }
+
+         return res;
        }
+     };
 
-       return res;
-     }
+    template<std::size_t N>
+    struct trim_bound_impl <crab::domains::dis_interval <q_number, N>, q_number> {
+      typedef crab::domains::dis_interval <q_number, N> dis_q_interval_t;
 
-    template<>
-    inline dis_q_interval_t trim_bound(dis_q_interval_t i, q_number /* c */) { 
-      // No refinement possible for disequations over rational numbers
-      return i;
-    }
+      static dis_q_interval_t trim(dis_q_interval_t i, q_number /* c */) { 
+        // No refinement possible for disequations over rational numbers
+        return i;
+      }
+    };
 
   } // end namespace intervals_impl
 } // end namespace ikos
@@ -1065,7 +1114,7 @@ namespace ikos {
 namespace crab {
   namespace domains {
 
-   template<typename Number, typename VariableName>
+   template<typename Number, typename VariableName, std::size_t MaxDisjuncts = 50>
    class dis_interval_domain: 
          public ikos::writeable, 
          public numerical_domain< Number, VariableName>,
@@ -1083,8 +1132,8 @@ namespace crab {
      typedef interval <Number> interval_t;
      typedef interval_domain <Number, VariableName> interval_domain_t;
 
-     typedef dis_interval <Number> dis_interval_t;
-     typedef dis_interval_domain <Number, VariableName> dis_interval_domain_t;
+     typedef dis_interval <Number, MaxDisjuncts> dis_interval_t;
+     typedef dis_interval_domain <Number, VariableName, MaxDisjuncts> dis_interval_domain_t;
 
     private:
 
@@ -1361,7 +1410,9 @@ namespace crab {
 
        separate_domain_t env;
        for (auto p : boost::make_iterator_range (_env.begin (), _env.end ())) {
-         env.set (p.first, p.second.normalize ());
+         dis_interval_t i (p.second);
+         i.normalize ();
+         env.set (p.first, i);
        }
        std::swap (_env, env);
      }
@@ -1394,11 +1445,11 @@ namespace crab {
      }  
    }; 
 
-   template<typename Number, typename VariableName>
-   class domain_traits <dis_interval_domain<Number, VariableName> > {
+   template<typename Number, typename VariableName, std::size_t MaxDisjuncts>
+   class domain_traits <dis_interval_domain<Number, VariableName, MaxDisjuncts> > {
     public:
      
-     typedef dis_interval_domain<Number, VariableName> dis_interval_domain_t;
+     typedef dis_interval_domain<Number, VariableName, MaxDisjuncts> dis_interval_domain_t;
      
      static void normalize (dis_interval_domain_t& inv) {
        inv.normalize ();
@@ -83,6 +83,21 @@ namespace crab {
                               z_number n_bytes, bool is_singleton) { }
    };
 
+   // Whether the constraints returned by to_linear_constraint_system
+   // are closed under unit difference bounds, i.e., every bound of x,
+   // -x or x - y implied by the value appears syntactically.
+   template<typename Domain>
+   class diff_constraints_traits {
+    public:
+     static const bool closed = false;
+   };
+
+   template<typename Number, typename VariableName, std::size_t N>
+   class diff_constraints_traits<ikos::interval_domain<Number,VariableName,N> > {
+    public:
+     static const bool closed = true;
+   };
+
    template<typename Domain1, typename Domain2>
    class product_domain_traits {
     public:
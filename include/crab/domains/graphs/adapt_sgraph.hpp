@@ -43,7 +43,7 @@ namespace crab {
         o.sparse = nullptr;
         o.sz = 0;
         o.dense_maxsz = 0;
-        o.sparse_maxsz = 0; 
+        o.sparse_ub = 0;
       }
 
       AdaptSMap(const AdaptSMap& o)
@@ -213,6 +213,26 @@ namespace crab {
         }
       }
 
+      // Returns a pointer to the value bound to k, or nullptr.
+      val_t* find(key_t k)
+      {
+        if(sparse)
+        {
+          // SEE ABOVE WARNING
+          size_t idx = sparse[k];
+          if (idx < sz && dense[idx].key == k)
+            return &(dense[idx].val);
+          return nullptr;
+        } else {
+          for(elt_t* e = dense; e < dense + sz; ++e)
+          {
+            if(e->key == k)
+              return &(e->val);
+          }
+          return nullptr;
+        }
+      }
+
       // precondition: k \in S
       void remove(key_t k)
       {
@@ -306,6 +326,7 @@ namespace crab {
     typedef Weight Wt;
 
     AdaptGraph(void)
+      : edge_count(0)
     { }
 
     AdaptGraph(AdaptGraph<Wt>&& o)
@@ -464,6 +485,7 @@ namespace crab {
     // Management
     bool is_empty(void) const { return edge_count == 0; }
     size_t size(void) const { return _succs.size(); }
+    size_t num_edges(void) const { return edge_count; }
     vert_id new_vertex(void) {
       vert_id v;
       if(free_id.size() > 0)
@@ -0,0 +1,440 @@
+#ifndef CRAB_AUTO_GRAPH_HPP
+#define CRAB_AUTO_GRAPH_HPP
+#include <crab/common/types.hpp>
+#include <crab/domains/graphs/graph_ops.hpp>
+#include <crab/domains/graphs/adapt_sgraph.hpp>
+#include <crab/domains/graphs/dense_graph.hpp>
+
+/*
+ * Weighted graph which is stored either as a DenseGraph or as an
+ * AdaptGraph, depending on its size and edge density.
+ *
+ * The representation is only reconsidered when the graph is copied
+ * (copy construction/assignment and copy()), so iterators and edge
+ * references are never invalidated behind the client's back.
+ * Abstract states are copied often enough during a fixpoint that
+ * this is sufficient to track how the zone evolves.
+ */
+namespace crab {
+
+template <class Weight>
+class AutoGraph : public writeable {
+  typedef DenseGraph<Weight> dense_t;
+  typedef AdaptGraph<Weight> sparse_t;
+ public:
+  typedef Weight Wt;
+  typedef AutoGraph<Wt> graph_t;
+
+  typedef unsigned int vert_id;
+
+  // Graphs with more vertices are always sparse.
+  enum { dense_max_sz = 64 };
+  // Go dense above 1/dense_ratio of the possible edges, and back to
+  // sparse below 1/sparse_ratio.
+  enum { dense_ratio = 4, sparse_ratio = 8 };
+
+  AutoGraph(void)
+    : dense_rep(false)
+  { }
+
+  AutoGraph(const graph_t& o)
+    : dense_rep(o.dense_rep), dg(o.dg), sg(o.sg)
+  { adjust_rep(); }
+
+  AutoGraph(graph_t&& o)
+    : dense_rep(o.dense_rep), dg(std::move(o.dg)), sg(std::move(o.sg))
+  { }
+
+  graph_t& operator=(const graph_t& o)
+  {
+    if(this != &o)
+    {
+      dense_rep = o.dense_rep;
+      dg = o.dg;
+      sg = o.sg;
+      adjust_rep();
+    }
+    return *this;
+  }
+
+  graph_t& operator=(graph_t&& o)
+  {
+    dense_rep = o.dense_rep;
+    dg = std::move(o.dg);
+    sg = std::move(o.sg);
+    return *this;
+  }
+
+  template<class G>
+  static graph_t copy(G& g)
+  {
+    graph_t ret;
+    ret.sg = sparse_t::copy(g);
+    ret.adjust_rep();
+    return ret;
+  }
+
+  bool is_dense(void) const { return dense_rep; }
+  dense_t& dense_graph(void) { return dg; }
+
+  bool is_empty(void) const { return dense_rep ? dg.is_empty() : sg.is_empty(); }
+
+  size_t size(void) const { return dense_rep ? dg.size() : sg.size(); }
+
+  size_t num_edges(void) const { return dense_rep ? dg.num_edges() : sg.num_edges(); }
+
+  vert_id new_vertex(void) { return dense_rep ? dg.new_vertex() : sg.new_vertex(); }
+
+  void growTo(unsigned int new_sz)
+  {
+    if(dense_rep)
+      dg.growTo(new_sz);
+    else
+      sg.growTo(new_sz);
+  }
+
+  void forget(vert_id v)
+  {
+    if(dense_rep)
+      dg.forget(v);
+    else
+      sg.forget(v);
+  }
+
+  bool elem(vert_id x, vert_id y) { return dense_rep ? dg.elem(x, y) : sg.elem(x, y); }
+
+  typedef typename sparse_t::mut_val_ref_t mut_val_ref_t;
+
+  bool lookup(vert_id x, vert_id y, mut_val_ref_t* w)
+  {
+    if(!dense_rep)
+      return sg.lookup(x, y, w);
+
+    if(!dg.elem(x, y))
+      return false;
+    (*w) = &(dg.edge_val(x, y));
+    return true;
+  }
+
+  // Precondition: elem(x, y) is true.
+  Wt& edge_val(vert_id x, vert_id y)
+  {
+    return dense_rep ? dg.edge_val(x, y) : sg.edge_val(x, y);
+  }
+
+  // Precondition: elem(x, y) is true.
+  Wt operator()(vert_id x, vert_id y) { return edge_val(x, y); }
+
+  void clear_edges(void)
+  {
+    if(dense_rep)
+      dg.clear_edges();
+    else
+      sg.clear_edges();
+  }
+
+  void clear(void)
+  {
+    dg.clear();
+    sg.clear();
+    dense_rep = false;
+  }
+
+  void add_edge(vert_id x, Wt wt, vert_id y)
+  {
+    if(dense_rep)
+      dg.add_edge(x, wt, y);
+    else
+      sg.add_edge(x, wt, y);
+  }
+
+  void set_edge(vert_id s, Wt w, vert_id d)
+  {
+    if(dense_rep)
+      dg.set_edge(s, w, d);
+    else
+      sg.set_edge(s, w, d);
+  }
+
+  template<class Op>
+  void update_edge(vert_id s, Wt w, vert_id d, Op& op)
+  {
+    if(dense_rep)
+      dg.update_edge(s, w, d, op);
+    else
+      sg.update_edge(s, w, d, op);
+  }
+
+  // Both representations keep a free-list bitmap, so vertices are
+  // enumerated the same way.
+  typedef typename dense_t::vert_iterator vert_iterator;
+  typedef typename dense_t::vert_range vert_range;
+
+  vert_range verts(void) const
+  {
+    return dense_rep ? dg.verts() : vert_range(sg.size(), sg.is_free);
+  }
+
+  class adj_iterator {
+    typedef typename dense_t::succ_iterator d_iter_t;
+    typedef typename sparse_t::adj_iterator_t s_iter_t;
+  public:
+    adj_iterator(void)
+      : dense(false)
+    { }
+    adj_iterator(const d_iter_t& _d)
+      : dense(true), d(_d)
+    { }
+    adj_iterator(const s_iter_t& _s)
+      : dense(false), s(_s)
+    { }
+    vert_id operator*(void) const { return dense ? *d : *s; }
+    adj_iterator& operator++(void)
+    {
+      if(dense)
+        ++d;
+      else
+        ++s;
+      return *this;
+    }
+    bool operator!=(const adj_iterator& o) { return dense ? (d != o.d) : (s != o.s); }
+
+  protected:
+    bool dense;
+    d_iter_t d;
+    s_iter_t s;
+  };
+
+  class adj_range {
+  public:
+    typedef adj_iterator iterator;
+
+    adj_range(const adj_iterator& _b, const adj_iterator& _e, size_t _sz)
+      : b(_b), e(_e), sz(_sz)
+    { }
+    adj_iterator begin(void) const { return b; }
+    adj_iterator end(void) const { return e; }
+    size_t size(void) const { return sz; }
+
+  protected:
+    adj_iterator b;
+    adj_iterator e;
+    size_t sz;
+  };
+
+  typedef adj_iterator succ_iterator;
+  typedef adj_iterator pred_iterator;
+  typedef adj_range succ_range;
+  typedef adj_range pred_range;
+
+  succ_range succs(vert_id v)
+  {
+    if(dense_rep)
+    {
+      auto r = dg.succs(v);
+      return adj_range(r.begin(), r.end(), r.size());
+    }
+    auto r = sg.succs(v);
+    return adj_range(r.begin(), r.end(), r.size());
+  }
+
+  pred_range preds(vert_id v)
+  {
+    if(dense_rep)
+    {
+      auto r = dg.preds(v);
+      return adj_range(r.begin(), r.end(), r.size());
+    }
+    auto r = sg.preds(v);
+    return adj_range(r.begin(), r.end(), r.size());
+  }
+
+  class edge_ref_t {
+  public:
+    edge_ref_t(vert_id _vert, Wt& _val)
+      : vert(_vert), val(_val)
+    { }
+    vert_id vert;
+    Wt& val;
+  };
+
+  template<class DIt>
+  class edge_iter {
+    typedef typename sparse_t::edge_iter s_iter_t;
+  public:
+    typedef edge_ref_t edge_ref;
+
+    edge_iter(void)
+      : dense(false)
+    { }
+    edge_iter(const DIt& _d)
+      : dense(true), d(_d)
+    { }
+    edge_iter(const s_iter_t& _s)
+      : dense(false), s(_s)
+    { }
+    edge_ref operator*(void) const
+    {
+      if(dense)
+      {
+        auto e = *d;
+        return edge_ref(e.vert, e.val);
+      }
+      auto e = *s;
+      return edge_ref(e.vert, e.val);
+    }
+    edge_iter& operator++(void)
+    {
+      if(dense)
+        ++d;
+      else
+        ++s;
+      return *this;
+    }
+    bool operator!=(const edge_iter& o) { return dense ? (d != o.d) : (s != o.s); }
+
+  protected:
+    bool dense;
+    DIt d;
+    s_iter_t s;
+  };
+
+  template<class It>
+  class edge_range {
+  public:
+    typedef It iterator;
+
+    edge_range(const It& _b, const It& _e, size_t _sz)
+      : b(_b), e(_e), sz(_sz)
+    { }
+    It begin(void) const { return b; }
+    It end(void) const { return e; }
+    size_t size(void) const { return sz; }
+
+  protected:
+    It b;
+    It e;
+    size_t sz;
+  };
+
+  typedef edge_iter<typename dense_t::fwd_edge_iterator> fwd_edge_iterator;
+  typedef edge_iter<typename dense_t::rev_edge_iterator> rev_edge_iterator;
+  typedef edge_range<fwd_edge_iterator> e_succ_range;
+  typedef edge_range<rev_edge_iterator> e_pred_range;
+
+  e_succ_range e_succs(vert_id v)
+  {
+    if(dense_rep)
+    {
+      auto r = dg.e_succs(v);
+      return e_succ_range(r.begin(), r.end(), r.size());
+    }
+    auto r = sg.e_succs(v);
+    return e_succ_range(r.begin(), r.end(), r.size());
+  }
+
+  e_pred_range e_preds(vert_id v)
+  {
+    if(dense_rep)
+    {
+      auto r = dg.e_preds(v);
+      return e_pred_range(r.begin(), r.end(), r.size());
+    }
+    auto r = sg.e_preds(v);
+    return e_pred_range(r.begin(), r.end(), r.size());
+  }
+
+  void write(std::ostream& o) {
+    if(dense_rep)
+      dg.write(o);
+    else
+      sg.write(o);
+  }
+
+ protected:
+
+  // Switch representation if size/density crossed a threshold.
+  void adjust_rep(void)
+  {
+    size_t sz = size();
+    size_t max_edges = sz*sz;
+    if(dense_rep)
+    {
+      if(sz > dense_max_sz || num_edges()*sparse_ratio < max_edges)
+        to_sparse();
+    } else {
+      if(sz > 0 && sz <= dense_max_sz && num_edges()*dense_ratio >= max_edges)
+        to_dense();
+    }
+  }
+
+  // Conversions preserve vertex ids, including the free ones.
+  void to_dense(void)
+  {
+    dg.clear();
+    dg.growTo(sg.size());
+    for(vert_id v = 0; v < sg.size(); v++)
+    {
+      if(sg.is_free[v])
+        dg.forget(v);
+    }
+    for(vert_id s : sg.verts())
+    {
+      for(auto e : sg.e_succs(s))
+        dg.add_edge(s, e.val, e.vert);
+    }
+    sg.clear();
+    dense_rep = true;
+  }
+
+  void to_sparse(void)
+  {
+    sg.clear();
+    sg.growTo(dg.size());
+    vert_id next = 0;
+    for(vert_id v : dg.verts())
+    {
+      for(; next < v; next++)
+        sg.forget(next);
+      next = v+1;
+    }
+    for(; next < dg.size(); next++)
+      sg.forget(next);
+    for(vert_id s : dg.verts())
+    {
+      for(auto e : dg.e_succs(s))
+        sg.add_edge(s, e.val, e.vert);
+    }
+    dg.clear();
+    dense_rep = false;
+  }
+
+  bool dense_rep;
+  dense_t dg;
+  sparse_t sg;
+};
+
+template<class Wt>
+class DenseClosure< AutoGraph<Wt> > {
+ public:
+  template<class EdgeVector>
+  static bool close(AutoGraph<Wt>& g, EdgeVector& delta)
+  {
+    return g.is_dense() &&
+      g.dense_graph().close_floyd_warshall(g.size(), delta);
+  }
+};
+
+template<class Wt>
+class DenseClosure< SubGraph< AutoGraph<Wt> > > {
+ public:
+  template<class EdgeVector>
+  static bool close(SubGraph< AutoGraph<Wt> >& g, EdgeVector& delta)
+  {
+    return g.g.is_dense() &&
+      g.g.dense_graph().close_floyd_warshall(g.v_ex, delta);
+  }
+};
+
+}
+#endif
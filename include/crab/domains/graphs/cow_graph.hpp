@@ -0,0 +1,439 @@
+#ifndef CRAB_COW_GRAPH_HPP
+#define CRAB_COW_GRAPH_HPP
+#include <vector>
+#include <memory>
+#include <limits>
+#include <type_traits>
+#include <crab/common/types.hpp>
+#include <crab/domains/graphs/adapt_sgraph.hpp>
+
+/*
+ * Copy-on-write weighted graph.
+ *
+ * Adjacency rows (successor maps and predecessor sets) are adaptive
+ * sparse maps held through reference-counted pointers. Copying the
+ * graph copies only the row pointers; a row is cloned the first time
+ * it is modified while shared. Thus copying an abstract state and
+ * then applying a transfer function costs O(|V|) plus the size of the
+ * rows actually touched, rather than O(|V| + |E|).
+ *
+ * Weights live only in the successor maps, so edges are never
+ * modified in place through references: mut_val_ref_t and the edge
+ * iterators carry the weight by value, and writing a mut_val_ref_t
+ * goes through set_edge.
+ *
+ * Weights may be stored in a narrower type than the one the graph
+ * computes with (e.g. int32_t instead of long). A weight above the
+ * range of the storage type is weaker than any representable one, so
+ * the edge is dropped; a weight below it is rounded up to the least
+ * representable one. Both only lose precision.
+ */
+namespace crab {
+
+template <class Weight, class Store = Weight>
+class CowGraph : public writeable {
+ public:
+  typedef Weight Wt;
+  typedef Store store_t;
+  typedef CowGraph<Wt, Store> graph_t;
+
+  typedef unsigned int vert_id;
+
+ private:
+  typedef AdaptSMap<Store> succ_map_t;
+  typedef AdaptSMap<char> pred_set_t;
+  typedef std::shared_ptr<succ_map_t> succ_ref_t;
+  typedef std::shared_ptr<pred_set_t> pred_ref_t;
+
+ public:
+  CowGraph(void)
+    : edge_count(0)
+  { }
+
+  CowGraph(const graph_t& o) = default;
+  CowGraph(graph_t&& o) = default;
+  graph_t& operator=(const graph_t& o) = default;
+  graph_t& operator=(graph_t&& o) = default;
+
+  template<class G>
+  static graph_t copy(const G& o)
+  {
+    graph_t g;
+    g.growTo(o.size());
+
+    for(vert_id s : o.verts())
+    {
+      for(auto e : const_cast<G&>(o).e_succs(s))
+        g.add_edge(s, e.val, e.vert);
+    }
+    return g;
+  }
+
+  class vert_iterator {
+  public:
+    vert_iterator(vert_id _v, const std::vector<bool>& _is_free)
+      : v(_v), is_free(&_is_free)
+    { }
+    vert_id operator*(void) const { return v; }
+    bool operator!=(const vert_iterator& o) {
+      while(v < o.v && (*is_free)[v])
+        ++v;
+      return v < o.v;
+    }
+    vert_iterator& operator++(void) { ++v; return *this; }
+
+    vert_id v;
+    const std::vector<bool>* is_free;
+  };
+
+  class vert_range {
+  public:
+    vert_range(const std::vector<bool>& _is_free)
+      : is_free(_is_free)
+    { }
+
+    vert_iterator begin(void) const { return vert_iterator(0, is_free); }
+    vert_iterator end(void) const { return vert_iterator(is_free.size(), is_free); }
+
+    size_t size(void) const { return is_free.size(); }
+    const std::vector<bool>& is_free;
+  };
+  vert_range verts(void) const { return vert_range(is_free); }
+
+  typedef typename succ_map_t::key_range_t succ_range;
+  typedef typename pred_set_t::key_range_t pred_range;
+
+  succ_range succs(vert_id v) const { return succ_row(v).keys(); }
+  pred_range preds(vert_id v) const { return pred_row(v).keys(); }
+
+  class edge_ref_t {
+  public:
+    edge_ref_t(vert_id _vert, Wt _val)
+      : vert(_vert), val(_val)
+    { }
+    vert_id vert;
+    Wt val;
+  };
+
+  class fwd_edge_iter {
+  public:
+    typedef edge_ref_t edge_ref;
+    typedef typename succ_map_t::elt_iter_t elt_iter_t;
+
+    fwd_edge_iter(void)
+      : it(nullptr)
+    { }
+    fwd_edge_iter(elt_iter_t _it)
+      : it(_it)
+    { }
+
+    edge_ref operator*(void) const { return edge_ref((*it).key, Wt((*it).val)); }
+    fwd_edge_iter& operator++(void) { ++it; return *this; }
+    bool operator!=(const fwd_edge_iter& o) { return it != o.it; }
+
+    elt_iter_t it;
+  };
+
+  class rev_edge_iter {
+  public:
+    typedef edge_ref_t edge_ref;
+    typedef typename pred_set_t::key_iter_t key_iter_t;
+
+    rev_edge_iter(void)
+      : g(nullptr)
+    { }
+    rev_edge_iter(const graph_t& _g, vert_id _d, key_iter_t _it)
+      : g(&_g), d(_d), it(_it)
+    { }
+
+    edge_ref operator*(void) const { return edge_ref((*it), g->edge_val((*it), d)); }
+    rev_edge_iter& operator++(void) { ++it; return *this; }
+    bool operator!=(const rev_edge_iter& o) { return it != o.it; }
+
+    const graph_t* g;
+    vert_id d;
+    key_iter_t it;
+  };
+
+  class fwd_edge_range {
+  public:
+    typedef fwd_edge_iter iterator;
+
+    fwd_edge_range(const succ_map_t& _row)
+      : row(&_row)
+    { }
+    fwd_edge_iter begin(void) const { return fwd_edge_iter(row->elts().begin()); }
+    fwd_edge_iter end(void) const { return fwd_edge_iter(row->elts().end()); }
+    size_t size(void) const { return row->size(); }
+
+    const succ_map_t* row;
+  };
+
+  class rev_edge_range {
+  public:
+    typedef rev_edge_iter iterator;
+
+    rev_edge_range(const graph_t& _g, vert_id _d)
+      : g(&_g), d(_d)
+    { }
+    rev_edge_iter begin(void) const { return rev_edge_iter(*g, d, g->preds(d).begin()); }
+    rev_edge_iter end(void) const { return rev_edge_iter(*g, d, g->preds(d).end()); }
+    size_t size(void) const { return g->preds(d).size(); }
+
+    const graph_t* g;
+    vert_id d;
+  };
+
+  typedef fwd_edge_range e_succ_range;
+  typedef rev_edge_range e_pred_range;
+
+  e_succ_range e_succs(vert_id v) const { return fwd_edge_range(succ_row(v)); }
+  e_pred_range e_preds(vert_id v) const { return rev_edge_range(*this, v); }
+
+  // Management
+  bool is_empty(void) const { return edge_count == 0; }
+  size_t size(void) const { return is_free.size(); }
+  size_t num_edges(void) const { return edge_count; }
+
+  vert_id new_vertex(void) {
+    vert_id v;
+    if(free_id.size() > 0)
+    {
+      v = free_id.back();
+      assert(v < size());
+      free_id.pop_back();
+      is_free[v] = false;
+    } else {
+      v = is_free.size();
+      is_free.push_back(false);
+      _succs.push_back(succ_ref_t());
+      _preds.push_back(pred_ref_t());
+    }
+    return v;
+  }
+
+  void growTo(vert_id v) {
+    while(size() < v)
+      new_vertex();
+  }
+
+  void forget(vert_id v)
+  {
+    if(is_free[v])
+      return;
+
+    for(vert_id d : succs(v))
+      preds_mut(d).remove(v);
+    edge_count -= succ_row(v).size();
+    _succs[v].reset();
+
+    for(vert_id s : preds(v))
+      succs_mut(s).remove(v);
+    edge_count -= pred_row(v).size();
+    _preds[v].reset();
+
+    is_free[v] = true;
+    free_id.push_back(v);
+  }
+
+  void clear_edges(void) {
+    for(succ_ref_t& r : _succs)
+      r.reset();
+    for(pred_ref_t& r : _preds)
+      r.reset();
+    edge_count = 0;
+  }
+
+  void clear(void)
+  {
+    _succs.clear();
+    _preds.clear();
+    is_free.clear();
+    free_id.clear();
+    edge_count = 0;
+  }
+
+  bool elem(vert_id s, vert_id d) const
+  {
+    return succ_row(s).elem(d);
+  }
+
+  // Precondition: elem(s, d) is true.
+  Wt edge_val(vert_id s, vert_id d) const
+  {
+    return Wt(*find_wt(s, d));
+  }
+
+  // Precondition: elem(s, d) is true.
+  Wt operator()(vert_id s, vert_id d) const { return edge_val(s, d); }
+
+  // Reading does not unshare the row: the weight is cached, and
+  // assignment writes it back to the graph.
+  class mut_val_ref_t {
+   public:
+    mut_val_ref_t(): g(nullptr) { }
+    operator Wt () const { assert (g); return w; }
+    void operator=(Wt _w) { assert (g); g->set_edge(s, _w, d); w = _w; }
+
+   private:
+    friend class CowGraph<Weight, Store>;
+    graph_t* g;
+    vert_id s;
+    vert_id d;
+    Wt w;
+  };
+
+  bool lookup(vert_id s, vert_id d, mut_val_ref_t* w)
+  {
+    const Store* sw = find_wt(s, d);
+    if(!sw)
+      return false;
+    w->w = Wt(*sw);
+    w->g = this;
+    w->s = s;
+    w->d = d;
+    return true;
+  }
+
+  // Assumption: (s, d) not in the graph
+  void add_edge(vert_id s, Wt w, vert_id d)
+  {
+    Store sw;
+    if(!to_store(w, sw))
+      return;
+    succs_mut(s).add(d, sw);
+    preds_mut(d).add(s, 0);
+    edge_count++;
+  }
+
+  template<class Op>
+  void update_edge(vert_id s, Wt w, vert_id d, Op& op)
+  {
+    const Store* old = find_wt(s, d);
+    if(old)
+      set_edge(s, op.apply(Wt(*old), w), d);
+    else if(!op.default_is_absorbing())
+      add_edge(s, w, d);
+  }
+
+  void set_edge(vert_id s, Wt w, vert_id d)
+  {
+    const Store* old = find_wt(s, d);
+    if(!old)
+    {
+      add_edge(s, w, d);
+      return;
+    }
+
+    Store sw;
+    if(!to_store(w, sw))
+      remove_edge(s, d);
+    else if(!(sw == *old))
+      *(succs_mut(s).find(d)) = sw;
+  }
+
+  void write(std::ostream& o) {
+    o << "[|";
+    bool first = true;
+    for(vert_id v : verts())
+    {
+      auto it = e_succs(v).begin();
+      auto end = e_succs(v).end();
+
+      if(it != end)
+      {
+        if(first)
+          first = false;
+        else
+          o << ", ";
+
+        o << "[v" << v << " -> ";
+        o << "(" << (*it).val << ":" << (*it).vert << ")";
+        for(++it; it != end; ++it)
+        {
+          o << ", (" << (*it).val << ":" << (*it).vert << ")";
+        }
+        o << "]";
+      }
+    }
+    o << "|]";
+  }
+
+ protected:
+
+  // Shared, never modified, row standing for all empty rows.
+  static const succ_map_t& empty_succs(void) {
+    static const succ_map_t e;
+    return e;
+  }
+  static const pred_set_t& empty_preds(void) {
+    static const pred_set_t e;
+    return e;
+  }
+
+  const succ_map_t& succ_row(vert_id v) const {
+    return _succs[v] ? *_succs[v] : empty_succs();
+  }
+  const pred_set_t& pred_row(vert_id v) const {
+    return _preds[v] ? *_preds[v] : empty_preds();
+  }
+
+  const Store* find_wt(vert_id s, vert_id d) const {
+    return const_cast<succ_map_t&>(succ_row(s)).find(d);
+  }
+
+  // Convert a weight to the storage type. Returns false if the edge
+  // must be dropped.
+  static bool to_store(Wt w, Store& out) {
+    return to_store(w, out, std::integral_constant<bool,
+                    (std::numeric_limits<Store>::digits < std::numeric_limits<Wt>::digits)>());
+  }
+  static bool to_store(Wt w, Store& out, std::false_type) {
+    out = w;
+    return true;
+  }
+  static bool to_store(Wt w, Store& out, std::true_type) {
+    if(w > Wt(std::numeric_limits<Store>::max()))
+      return false;
+    if(w < Wt(std::numeric_limits<Store>::min()))
+      out = std::numeric_limits<Store>::min();
+    else
+      out = Store(w);
+    return true;
+  }
+
+  void remove_edge(vert_id s, vert_id d) {
+    succs_mut(s).remove(d);
+    preds_mut(d).remove(s);
+    edge_count--;
+  }
+
+  // Return a row owned by this graph only, cloning it if necessary.
+  succ_map_t& succs_mut(vert_id v) {
+    succ_ref_t& r = _succs[v];
+    if(!r)
+      r = std::make_shared<succ_map_t>();
+    else if(r.use_count() > 1)
+      r = std::make_shared<succ_map_t>(*r);
+    return *r;
+  }
+  pred_set_t& preds_mut(vert_id v) {
+    pred_ref_t& r = _preds[v];
+    if(!r)
+      r = std::make_shared<pred_set_t>();
+    else if(r.use_count() > 1)
+      r = std::make_shared<pred_set_t>(*r);
+    return *r;
+  }
+
+  std::vector<succ_ref_t> _succs;
+  std::vector<pred_ref_t> _preds;
+
+  size_t edge_count;
+
+  std::vector<bool> is_free;
+  std::vector<vert_id> free_id;
+};
+
+}
+#endif
@@ -0,0 +1,580 @@
+#ifndef CRAB_DENSE_GRAPH_HPP
+#define CRAB_DENSE_GRAPH_HPP
+#include <vector>
+#include <limits>
+#include <type_traits>
+#include <stdint.h>
+#include <crab/common/types.hpp>
+#include <crab/domains/graphs/graph_ops.hpp>
+
+/*
+ * Dense weighted graph: edge weights are stored in a flat row-major
+ * matrix, and successors/predecessors as one bit-vector per vertex.
+ *
+ * Intended for zones which stay small (a few dozen vertices) but
+ * dense. Besides constant-time edge access, the flat layout allows
+ * closing the graph with a Floyd-Warshall whose inner loop is a
+ * branch-free min-plus over a matrix row, which the compiler
+ * vectorizes.
+ */
+namespace crab {
+
+template <class Weight>
+class DenseGraph : public writeable {
+  typedef uint64_t word_t;
+  enum { word_bits = 64 };
+  enum { init_max_sz = 8 };
+ public:
+  typedef Weight Wt;
+  typedef DenseGraph<Wt> graph_t;
+
+  typedef unsigned int vert_id;
+
+  DenseGraph(void)
+    : sz(0), max_sz(0), words(0), edge_count(0)
+  { }
+
+  DenseGraph(const graph_t& o) = default;
+  DenseGraph(graph_t&& o) = default;
+  graph_t& operator=(const graph_t& o) = default;
+  graph_t& operator=(graph_t&& o) = default;
+
+  template<class G>
+  static graph_t copy(G& g)
+  {
+    graph_t ret;
+    ret.growTo(g.size());
+
+    for(vert_id s : g.verts())
+    {
+      for(auto e : g.e_succs(s))
+        ret.add_edge(s, e.val, e.vert);
+    }
+    return ret;
+  }
+
+  bool is_empty(void) const { return edge_count == 0; }
+
+  // Number of allocated vertices
+  size_t size(void) const { return sz; }
+
+  size_t num_edges(void) const { return edge_count; }
+
+  vert_id new_vertex(void)
+  {
+    vert_id v;
+    if(free_id.size() > 0)
+    {
+      v = free_id.back();
+      assert(v < sz);
+      free_id.pop_back();
+      is_free[v] = false;
+    } else {
+      if(max_sz <= sz)
+        growCap(max_sz == 0 ? (unsigned int) init_max_sz : 2*max_sz);
+      v = sz++;
+      is_free.push_back(false);
+    }
+    assert(succ_count[v] == 0 && pred_count[v] == 0);
+    return v;
+  }
+
+  // growTo shouldn't be used after forget
+  void growTo(unsigned int new_sz)
+  {
+    if(new_sz <= sz)
+      return;
+    if(max_sz < new_sz)
+      growCap(std::max(new_sz, (unsigned int) init_max_sz));
+    for(; sz < new_sz; sz++)
+      is_free.push_back(false);
+  }
+
+  void forget(vert_id v)
+  {
+    assert(v < sz);
+    if(is_free[v])
+      return;
+
+    free_id.push_back(v);
+    is_free[v] = true;
+
+    edge_count -= succ_count[v];
+    for(vert_id d : succs(v))
+    {
+      clear_bit(rev, d, v);
+      pred_count[d]--;
+    }
+    clear_row(fwd, v);
+    succ_count[v] = 0;
+
+    edge_count -= pred_count[v];
+    for(vert_id s : preds(v))
+    {
+      clear_bit(fwd, s, v);
+      succ_count[s]--;
+    }
+    clear_row(rev, v);
+    pred_count[v] = 0;
+  }
+
+  // Check whether an edge is live
+  bool elem(vert_id x, vert_id y) const {
+    return test_bit(fwd, x, y);
+  }
+
+  class mut_val_ref_t {
+   public:
+
+    mut_val_ref_t(): w(nullptr) { }
+    operator Wt () const { assert (w); return *w; }
+    void operator=(Wt* _w) { w = _w; }
+    void operator=(Wt _w) { assert (w); *w = _w; }
+
+   private:
+    Wt* w;
+  };
+
+  typedef mut_val_ref_t mut_val_ref_t;
+
+  bool lookup(vert_id x, vert_id y, mut_val_ref_t* w) {
+    if(!elem(x, y))
+      return false;
+    *w = &mtx[max_sz*x + y];
+    return true;
+  }
+
+  // Precondition: elem(x, y) is true.
+  Wt& edge_val(vert_id x, vert_id y) {
+    return mtx[max_sz*x + y];
+  }
+
+  Wt edge_val(vert_id x, vert_id y) const {
+    return mtx[max_sz*x + y];
+  }
+
+  // Precondition: elem(x, y) is true.
+  Wt operator()(vert_id x, vert_id y) const {
+    return mtx[max_sz*x + y];
+  }
+
+  void clear_edges(void) {
+    std::fill(fwd.begin(), fwd.end(), 0);
+    std::fill(rev.begin(), rev.end(), 0);
+    std::fill(succ_count.begin(), succ_count.end(), 0);
+    std::fill(pred_count.begin(), pred_count.end(), 0);
+    edge_count = 0;
+  }
+
+  void clear(void)
+  {
+    clear_edges();
+    is_free.clear();
+    free_id.clear();
+    sz = 0;
+  }
+
+  // Assumption: (x, y) not in mtx
+  void add_edge(vert_id x, Wt wt, vert_id y)
+  {
+    assert(x < sz && y < sz);
+    assert(!elem(x, y));
+    set_bit(fwd, x, y);
+    set_bit(rev, y, x);
+    succ_count[x]++;
+    pred_count[y]++;
+    mtx[max_sz*x + y] = wt;
+    edge_count++;
+  }
+
+  void set_edge(vert_id s, Wt w, vert_id d)
+  {
+    if(!elem(s, d))
+      add_edge(s, w, d);
+    else
+      edge_val(s, d) = w;
+  }
+
+  template<class Op>
+  void update_edge(vert_id s, Wt w, vert_id d, Op& op)
+  {
+    if(elem(s, d))
+    {
+      edge_val(s, d) = op.apply(edge_val(s, d), w);
+      return;
+    }
+
+    if(!op.default_is_absorbing())
+      add_edge(s, w, d);
+  }
+
+  class vert_iterator {
+  public:
+    vert_iterator(vert_id _v, const vector<bool>& _is_free)
+      : v(_v), is_free(&_is_free)
+    { }
+    vert_id operator*(void) const { return v; }
+    vert_iterator& operator++(void) { ++v; return *this; }
+    bool operator!=(const vert_iterator& o) {
+      while(v < o.v && (*is_free)[v])
+        ++v;
+      return v < o.v;
+    }
+  protected:
+    vert_id v;
+    const vector<bool>* is_free;
+  };
+
+  class vert_range {
+  public:
+    vert_range(vert_id _sz, const vector<bool>& _is_free)
+      : sz(_sz), is_free(&_is_free)
+    { }
+    vert_iterator begin(void) const { return vert_iterator(0, *is_free); }
+    vert_iterator end(void) const { return vert_iterator(sz, *is_free); }
+  protected:
+    vert_id sz;
+    const vector<bool>* is_free;
+  };
+
+  vert_range verts(void) const { return vert_range(sz, is_free); }
+
+  // Iterates over the set bits of a row.
+  class adj_iterator {
+  public:
+    adj_iterator(void)
+      : w(nullptr), end(nullptr), base(0), cur(0)
+    { }
+    adj_iterator(const word_t* _w, const word_t* _end)
+      : w(_w), end(_end), base(0), cur(_w < _end ? *_w : 0)
+    { skip(); }
+
+    vert_id operator*(void) const { return base + __builtin_ctzll(cur); }
+    adj_iterator& operator++(void) { cur &= cur - 1; skip(); return *this; }
+    bool operator!=(const adj_iterator& o) const { return w != o.w || cur != o.cur; }
+
+  protected:
+    void skip(void) {
+      while(!cur && w < end)
+      {
+        ++w;
+        base += word_bits;
+        cur = (w < end) ? *w : 0;
+      }
+    }
+
+    const word_t* w;
+    const word_t* end;
+    vert_id base;
+    word_t cur;
+  };
+
+  class adj_list {
+  public:
+    typedef adj_iterator iterator;
+
+    adj_list(void)
+      : row(nullptr), nwords(0), count(0)
+    { }
+    adj_list(const word_t* _row, unsigned int _nwords, unsigned int _count)
+      : row(_row), nwords(_nwords), count(_count)
+    { }
+    adj_iterator begin(void) const { return adj_iterator(row, row + nwords); }
+    adj_iterator end(void) const { return adj_iterator(row + nwords, row + nwords); }
+    unsigned int size(void) const { return count; }
+
+    bool mem(unsigned int v) const {
+      return (row[v/word_bits] >> (v%word_bits)) & 1;
+    }
+
+  protected:
+    const word_t* row;
+    unsigned int nwords;
+    unsigned int count;
+  };
+
+  typedef adj_iterator succ_iterator;
+  typedef adj_iterator pred_iterator;
+  typedef adj_list succ_range;
+  typedef adj_list pred_range;
+
+  class edge_ref_t {
+  public:
+    edge_ref_t(vert_id _v, Wt& _w)
+      : vert(_v), val(_w)
+    { }
+    vert_id vert;
+    Wt& val;
+  };
+
+  class fwd_edge_iterator {
+  public:
+    typedef edge_ref_t edge_ref;
+    fwd_edge_iterator(void)
+      : g(nullptr)
+    { }
+    fwd_edge_iterator(graph_t& _g, vert_id _s, adj_iterator _it)
+      : g(&_g), s(_s), it(_it)
+    { }
+
+    edge_ref operator*(void) const { return edge_ref((*it), g->edge_val(s, (*it))); }
+    fwd_edge_iterator& operator++(void) { ++it; return *this; }
+    bool operator!=(const fwd_edge_iterator& o) { return it != o.it; }
+
+    graph_t* g;
+    vert_id s;
+    adj_iterator it;
+  };
+
+  class rev_edge_iterator {
+  public:
+    typedef edge_ref_t edge_ref;
+    rev_edge_iterator(void)
+      : g(nullptr)
+    { }
+    rev_edge_iterator(graph_t& _g, vert_id _d, adj_iterator _it)
+      : g(&_g), d(_d), it(_it)
+    { }
+
+    edge_ref operator*(void) const { return edge_ref((*it), g->edge_val((*it), d)); }
+    rev_edge_iterator& operator++(void) { ++it; return *this; }
+    bool operator!=(const rev_edge_iterator& o) { return it != o.it; }
+
+    graph_t* g;
+    vert_id d;
+    adj_iterator it;
+  };
+
+  class fwd_edge_range {
+  public:
+    typedef fwd_edge_iterator iterator;
+    fwd_edge_range(graph_t& _g, vert_id _s)
+      : g(&_g), s(_s)
+    { }
+
+    fwd_edge_iterator begin(void) const { return fwd_edge_iterator(*g, s, g->succs(s).begin()); }
+    fwd_edge_iterator end(void) const { return fwd_edge_iterator(*g, s, g->succs(s).end()); }
+    unsigned int size(void) const { return g->succs(s).size(); }
+    graph_t* g;
+    vert_id s;
+  };
+
+  class rev_edge_range {
+  public:
+    typedef rev_edge_iterator iterator;
+    rev_edge_range(graph_t& _g, vert_id _d)
+      : g(&_g), d(_d)
+    { }
+
+    rev_edge_iterator begin(void) const { return rev_edge_iterator(*g, d, g->preds(d).begin()); }
+    rev_edge_iterator end(void) const { return rev_edge_iterator(*g, d, g->preds(d).end()); }
+    unsigned int size(void) const { return g->preds(d).size(); }
+    graph_t* g;
+    vert_id d;
+  };
+
+  typedef fwd_edge_range e_succ_range;
+  typedef rev_edge_range e_pred_range;
+
+  succ_range succs(vert_id v) const
+  {
+    return adj_list(&fwd[v*words], words, succ_count[v]);
+  }
+  pred_range preds(vert_id v) const
+  {
+    return adj_list(&rev[v*words], words, pred_count[v]);
+  }
+  e_succ_range e_succs(vert_id v) { return fwd_edge_range(*this, v); }
+  e_pred_range e_preds(vert_id v) { return rev_edge_range(*this, v); }
+
+  // Compute the shortest-path closure of the graph without vertex
+  // v_ex (pass size() to keep every vertex), pushing onto delta each
+  // edge which is new or tightened. Returns false, leaving delta
+  // untouched, if the weights are too large to run the algorithm
+  // without overflow.
+  template<class EdgeVector>
+  bool close_floyd_warshall(vert_id v_ex, EdgeVector& delta)
+  {
+    return close_fw(v_ex, delta, std::is_integral<Wt>());
+  }
+
+  void write(std::ostream& o) {
+    o << "[|";
+    bool first = true;
+    for(vert_id v = 0; v < sz; v++)
+    {
+      auto it = succs(v).begin();
+      auto end = succs(v).end();
+
+      if(it != end)
+      {
+        if(first)
+          first = false;
+        else
+          o << ", ";
+
+        o << "[v" << v << " -> ";
+        o << "(" << edge_val(v, *it) << ":" << *it << ")";
+        for(++it; it != end; ++it)
+        {
+          o << ", (" << edge_val(v, *it) << ":" << *it << ")";
+        }
+        o << "]";
+      }
+    }
+    o << "|]";
+  }
+
+ protected:
+
+  template<class EdgeVector>
+  bool close_fw(vert_id v_ex, EdgeVector& delta, std::false_type)
+  { return false; }
+
+  template<class EdgeVector>
+  bool close_fw(vert_id v_ex, EdgeVector& delta, std::true_type)
+  {
+    const unsigned int n = sz;
+    if(n == 0)
+      return true;
+
+    // Missing edges are represented by a large value which can be
+    // added to itself without overflow. Any weight whose magnitude
+    // could make a path reach inf/2 makes us give up.
+    const Wt inf = std::numeric_limits<Wt>::max()/4;
+    const Wt half_inf = inf/2;
+    const Wt w_bound = half_inf/(Wt) n;
+
+    std::vector<Wt> dist(n*n, inf);
+    for(vert_id s = 0; s < n; s++)
+    {
+      if(is_free[s] || s == v_ex)
+        continue;
+      dist[n*s + s] = Wt(0);
+      for(vert_id d : succs(s))
+      {
+        if(d == v_ex)
+          continue;
+        Wt w = mtx[max_sz*s + d];
+        if(w >= w_bound || w <= -w_bound)
+          return false;
+        dist[n*s + d] = w;
+      }
+    }
+
+    for(vert_id k = 0; k < n; k++)
+    {
+      if(is_free[k] || k == v_ex)
+        continue;
+      const Wt* row_k = &dist[n*k];
+      for(vert_id i = 0; i < n; i++)
+      {
+        Wt* row_i = &dist[n*i];
+        const Wt d_ik = row_i[k];
+        if(d_ik >= half_inf)
+          continue;
+        // min-plus row update: no branches, no aliasing between
+        // row_i and row_k when i != k (and a no-op when i == k).
+        for(vert_id j = 0; j < n; j++)
+        {
+          const Wt c = d_ik + row_k[j];
+          row_i[j] = c < row_i[j] ? c : row_i[j];
+        }
+      }
+    }
+
+    for(vert_id s = 0; s < n; s++)
+    {
+      if(is_free[s] || s == v_ex)
+        continue;
+      const Wt* row_s = &dist[n*s];
+      for(vert_id d = 0; d < n; d++)
+      {
+        if(d == s || row_s[d] >= half_inf)
+          continue;
+        if(!elem(s, d) || row_s[d] < mtx[max_sz*s + d])
+          delta.push_back(std::make_pair(std::make_pair(s, d), row_s[d]));
+      }
+    }
+    return true;
+  }
+
+  bool test_bit(const vector<word_t>& bits, vert_id row, vert_id v) const {
+    return (bits[row*words + v/word_bits] >> (v%word_bits)) & 1;
+  }
+  void set_bit(vector<word_t>& bits, vert_id row, vert_id v) {
+    bits[row*words + v/word_bits] |= ((word_t) 1) << (v%word_bits);
+  }
+  void clear_bit(vector<word_t>& bits, vert_id row, vert_id v) {
+    bits[row*words + v/word_bits] &= ~(((word_t) 1) << (v%word_bits));
+  }
+  void clear_row(vector<word_t>& bits, vert_id row) {
+    std::fill(bits.begin() + row*words, bits.begin() + (row+1)*words, 0);
+  }
+
+  // Re-lay the matrix and the bit-vectors out for a larger capacity.
+  void growCap(unsigned int new_max)
+  {
+    if(new_max <= max_sz)
+      return;
+
+    unsigned int new_words = (new_max + word_bits - 1)/word_bits;
+    vector<Wt> new_mtx(new_max*new_max);
+    vector<word_t> new_fwd(new_max*new_words, 0);
+    vector<word_t> new_rev(new_max*new_words, 0);
+    for(vert_id v = 0; v < sz; v++)
+    {
+      std::copy(mtx.begin() + v*max_sz, mtx.begin() + v*max_sz + sz,
+                new_mtx.begin() + v*new_max);
+      std::copy(fwd.begin() + v*words, fwd.begin() + (v+1)*words,
+                new_fwd.begin() + v*new_words);
+      std::copy(rev.begin() + v*words, rev.begin() + (v+1)*words,
+                new_rev.begin() + v*new_words);
+    }
+    mtx.swap(new_mtx);
+    fwd.swap(new_fwd);
+    rev.swap(new_rev);
+    succ_count.resize(new_max, 0);
+    pred_count.resize(new_max, 0);
+
+    max_sz = new_max;
+    words = new_words;
+  }
+
+  unsigned int sz;
+  unsigned int max_sz;
+  unsigned int words;
+  unsigned int edge_count;
+
+  // mtx[max_sz*s + d] is the weight of (s -> d), if any.
+  vector<Wt> mtx;
+  // Row v holds the successors (fwd) or predecessors (rev) of v.
+  vector<word_t> fwd;
+  vector<word_t> rev;
+  vector<unsigned int> succ_count;
+  vector<unsigned int> pred_count;
+
+  std::vector<bool> is_free;
+  std::vector<int> free_id;
+};
+
+// Close dense graphs (and views of them without the zero vertex)
+// with Floyd-Warshall instead of the sparse algorithms of GraphOps.
+template<class Wt>
+class DenseClosure< DenseGraph<Wt> > {
+ public:
+  template<class EdgeVector>
+  static bool close(DenseGraph<Wt>& g, EdgeVector& delta)
+  { return g.close_floyd_warshall(g.size(), delta); }
+};
+
+template<class Wt>
+class DenseClosure< SubGraph< DenseGraph<Wt> > > {
+ public:
+  template<class EdgeVector>
+  static bool close(SubGraph< DenseGraph<Wt> >& g, EdgeVector& delta)
+  { return g.g.close_floyd_warshall(g.v_ex, delta); }
+};
+
+}
+#endif
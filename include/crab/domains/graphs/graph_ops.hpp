@@ -505,6 +505,17 @@ namespace crab {
     V& A;
   };
 
+  // Hook for representations that can restore closure of the whole
+  // graph more cheaply than the generic algorithms below. close()
+  // pushes the tightened edges onto delta and returns true, or
+  // returns false if the generic algorithm should be used instead.
+  template<class G>
+  class DenseClosure {
+  public:
+    template<class EdgeVector>
+    static bool close(G& g, EdgeVector& delta) { return false; }
+  };
+
   // GKG - What's the best way to split this out?
   template<class Gr>
   class GraphOps {
@@ -536,13 +547,14 @@ namespace crab {
     // Scratch space needed by the graph algorithms.
     // Should really switch to some kind of arena allocator, rather
     // than having all these static structures.
+    // Each thread has its own scratch space.
     // ===========================================
-    static char* edge_marks;
+    static thread_local char* edge_marks;
 
     // Used for Bellman-Ford queueing
-    static vert_id* dual_queue;
-    static int* vert_marks;
-    static unsigned int scratch_sz;
+    static thread_local vert_id* dual_queue;
+    static thread_local int* vert_marks;
+    static thread_local unsigned int scratch_sz;
 
     // For locality, should combine dists & dist_ts.
     // Wt must have an empty constructor, but does _not_
@@ -550,16 +562,39 @@ namespace crab {
     // dist_ts tells us which distances are current,
     // and ts_idx prevents wraparound problems, in the unlikely
     // circumstance that we have more than 2^sizeof(uint) iterations.
-    static vector<Wt> dists;
-    static vector<Wt> dists_alt;
-    static vector<unsigned int> dist_ts;
-    static unsigned int ts; 
-    static unsigned int ts_idx;
+    // They are function-local thread_locals, like scratch_guard,
+    // because GCC 12 fails with "redefinition of __tls_guard" on
+    // dynamically initialized thread_local static members when a
+    // translation unit instantiates several GraphOps.
+    struct scratch_vecs_t {
+      vector<Wt> dists;
+      vector<Wt> dists_alt;
+      vector<unsigned int> dist_ts;
+    };
+    static scratch_vecs_t& scratch_vectors() {
+      static thread_local scratch_vecs_t vecs;
+      return vecs;
+    }
+    static thread_local unsigned int ts; 
+    static thread_local unsigned int ts_idx;
+
+    // Frees the scratch space of a thread when it exits.
+    struct scratch_owner {
+      ~scratch_owner() {
+        free(edge_marks);
+        free(dual_queue);
+        free(vert_marks);
+      }
+    };
 
     static void grow_scratch(unsigned int sz) {
       if(sz <= scratch_sz)
         return;
 
+      // the guard is constructed on first use in each thread
+      static thread_local scratch_owner scratch_guard;
+      (void) &scratch_guard;
+
       if(scratch_sz == 0)
         scratch_sz = 10; // Introduce enums for init_sz and growth_factor
       while(scratch_sz < sz)
@@ -570,6 +605,9 @@ namespace crab {
       vert_marks = (int*) realloc(vert_marks, sizeof(int)*scratch_sz);
 
       // Initialize new elements as necessary.
+      vector<Wt>& dists = scratch_vectors().dists;
+      vector<Wt>& dists_alt = scratch_vectors().dists_alt;
+      vector<unsigned int>& dist_ts = scratch_vectors().dist_ts;
       while(dists.size() < scratch_sz)
       {
         dists.push_back(Wt());
@@ -852,8 +890,10 @@ r_not_dom:
       // We just want to restore closure.
       assert(l.size() == r.size());
       unsigned int sz = l.size();
-      grow_scratch(sz);
       delta.clear();
+      if(DenseClosure<G>::close(g, delta))
+        return;
+      grow_scratch(sz);
       
       vector< vector<vert_id> > colour_succs(2*sz);
       mut_val_ref_t w;
@@ -919,6 +959,8 @@ r_not_dom:
     template<class G, class P>
     static void dijkstra(G& g, const P& p, vert_id src, vector< pair<vert_id, Wt> >& out)
     {
+      vector<Wt>& dists = scratch_vectors().dists;
+      vector<unsigned int>& dist_ts = scratch_vectors().dist_ts;
       unsigned int sz = g.size();
       if(sz == 0)
         return;
@@ -976,6 +1018,9 @@ r_not_dom:
     template<class G, class P>
     static void close_johnson(G& g, const P& p, edge_vector& out)
     {
+      if(DenseClosure<G>::close(g, out))
+        return;
+
       vector< pair<vert_id, Wt> > adjs;
       for(vert_id v : g.verts())
       {
@@ -991,6 +1036,8 @@ r_not_dom:
     template<class G, class P>
     static void chrome_dijkstra(G& g, const P& p, vector< vector<vert_id> >& colour_succs, vert_id src, vector< pair<vert_id, Wt> >& out)
     {
+      vector<Wt>& dists = scratch_vectors().dists;
+      vector<unsigned int>& dist_ts = scratch_vectors().dist_ts;
       unsigned int sz = g.size();
       if(sz == 0)
         return;
@@ -1059,6 +1106,8 @@ r_not_dom:
     template<class G, class P, class S>
     static void dijkstra_recover(G& g, const P& p, const S& is_stable, vert_id src, vector< pair<vert_id, Wt> >& out)
     {
+      vector<Wt>& dists = scratch_vectors().dists;
+      vector<unsigned int>& dist_ts = scratch_vectors().dist_ts;
       unsigned int sz = g.size();
       if(sz == 0)
         return;
@@ -1154,11 +1203,18 @@ r_not_dom:
     template<class G, class P>
     static bool repair_potential(G& g, P& p, vert_id ii, vert_id jj)
     { 
+      vector<Wt>& dists = scratch_vectors().dists;
+      vector<Wt>& dists_alt = scratch_vectors().dists_alt;
       // Ensure there's enough scratch space. 
       unsigned int sz = g.size();
 //      assert(src < (int) sz && dest < (int) sz);
       grow_scratch(sz);
 
+      // The edge may have been dropped by a graph with narrow
+      // weights; then there is nothing to repair.
+      if(!g.elem(ii, jj))
+        return true;
+
       for(vert_id vi : g.verts())
       {
         dists[vi] = Wt(0);
@@ -1212,6 +1268,9 @@ r_not_dom:
     template<class G, class P, class V>
     static void close_after_widen(G& g, P& p, const V& is_stable, edge_vector& delta)
     {
+      if(DenseClosure<G>::close(g, delta))
+        return;
+
       unsigned int sz = g.size();
       grow_scratch(sz);
 //      assert(orig.size() == sz);
@@ -1250,6 +1309,7 @@ r_not_dom:
        return (dists[d1] - p[d1]) < (dists[d2] - p[d2]);
       }
     protected:
+      const vector<Wt>& dists = scratch_vectors().dists;
       const P& p;
     };
 
@@ -1278,6 +1338,7 @@ r_not_dom:
     template<class G, class P>
     static void close_after_assign_fwd(G& g, const P& p, vert_id v, vector< pair<vert_id, Wt> >& aux)
     {
+      vector<Wt>& dists = scratch_vectors().dists;
       // Initialize the queue and distances.
       for(vert_id u : g.verts())
         vert_marks[u] = 0;
@@ -1352,28 +1413,22 @@ r_not_dom:
 
   // Static data allocation
   template<class Wt>
-  char* GraphOps<Wt>::edge_marks = NULL;
+  thread_local char* GraphOps<Wt>::edge_marks = NULL;
 
   // Used for Bellman-Ford queueing
   template<class Wt>
-  typename GraphOps<Wt>::vert_id* GraphOps<Wt>::dual_queue = NULL;
+  thread_local typename GraphOps<Wt>::vert_id* GraphOps<Wt>::dual_queue = NULL;
 
   template<class Wt>
-  int* GraphOps<Wt>::vert_marks = NULL;
+  thread_local int* GraphOps<Wt>::vert_marks = NULL;
 
   template<class Wt>
-  unsigned int GraphOps<Wt>::scratch_sz = 0;
+  thread_local unsigned int GraphOps<Wt>::scratch_sz = 0;
 
   template<class G>
-  vector<typename G::Wt> GraphOps<G>::dists;
-  template<class G>
-  vector<typename G::Wt> GraphOps<G>::dists_alt;
-  template<class G>
-  vector<unsigned int> GraphOps<G>::dist_ts;
-  template<class G>
-  unsigned int GraphOps<G>::ts = 0;
+  thread_local unsigned int GraphOps<G>::ts = 0;
   template<class G>
-  unsigned int GraphOps<G>::ts_idx = 0;
+  thread_local unsigned int GraphOps<G>::ts_idx = 0;
 
 } // namespace crab
 
@@ -929,8 +929,16 @@ namespace ikos {
   
   namespace intervals_impl {
 
+    // Interval types that are templates themselves specialize
+    // trim_bound_impl since function templates cannot be partially
+    // specialized.
     template< typename Interval, typename Number >
-    inline Interval trim_bound(Interval i, Number c);
+    struct trim_bound_impl;
+
+    template< typename Interval, typename Number >
+    inline Interval trim_bound(Interval i, Number c) {
+      return trim_bound_impl< Interval, Number >::trim(i, c);
+    }
     
     template<>
     inline z_interval trim_bound(z_interval i, z_number c) {
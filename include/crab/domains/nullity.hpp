@@ -4,7 +4,13 @@
 /* A flat lattice for nullity */
 
 #include <crab/common/types.hpp>
-#include <crab/domains/separate_domains.hpp>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/unordered_map.hpp>
+#include <algorithm>
+#include <stdint.h>
+#include <vector>
 
 namespace crab {
 
@@ -30,6 +36,8 @@ namespace crab {
     kind_t _value;
     
     nullity_value(kind_t v) : _value(v){};
+
+    template <typename VariableName> friend class nullity_domain;
     
    public:
     
@@ -112,42 +120,144 @@ namespace crab {
   }; // end class nullity_value
 
 
-  // Abstract domain for nullity
+  // Abstract domain for nullity. 
+  //
+  // The environment is a dense bit-vector indexed by variable id
+  // (VariableName::index ()) with two bits per variable, so that
+  // join, meet, inclusion and widening are word-parallel bitwise
+  // operations. Each variable stores the complement of its
+  // nullity_value bits: Top is 00, so unset and trailing variables
+  // are Top and join (the union of the value bits) becomes a bitwise
+  // and of the words.
   template <typename VariableName>
   class nullity_domain : public ikos::writeable {
     
-    typedef separate_domain< VariableName, nullity_value > separate_domain_t;
     typedef nullity_domain<VariableName> nullity_domain_t;
-    
+    typedef uint64_t word_t;
+    typedef nullity_value::kind_t kind_t;
+
+    static const unsigned vars_per_word = 32;
+    // the low bit of every variable
+    static const word_t low_bits = 0x5555555555555555ULL;
+
+    // The names of the variables that were set in a value or in the
+    // values it was computed from, by id. They are only needed to
+    // iterate over and print the environment. Copies share the map
+    // until a new variable is set.
+    typedef boost::unordered_map<std::size_t, VariableName> name_map_t;
+    typedef boost::shared_ptr<name_map_t> name_map_ptr;
+
    public:
 
     typedef VariableName varname_t;
-    typedef typename separate_domain_t::iterator iterator;
+
+    //! Iterate over the variables that are not Top.
+    class iterator {
+      const std::vector<word_t>* _bits;
+      const name_map_t* _names;
+      std::size_t _i;
+
+      void skip_top () {
+        std::size_t n = _bits->size () * vars_per_word;
+        while (_i < n && get_bits (*_bits, _i) == 0) ++_i;
+      }
+
+     public:
+      iterator (const std::vector<word_t>* bits, const name_map_t* names, std::size_t i)
+          : _bits (bits), _names (names), _i (i) { skip_top (); }
+
+      std::pair<VariableName, nullity_value> operator* () const {
+        return std::make_pair (_names->at (_i), decode (get_bits (*_bits, _i)));
+      }
+
+      iterator& operator++ () { ++_i; skip_top (); return *this; }
+
+      bool operator== (const iterator& o) const { return _i == o._i; }
+
+      bool operator!= (const iterator& o) const { return _i != o._i; }
+    };
     
    private:
 
-    separate_domain_t _env;
+    bool _is_bottom;
+    std::vector<word_t> _bits;
+    name_map_ptr _names;
     
-    nullity_domain(separate_domain_t env) : _env(env) {}
+    nullity_domain(bool is_bottom) : _is_bottom(is_bottom) {}
+
+    static word_t encode (nullity_value n) { return (~n._value) & 0x3; }
+
+    static nullity_value decode (word_t b) { 
+      return nullity_value (static_cast<kind_t> ((~b) & 0x3)); 
+    }
+
+    static word_t get_bits (const std::vector<word_t>& bits, std::size_t i) {
+      std::size_t w = i / vars_per_word;
+      if (w >= bits.size ()) return 0;
+      return (bits [w] >> (2 * (i % vars_per_word))) & 0x3;
+    }
+
+    // remove trailing Top words so that Top has a unique representation
+    void trim () {
+      while (!_bits.empty () && _bits.back () == 0)
+        _bits.pop_back ();
+    }
+
+    // a variable with both bits set is Bottom
+    static bool has_bottom (word_t w) { return (w & (w >> 1) & low_bits) != 0; }
+
+    void set_bits (std::size_t i, word_t b) {
+      std::size_t w = i / vars_per_word;
+      if (w >= _bits.size ()) {
+        if (b == 0) return;
+        _bits.resize (w + 1, 0);
+      }
+      unsigned shift = 2 * (i % vars_per_word);
+      _bits [w] = (_bits [w] & ~(word_t (0x3) << shift)) | (b << shift);
+      if (b == 0) trim ();
+    }
+
+    void add_name (const VariableName& v) {
+      if (_names && _names->count (v.index ())) return;
+      if (!_names)
+        _names = boost::make_shared<name_map_t> ();
+      else if (!_names.unique ())
+        _names = boost::make_shared<name_map_t> (*_names);
+      _names->insert (std::make_pair (v.index (), v));
+    }
+
+    void add_names (const name_map_ptr& names) {
+      if (!names || names == _names) return;
+      if (!_names) {
+        _names = names;
+        return;
+      }
+      name_map_ptr res = boost::make_shared<name_map_t> (*_names);
+      res->insert (names->begin (), names->end ());
+      _names = res;
+    }
         
    public:
     
     static nullity_domain_t top() {
-      return nullity_domain(separate_domain_t::top());
+      return nullity_domain(false);
     }
     
     static nullity_domain_t bottom() {
-      return nullity_domain(separate_domain_t::bottom());
+      return nullity_domain(true);
     }
     
-    nullity_domain() : _env(separate_domain_t::top()) {}
+    nullity_domain() : _is_bottom(false) {}
 
     nullity_domain(const nullity_domain_t& e) : 
-        writeable(), _env(e._env) {}
+        writeable(), _is_bottom(e._is_bottom), _bits(e._bits), _names(e._names) {}
     
     nullity_domain_t& operator=(const nullity_domain_t& o) {
-      if (this != &o)
-        _env = o._env;
+      if (this != &o) {
+        _is_bottom = o._is_bottom;
+        _bits = o._bits;
+        _names = o._names;
+      }
       return *this;
     }
     
@@ -155,99 +265,141 @@ namespace crab {
       if (is_bottom ()) 
         CRAB_ERROR ("Cannot return iterator from bottom");
       
-      return _env.begin(); 
+      return iterator (&_bits, _names.get (), 0);
     }
     
     iterator end() { 
       if (is_bottom ()) 
         CRAB_ERROR ("Cannot return iterator from bottom");
-      return _env.end(); 
+      return iterator (&_bits, _names.get (), _bits.size () * vars_per_word);
     }
     
-    bool is_bottom() { return _env.is_bottom(); }
+    bool is_bottom() { return _is_bottom; }
     
-    bool is_top() { return _env.is_top(); }
+    bool is_top() { return !_is_bottom && _bits.empty (); }
     
-    bool operator<=(nullity_domain_t o) { return (_env <= o._env); }
+    bool operator<=(nullity_domain_t o) { 
+      if (_is_bottom) return true;
+      if (o._is_bottom) return false;
+      // every value bit of this must be in o, i.e., every
+      // complemented bit of o must be in this.
+      for (std::size_t w = 0; w < o._bits.size (); w++) {
+        word_t mine = (w < _bits.size () ? _bits [w] : 0);
+        if ((o._bits [w] & ~mine) != 0) return false;
+      }
+      return true;
+    }
     
     nullity_domain_t operator|(nullity_domain_t o) {
-      return (_env | o._env);
+      if (_is_bottom) return o;
+      if (o._is_bottom) return *this;
+      // the variables that are not Top in res are not Top in this
+      nullity_domain_t res (false);
+      res._names = _names;
+      std::size_t n = std::min (_bits.size (), o._bits.size ());
+      res._bits.reserve (n);
+      for (std::size_t w = 0; w < n; w++)
+        res._bits.push_back (_bits [w] & o._bits [w]);
+      res.trim ();
+      return res;
     }
 
     void operator|=(nullity_domain_t o) {
-      _env = _env  | o._env;
+      *this = *this | o;
     }
 
     nullity_domain_t operator&(nullity_domain_t o) {
-      return (_env & o._env);
+      if (_is_bottom || o._is_bottom) return bottom ();
+      const std::vector<word_t>& small = (_bits.size () < o._bits.size () ? _bits : o._bits);
+      nullity_domain_t res (*this);
+      res._bits = (_bits.size () < o._bits.size () ? o._bits : _bits);
+      for (std::size_t w = 0; w < small.size (); w++) {
+        res._bits [w] |= small [w];
+        if (has_bottom (res._bits [w])) return bottom ();
+      }
+      res.add_names (o._names);
+      return res;
     }
     
+    // the lattice satisfy ACC so join is the widening
     nullity_domain_t operator||(nullity_domain_t o) {
-      return (_env || o._env);
+      return (*this | o);
     }
 
     template<typename Thresholds>
     nullity_domain_t widening_thresholds (nullity_domain_t o, const Thresholds &) {
-      return (_env || o._env);
+      return (*this | o);
     }
     
+    // the lattice satisfy DCC so meet is the narrowing
     nullity_domain_t operator&&(nullity_domain_t o) {
-      return (_env && o._env);
+      return (*this & o);
     }
     
     void set(VariableName v, nullity_value n) {
-      if (!is_bottom())
-        _env.set(v, n);
+      if (is_bottom()) return;
+
+      if (n.is_bottom ()) {
+        *this = bottom ();
+        return;
+      }
+      word_t b = encode (n);
+      if (b != 0) add_name (v);
+      set_bits (v.index (), b);
     }
 
     void assign(VariableName x, VariableName y) {
       if (!is_bottom())
-        _env.set (x, _env[y]);
+        set (x, operator[] (y));
     }
     
     nullity_value operator[](VariableName v) { 
-      return _env[v]; 
+      if (is_bottom ()) return nullity_value::bottom ();
+      return decode (get_bits (_bits, v.index ()));
     }
     
     void operator-=(VariableName v) { 
       if (!is_bottom ())
-        _env -= v; 
+        set_bits (v.index (), 0);
     }
         
     void equality (VariableName p, VariableName q) {
       if (is_bottom ()) return;
 
       // if (p == q) ...
-      nullity_value p_meet_q = _env[p] & _env[q];
-      _env.set(p, p_meet_q);
-      _env.set(q, p_meet_q);
+      nullity_value p_meet_q = operator[] (p) & operator[] (q);
+      set(p, p_meet_q);
+      set(q, p_meet_q);
     }
 
     void equality (VariableName p, nullity_value v) {
       if (!is_bottom ()) 
-        _env.set(p, _env[p] & v);
+        set(p, operator[] (p) & v);
     }
     
     void disequality (VariableName p, VariableName q) {
       if (is_bottom ()) return;
 
       // if (p != q) ...
-      if (_env[p].is_null() && _env[q].is_null()) {
+      nullity_value p_val = operator[] (p);
+      nullity_value q_val = operator[] (q);
+      if (p_val.is_null() && q_val.is_null()) {
         *this = bottom();
-      } else if (_env[p].is_top() && _env[q].is_null()) {
-        _env.set(p, nullity_value::non_null()); // refine p
-      } else if (_env[q].is_top() && _env[p].is_null()) {
-        _env.set(q, nullity_value::non_null()); // refine q
+      } else if (p_val.is_top() && q_val.is_null()) {
+        set(p, nullity_value::non_null()); // refine p
+      } else if (q_val.is_top() && p_val.is_null()) {
+        set(q, nullity_value::non_null()); // refine q
       }
     }
     
     void disequality (VariableName p, nullity_value v) {
       if (is_bottom ()) return;
 
-      if (_env[p].is_null() && v.is_null()) {
+      nullity_value p_val = operator[] (p);
+      if (p_val.is_null() && v.is_null()) {
         *this = bottom();
-      } else if (_env[p].is_top() && v.is_null()) { // refine p
-        _env.set(p, nullity_value::non_null());
+      } else if (p_val.is_top() && v.is_null()) { // refine p
+        set(p, nullity_value::non_null());
       }
     }
    
@@ -256,7 +408,21 @@ namespace crab {
     }    
 
     void write(std::ostream& o) {
-      _env.write(o); 
+      if (is_bottom ()) {
+        o << "_|_";
+        return;
+      }
+      o << "{";
+      for (iterator it = begin (), et = end (); it != et; ) {
+        auto kv = *it;
+        kv.first.write (o);
+        o << " -> ";
+        kv.second.write (o);
+        ++it;
+        if (it != et) 
+          o << "; ";
+      }
+      o << "}";
     }
     
     }; // class nullity_domain
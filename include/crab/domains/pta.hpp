@@ -51,13 +51,19 @@
 #ifndef IKOS_PTA_HPP
 #define IKOS_PTA_HPP
 
+#include <algorithm>
+#include <deque>
 #include <set>
+#include <stdint.h>
 #include <vector>
 
+#include <boost/optional.hpp>
 #include <boost/shared_ptr.hpp>
 #include <boost/unordered_map.hpp>
+#include <boost/unordered_set.hpp>
 
 #include <crab/common/types.hpp>
+#include <crab/common/stats.hpp>
 #include <crab/common/bignums.hpp>
 #include <crab/domains/intervals.hpp>
 
@@ -369,316 +375,609 @@ boost::shared_ptr< pta_constraint > operator*=(
 typedef std::set< index_t > address_set;
 typedef std::pair< address_set, z_interval > pta_info;
 
-class pta_system {
-  class binary_op {
-  public:
-    virtual z_interval apply(z_interval before,
-                             z_interval after,
-                             std::size_t iteration) const = 0;
-    virtual bool convergence_achieved(z_interval before,
-                                      z_interval after) const = 0;
-    virtual ~binary_op() {}
-  };
+// A sparse set of small non-negative integers, stored as a sorted
+// vector of 64-bit words. Used for points-to sets over dense address
+// ids.
+class pta_bitmap {
+  typedef std::pair< unsigned, uint64_t > word_t;
+
+  std::vector< word_t > _words;
+
+  static bool word_lt(const word_t& w, unsigned i) { return w.first < i; }
+
+public:
+  pta_bitmap() {}
+
+  bool empty() const { return this->_words.empty(); }
 
-  class extrapolate : public binary_op {
-  private:
-    std::size_t _threshold;
+  void clear() { std::vector< word_t >().swap(this->_words); }
 
-  public:
-    extrapolate(std::size_t threshold) : _threshold(threshold) {}
+  void swap(pta_bitmap& o) { this->_words.swap(o._words); }
 
-    bool convergence_achieved(z_interval before, z_interval after) const {
-      return after <= before;
+  bool operator==(const pta_bitmap& o) const {
+    return this->_words == o._words;
+  }
+
+  bool insert(unsigned b) {
+    unsigned i = b / 64;
+    uint64_t m = uint64_t(1) << (b % 64);
+    std::vector< word_t >::iterator it =
+        std::lower_bound(this->_words.begin(), this->_words.end(), i, word_lt);
+    if (it != this->_words.end() && it->first == i) {
+      if (it->second & m) {
+        return false;
+      }
+      it->second |= m;
+    } else {
+      this->_words.insert(it, word_t(i, m));
     }
+    return true;
+  }
 
-    z_interval apply(z_interval before,
-                     z_interval after,
-                     std::size_t iteration) const {
-      if (iteration < _threshold) {
-        return before | after;
+  // Add the bits of o to this and return those that were not already
+  // in this.
+  pta_bitmap unite(const pta_bitmap& o) {
+    pta_bitmap added;
+    if (o.empty()) {
+      return added;
+    }
+    std::vector< word_t > res;
+    res.reserve(this->_words.size() + o._words.size());
+    std::vector< word_t >::const_iterator i = this->_words.begin(),
+                                          ie = this->_words.end();
+    std::vector< word_t >::const_iterator j = o._words.begin(),
+                                          je = o._words.end();
+    while (i != ie || j != je) {
+      if (j == je || (i != ie && i->first < j->first)) {
+        res.push_back(*i++);
+      } else if (i == ie || j->first < i->first) {
+        res.push_back(*j);
+        added._words.push_back(*j++);
       } else {
-        return before || after;
+        uint64_t fresh = j->second & ~i->second;
+        res.push_back(word_t(i->first, i->second | j->second));
+        if (fresh) {
+          added._words.push_back(word_t(i->first, fresh));
+        }
+        ++i;
+        ++j;
       }
     }
+    if (!added.empty()) {
+      this->_words.swap(res);
+    }
+    return added;
+  }
+
+  template < typename F >
+  void for_each(F f) const {
+    for (std::vector< word_t >::const_iterator it = this->_words.begin(),
+                                               et = this->_words.end();
+         it != et;
+         ++it) {
+      uint64_t bits = it->second;
+      while (bits) {
+        f(it->first * 64 + __builtin_ctzll(bits));
+        bits &= bits - 1;
+      }
+    }
+  }
+
+}; // class pta_bitmap
+
+// Worklist solver for the points-to constraints.
+//
+// Each pointer variable, memory object, formal parameter and return
+// value is interned to a dense node id, and each address to a dense
+// bit. Assignments between pointers become copy edges (labeled with
+// an offset) and loads and stores are attached to the dereferenced
+// node, where they add copy edges as its points-to set grows. Only
+// the addresses that a node gained since it was last processed are
+// pushed along its edges (difference propagation), and nodes are
+// processed in topological order.
+//
+// Cycles of copy edges with offset zero are collapsed into a single
+// node: once before solving, and again when propagation makes both
+// ends of an edge equal and enough edges were added by loads and
+// stores since the last time.
+//
+// Offsets are joined for the first widening_threshold updates of a
+// node and widened afterwards. Once the worklist is empty, each pass
+// of narrowing recomputes every offset from its incoming edges.
+class pta_system {
+
+  // x => y + offset
+  struct copy_edge {
+    unsigned _dst;
+    z_interval _offset;
+
+    copy_edge(unsigned dst, z_interval offset) : _dst(dst), _offset(offset) {}
   };
 
-  class refine : public binary_op {
-  private:
-    // This refinement is not a narrowing since it will not ensure
-    // convergence. Thus, we need to make sure it is called a finite
-    // number of times.
+  typedef enum { DEREF_OBJECT, DEREF_PARAM, DEREF_RETURN } deref_target;
 
-  public:
-    refine(std::size_t /*threshold*/)  {}
+  // x => *y (load) or *y => x (store), attached to y
+  struct deref_cst {
+    bool _is_load;
+    deref_target _target;
+    unsigned _param;
+    unsigned _other;
 
-    bool convergence_achieved(z_interval /*before*/,
-                              z_interval /*after*/) const {
-      return false;
-    }
+    deref_cst(bool is_load, deref_target target, unsigned param, unsigned other)
+        : _is_load(is_load), _target(target), _param(param), _other(other) {}
+  };
 
-    z_interval apply(z_interval before,
-                     z_interval after,
-                     std::size_t /*iteration*/) const {
-      if (after <= before) { // descending chain
-        return after;
-      } else { // no descending chain
-        return before | after;
-      }
-    }
+  struct node {
+    unsigned _parent;
+    pta_bitmap _pts;
+    pta_bitmap _delta;
+    z_interval _offset;
+    z_interval _base;
+    std::size_t _updates;
+    // position in a topological order of the copy edges
+    unsigned _rank;
+    bool _queued;
+    std::vector< copy_edge > _succs;
+    std::vector< deref_cst > _derefs;
+
+    node(unsigned id)
+        : _parent(id),
+          _offset(z_interval::bottom()),
+          _base(z_interval::bottom()),
+          _updates(0),
+          _rank(0),
+          _queued(false) {}
   };
 
-private:
-  typedef boost::unordered_map< std::string, z_interval > offset_map;
-  typedef boost::unordered_map< std::string, address_set > address_map;
+  typedef boost::unordered_map< index_t, unsigned > id_map;
+  typedef boost::unordered_map< std::pair< index_t, index_t >, unsigned >
+      pair_id_map;
+  typedef boost::unordered_set< std::pair< unsigned, unsigned > > edge_set;
 
 private:
   std::vector< boost::shared_ptr< pta_constraint > > _csts;
-  offset_map _offset_map;
-  address_map _address_map;
-  bool change_seen;
-  std::size_t iteration;
+  // std::deque so that nodes do not move when new ones are created
+  std::deque< node > _nodes;
+  id_map _var_ids;
+  id_map _obj_ids;
+  pair_id_map _param_ids;
+  id_map _ret_ids;
+  id_map _addr_ids;
+  std::vector< index_t > _addrs;
+  edge_set _copies;
+  // zero-offset copy edges added since the last cycle detection
+  std::size_t _new_copies;
+  std::set< std::pair< unsigned, unsigned > > _worklist;
+  std::size_t _widening_threshold;
 
 private:
 
-  address_set get_address_set(const std::string& v) const {
-    address_map::const_iterator it = this->_address_map.find(v);
-    if (it == this->_address_map.end()) {
-      return address_set();
-    } else {
+  static bool is_zero(z_interval o) {
+    boost::optional< z_number > n = o.singleton();
+    return n && *n == z_number(0);
+  }
+
+  unsigned new_node() {
+    unsigned id = this->_nodes.size();
+    this->_nodes.push_back(node(id));
+    return id;
+  }
+
+  unsigned get_node(id_map& m, index_t k) {
+    id_map::iterator it = m.find(k);
+    if (it != m.end()) {
       return it->second;
     }
+    unsigned id = new_node();
+    m.insert(std::make_pair(k, id));
+    return id;
   }
 
-  address_set& get_address_set(const std::string& v) {
-    return this->_address_map[v];
+  unsigned var_node(pointer_var p) { return get_node(this->_var_ids, p._uid); }
+
+  unsigned deref_node(const deref_cst& c, index_t a) {
+    switch (c._target) {
+      case DEREF_OBJECT:
+        return get_node(this->_obj_ids, a);
+      case DEREF_PARAM: {
+        std::pair< index_t, index_t > k(c._param, a);
+        pair_id_map::iterator it = this->_param_ids.find(k);
+        if (it != this->_param_ids.end()) {
+          return it->second;
+        }
+        unsigned id = new_node();
+        this->_param_ids.insert(std::make_pair(k, id));
+        return id;
+      }
+      case DEREF_RETURN:
+        return get_node(this->_ret_ids, a);
+      default: { CRAB_ERROR("unreachable"); }
+    }
   }
 
-  z_interval get_offset(const std::string& v) const {
-    offset_map::const_iterator it = this->_offset_map.find(v);
-    if (it == this->_offset_map.end()) {
-      return z_interval::bottom();
-    } else {
+  unsigned addr_bit(index_t a) {
+    id_map::iterator it = this->_addr_ids.find(a);
+    if (it != this->_addr_ids.end()) {
       return it->second;
     }
+    unsigned b = this->_addrs.size();
+    this->_addr_ids.insert(std::make_pair(a, b));
+    this->_addrs.push_back(a);
+    return b;
+  }
+
+  unsigned find(unsigned n) {
+    while (this->_nodes[n]._parent != n) {
+      unsigned p = this->_nodes[n]._parent;
+      this->_nodes[n]._parent = this->_nodes[p]._parent;
+      n = p;
+    }
+    return n;
   }
 
-  void add_offset(const std::string& v, z_interval o, const binary_op& op) {
-    z_interval off = get_offset(v);
-    if (!op.convergence_achieved(off, o)) {
+  void enqueue(unsigned n) {
+    node& x = this->_nodes[n];
+    if (!x._queued) {
+      x._queued = true;
+      this->_worklist.insert(std::make_pair(x._rank, n));
+    }
+  }
+
+  // Propagate addrs and the offset of s (shifted by o) to t
+  void propagate(unsigned s, unsigned t, z_interval o, const pta_bitmap& addrs) {
+    node& x = this->_nodes[s];
+    node& y = this->_nodes[t];
+    bool change_seen = false;
+    pta_bitmap added = y._pts.unite(addrs);
+    if (!added.empty()) {
+      y._delta.unite(added);
       change_seen = true;
-      z_interval new_offset = op.apply(off, o, iteration);
-      offset_map::iterator it = this->_offset_map.find(v);
-      if (it == this->_offset_map.end()) {
-        this->_offset_map.insert(std::make_pair(v, new_offset));
+    }
+    if (!x._offset.is_bottom()) {
+      z_interval off = x._offset + o;
+      if (!(off <= y._offset)) {
+        ++y._updates;
+        if (y._updates < this->_widening_threshold) {
+          y._offset = y._offset | off;
+        } else {
+          y._offset = y._offset || off;
+        }
+        change_seen = true;
+      }
+    }
+    if (change_seen) {
+      enqueue(t);
+    }
+  }
+
+  void add_base(unsigned n, index_t a, z_interval o) {
+    node& x = this->_nodes[n];
+    unsigned b = addr_bit(a);
+    if (x._pts.insert(b)) {
+      x._delta.insert(b);
+    }
+    x._base = x._base | o;
+    x._offset = x._offset | o;
+    enqueue(n);
+  }
+
+  void add_copy(unsigned src, unsigned dst, z_interval o) {
+    unsigned s = find(src);
+    unsigned t = find(dst);
+    if (is_zero(o)) {
+      if (s == t || !this->_copies.insert(std::make_pair(s, t)).second) {
+        return;
+      }
+      ++this->_new_copies;
+    }
+    this->_nodes[s]._succs.push_back(copy_edge(t, o));
+    propagate(s, t, o, this->_nodes[s]._pts);
+  }
+
+  void add_deref(unsigned n, deref_cst c) {
+    this->_nodes[find(n)]._derefs.push_back(c);
+  }
+
+  void apply_deref(const deref_cst& c, const pta_bitmap& addrs) {
+    addrs.for_each([&](unsigned b) {
+      unsigned t = deref_node(c, this->_addrs[b]);
+      if (c._is_load) {
+        add_copy(t, c._other, z_interval(z_number(0)));
       } else {
-        it->second = new_offset;
+        add_copy(c._other, t, z_interval(z_number(0)));
+      }
+    });
+  }
+
+  // Merge the nodes of scc into r and drop the copy edges that became
+  // self loops or duplicates.
+  void merge(unsigned r, const std::vector< unsigned >& scc) {
+    node& x = this->_nodes[r];
+    for (std::vector< unsigned >::const_iterator it = scc.begin(),
+                                                 et = scc.end();
+         it != et;
+         ++it) {
+      if (*it == r) {
+        continue;
       }
+      node& y = this->_nodes[*it];
+      y._parent = r;
+      x._pts.unite(y._pts);
+      x._base = x._base | y._base;
+      x._offset = x._offset | y._offset;
+      x._updates = std::max(x._updates, y._updates);
+      x._succs.insert(x._succs.end(), y._succs.begin(), y._succs.end());
+      x._derefs.insert(x._derefs.end(), y._derefs.begin(), y._derefs.end());
+      y._pts.clear();
+      y._delta.clear();
+      std::vector< copy_edge >().swap(y._succs);
+      std::vector< deref_cst >().swap(y._derefs);
+      crab::CrabStats::count("Pta.count.collapsed");
     }
+
+    std::vector< copy_edge > succs;
+    boost::unordered_set< unsigned > copies;
+    for (std::vector< copy_edge >::const_iterator it = x._succs.begin(),
+                                                  et = x._succs.end();
+         it != et;
+         ++it) {
+      unsigned t = find(it->_dst);
+      if (is_zero(it->_offset)) {
+        if (t == r || !copies.insert(t).second) {
+          continue;
+        }
+        this->_copies.insert(std::make_pair(r, t));
+      }
+      succs.push_back(copy_edge(t, it->_offset));
+    }
+    x._succs.swap(succs);
+    // everything is pushed again from the merged node
+    x._delta = x._pts;
+    enqueue(r);
   }
 
-  void add_address(const std::string& v, index_t a) {
-    address_set& s = get_address_set(v);
-    if (s.find(a) == s.end()) {
-      change_seen = true;
-      s.insert(a);
+  // Collapse the cycles of zero-offset copy edges reachable from
+  // roots (Tarjan's algorithm) and rank the nodes in topological
+  // order. A cycle through n is merged into n. Return true if n was
+  // merged with other nodes.
+  bool collapse_cycles(const std::vector< unsigned >& roots, unsigned n) {
+    typedef boost::unordered_map< unsigned, unsigned > index_map;
+    index_map index, low;
+    std::vector< std::pair< unsigned, std::size_t > > dfs;
+    std::vector< unsigned > stack;
+    boost::unordered_set< unsigned > on_stack;
+    unsigned counter = 0;
+    unsigned finished = 0;
+    bool merged = false;
+
+    for (std::vector< unsigned >::const_iterator r = roots.begin(),
+                                                 re = roots.end();
+         r != re;
+         ++r) {
+      unsigned t = find(*r);
+      if (index.find(t) != index.end()) {
+        continue;
+      }
+      index[t] = low[t] = counter++;
+      stack.push_back(t);
+      on_stack.insert(t);
+      dfs.push_back(std::make_pair(t, 0));
+      while (!dfs.empty()) {
+        unsigned u = dfs.back().first;
+        std::size_t& i = dfs.back().second;
+        if (i < this->_nodes[u]._succs.size()) {
+          const copy_edge& e = this->_nodes[u]._succs[i++];
+          if (!is_zero(e._offset)) {
+            continue;
+          }
+          unsigned v = find(e._dst);
+          if (index.find(v) == index.end()) {
+            index[v] = low[v] = counter++;
+            stack.push_back(v);
+            on_stack.insert(v);
+            dfs.push_back(std::make_pair(v, 0));
+          } else if (on_stack.count(v) > 0) {
+            low[u] = std::min(low[u], index[v]);
+          }
+          continue;
+        }
+        dfs.pop_back();
+        if (!dfs.empty()) {
+          unsigned p = dfs.back().first;
+          low[p] = std::min(low[p], low[u]);
+        }
+        if (low[u] == index[u]) {
+          std::vector< unsigned > scc;
+          unsigned v;
+          do {
+            v = stack.back();
+            stack.pop_back();
+            on_stack.erase(v);
+            scc.push_back(v);
+          } while (v != u);
+          if (scc.size() > 1) {
+            bool has_n = std::find(scc.begin(), scc.end(), n) != scc.end();
+            merge(has_n ? n : u, scc);
+            merged |= has_n;
+          }
+          // Tarjan's algorithm finds the sinks first
+          this->_nodes[find(u)]._rank = this->_nodes.size() - finished++;
+        }
+      }
+    }
+    return merged;
+  }
+
+  // Collapse all the cycles and rank the nodes again. This is only
+  // done once enough copy edges were added since the last time, so
+  // the cost is amortized over the edges.
+  bool collapse_all(unsigned n) {
+    std::vector< unsigned > roots;
+    for (unsigned m = 0; m < this->_nodes.size(); ++m) {
+      if (find(m) == m) {
+        roots.push_back(m);
+      }
     }
+    this->_new_copies = 0;
+    crab::CrabStats::count("Pta.count.cycle_detection");
+    return collapse_cycles(roots, n);
   }
 
-  void add_address_set(const std::string& v, address_set s) {
-    for (address_set::iterator it = s.begin(); it != s.end(); ++it) {
-      add_address(v, *it);
+  void process(unsigned n) {
+    pta_bitmap delta;
+    delta.swap(this->_nodes[n]._delta);
+    if (!delta.empty()) {
+      for (std::size_t i = 0; i < this->_nodes[n]._derefs.size(); ++i) {
+        deref_cst c = this->_nodes[n]._derefs[i];
+        apply_deref(c, delta);
+      }
+    }
+    for (std::size_t i = 0; i < this->_nodes[n]._succs.size(); ++i) {
+      copy_edge e = this->_nodes[n]._succs[i];
+      unsigned t = find(e._dst);
+      bool zero = is_zero(e._offset);
+      if (t == n && zero) {
+        continue;
+      }
+      propagate(n, t, e._offset, delta);
+      if (zero && !this->_nodes[n]._pts.empty() &&
+          this->_nodes[n]._pts == this->_nodes[t]._pts &&
+          this->_new_copies > this->_copies.size() / 8 &&
+          collapse_all(n)) {
+        // n was enqueued again with all its addresses
+        return;
+      }
     }
   }
 
-  pta_info process_ref(boost::shared_ptr< pta_ref > ref) {
-    switch (ref->kind()) {
+  void gen_deref(pta_ref& ref, bool is_load, unsigned other) {
+    switch (ref.kind()) {
       case POINTER_REF: {
-        boost::shared_ptr< pointer_ref > pt_ref =
-            boost::static_pointer_cast< pointer_ref >(ref);
-        address_set& addrs = get_address_set(pt_ref->str());
-        z_interval offset = get_offset(pt_ref->str());
-        return std::make_pair(addrs, offset + pt_ref->_offset);
+        pointer_ref& pt_ref = static_cast< pointer_ref& >(ref);
+        add_deref(var_node(pt_ref._pointer),
+                  deref_cst(is_load, DEREF_OBJECT, 0, other));
+        break;
       }
       case OBJECT_REF: {
-        boost::shared_ptr< object_ref > obj_ref =
-            boost::static_pointer_cast< object_ref >(ref);
-        address_set addrs;
-        addrs.insert(obj_ref->_address);
-        return std::make_pair(addrs, obj_ref->_offset);
+        CRAB_ERROR("cannot dereference a memory object");
+        break;
       }
       case FUNCTION_REF: {
-        boost::shared_ptr< function_ref > fun_ref =
-            boost::static_pointer_cast< function_ref >(ref);
-        address_set addrs;
-        addrs.insert(fun_ref->_uid);
-        return std::make_pair(addrs, z_interval::top());
+        CRAB_ERROR("cannot dereference a function object");
+        break;
       }
       case PARAM_REF: {
-        boost::shared_ptr< param_ref > param =
-            boost::static_pointer_cast< param_ref >(ref);
-        address_set& fptrs = get_address_set(param->_fptr.str());
-        address_set addrs;
-        z_interval offset = z_interval::bottom();
-        for (address_set::iterator it = fptrs.begin(); it != fptrs.end();
-             ++it) {
-          address_set& ptrs = get_address_set(param->str(*it));
-          addrs.insert(ptrs.begin(), ptrs.end());
-          offset = offset | get_offset(param->str(*it));
-        }
-        return std::make_pair(addrs, offset);
+        param_ref& param = static_cast< param_ref& >(ref);
+        add_deref(var_node(param._fptr),
+                  deref_cst(is_load, DEREF_PARAM, param._param, other));
+        break;
       }
       case RETURN_REF: {
-        boost::shared_ptr< return_ref > ret =
-            boost::static_pointer_cast< return_ref >(ref);
-        address_set& fptrs = get_address_set(ret->_fptr.str());
-        address_set addrs;
-        z_interval offset = z_interval::bottom();
-        for (address_set::iterator it = fptrs.begin(); it != fptrs.end();
-             ++it) {
-          address_set& ptrs = get_address_set(ret->str(*it));
-          addrs.insert(ptrs.begin(), ptrs.end());
-          offset = offset | get_offset(ret->str(*it));
-        }
-        return std::make_pair(addrs, offset);
+        return_ref& ret = static_cast< return_ref& >(ref);
+        add_deref(var_node(ret._fptr),
+                  deref_cst(is_load, DEREF_RETURN, 0, other));
+        break;
       }
       default: { CRAB_ERROR("unreachable"); }
     }
   }
 
-  void process_constraint(boost::shared_ptr< pta_constraint > cst,
-                          const binary_op& op) {
-    switch (cst->kind()) {
+  void gen_constraint(pta_constraint& cst) {
+    switch (cst.kind()) {
       case CST_ASSIGN: {
-        boost::shared_ptr< pta_assign > assign =
-            boost::static_pointer_cast< pta_assign >(cst);
-        pta_info rhs_info = process_ref(assign->_rhs);
-        add_address_set(assign->_lhs.str(), rhs_info.first);
-        add_offset(assign->_lhs.str(), rhs_info.second, op);
-        break;
-      }
-      case CST_STORE: {
-        boost::shared_ptr< pta_store > store =
-            boost::static_pointer_cast< pta_store >(cst);
-        address_set& rhs_addrs = get_address_set(store->_rhs.str());
-        z_interval rhs_offset = get_offset(store->_rhs.str());
-        boost::shared_ptr< pta_ref > ref = store->_lhs;
-
-        switch (ref->kind()) {
+        pta_assign& assign = static_cast< pta_assign& >(cst);
+        unsigned lhs = var_node(assign._lhs);
+        pta_ref& ref = *(assign._rhs);
+        switch (ref.kind()) {
           case POINTER_REF: {
-            boost::shared_ptr< pointer_ref > pt_ref =
-                boost::static_pointer_cast< pointer_ref >(ref);
-            address_set& addrs = get_address_set(pt_ref->str());
-            for (address_set::iterator it = addrs.begin(); it != addrs.end();
-                 ++it) {
-              std::string vname = "O{" + std::to_string(*it) + "}";
-              add_address_set(vname, rhs_addrs);
-              add_offset(vname, rhs_offset, op);
-            }
+            pointer_ref& pt_ref = static_cast< pointer_ref& >(ref);
+            add_copy(var_node(pt_ref._pointer), lhs, pt_ref._offset);
             break;
           }
           case OBJECT_REF: {
-            CRAB_ERROR("cannot dereference a memory object");
+            object_ref& obj_ref = static_cast< object_ref& >(ref);
+            add_base(lhs, obj_ref._address, obj_ref._offset);
             break;
           }
           case FUNCTION_REF: {
-            CRAB_ERROR("cannot dereference a function object");
+            function_ref& fun_ref = static_cast< function_ref& >(ref);
+            add_base(lhs, fun_ref._uid, z_interval::top());
             break;
           }
-          case PARAM_REF: {
-            boost::shared_ptr< param_ref > param =
-                boost::static_pointer_cast< param_ref >(ref);
-            address_set& fptrs = get_address_set(param->_fptr.str());
-            for (address_set::iterator it = fptrs.begin(); it != fptrs.end();
-                 ++it) {
-              add_address_set(param->str(*it), rhs_addrs);
-              add_offset(param->str(*it), rhs_offset, op);
-            }
-            break;
-          }
-          case RETURN_REF: {
-            boost::shared_ptr< return_ref > ret =
-                boost::static_pointer_cast< return_ref >(ref);
-            address_set& fptrs = get_address_set(ret->_fptr.str());
-            for (address_set::iterator it = fptrs.begin(); it != fptrs.end();
-                 ++it) {
-              add_address_set(ret->str(*it), rhs_addrs);
-              add_offset(ret->str(*it), rhs_offset, op);
-            }
-            break;
+          default: {
+            // x = P_i(f) and x = R(f) read the parameter or return
+            // value of each function pointed to by f, as a load
+            gen_deref(ref, true, lhs);
           }
-          default: { CRAB_ERROR("unreachable"); }
         }
         break;
       }
+      case CST_STORE: {
+        pta_store& store = static_cast< pta_store& >(cst);
+        gen_deref(*(store._lhs), false, var_node(store._rhs));
+        break;
+      }
       case CST_LOAD: {
-        boost::shared_ptr< pta_load > load =
-            boost::static_pointer_cast< pta_load >(cst);
-        boost::shared_ptr< pta_ref > ref = load->_rhs;
-
-        switch (ref->kind()) {
-          case POINTER_REF: {
-            boost::shared_ptr< pointer_ref > pt_ref =
-                boost::static_pointer_cast< pointer_ref >(ref);
-            address_set& addrs = get_address_set(pt_ref->str());
-            for (address_set::iterator it = addrs.begin(); it != addrs.end();
-                 ++it) {
-              std::string vname = "O{" + std::to_string(*it) + "}";
-              add_address_set(load->_lhs.str(), get_address_set(vname));
-              add_offset(load->_lhs.str(), get_offset(vname), op);
-            }
-            break;
-          }
-          case OBJECT_REF: {
-            CRAB_ERROR("cannot dereference a memory object");
-            break;
-          }
-          case FUNCTION_REF: {
-            CRAB_ERROR("cannot dereference a function object");
-            break;
-          }
-          case PARAM_REF: {
-            boost::shared_ptr< param_ref > param =
-                boost::static_pointer_cast< param_ref >(ref);
-            address_set& fptrs = get_address_set(param->_fptr.str());
-            for (address_set::iterator it = fptrs.begin(); it != fptrs.end();
-                 ++it) {
-              add_address_set(load->_lhs.str(),
-                              get_address_set(param->str(*it)));
-              add_offset(load->_lhs.str(), get_offset(param->str(*it)), op);
-            }
-            break;
-          }
-          case RETURN_REF: {
-            boost::shared_ptr< return_ref > ret =
-                boost::static_pointer_cast< return_ref >(ref);
-            address_set& fptrs = get_address_set(ret->_fptr.str());
-            for (address_set::iterator it = fptrs.begin(); it != fptrs.end();
-                 ++it) {
-              add_address_set(load->_lhs.str(), get_address_set(ret->str(*it)));
-              add_offset(load->_lhs.str(), get_offset(ret->str(*it)), op);
-            }
-            break;
-          }
-          default: { CRAB_ERROR("unreachable"); }
-        }
+        pta_load& load = static_cast< pta_load& >(cst);
+        gen_deref(*(load._rhs), true, var_node(load._lhs));
         break;
       }
       default: { CRAB_ERROR("unreachable"); }
     }
   }
 
-  void step(const binary_op& op) {
-    for (std::vector< boost::shared_ptr< pta_constraint > >::iterator
-             it = this->_csts.begin(),
-             et = this->_csts.end();
-         it != et;
-         ++it) {
-      process_constraint(*it, op);
+  void reset() {
+    this->_nodes.clear();
+    this->_var_ids.clear();
+    this->_obj_ids.clear();
+    this->_param_ids.clear();
+    this->_ret_ids.clear();
+    this->_addr_ids.clear();
+    this->_addrs.clear();
+    this->_copies.clear();
+    this->_new_copies = 0;
+    this->_worklist.clear();
+  }
+
+  // One descending step: recompute each offset from the base
+  // addresses and the incoming copy edges of its node.
+  void refine_offsets() {
+    std::vector< z_interval > next(this->_nodes.size(), z_interval::bottom());
+    for (unsigned n = 0; n < this->_nodes.size(); ++n) {
+      if (find(n) == n) {
+        next[n] = next[n] | this->_nodes[n]._base;
+      }
+    }
+    for (unsigned n = 0; n < this->_nodes.size(); ++n) {
+      const node& x = this->_nodes[n];
+      if (find(n) != n || x._offset.is_bottom()) {
+        continue;
+      }
+      for (std::vector< copy_edge >::const_iterator it = x._succs.begin(),
+                                                    et = x._succs.end();
+           it != et;
+           ++it) {
+        unsigned t = find(it->_dst);
+        if (t != n || !is_zero(it->_offset)) {
+          next[t] = next[t] | (x._offset + it->_offset);
+        }
+      }
+    }
+    for (unsigned n = 0; n < this->_nodes.size(); ++n) {
+      node& x = this->_nodes[n];
+      if (find(n) != n) {
+        continue;
+      }
+      if (next[n] <= x._offset) { // descending chain
+        x._offset = next[n];
+      } else { // no descending chain
+        x._offset = x._offset | next[n];
+      }
     }
   }
 
 public:
-  pta_system() {}
+  pta_system() : _new_copies(0), _widening_threshold(100) {}
 
   void print(std::ostream& o) const {
     for (std::vector< boost::shared_ptr< pta_constraint > >::const_iterator
@@ -697,24 +996,58 @@ public:
 
   void solve(std::size_t widening_threshold = 100,
              std::size_t narrowing_threshold = 1) {
-    iteration = 0;
-    extrapolate widening_op(widening_threshold);
-    do {
-      ++iteration;
-      change_seen = false;
-      step(widening_op);
-    } while (change_seen);
+    crab::ScopedCrabStats __st__("Pta.solve");
+    reset();
+    this->_widening_threshold = widening_threshold;
+    for (std::vector< boost::shared_ptr< pta_constraint > >::iterator
+             it = this->_csts.begin(),
+             et = this->_csts.end();
+         it != et;
+         ++it) {
+      gen_constraint(**it);
+    }
+    // the cycles between pointer variables are known upfront
+    collapse_all(this->_nodes.size());
+    this->_worklist.clear();
+    for (unsigned n = 0; n < this->_nodes.size(); ++n) {
+      if (this->_nodes[n]._queued) {
+        this->_nodes[n]._queued = false;
+        if (find(n) == n) {
+          enqueue(n);
+        }
+      }
+    }
 
-    refine narrowing_op(narrowing_threshold);
-    iteration = 0;
-    for (; iteration < narrowing_threshold; ++iteration) {
-      step(narrowing_op);
+    while (!this->_worklist.empty()) {
+      unsigned n = this->_worklist.begin()->second;
+      this->_worklist.erase(this->_worklist.begin());
+      this->_nodes[n]._queued = false;
+      if (find(n) == n) {
+        process(n);
+      }
     }
+
+    for (std::size_t i = 0; i < narrowing_threshold; ++i) {
+      refine_offsets();
+    }
+
+    crab::CrabStats::count_max("Pta.max_nodes", this->_nodes.size());
+    crab::CrabStats::count_max("Pta.max_addresses", this->_addrs.size());
   }
 
   pta_info get(pointer_var p) const {
-    return std::make_pair(get_address_set(p.str()), 
-                          get_offset(p.str()));
+    id_map::const_iterator it = this->_var_ids.find(p._uid);
+    if (it == this->_var_ids.end()) {
+      return std::make_pair(address_set(), z_interval::bottom());
+    }
+    unsigned n = it->second;
+    while (this->_nodes[n]._parent != n) {
+      n = this->_nodes[n]._parent;
+    }
+    const node& x = this->_nodes[n];
+    address_set addrs;
+    x._pts.for_each([&](unsigned b) { addrs.insert(this->_addrs[b]); });
+    return std::make_pair(addrs, x._offset);
   }
 
 }; // class pta_system
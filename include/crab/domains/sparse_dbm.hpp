@@ -16,6 +16,9 @@
 #include <crab/domains/graphs/adapt_sgraph.hpp>
 #include <crab/domains/graphs/ht_graph.hpp>
 #include <crab/domains/graphs/pt_graph.hpp>
+#include <crab/domains/graphs/dense_graph.hpp>
+#include <crab/domains/graphs/auto_graph.hpp>
+#include <crab/domains/graphs/cow_graph.hpp>
 #include <crab/domains/graphs/graph_ops.hpp>
 #include <crab/domains/linear_constraints.hpp>
 #include <crab/domains/intervals.hpp>
@@ -26,6 +29,7 @@
 #include <crab/domains/domain_traits.hpp>
 
 #include <unordered_set>
+#include <limits>
 
 #include <boost/optional.hpp>
 #include <boost/unordered_set.hpp>
@@ -50,7 +54,15 @@ namespace crab {
        template<typename Number, typename Wt>
        class NtoV {
        public:
+         // Whether n can be represented as a Wt.
+         static bool fits(const Number& n) {
+           return Number(std::numeric_limits<Wt>::min()) <= n &&
+                  n <= Number(std::numeric_limits<Wt>::max());
+         }
+
          static Wt ntov(const Number& n) { 
+           if(!fits(n))
+             CRAB_ERROR("NtoV: ", n, " does not fit in the weight type");
            return (Wt) n;
          }
        };
@@ -66,10 +78,21 @@ namespace crab {
          // patricia tree-maps and patricia tree-sets
          pt = 3,           
          // hash table and hash sets
-         ht = 4
+         ht = 4,
+         // dense matrix, closed with Floyd-Warshall
+         dense = 5,
+         // dense matrix while the zone is small and dense,
+         // adaptive sparse otherwise
+         auto_dense = 6,
+         // adaptive sparse rows shared copy-on-write between copies
+         cow_ss = 7
        };          
 
-       template<typename Number, GraphRep Graph = GraphRep::adapt_ss>
+       // Wt is the type used for arithmetic on weights (potentials,
+       // closure). EdgeWt is the type edges are stored as, which can
+       // be narrower (e.g. int32_t) with the cow_ss representation.
+       template<typename Number, GraphRep Graph = GraphRep::adapt_ss,
+                typename EdgeWt = long>
        class DefaultParams {
        public:
          enum { chrome_dijkstra = 1 };
@@ -88,13 +111,29 @@ namespace crab {
              typename std::conditional< 
                (Graph == pt), 
                PtGraph<Wt>, 
-               HtGraph<Wt> 
+               typename std::conditional< 
+                 (Graph == dense), 
+                 DenseGraph<Wt>, 
+                 typename std::conditional< 
+                   (Graph == auto_dense), 
+                   AutoGraph<Wt>, 
+                   typename std::conditional< 
+                     (Graph == cow_ss), 
+                     CowGraph<Wt, EdgeWt>, 
+                     HtGraph<Wt> 
+                     >::type 
+                   >::type 
+                 >::type 
                >::type 
              >::type 
            >::type graph_t;
+
+         static_assert(std::is_same<EdgeWt, Wt>::value || Graph == cow_ss,
+                       "narrow edge weights need the cow_ss representation");
        };
 
-       template<typename Number, GraphRep Graph = GraphRep::adapt_ss>
+       template<typename Number, GraphRep Graph = GraphRep::adapt_ss,
+                typename EdgeWt = long>
        class SimpleParams {
        public:
          enum { chrome_dijkstra = 0 };
@@ -112,10 +151,25 @@ namespace crab {
              typename std::conditional< 
                (Graph == pt), 
                PtGraph<Wt>, 
-               HtGraph<Wt> 
+               typename std::conditional< 
+                 (Graph == dense), 
+                 DenseGraph<Wt>, 
+                 typename std::conditional< 
+                   (Graph == auto_dense), 
+                   AutoGraph<Wt>, 
+                   typename std::conditional< 
+                     (Graph == cow_ss), 
+                     CowGraph<Wt, EdgeWt>, 
+                     HtGraph<Wt> 
+                     >::type 
+                   >::type 
+                 >::type 
                >::type 
              >::type 
            >::type graph_t;
+
+         static_assert(std::is_same<EdgeWt, Wt>::value || Graph == cow_ss,
+                       "narrow edge weights need the cow_ss representation");
        };
      }; // end namespace SpDBM_impl
 
@@ -840,6 +894,19 @@ namespace crab {
         return v;
       }
       
+      // Whether the constant and coefficients of e fit in a Wt.
+      bool fits_wt(linear_expression_t e)
+      {
+        if(!ntov::fits(e.constant()))
+          return false;
+        for(auto p : e)
+        {
+          if(!ntov::fits(p.first))
+            return false;
+        }
+        return true;
+      }
+
       interval_t eval_interval(linear_expression_t e)
       {
         interval_t r = e.constant();
@@ -1049,6 +1116,9 @@ namespace crab {
         // If it's a constant, just assign the interval.
         if (e.is_constant()){
           set(x, e.constant());
+        } else if (!fits_wt(e)) {
+          // Cannot be encoded with difference constraints over Wt.
+          set(x, eval_interval(e));
         } else {
           interval_t x_int = eval_interval(e);
           vector<pair<VariableName, Wt> > diffs_lb;
@@ -1081,9 +1151,9 @@ namespace crab {
               {
                 delta.push_back(make_pair(make_pair(get_vert(diff.first), v), diff.second));
               }
-              if(x_int.lb().is_finite())
+              if(x_int.lb().is_finite() && ntov::fits(-(*(x_int.lb().number()))))
                 delta.push_back(make_pair(make_pair(v, 0), ntov::ntov(-(*(x_int.lb().number())))));
-              if(x_int.ub().is_finite())
+              if(x_int.ub().is_finite() && ntov::fits(*(x_int.ub().number())))
                 delta.push_back(make_pair(make_pair(0, v), ntov::ntov(*(x_int.ub().number()))));
                  
               GrOps::apply_delta(g, delta);
@@ -1109,9 +1179,9 @@ namespace crab {
               Wt_min min_op;
               edge_vector cst_edges;
 
-              if(x_int.lb().is_finite())
+              if(x_int.lb().is_finite() && ntov::fits(-(*(x_int.lb().number()))))
                 cst_edges.push_back(make_pair(make_pair(v, 0), ntov::ntov(-(*(x_int.lb().number())))));
-              if(x_int.ub().is_finite())
+              if(x_int.ub().is_finite() && ntov::fits(*(x_int.ub().number())))
                 cst_edges.push_back(make_pair(make_pair(0, v), ntov::ntov(*(x_int.ub().number()))));
 
               for(auto diff : diffs_lb)
@@ -1355,6 +1425,10 @@ namespace crab {
           return ;
         }
 
+        // Dropping a constraint that does not fit in Wt is sound.
+        if (!fits_wt(cst.expression()))
+          return;
+
         if (cst.is_inequality())
         {
           if(!add_linear_leq(cst.expression()))
@@ -1452,14 +1526,14 @@ namespace crab {
           return;
 
         vert_id v = get_vert(x);
-        if(intv.ub().is_finite())
+        if(intv.ub().is_finite() && ntov::fits(*(intv.ub().number())))
         {
           Wt ub = ntov::ntov(*(intv.ub().number()));
           potential[v] = potential[0] + ub;
           g.set_edge(0, ub, v);
           close_over_edge(0, v);
         }
-        if(intv.lb().is_finite())
+        if(intv.lb().is_finite() && ntov::fits(*(intv.lb().number())))
         {
           Wt lb = ntov::ntov(*(intv.lb().number()));
           potential[v] = potential[0] + lb;
@@ -1632,6 +1706,9 @@ namespace crab {
       {
         Wt_min min_op;
 
+        // The graph may have dropped an edge whose weight did not fit.
+        if(!g.elem(ii, jj))
+          return;
         Wt c = g.edge_val(ii,jj);
 
         typename graph_t::mut_val_ref_t w;
@@ -1894,9 +1971,9 @@ namespace crab {
           if(!rev_map[v])
             continue;
           if(g.elem(v, 0))
-            csts += linear_constraint_t(linear_expression_t(*rev_map[v]) >= -g.edge_val(v, 0));
+            csts += linear_constraint_t(linear_expression_t(*rev_map[v]) >= -Number(g.edge_val(v, 0)));
           if(g.elem(0, v))
-            csts += linear_constraint_t(linear_expression_t(*rev_map[v]) <= g.edge_val(0, v));
+            csts += linear_constraint_t(linear_expression_t(*rev_map[v]) <= Number(g.edge_val(0, v)));
         }
 
         for(vert_id s : g_excl.verts())
@@ -1909,7 +1986,7 @@ namespace crab {
             if(!rev_map[d])
               continue;
             variable_t vd = *rev_map[d];
-            csts += linear_constraint_t(linear_expression_t(vd) - linear_expression_t(vs) <= linear_expression_t(g_excl.edge_val(s, d)));
+            csts += linear_constraint_t(linear_expression_t(vd) - linear_expression_t(vs) <= Number(g_excl.edge_val(s, d)));
           }
         }
 
@@ -1937,7 +2014,7 @@ namespace crab {
       typedef typename linear_constraint_t::kind_t constraint_kind_t;
       typedef interval<Number>  interval_t;
 
-      typedef SparseDBM_<Number, VariableName> dbm_impl_t;
+      typedef SparseDBM_<Number, VariableName, Params> dbm_impl_t;
       typedef std::shared_ptr<dbm_impl_t> dbm_ref_t;
       typedef SparseDBM<Number, VariableName, Params> DBM_t;
 
@@ -2061,6 +2138,12 @@ namespace crab {
       dbm_ref_t norm_ref;
     };
 
+    template<typename Number, typename VariableName, typename Params>
+    class diff_constraints_traits <SparseDBM<Number,VariableName,Params> > {
+     public:
+      static const bool closed = true;
+    };
+
     template<typename Number, typename VariableName, typename Params>
     class domain_traits <SparseDBM<Number,VariableName,Params> > {
      public:
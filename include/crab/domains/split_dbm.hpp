@@ -19,6 +19,9 @@
 #include <crab/domains/graphs/sparse_graph.hpp>
 #include <crab/domains/graphs/ht_graph.hpp>
 #include <crab/domains/graphs/pt_graph.hpp>
+#include <crab/domains/graphs/dense_graph.hpp>
+#include <crab/domains/graphs/auto_graph.hpp>
+#include <crab/domains/graphs/cow_graph.hpp>
 #include <crab/domains/graphs/graph_ops.hpp>
 #include <crab/domains/linear_constraints.hpp>
 #include <crab/domains/intervals.hpp>
@@ -26,9 +29,12 @@
 #include <crab/domains/numerical_domains_api.hpp>
 #include <crab/domains/bitwise_operators_api.hpp>
 #include <crab/domains/division_operators_api.hpp>
+#include <crab/domains/domain_traits.hpp>
 
+#include <algorithm>
 #include <type_traits>
 #include <unordered_set>
+#include <limits>
 
 #include <boost/optional.hpp>
 #include <boost/unordered_set.hpp>
@@ -54,7 +60,15 @@ namespace crab {
        template<typename Number, typename Wt>
        class NtoV {
        public:
+         // Whether n can be represented as a Wt.
+         static bool fits(const Number& n) {
+           return Number(std::numeric_limits<Wt>::min()) <= n &&
+                  n <= Number(std::numeric_limits<Wt>::max());
+         }
+
          static Wt ntov(const Number& n) { 
+           if(!fits(n))
+             CRAB_ERROR("NtoV: ", n, " does not fit in the weight type");
            return (Wt) n;
          }
        };
@@ -70,10 +84,21 @@ namespace crab {
          // patricia tree-maps and patricia tree-sets
          pt = 3,           
          // hash table and hash sets
-         ht = 4
+         ht = 4,
+         // dense matrix, closed with Floyd-Warshall
+         dense = 5,
+         // dense matrix while the zone is small and dense,
+         // adaptive sparse otherwise
+         auto_dense = 6,
+         // adaptive sparse rows shared copy-on-write between copies
+         cow_ss = 7
        };          
 
-       template<typename Number, GraphRep Graph = GraphRep::adapt_ss>
+       // Wt is the type used for arithmetic on weights (potentials,
+       // closure). EdgeWt is the type edges are stored as, which can
+       // be narrower (e.g. int32_t) with the cow_ss representation.
+       template<typename Number, GraphRep Graph = GraphRep::adapt_ss,
+                typename EdgeWt = long>
        class DefaultParams {
        public:
          enum { chrome_dijkstra = 1 };
@@ -92,13 +117,29 @@ namespace crab {
              typename std::conditional< 
                (Graph == pt), 
                PtGraph<Wt>, 
-               HtGraph<Wt> 
+               typename std::conditional< 
+                 (Graph == dense), 
+                 DenseGraph<Wt>, 
+                 typename std::conditional< 
+                   (Graph == auto_dense), 
+                   AutoGraph<Wt>, 
+                   typename std::conditional< 
+                     (Graph == cow_ss), 
+                     CowGraph<Wt, EdgeWt>, 
+                     HtGraph<Wt> 
+                     >::type 
+                   >::type 
+                 >::type 
                >::type 
              >::type 
            >::type graph_t;
+
+         static_assert(std::is_same<EdgeWt, Wt>::value || Graph == cow_ss,
+                       "narrow edge weights need the cow_ss representation");
        };
 
-       template<typename Number, GraphRep Graph = GraphRep::adapt_ss>
+       template<typename Number, GraphRep Graph = GraphRep::adapt_ss,
+                typename EdgeWt = long>
        class SimpleParams {
        public:
          enum { chrome_dijkstra = 0 };
@@ -116,10 +157,156 @@ namespace crab {
              typename std::conditional< 
                (Graph == pt), 
                PtGraph<Wt>, 
-               HtGraph<Wt> 
+               typename std::conditional< 
+                 (Graph == dense), 
+                 DenseGraph<Wt>, 
+                 typename std::conditional< 
+                   (Graph == auto_dense), 
+                   AutoGraph<Wt>, 
+                   typename std::conditional< 
+                     (Graph == cow_ss), 
+                     CowGraph<Wt, EdgeWt>, 
+                     HtGraph<Wt> 
+                     >::type 
+                   >::type 
+                 >::type 
                >::type 
              >::type 
            >::type graph_t;
+
+         static_assert(std::is_same<EdgeWt, Wt>::value || Graph == cow_ss,
+                       "narrow edge weights need the cow_ss representation");
+       };
+
+       // Partition of the vertices of a graph, except the zero
+       // vertex, into blocks such that the endpoints of every edge
+       // not involving the zero vertex are in the same block.
+       //
+       // Blocks are merged when an edge relates them, and shrink when
+       // a vertex is removed, but are never split: a block may be
+       // coarser than a connected component. Each block is a circular
+       // list of vertices, so copying a partition is a few vector
+       // copies regardless of the number of blocks.
+       class VertPartition {
+       public:
+         typedef unsigned int vert_id;
+
+       private:
+         vector<int> _block; // block of each vertex, -1 if none
+         vector<vert_id> _next;
+         vector<vert_id> _prev;
+         vector<vert_id> _head; // some vertex of each block
+         vector<unsigned int> _size; // 0 if the block id is free
+         vector<int> _free;
+
+       public:
+         bool mem(vert_id v) const {
+           return v < _block.size() && _block[v] >= 0;
+         }
+
+         int find(vert_id v) const {
+           assert(mem(v));
+           return _block[v];
+         }
+
+         // Block ids range from 0 to num_ids(), some of them unused.
+         unsigned int num_ids() const { return _size.size(); }
+
+         unsigned int size(int b) const { return _size[b]; }
+
+         // Append the vertices of block b to out.
+         void members(int b, vector<vert_id>& out) const {
+           if(_size[b] == 0)
+             return;
+           vert_id v = _head[b];
+           do {
+             out.push_back(v);
+             v = _next[v];
+           } while(v != _head[b]);
+         }
+
+         // Make room for the vertices 0..n-1 and as many blocks.
+         void reserve(unsigned int n) {
+           _block.reserve(n);
+           _next.reserve(n);
+           _prev.reserve(n);
+           _head.reserve(n);
+           _size.reserve(n);
+         }
+
+         // Add v as a block of its own.
+         void add(vert_id v) {
+           if(v >= _block.size()) {
+             _block.resize(v+1, -1);
+             _next.resize(v+1);
+             _prev.resize(v+1);
+           }
+           assert(_block[v] < 0);
+           int b;
+           if(_free.empty()) {
+             b = _size.size();
+             _head.push_back(v);
+             _size.push_back(1);
+           } else {
+             b = _free.back();
+             _free.pop_back();
+             _head[b] = v;
+             _size[b] = 1;
+           }
+           _block[v] = b;
+           _next[v] = _prev[v] = v;
+         }
+
+         void remove(vert_id v) {
+           if(!mem(v))
+             return;
+           int b = _block[v];
+           _block[v] = -1;
+           if(--_size[b] == 0) {
+             _free.push_back(b);
+             return;
+           }
+           _next[_prev[v]] = _next[v];
+           _prev[_next[v]] = _prev[v];
+           if(_head[b] == v)
+             _head[b] = _next[v];
+         }
+
+         // Merge the blocks of u and v, relabelling the smaller one.
+         void merge(vert_id u, vert_id v) {
+           int bu = find(u);
+           int bv = find(v);
+           if(bu == bv)
+             return;
+           if(_size[bu] < _size[bv])
+             std::swap(bu, bv);
+           vert_id hu = _head[bu];
+           vert_id hv = _head[bv];
+           vert_id w = hv;
+           do {
+             _block[w] = bu;
+             w = _next[w];
+           } while(w != hv);
+           // Splice the two circular lists
+           vert_id nu = _next[hu];
+           vert_id nv = _next[hv];
+           _next[hu] = nv;
+           _prev[nv] = hu;
+           _next[hv] = nu;
+           _prev[nu] = hv;
+           _size[bu] += _size[bv];
+           _size[bv] = 0;
+           _free.push_back(bv);
+         }
+
+         void clear() {
+           _block.clear();
+           _next.clear();
+           _prev.clear();
+           _head.clear();
+           _size.clear();
+           _free.clear();
+         }
        };
      }; // end namespace SDBM_impl
 
@@ -166,6 +353,7 @@ namespace crab {
       typedef pair< pair<VariableName, VariableName>, Wt > diffcst_t;
 
       typedef std::unordered_set<vert_id> vert_set_t;
+      typedef SDBM_impl::VertPartition vert_partition_t;
 
       protected:
         
@@ -179,6 +367,9 @@ namespace crab {
       vector<Wt> potential; // Stored potential for the vertex
 
       vert_set_t unstable;
+      // Blocks of vertices which may be related. Join, meet and
+      // widening work on one block at a time.
+      vert_partition_t comps;
 
       bool _is_bottom;
 
@@ -202,6 +393,7 @@ namespace crab {
           g(o.g),
           potential(o.potential),
           unstable(o.unstable),
+          comps(o.comps),
           _is_bottom(false)
       {
         crab::CrabStats::count ("Domain.count.copy");
@@ -218,31 +410,33 @@ namespace crab {
         : vert_map(std::move(o.vert_map)), rev_map(std::move(o.rev_map)),
           g(std::move(o.g)), potential(std::move(o.potential)),
           unstable(std::move(o.unstable)),
+          comps(std::move(o.comps)),
           _is_bottom(o._is_bottom)
       { }
 
       // We should probably use the magical rvalue ownership semantics stuff.
       SplitDBM_(vert_map_t& _vert_map, rev_map_t& _rev_map, graph_t& _g, vector<Wt>& _potential,
-        vert_set_t& _unstable)
+        vert_set_t& _unstable, vert_partition_t& _comps)
         : writeable(),
           numerical_domain<Number, VariableName >(),
           bitwise_operators< Number, VariableName >(),
           division_operators< Number, VariableName >(),
           /* ranges(_ranges),*/ vert_map(_vert_map), rev_map(_rev_map), g(_g), potential(_potential),
-          unstable(_unstable),
+          unstable(_unstable), comps(_comps),
           _is_bottom(false)
       {
         CRAB_WARN("Non-moving constructor.");
         assert(g.size() > 0);
       }
       
-      SplitDBM_(vert_map_t&& _vert_map, rev_map_t&& _rev_map, graph_t&& _g, vector<Wt>&& _potential, vert_set_t&& _unstable)
+      SplitDBM_(vert_map_t&& _vert_map, rev_map_t&& _rev_map, graph_t&& _g, vector<Wt>&& _potential,
+                vert_set_t&& _unstable, vert_partition_t&& _comps)
         : writeable(),
           numerical_domain<Number, VariableName >(),
           bitwise_operators< Number, VariableName >(),
           division_operators< Number, VariableName >(),
           vert_map(std::move(_vert_map)), rev_map(std::move(_rev_map)), g(std::move(_g)), potential(std::move(_potential)),
-          unstable(std::move(_unstable)),
+          unstable(std::move(_unstable)), comps(std::move(_comps)),
           _is_bottom(false)
       { assert(g.size() > 0); }
 
@@ -263,6 +457,7 @@ namespace crab {
             g = o.g;
             potential = o.potential;
             unstable = o.unstable;
+            comps = o.comps;
             assert(g.size() > 0);
           }
         }
@@ -280,6 +475,7 @@ namespace crab {
           g = std::move(o.g);
           potential = std::move(o.potential);
           unstable = std::move(o.unstable);
+          comps = std::move(o.comps);
         }
         return *this;
       }
@@ -293,6 +489,7 @@ namespace crab {
         g.clear();
         potential.clear();
         unstable.clear();
+        comps.clear();
         _is_bottom = true;
       }
 
@@ -428,6 +625,7 @@ namespace crab {
           rev_map.push_back(variable_t(v));
         }
         vert_map.insert(vmap_elt_t(v, vert));
+        comps.add(vert);
 
         assert(vert != 0);
 
@@ -477,6 +675,253 @@ namespace crab {
         return true;
       }
 
+      // Merge the vertices 1..perm.size()-1 of out which are in the
+      // same block of p, where vertex v of out is vertex perm[v] of p,
+      // or -1 if it has none.
+      static void merge_blocks(const vector<vert_id>& perm, const vert_partition_t& p,
+                               vert_partition_t& out)
+      {
+        vector<int> rep(p.num_ids(), -1);
+        for(vert_id v = 1; v < perm.size(); v++)
+        {
+          if(perm[v] == (vert_id) -1)
+            continue;
+          int& r = rep[p.find(perm[v])];
+          if(r < 0)
+            r = v;
+          else
+            out.merge(r, v);
+        }
+      }
+
+      // Copy into out the edges of g among the zero vertex and verts,
+      // renaming verts[i] to names[i]. Entries of verts equal to -1
+      // stand for variables missing from g. loc must map the zero
+      // vertex to itself and every other vertex of g to -1; it is
+      // restored on exit.
+      static void copy_block(graph_t& g, const vector<vert_id>& verts,
+                             const vector<vert_id>& names,
+                             vector<vert_id>& loc, graph_t& out)
+      {
+        for(unsigned int i = 0; i < verts.size(); i++)
+        {
+          if(verts[i] != (vert_id) -1)
+            loc[verts[i]] = names[i];
+        }
+
+        typename graph_t::mut_val_ref_t w;
+        for(unsigned int i = 0; i < verts.size(); i++)
+        {
+          vert_id v = verts[i];
+          if(v == (vert_id) -1)
+            continue;
+          for(auto e : g.e_succs(v))
+          {
+            if(loc[e.vert] != (vert_id) -1)
+              out.add_edge(names[i], e.val, loc[e.vert]);
+          }
+          if(g.lookup(0, v, &w))
+            out.add_edge(0, w, names[i]);
+        }
+
+        for(vert_id v : verts)
+        {
+          if(v != (vert_id) -1)
+            loc[v] = -1;
+        }
+      }
+
+      // Whether some vertex of verts has an edge in g. Entries equal
+      // to -1 are skipped.
+      static bool has_edges(graph_t& g, const vector<vert_id>& verts)
+      {
+        for(vert_id v : verts)
+        {
+          if(v != (vert_id) -1 && (g.succs(v).size() > 0 || g.preds(v).size() > 0))
+            return true;
+        }
+        return false;
+      }
+
+      // Add the edges of the block graph b to out, renaming each
+      // vertex i > 0 of b to names[i-1].
+      static void paste_block(graph_t& b, const vector<vert_id>& names, graph_t& out)
+      {
+        for(vert_id s : b.verts())
+        {
+          for(auto e : b.e_succs(s))
+            out.add_edge(s == 0 ? 0 : names[s-1], e.val,
+                         e.vert == 0 ? 0 : names[e.vert-1]);
+        }
+      }
+
+      // Whether the vertices xs of g and ys of o.g have the same
+      // edges, bounds included, once xs[i] is renamed to ys[i]. This
+      // is conservative: an edge of xs leaving the block is taken as a
+      // difference. loc is as in copy_block.
+      bool same_block(const vector<vert_id>& xs, DBM_t& o, const vector<vert_id>& ys,
+                      vector<vert_id>& loc)
+      {
+        for(unsigned int i = 0; i < xs.size(); i++)
+          loc[xs[i]] = i + 1;
+
+        bool same = true;
+        typename graph_t::mut_val_ref_t w;
+        for(unsigned int i = 0; same && i < xs.size(); i++)
+        {
+          vert_id xv = xs[i];
+          vert_id yv = ys[i];
+          if(g.succs(xv).size() != o.g.succs(yv).size())
+          {
+            same = false;
+            break;
+          }
+
+          if(g.lookup(0, xv, &w))
+          {
+            Wt wx = w;
+            if(!o.g.lookup(0, yv, &w) || wx != w)
+              same = false;
+          } else if(o.g.elem(0, yv)) {
+            same = false;
+          }
+
+          for(auto e : g.e_succs(xv))
+          {
+            if(!same)
+              break;
+            if(loc[e.vert] == (vert_id) -1)
+            {
+              same = false;
+              break;
+            }
+            vert_id yd = (e.vert == 0 ? 0 : ys[loc[e.vert]-1]);
+            if(!o.g.lookup(yv, yd, &w) || e.val != w)
+              same = false;
+          }
+        }
+
+        for(vert_id v : xs)
+          loc[v] = -1;
+        return same;
+      }
+
+      // Join the closed block graphs gx and gy, with potentials pot_rx
+      // and pot_ry. The relations implied by the bounds of variables
+      // in different blocks are left to the caller.
+      graph_t join_block(graph_t& gx, vector<Wt>& pot_rx, graph_t& gy, vector<Wt>& pot_ry)
+      {
+        unsigned int sz = gx.size();
+
+        // Compute the deferred relations
+        graph_t g_ix_ry;
+        g_ix_ry.growTo(sz);
+        SubGraph<graph_t> gy_excl(gy, 0);
+        for(vert_id s : gy_excl.verts())
+        {
+          for(vert_id d : gy_excl.succs(s))
+          {
+            typename graph_t::mut_val_ref_t ws; typename graph_t::mut_val_ref_t wd;
+            if(gx.lookup(s, 0, &ws) && gx.lookup(0, d, &wd))
+              g_ix_ry.add_edge(s, ws + wd, d);
+          }
+        }
+        // Apply the deferred relations, and re-close.
+        edge_vector delta;
+        bool is_closed;
+        graph_t g_rx(GrOps::meet(gx, g_ix_ry, is_closed));
+        assert(check_potential(g_rx, pot_rx));
+        if(!is_closed)
+        {
+          SubGraph<graph_t> g_rx_excl(g_rx, 0);
+          GrOps::close_after_meet(g_rx_excl, pot_rx, gx, g_ix_ry, delta);
+          GrOps::apply_delta(g_rx, delta);
+        }
+
+        graph_t g_rx_iy;
+        g_rx_iy.growTo(sz);
+
+        SubGraph<graph_t> gx_excl(gx, 0);
+        for(vert_id s : gx_excl.verts())
+        {
+          for(vert_id d : gx_excl.succs(s))
+          {
+            typename graph_t::mut_val_ref_t ws; typename graph_t::mut_val_ref_t wd;
+            // Assumption: gx.mem(s, d) -> gx.edge_val(s, d) <= ranges[var(s)].ub() - ranges[var(d)].lb()
+            // That is, if the relation exists, it's at least as strong as the bounds.
+            if(gy.lookup(s, 0, &ws) && gy.lookup(0, d, &wd))
+              g_rx_iy.add_edge(s, ws + wd, d);
+          }
+        }
+        delta.clear();
+        // Similarly, should use a SubGraph view.
+        graph_t g_ry(GrOps::meet(gy, g_rx_iy, is_closed));
+        assert(check_potential(g_rx, pot_rx));
+        if(!is_closed)
+        {
+
+          SubGraph<graph_t> g_ry_excl(g_ry, 0);
+          GrOps::close_after_meet(g_ry_excl, pot_ry, gy, g_rx_iy, delta);
+          GrOps::apply_delta(g_ry, delta);
+        }
+
+        // We now have the relevant set of relations. Because g_rx and g_ry are closed,
+        // the result is also closed.
+        return GrOps::join(g_rx, g_ry);
+      }
+
+      // Meet the closed block graphs gx and gy, and close the result.
+      // pi is updated to a potential of the result. is_feasible is
+      // set to false if the meet is infeasible.
+      graph_t meet_block(graph_t& gx, graph_t& gy, vector<Wt>& pi, bool& is_feasible)
+      {
+        // Compute the syntactic meet of the permuted graphs.
+        bool is_closed;
+        graph_t meet_g(GrOps::meet(gx, gy, is_closed));
+
+        // Compute updated potentials on the zero-enriched graph
+        //vector<Wt> meet_pi(meet_g.size());
+        // We've warm-started pi with the operand potentials
+        is_feasible = GrOps::select_potentials(meet_g, pi);
+        if(!is_feasible)
+        {
+          // Potentials cannot be selected -- state is infeasible.
+          return meet_g;
+        }
+
+        if(!is_closed)
+        {
+          edge_vector delta;
+          SubGraph<graph_t> meet_g_excl(meet_g, 0);
+//          GrOps::close_after_meet(meet_g_excl, pi, gx, gy, delta);
+
+          if(Params::chrome_dijkstra)
+            GrOps::close_after_meet(meet_g_excl, pi, gx, gy, delta);
+          else
+            GrOps::close_johnson(meet_g_excl, pi, delta);
+
+          GrOps::apply_delta(meet_g, delta);
+
+        // Recover updated LBs and UBs.
+#ifdef CLOSE_BOUNDS_INLINE
+          Wt_min min_op;
+          for(auto e : delta)
+          {
+            if(meet_g.elem(0, e.first.first))
+              meet_g.update_edge(0, meet_g.edge_val(0, e.first.first) + e.second, e.first.second, min_op);
+            if(meet_g.elem(e.first.second, 0))
+              meet_g.update_edge(e.first.first, meet_g.edge_val(e.first.second, 0) + e.second, 0, min_op);
+          }
+#else
+          delta.clear();
+          GrOps::close_after_assign(meet_g, pi, 0, delta);
+          GrOps::apply_delta(meet_g, delta);
+#endif
+        }
+        assert(check_potential(meet_g, pi));
+        return meet_g;
+      }
+
       // FIXME: can be done more efficient
       void operator|=(DBM_t& o) {
         *this = *this | o;
@@ -501,7 +946,6 @@ namespace crab {
           // resulting potentials as we go.
           vector<vert_id> perm_x;
           vector<vert_id> perm_y;
-          vector<variable_t> perm_inv;
 
           vector<Wt> pot_rx;
           vector<Wt> pot_ry;
@@ -517,7 +961,7 @@ namespace crab {
 
           for(auto p : vert_map)
           {
-            auto it = o.vert_map.find(p.first); 
+            auto it = o.vert_map.find(p.first);
             // Variable exists in both
             if(it != o.vert_map.end())
             {
@@ -528,78 +972,77 @@ namespace crab {
               // XXX JNL: check this out
               //pot_ry.push_back(o.potential[p.second] - o.potential[0]);
               pot_ry.push_back(o.potential[(*it).second] - o.potential[0]);
-              perm_inv.push_back(p.first);
               perm_x.push_back(p.second);
               perm_y.push_back((*it).second);
             }
           }
           unsigned int sz = perm_x.size();
 
-          // Build the permuted view of x and y.
-          assert(g.size() > 0);
-          GrPerm gx(perm_x, g);
-          assert(o.g.size() > 0);
-          GrPerm gy(perm_y, o.g);
-
-          // Compute the deferred relations
-          graph_t g_ix_ry;
-          g_ix_ry.growTo(sz);
-          SubGraph<GrPerm> gy_excl(gy, 0);
-          for(vert_id s : gy_excl.verts())
+          // Variables can only be related by the join if they are in
+          // the same block of x or of y, or through their bounds,
+          // which is handled afterwards.
+          vert_partition_t out_comps;
+          out_comps.reserve(sz);
+          for(vert_id v = 1; v < sz; v++)
+            out_comps.add(v);
+          merge_blocks(perm_x, comps, out_comps);
+          merge_blocks(perm_y, o.comps, out_comps);
+
+          // Join block by block. A block which is the same in both
+          // operands is its own join.
+          graph_t join_g;
+          join_g.growTo(sz);
+          vector<vert_id> loc_x(g.size(), -1);
+          vector<vert_id> loc_y(o.g.size(), -1);
+          loc_x[0] = 0;
+          loc_y[0] = 0;
+          vector<vert_id> block;
+          vector<vert_id> local;
+          vector<vert_id> bx;
+          vector<vert_id> by;
+          for(unsigned int b = 0; b < out_comps.num_ids(); b++)
           {
-            for(vert_id d : gy_excl.succs(s))
+            if(out_comps.size(b) == 0)
+              continue;
+            block.clear();
+            out_comps.members(b, block);
+            std::sort(block.begin(), block.end());
+            local.clear();
+            bx.clear();
+            by.clear();
+            for(vert_id v : block)
             {
-              typename graph_t::mut_val_ref_t ws; typename graph_t::mut_val_ref_t wd;
-              if(gx.lookup(s, 0, &ws) && gx.lookup(0, d, &wd))
-                g_ix_ry.add_edge(s, ws + wd, d);
+              local.push_back(local.size() + 1);
+              bx.push_back(perm_x[v]);
+              by.push_back(perm_y[v]);
             }
-          }
-          // Apply the deferred relations, and re-close.
-          edge_vector delta;
-          bool is_closed;
-          graph_t g_rx(GrOps::meet(gx, g_ix_ry, is_closed));
-          assert(check_potential(g_rx, pot_rx));
-          if(!is_closed)
-          {
-            SubGraph<graph_t> g_rx_excl(g_rx, 0);
-            GrOps::close_after_meet(g_rx_excl, pot_rx, gx, g_ix_ry, delta);
-            GrOps::apply_delta(g_rx, delta);
-          }
-
-          graph_t g_rx_iy;
-          g_rx_iy.growTo(sz);
 
-          SubGraph<GrPerm> gx_excl(gx, 0);
-          for(vert_id s : gx_excl.verts())
-          {
-            for(vert_id d : gx_excl.succs(s))
+            if(same_block(bx, o, by, loc_x))
             {
-              typename graph_t::mut_val_ref_t ws; typename graph_t::mut_val_ref_t wd;
-              // Assumption: gx.mem(s, d) -> gx.edge_val(s, d) <= ranges[var(s)].ub() - ranges[var(d)].lb()
-              // That is, if the relation exists, it's at least as strong as the bounds.
-              if(gy.lookup(s, 0, &ws) && gy.lookup(0, d, &wd))
-                g_rx_iy.add_edge(s, ws + wd, d);
+              copy_block(g, bx, block, loc_x, join_g);
+              continue;
+            }
+            graph_t gx_b;
+            gx_b.growTo(block.size() + 1);
+            copy_block(g, bx, local, loc_x, gx_b);
+            graph_t gy_b;
+            gy_b.growTo(block.size() + 1);
+            copy_block(o.g, by, local, loc_y, gy_b);
+
+            vector<Wt> pot_bx(1, Wt(0));
+            vector<Wt> pot_by(1, Wt(0));
+            for(vert_id v : block)
+            {
+              pot_bx.push_back(pot_rx[v]);
+              pot_by.push_back(pot_ry[v]);
             }
+            graph_t join_b(join_block(gx_b, pot_bx, gy_b, pot_by));
+            paste_block(join_b, block, join_g);
           }
-          delta.clear();
-          // Similarly, should use a SubGraph view.
-          graph_t g_ry(GrOps::meet(gy, g_rx_iy, is_closed));
-          assert(check_potential(g_rx, pot_rx));
-          if(!is_closed)
-          {
-
-            SubGraph<graph_t> g_ry_excl(g_ry, 0);
-            GrOps::close_after_meet(g_ry_excl, pot_ry, gy, g_rx_iy, delta);
-            GrOps::apply_delta(g_ry, delta);
-          }
-           
-          // We now have the relevant set of relations. Because g_rx and g_ry are closed,
-          // the result is also closed.
-          Wt_min min_op;
-          graph_t join_g(GrOps::join(g_rx, g_ry));
 
           // Now reapply the missing independent relations.
           // Need to derive vert_ids from lb_up/lb_down, and make sure the vertices exist
+          Wt_min min_op;
           vector<vert_id> lb_up;
           vector<vert_id> lb_down;
           vector<vert_id> ub_up;
@@ -607,16 +1050,16 @@ namespace crab {
 
           typename graph_t::mut_val_ref_t wx;
           typename graph_t::mut_val_ref_t wy;
-          for(vert_id v : gx_excl.verts())
+          for(vert_id v = 1; v < sz; v++)
           {
-            if(gx.lookup(0, v, &wx) && gy.lookup(0, v, &wy))
+            if(g.lookup(0, perm_x[v], &wx) && o.g.lookup(0, perm_y[v], &wy))
             {
               if(wx < wy)
                 ub_up.push_back(v);
               if(wy < wx)
                 ub_down.push_back(v);
             }
-            if(gx.lookup(v, 0, &wx) && gy.lookup(v, 0, &wy))
+            if(g.lookup(perm_x[v], 0, &wx) && o.g.lookup(perm_y[v], 0, &wy))
             {
               if(wx < wy)
                 lb_down.push_back(v);
@@ -627,32 +1070,36 @@ namespace crab {
 
           for(vert_id s : lb_up)
           {
-            Wt dx_s = gx.edge_val(s, 0);
-            Wt dy_s = gy.edge_val(s, 0);
+            Wt dx_s = g.edge_val(perm_x[s], 0);
+            Wt dy_s = o.g.edge_val(perm_y[s], 0);
             for(vert_id d : ub_up)
             {
               if(s == d)
                 continue;
 
-              join_g.update_edge(s, max(dx_s + gx.edge_val(0, d), dy_s + gy.edge_val(0, d)), d, min_op);
+              join_g.update_edge(s, max(dx_s + g.edge_val(0, perm_x[d]),
+                                        dy_s + o.g.edge_val(0, perm_y[d])), d, min_op);
+              out_comps.merge(s, d);
             }
           }
 
           for(vert_id s : lb_down)
           {
-            Wt dx_s = gx.edge_val(s, 0);
-            Wt dy_s = gy.edge_val(s, 0);
+            Wt dx_s = g.edge_val(perm_x[s], 0);
+            Wt dy_s = o.g.edge_val(perm_y[s], 0);
             for(vert_id d : ub_down)
             {
               if(s == d)
                 continue;
 
-              join_g.update_edge(s, max(dx_s + gx.edge_val(0, d), dy_s + gy.edge_val(0, d)), d, min_op);
+              join_g.update_edge(s, max(dx_s + g.edge_val(0, perm_x[d]),
+                                        dy_s + o.g.edge_val(0, perm_y[d])), d, min_op);
+              out_comps.merge(s, d);
             }
           }
 
           // Conjecture: join_g remains closed.
-          
+
           // Now garbage collect any unused vertices
           for(vert_id v : join_g.verts())
           {
@@ -661,6 +1108,7 @@ namespace crab {
             if(join_g.succs(v).size() == 0 && join_g.preds(v).size() == 0)
             {
               join_g.forget(v);
+              out_comps.remove(v);
               if(out_revmap[v])
               {
                 out_vmap.erase(*(out_revmap[v]));
@@ -668,19 +1116,19 @@ namespace crab {
               }
             }
           }
-          
+
           // DBM_t res(join_range, out_vmap, out_revmap, join_g, join_pot);
-          DBM_t res(std::move(out_vmap), std::move(out_revmap), std::move(join_g), 
-                    std::move(pot_rx), vert_set_t());
+          DBM_t res(std::move(out_vmap), std::move(out_revmap), std::move(join_g),
+                    std::move(pot_rx), vert_set_t(), std::move(out_comps));
           //join_g.check_adjs();
           CRAB_LOG ("zones-split",
                     crab::outs() << "Result join:\n"<<res <<"\n");
-           
+
           return res;
         }
       }
 
-      DBM_t operator||(DBM_t& o) {	
+      DBM_t operator||(DBM_t& o) {
         if (is_bottom())
           return o;
         else if (o.is_bottom())
@@ -689,14 +1137,14 @@ namespace crab {
           CRAB_LOG ("zones-split",
                     crab::outs() << "Before widening:\n"<<"DBM 1\n"<<*this<<"\n"<<"DBM 2\n"<<o <<"\n");
           o.normalize();
-          
+
           // Figure out the common renaming
           vector<vert_id> perm_x;
           vector<vert_id> perm_y;
           vert_map_t out_vmap;
           rev_map_t out_revmap;
           vector<Wt> widen_pot;
-          vert_set_t widen_unstable(unstable);
+          vert_set_t widen_unstable;
 
           assert(potential.size() > 0);
           widen_pot.push_back(Wt(0));
@@ -705,7 +1153,7 @@ namespace crab {
           out_revmap.push_back(none);
           for(auto p : vert_map)
           {
-            auto it = o.vert_map.find(p.first); 
+            auto it = o.vert_map.find(p.first);
             // Variable exists in both
             if(it != o.vert_map.end())
             {
@@ -717,22 +1165,77 @@ namespace crab {
               perm_y.push_back((*it).second);
             }
           }
+          unsigned int sz = perm_x.size();
 
-          // Build the permuted view of x and y.
-          assert(g.size() > 0);
-          GrPerm gx(perm_x, g);            
-          assert(o.g.size() > 0);
-          GrPerm gy(perm_y, o.g);
-         
-          // Now perform the widening 
+          // The vertices of x which are still to be closed
+          if(!unstable.empty())
+          {
+            for(vert_id v = 0; v < sz; v++)
+            {
+              if(unstable.count(perm_x[v]))
+                widen_unstable.insert(v);
+            }
+          }
+
+          // The widening only keeps relations of x, so the blocks of x
+          // are enough.
+          vert_partition_t out_comps;
+          out_comps.reserve(sz);
+          for(vert_id v = 1; v < sz; v++)
+            out_comps.add(v);
+          merge_blocks(perm_x, comps, out_comps);
+
+          // Now perform the widening, block by block
+          graph_t widen_g;
+          widen_g.growTo(sz);
+          vector<vert_id> loc_x(g.size(), -1);
+          vector<vert_id> loc_y(o.g.size(), -1);
+          loc_x[0] = 0;
+          loc_y[0] = 0;
+          vector<vert_id> block;
+          vector<vert_id> local;
+          vector<vert_id> bx;
+          vector<vert_id> by;
           vector<vert_id> destabilized;
-          graph_t widen_g(GrOps::widen(gx, gy, destabilized));
-          for(vert_id v : destabilized)
-            widen_unstable.insert(v);
+          for(unsigned int b = 0; b < out_comps.num_ids(); b++)
+          {
+            if(out_comps.size(b) == 0)
+              continue;
+            block.clear();
+            out_comps.members(b, block);
+            std::sort(block.begin(), block.end());
+            local.clear();
+            bx.clear();
+            by.clear();
+            for(vert_id v : block)
+            {
+              local.push_back(local.size() + 1);
+              bx.push_back(perm_x[v]);
+              by.push_back(perm_y[v]);
+            }
+
+            if(same_block(bx, o, by, loc_x))
+            {
+              copy_block(g, bx, block, loc_x, widen_g);
+              continue;
+            }
+            graph_t gx_b;
+            gx_b.growTo(block.size() + 1);
+            copy_block(g, bx, local, loc_x, gx_b);
+            graph_t gy_b;
+            gy_b.growTo(block.size() + 1);
+            copy_block(o.g, by, local, loc_y, gy_b);
+
+            destabilized.clear();
+            graph_t widen_b(GrOps::widen(gx_b, gy_b, destabilized));
+            for(vert_id v : destabilized)
+              widen_unstable.insert(v == 0 ? 0 : block[v-1]);
+            paste_block(widen_b, block, widen_g);
+          }
+
+          DBM_t res(std::move(out_vmap), std::move(out_revmap), std::move(widen_g),
+                    std::move(widen_pot), std::move(widen_unstable), std::move(out_comps));
 
-          DBM_t res(std::move(out_vmap), std::move(out_revmap), std::move(widen_g), 
-                    std::move(widen_pot), std::move(widen_unstable));
-           
           CRAB_LOG ("zones-split",
                     crab::outs() << "Result widening:\n"<<res <<"\n");
           return res;
@@ -757,7 +1260,7 @@ namespace crab {
                     crab::outs() << "Before meet:\n"<<"DBM 1\n"<<*this<<"\n"<<"DBM 2\n"<<o <<"\n");
           normalize();
           o.normalize();
-          
+
           // We map vertices in the left operand onto a contiguous range.
           // This will often be the identity map, but there might be gaps.
           vert_map_t meet_verts;
@@ -799,64 +1302,92 @@ namespace crab {
               perm_y[(*it).second] = p.second;
             }
           }
+          unsigned int sz = perm_x.size();
 
-          // Build the permuted view of x and y.
-          assert(g.size() > 0);
-          GrPerm gx(perm_x, g);
-          assert(o.g.size() > 0);
-          GrPerm gy(perm_y, o.g);
-
-          // Compute the syntactic meet of the permuted graphs.
-          bool is_closed;
-          graph_t meet_g(GrOps::meet(gx, gy, is_closed));
-           
-          // Compute updated potentials on the zero-enriched graph
-          //vector<Wt> meet_pi(meet_g.size());
-          // We've warm-started pi with the operand potentials
-          if(!GrOps::select_potentials(meet_g, meet_pi))
-          {
-            // Potentials cannot be selected -- state is infeasible.
-            return bottom();
-          }
-
-          if(!is_closed)
+          // The meet and its closure only relate variables in the
+          // same block of x or of y.
+          vert_partition_t meet_comps;
+          meet_comps.reserve(sz);
+          for(vert_id v = 1; v < sz; v++)
+            meet_comps.add(v);
+          merge_blocks(perm_x, comps, meet_comps);
+          merge_blocks(perm_y, o.comps, meet_comps);
+
+          graph_t meet_g;
+          meet_g.growTo(sz);
+          vector<vert_id> loc_x(g.size(), -1);
+          vector<vert_id> loc_y(o.g.size(), -1);
+          loc_x[0] = 0;
+          loc_y[0] = 0;
+          vector<vert_id> block;
+          vector<vert_id> local;
+          vector<vert_id> bx;
+          vector<vert_id> by;
+          for(unsigned int b = 0; b < meet_comps.num_ids(); b++)
           {
-            edge_vector delta;
-            SubGraph<graph_t> meet_g_excl(meet_g, 0);
-//            GrOps::close_after_meet(meet_g_excl, meet_pi, gx, gy, delta);
-
-            if(Params::chrome_dijkstra)
-              GrOps::close_after_meet(meet_g_excl, meet_pi, gx, gy, delta);
-            else
-              GrOps::close_johnson(meet_g_excl, meet_pi, delta);
-
-            GrOps::apply_delta(meet_g, delta);
+            if(meet_comps.size(b) == 0)
+              continue;
+            block.clear();
+            meet_comps.members(b, block);
+            std::sort(block.begin(), block.end());
+            local.clear();
+            bx.clear();
+            by.clear();
+            for(vert_id v : block)
+            {
+              local.push_back(local.size() + 1);
+              bx.push_back(perm_x[v]);
+              by.push_back(perm_y[v]);
+            }
 
-          // Recover updated LBs and UBs.
-#ifdef CLOSE_BOUNDS_INLINE
-            Wt_min min_op;
-            for(auto e : delta)
+            // A block constrained by one operand only is already
+            // closed, and keeps that operand's potentials.
+            if(!has_edges(o.g, by))
             {
-              if(meet_g.elem(0, e.first.first))
-                meet_g.update_edge(0, meet_g.edge_val(0, e.first.first) + e.second, e.first.second, min_op);
-              if(meet_g.elem(e.first.second, 0))
-                meet_g.update_edge(e.first.first, meet_g.edge_val(e.first.second, 0) + e.second, e.first.first, min_op);
+              copy_block(g, bx, block, loc_x, meet_g);
+              continue;
             }
-#else
-            delta.clear();
-            GrOps::close_after_assign(meet_g, meet_pi, 0, delta);
-            GrOps::apply_delta(meet_g, delta);
-#endif
-          }
-          assert(check_potential(meet_g, meet_pi)); 
-          DBM_t res(std::move(meet_verts), std::move(meet_rev), std::move(meet_g), 
-                    std::move(meet_pi), vert_set_t());
+            if(!has_edges(g, bx))
+            {
+              copy_block(o.g, by, block, loc_y, meet_g);
+              for(vert_id v : block)
+              {
+                if(perm_y[v] != (vert_id) -1)
+                  meet_pi[v] = o.potential[perm_y[v]] - o.potential[0];
+              }
+              continue;
+            }
+
+            graph_t gx_b;
+            gx_b.growTo(block.size() + 1);
+            copy_block(g, bx, local, loc_x, gx_b);
+            graph_t gy_b;
+            gy_b.growTo(block.size() + 1);
+            copy_block(o.g, by, local, loc_y, gy_b);
+
+            vector<Wt> pi_b(1, meet_pi[0]);
+            for(vert_id v : block)
+              pi_b.push_back(meet_pi[v]);
+            bool is_feasible;
+            graph_t meet_b(meet_block(gx_b, gy_b, pi_b, is_feasible));
+            if(!is_feasible)
+              return bottom();
+            paste_block(meet_b, block, meet_g);
+            // The potentials of each block are relative to its own
+            // zero vertex.
+            for(unsigned int i = 0; i < block.size(); i++)
+              meet_pi[block[i]] = pi_b[i+1] - pi_b[0];
+          }
+
+          assert(check_potential(meet_g, meet_pi));
+          DBM_t res(std::move(meet_verts), std::move(meet_rev), std::move(meet_g),
+                    std::move(meet_pi), vert_set_t(), std::move(meet_comps));
           CRAB_LOG ("zones-split",
                     crab::outs() << "Result meet:\n"<<res <<"\n");
           return res;
         }
       }
-    
+
       DBM_t operator&&(DBM_t& o) {
         if (is_bottom() || o.is_bottom())
           return bottom();
@@ -925,6 +1456,7 @@ namespace crab {
           CRAB_LOG("zones-split", crab::outs() << "Before forget "<< it->second<< ": "<< g <<"\n");
           g.forget(it->second);
           CRAB_LOG("zones-split", crab::outs() << "After: "<< g <<"\n");
+          comps.remove(it->second);
           rev_map[it->second] = boost::none;
           vert_map.erase(v);
         }
@@ -984,6 +1516,19 @@ namespace crab {
         return v;
       }
       
+      // Whether the constant and coefficients of e fit in a Wt.
+      bool fits_wt(linear_expression_t e)
+      {
+        if(!ntov::fits(e.constant()))
+          return false;
+        for(auto p : e)
+        {
+          if(!ntov::fits(p.first))
+            return false;
+        }
+        return true;
+      }
+
       interval_t eval_interval(linear_expression_t e)
       {
         interval_t r = e.constant();
@@ -1191,6 +1736,9 @@ namespace crab {
         // If it's a constant, just assign the interval.
         if (e.is_constant()){
           set(x, e.constant());
+        } else if (!fits_wt(e)) {
+          // Cannot be encoded with difference constraints over Wt.
+          set(x, eval_interval(e));
         } else {
           interval_t x_int = eval_interval(e);
           vector<pair<VariableName, Wt> > diffs_lb;
@@ -1212,16 +1760,21 @@ namespace crab {
                 potential[v] = potential[0] + eval_expression(e);
                 rev_map[v] = x;
               }
+              comps.add(v);
               
               edge_vector delta;
               for(auto diff : diffs_lb)
               {
-                delta.push_back(make_pair(make_pair(v, get_vert(diff.first)), -diff.second));
+                vert_id d = get_vert(diff.first);
+                comps.merge(v, d);
+                delta.push_back(make_pair(make_pair(v, d), -diff.second));
               }
 
               for(auto diff : diffs_ub)
               {
-                delta.push_back(make_pair(make_pair(get_vert(diff.first), v), diff.second));
+                vert_id s = get_vert(diff.first);
+                comps.merge(s, v);
+                delta.push_back(make_pair(make_pair(s, v), diff.second));
               }
                  
               // apply_delta should be safe here, as x has no edges in G.
@@ -1232,9 +1785,9 @@ namespace crab {
               GrOps::apply_delta(g, delta);
 
               Wt_min min_op;
-              if(x_int.lb().is_finite())
+              if(x_int.lb().is_finite() && ntov::fits(-(*(x_int.lb().number()))))
                 g.update_edge(v, ntov::ntov(-(*(x_int.lb().number()))), 0, min_op);
-              if(x_int.ub().is_finite())
+              if(x_int.ub().is_finite() && ntov::fits(*(x_int.ub().number())))
                 g.update_edge(0, ntov::ntov(*(x_int.ub().number())), v, min_op);
               // Clear the old x vertex
               operator-=(x);
@@ -1251,6 +1804,7 @@ namespace crab {
                 potential[v] = Wt(0);
                 rev_map[v] = x;
               }
+              comps.add(v);
               Wt_min min_op;
               edge_vector cst_edges;
 
@@ -1269,6 +1823,7 @@ namespace crab {
                 vert_id src = diff.first.first;
                 vert_id dest = diff.first.second;
                 g.update_edge(src, diff.second, dest, min_op);
+                comps.merge(src, dest);
                 if(!repair_potential(src, dest))
                 {
                   assert(0 && "Unreachable");
@@ -1280,9 +1835,9 @@ namespace crab {
                 assert(check_potential(g, potential));
               }
 
-              if(x_int.lb().is_finite())
+              if(x_int.lb().is_finite() && ntov::fits(-(*(x_int.lb().number()))))
                 g.update_edge(v, ntov::ntov(-(*(x_int.lb().number()))), 0, min_op);
-              if(x_int.ub().is_finite())
+              if(x_int.ub().is_finite() && ntov::fits(*(x_int.ub().number())))
                 g.update_edge(0, ntov::ntov(*(x_int.ub().number())), v, min_op);
 
               // Clear the old x vertex
@@ -1479,6 +2034,7 @@ namespace crab {
           vert_id src = get_vert(diff.first.second);
           vert_id dest = get_vert(diff.first.first);
           g.update_edge(src, diff.second, dest, min_op);
+          comps.merge(src, dest);
           if(!repair_potential(src, dest))
           {
             set_to_bottom();
@@ -1561,6 +2117,10 @@ namespace crab {
           return ;
         }
 
+        // Dropping a constraint that does not fit in Wt is sound.
+        if (!fits_wt(cst.expression()))
+          return;
+
         if (cst.is_inequality())
         {
           if(!add_linear_leq(cst.expression()))
@@ -1659,13 +2219,13 @@ namespace crab {
           return;
 
         vert_id v = get_vert(x);
-        if(intv.ub().is_finite())
+        if(intv.ub().is_finite() && ntov::fits(*(intv.ub().number())))
         {
           Wt ub = ntov::ntov(*(intv.ub().number()));
           potential[v] = potential[0] + ub;
           g.set_edge(0, ub, v);
         }
-        if(intv.lb().is_finite())
+        if(intv.lb().is_finite() && ntov::fits(*(intv.lb().number())))
         {
           Wt lb = ntov::ntov(*(intv.lb().number()));
           potential[v] = potential[0] + lb;
@@ -1840,6 +2400,9 @@ namespace crab {
         assert(ii != 0 && jj != 0);
         SubGraph<graph_t> g_excl(g, 0);
 
+        // The graph may have dropped an edge whose weight did not fit.
+        if(!g_excl.elem(ii, jj))
+          return;
         Wt c = g_excl.edge_val(ii,jj);
 
         typename graph_t::mut_val_ref_t w;
@@ -1856,7 +2419,9 @@ namespace crab {
         for(auto edge : g_excl.e_preds(ii))
         {
           vert_id se = edge.vert;
-          Wt wt_sij = edge.val + c;
+          // edge.val may refer to storage moved by the additions below.
+          Wt wt_si = edge.val;
+          Wt wt_sij = wt_si + c;
 
           assert(g_excl.succs(se).begin() != g_excl.succs(se).end());
           if(se != jj)
@@ -1871,7 +2436,7 @@ namespace crab {
             } else {
               g_excl.add_edge(se, wt_sij, jj);
             }
-            src_dec.push_back(std::make_pair(se, edge.val));  
+            src_dec.push_back(std::make_pair(se, wt_si));
 #ifdef CLOSE_BOUNDS_INLINE
             if(g.lookup(0, se, &w))
               g.update_edge(0, w + wt_sij, jj, min_op);
@@ -1910,7 +2475,8 @@ namespace crab {
         for(auto edge : g_excl.e_succs(jj))
         {
           vert_id de = edge.vert;
-          Wt wt_ijd = edge.val + c;
+          Wt wt_jd = edge.val;
+          Wt wt_ijd = wt_jd + c;
           if(de != ii)
           {
             if(g_excl.lookup(ii, de, &w))
@@ -1921,7 +2487,7 @@ namespace crab {
             } else {
               g_excl.add_edge(ii, wt_ijd, de);
             }
-            dest_dec.push_back(std::make_pair(de, edge.val));
+            dest_dec.push_back(std::make_pair(de, wt_jd));
 #ifdef CLOSE_BOUNDS_INLINE
             if(g.lookup(0,  ii, &w))
               g.update_edge(0, w + wt_ijd, de, min_op);
@@ -1997,11 +2563,17 @@ namespace crab {
         vert_id ii = get_vert(x);
         vert_id jj = get_vert(y);
 
-        for (auto edge : g.e_preds(ii))  
+        for (auto edge : g.e_preds(ii)) {
           g.add_edge (edge.vert, edge.val, jj);
+          if (edge.vert != 0)
+            comps.merge (edge.vert, jj);
+        }
         
-        for (auto edge : g.e_succs(ii))  
+        for (auto edge : g.e_succs(ii)) {
           g.add_edge (jj, edge.val, edge.vert);
+          if (edge.vert != 0)
+            comps.merge (jj, edge.vert);
+        }
 
         CRAB_LOG ("zones-split",
                   crab::outs() << "After expand " << x << " into " << y << ":\n"<< *this <<"\n");
@@ -2068,7 +2640,7 @@ namespace crab {
                   //crab::outs() << "Propagating " << cst << " to " << inv.getDomainName () << "\n";
                   csts += cst;
                 } else if (g_excl.elem (s, d)) {
-                  linear_constraint_t cst (vd - vs <= g_excl.edge_val(s, d));
+                  linear_constraint_t cst (vd - vs <= Number(g_excl.edge_val(s, d)));
                   //crab::outs() << "Propagating " << cst << " to " << inv.getDomainName () << "\n";
                   csts += cst;
                 }
@@ -2214,9 +2786,9 @@ namespace crab {
           if(!rev_map[v])
             continue;
           if(g.elem(v, 0))
-            csts += linear_constraint_t(linear_expression_t(*rev_map[v]) >= -g.edge_val(v, 0));
+            csts += linear_constraint_t(linear_expression_t(*rev_map[v]) >= -Number(g.edge_val(v, 0)));
           if(g.elem(0, v))
-            csts += linear_constraint_t(linear_expression_t(*rev_map[v]) <= g.edge_val(0, v));
+            csts += linear_constraint_t(linear_expression_t(*rev_map[v]) <= Number(g.edge_val(0, v)));
         }
 
         for(vert_id s : g_excl.verts())
@@ -2229,7 +2801,7 @@ namespace crab {
             if(!rev_map[d])
               continue;
             variable_t vd = *rev_map[d];
-            csts += linear_constraint_t(linear_expression_t(vd) - linear_expression_t(vs) <= linear_expression_t(g_excl.edge_val(s, d)));
+            csts += linear_constraint_t(linear_expression_t(vd) - linear_expression_t(vs) <= Number(g_excl.edge_val(s, d)));
           }
         }
 
@@ -2383,6 +2955,12 @@ namespace crab {
     };
 
 
+    template<typename Number, typename VariableName, typename Params>
+    class diff_constraints_traits <SplitDBM<Number,VariableName,Params> > {
+     public:
+      static const bool closed = true;
+    };
+
     template<typename Number, typename VariableName>
     class domain_traits <SplitDBM<Number,VariableName> > {
      public:
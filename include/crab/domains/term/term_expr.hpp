@@ -1,8 +1,12 @@
 #ifndef __TERM_EXPR_H__
 #define __TERM_EXPR_H__
+#include <algorithm>
 #include <map>
 #include <memory>
+#include <vector>
 #include <boost/optional.hpp>
+#include <boost/functional/hash.hpp>
+#include <boost/unordered_map.hpp>
 
 using namespace std;
 using namespace boost;
@@ -33,6 +37,12 @@ namespace crab {
         int depth;
       };
    
+      template<class Num, class Ftor>
+      bool term_eq(term<Num, Ftor>* x, term<Num, Ftor>* y);
+
+      template<class Num, class Ftor>
+      std::size_t term_hash(term<Num, Ftor>* t);
+
       template<class Num, class Ftor>
       class term_ref {
        public:
@@ -51,10 +61,21 @@ namespace crab {
         {
           return *p < *(other.p);
         }
+
+        bool operator==(const term_ref& other) const
+        {
+          return term_eq(p.get(), other.p.get());
+        }
         
         term_ptr p;
       };
 
+      template<class Num, class Ftor>
+      std::size_t hash_value(const term_ref<Num, Ftor>& ref)
+      {
+        return term_hash(ref.p.get());
+      }
+
       // Dispatch for different kinds of terms.
       template<class Num, class Ftor>
       class const_term : public term<Num, Ftor> {
@@ -176,6 +197,49 @@ namespace crab {
         }
       }
 
+      // Structural equality and hash, for hash-consing. Arguments are
+      // compared by id since they are already hash-consed.
+      template<class Num, class Ftor>
+      bool term_eq(term<Num, Ftor>* x, term<Num, Ftor>* y)
+      {
+        if(x->kind() != y->kind())
+          return false;
+
+        switch(x->kind())
+        {
+          case TERM_CONST:
+            return term_const(x) == term_const(y);
+          case TERM_VAR:
+            return term_var(x) == term_var(y);
+          case TERM_APP:
+            return term_ftor(x) == term_ftor(y) && term_args(x) == term_args(y);
+          default:
+            CRAB_ERROR("Unsupported term kind.");
+        }
+      }
+
+      template<class Num, class Ftor>
+      std::size_t term_hash(term<Num, Ftor>* t)
+      {
+        std::size_t res = (std::size_t) t->kind();
+        switch(t->kind())
+        {
+          case TERM_CONST:
+            boost::hash_combine(res, term_const(t));
+            break;
+          case TERM_VAR:
+            boost::hash_combine(res, term_var(t));
+            break;
+          case TERM_APP:
+            boost::hash_combine(res, (int) term_ftor(t));
+            boost::hash_range(res, term_args(t).begin(), term_args(t).end());
+            break;
+          default:
+            CRAB_ERROR("Unsupported term kind.");
+        }
+        return res;
+      }
+
       template<typename TermTable>
       class congruence_closure_solver;
 
@@ -197,25 +261,18 @@ namespace crab {
         typedef std::map<std::pair<term_id, term_id>, term_id> gener_map_t;
         
         term_table(void)
-            : free_var(0)
+            : _rep(new table_rep())
         { }
         
+        // Copies share the representation until one of them adds or
+        // frees a term.
         term_table(const term_table_t& o)
-            : free_var(o.free_var), _map(o._map),
-              terms(o.terms), _parents(o._parents), _ref_count(o._ref_count),
-              _depth(o._depth),
-              free_terms(o.free_terms)
+            : _rep(o._rep)
         { }
         
         term_table_t& operator=(const term_table_t& o)
         {
-          free_var = o.free_var;
-          _map = o._map;
-          terms = o.terms;
-          _ref_count = o._ref_count;
-          _parents = o._parents;
-          _depth = o._depth;
-          free_terms = o.free_terms;
+          _rep = o._rep;
           return *this;
         }
         
@@ -229,13 +286,17 @@ namespace crab {
         }
         
         term_id make_var(var_id& n) {
-          free_var = std::max(free_var, n+1);
+          if(n >= _rep->free_var)
+          {
+            detach();
+            _rep->free_var = n+1;
+          }
           term_ref_t ref(new var_term_t(n));
           return add_term(ref);
         };
         
         term_id fresh_var(void) {
-          var_id v = free_var++;
+          var_id v = _rep->free_var;
           return make_var(v); 
         }
         
@@ -279,28 +340,38 @@ namespace crab {
 
         term_t* get_term_ptr(term_id t)
         {
-          return terms[t].p.get();
+          return _rep->terms[t].p.get();
         }
         
         void add_ref(term_id t)
         {
-          _ref_count[t]++;
+          detach();
+          _rep->ref_count[t]++;
         }
         
         void deref(term_id t, std::vector<term_id>& forgotten)
         {
-          assert(_ref_count[t]);
-          _ref_count[t]--;
-          if(!_ref_count[t])
+          detach();
+          assert(_rep->ref_count[t]);
+          _rep->ref_count[t]--;
+          if(!_rep->ref_count[t])
           {
             forgotten.push_back(t);
-            free_terms.push_back(t);
-            term_ref_t ref(terms[t]);
-            _map.erase(ref);
+            _rep->free_terms.push_back(t);
+            term_ref_t ref(_rep->terms[t]);
+            _rep->map.erase(ref);
             if(ref.p.get()->kind() == TERM_APP)
             {
               for(term_id c : term_args(ref.p.get()))
+              {
+                // t may occur several times in the parents of c, if
+                // c occurs several times in the arguments of t.
+                std::vector<term_id_t>& ps(_rep->parents[c]);
+                auto it = std::find(ps.begin(), ps.end(), t);
+                if(it != ps.end())
+                  ps.erase(it);
                 deref(c, forgotten);
+              }
             }
           }
         }
@@ -312,8 +383,8 @@ namespace crab {
           if(it != map.end())
             return (*it).second == tx;
           
-          term_ref_t ry(y.terms[ty]);
-          term_ref_t rx(terms[tx]);
+          term_ref_t ry(y._rep->terms[ty]);
+          term_ref_t rx(_rep->terms[tx]);
           switch(ry.p.get()->kind())
           {
             case TERM_CONST:
@@ -358,8 +429,8 @@ namespace crab {
         } else {
             // Haven't found this pair yet.
             // Generalize the arguments.
-            auto px(terms[tx].p.get());
-            auto py(y.terms[ty].p.get());
+            auto px(_rep->terms[tx].p.get());
+            auto py(y._rep->terms[ty].p.get());
             
             term_kind kx = px->kind();
             term_kind ky = py->kind();
@@ -413,7 +484,7 @@ namespace crab {
           if(it != ren_map.end()) {
             return (*it).second;
           } else {
-            auto px(tx.terms[x].p.get());
+            auto px(tx._rep->terms[x].p.get());
             term_kind kx = px->kind();
             term_id_t ret;
             if(kx == TERM_VAR) {
@@ -436,31 +507,118 @@ namespace crab {
 
         std::vector<term_id_t>& parents(term_id_t id)
         {
-          return _parents[id];
+          return _rep->parents[id];
         }
 
         void write(ostream& o) { 
           bool first = true;
-          for(unsigned int ti = 0; ti < terms.size(); ti++)
+          for(unsigned int ti = 0; ti < _rep->terms.size(); ti++)
           {
             if(first)
               first = false;
             else
               o << ", ";
-            term_t* p(terms[ti].p.get());
+            term_t* p(_rep->terms[ti].p.get());
             o << ti << " -> " << *p;
           }
         }
         
-        int size() { return terms.size(); }
+        int size() { return _rep->terms.size(); }
         
-        int depth(term_id t) { return _depth[t]; }
+        int depth(term_id t) { return _rep->depth[t]; }
+
+        // The table only grows: freed slots are reused but never
+        // released, and unreachable terms are not always freed. Return
+        // true if the table has doubled since the last compaction, so
+        // the cost of compacting is amortized.
+        bool needs_compaction() {
+          int sz = size();
+          int min_sz = min_compaction_size();
+          return min_sz > 0 && sz >= min_sz && sz >= 2*_rep->compacted_size;
+        }
+
+        // Tables with fewer terms are not compacted. 0 disables the
+        // compaction. Tests lower it to compact after most operations.
+        static int& min_compaction_size() {
+          static int sz = 64;
+          return sz;
+        }
+
+        // Keep only the terms reachable from roots and renumber them
+        // densely, preserving their relative order. Reference counts
+        // are recomputed assuming that each occurrence in roots is one
+        // reference. ren maps old ids to new ids of the kept terms.
+        void compact(const std::vector<term_id>& roots, term_map_t& ren)
+        {
+          std::vector<bool> live(size(), false);
+          std::vector<term_id> stack(roots);
+          while(!stack.empty())
+          {
+            term_id t = stack.back();
+            stack.pop_back();
+            if(live[t]) continue;
+            live[t] = true;
+            term_t* p(get_term_ptr(t));
+            if(p->kind() == TERM_APP)
+              for(term_id c : term_args(p))
+                stack.push_back(c);
+          }
+
+          std::shared_ptr<table_rep> out(new table_rep());
+          out->free_var = _rep->free_var;
+          for(unsigned int ti = 0; ti < live.size(); ti++)
+          {
+            if(!live[ti]) continue;
+            term_id id = out->terms.size();
+            ren[ti] = id;
+            term_ref_t ref(_rep->terms[ti]);
+            if(ref.p.get()->kind() == TERM_APP)
+            {
+              // Arguments are kept, but not necessarily before ti.
+              std::vector<term_id> args;
+              for(term_id c : term_args(ref.p.get()))
+              {
+                if(ren.find(c) == ren.end())
+                  args.push_back(-1 - c);
+                else
+                  args.push_back(ren[c]);
+              }
+              ref = term_ref_t(new ftor_term_t(term_ftor(ref.p.get()), args));
+            }
+            out->terms.push_back(ref);
+            out->ref_count.push_back(0);
+            out->parents.push_back(std::vector<term_id>());
+            out->depth.push_back(_rep->depth[ti]);
+          }
+          // Fix the forward references and rebuild the parents and
+          // the reference counts.
+          for(unsigned int id = 0; id < out->terms.size(); id++)
+          {
+            term_t* p(out->terms[id].p.get());
+            if(p->kind() == TERM_APP)
+            {
+              for(term_id& c : term_args(p))
+              {
+                if(c < 0)
+                  c = ren[-1 - c];
+                out->ref_count[c]++;
+                out->parents[c].push_back(id);
+              }
+            }
+            out->map[out->terms[id]] = id;
+          }
+          for(term_id r : roots)
+            out->ref_count[ren[r]]++;
+
+          out->compacted_size = out->terms.size();
+          _rep = out;
+        }
         
        protected:
         optional<term_id> find_term(term_ref_t ref)
         {
-          auto it = _map.find(ref);
-          if(it != _map.end())
+          auto it = _rep->map.find(ref);
+          if(it != _rep->map.end())
             return optional<term_id>(it->second);
           else
             return optional<term_id>();
@@ -469,62 +627,85 @@ namespace crab {
         // When we know that a germ doesn't already exist.
         term_id fresh_term(term_ref_t ref)
         {
-          if(free_terms.size() > 0)
+          table_rep& r(*_rep);
+          if(r.free_terms.size() > 0)
           {
-            term_id t = free_terms.back();
-            free_terms.pop_back();
-            terms[t] = ref;
-            _parents[t].clear();
-            _depth[t] = 0;
-            _ref_count[t] = 0;
+            term_id t = r.free_terms.back();
+            r.free_terms.pop_back();
+            r.terms[t] = ref;
+            r.parents[t].clear();
+            r.depth[t] = 0;
+            r.ref_count[t] = 0;
             return t;
           } else {
-            term_id t = terms.size();
-            terms.push_back(ref);
-            _ref_count.push_back(0);
-            _parents.push_back(std::vector<term_id>());
-            _depth.push_back(0);
+            term_id t = r.terms.size();
+            r.terms.push_back(ref);
+            r.ref_count.push_back(0);
+            r.parents.push_back(std::vector<term_id>());
+            r.depth.push_back(0);
             return t;
           }
         }
         
         term_id add_term(term_ref_t ref)
         {
-          auto it = _map.find(ref);
-          if(it != _map.end())
+          auto it = _rep->map.find(ref);
+          if(it != _rep->map.end())
           {
             return (*it).second;
           } else {
+            detach();
+            table_rep& r(*_rep);
             term_id id = fresh_term(ref);
-            _map[ref] = id;
+            r.map[ref] = id;
             if(ref.p.get()->kind() == TERM_APP)
             {
               unsigned int c_depth = 0;
               for(term_id c : term_args(ref.p.get()))
               {
-                assert(c < _ref_count.size());
-                _ref_count[c] += 1;
-                _parents[c].push_back(id);
-                c_depth = std::max(c_depth, _depth[c]);
+                assert(c < r.ref_count.size());
+                r.ref_count[c] += 1;
+                r.parents[c].push_back(id);
+                c_depth = std::max(c_depth, r.depth[c]);
               }
-              _depth[id] = 1+c_depth;
+              r.depth[id] = 1+c_depth;
             }
               /* Not true, as we're garbage collecting terms */
-//            assert(_map.size() == id+1);
+//            assert(r.map.size() == id+1);
             return id;
           }
         }
         
-        int free_var;
-        std::map<term_ref_t, term_id> _map;
-        std::vector<term_ref_t> terms;
-        std::vector< std::vector<term_id_t> > _parents;
-        std::vector<unsigned int> _ref_count;
-        std::vector<unsigned int> _depth;
-        std::vector<term_id> free_terms;
+        struct table_rep {
+          int free_var;
+          boost::unordered_map<term_ref_t, term_id> map;
+          std::vector<term_ref_t> terms;
+          std::vector< std::vector<term_id_t> > parents;
+          std::vector<unsigned int> ref_count;
+          std::vector<unsigned int> depth;
+          std::vector<term_id> free_terms;
+          // number of terms after the last compaction
+          int compacted_size;
+
+          table_rep(): free_var(0), compacted_size(0) { }
+        };
+
+        std::shared_ptr<table_rep> _rep;
+
+        // Copy the representation before modifying it if it is
+        // shared. Terms are immutable so they are shared anyway.
+        void detach()
+        {
+          if(!_rep.unique())
+            _rep.reset(new table_rep(*_rep));
+        }
       };
 
 
+      // Congruence closure over the terms of a term table. Term ids
+      // are dense so the union-find forest, the class members and the
+      // parents of each class are indexed by term id. A term that does
+      // not occur in any equation is a singleton class.
       template<typename TermTable>
       class congruence_closure_solver : public boost::noncopyable {
        
@@ -532,36 +713,99 @@ namespace crab {
        
         typedef typename TermTable::term_id_t term_id_t;
         typedef typename TermTable::term_t term_t;
-        typedef container::flat_set< term_id_t > term_set_t;
-        typedef std::map <term_id_t, term_set_t> ccpar_map_t;
-        typedef std::map <term_id_t, term_id_t> find_map_t;
         typedef std::pair<term_id_t, term_id_t> equation_t;
-        typedef std::map <term_id_t, std::vector<term_id_t> > member_map_t;
 
        private:
         TermTable* _ttbl;
-        ccpar_map_t _ccpar_map;
-        find_map_t _find_map;
+        // union-find: _find[t] == t iff t is a representative
+        std::vector<term_id_t> _find;
+        std::vector<unsigned> _rank;
+        // for each representative, the parents of all the class
+        // members and the members themselves. Both are filled when a
+        // merge first touches the class: until then _has_ccpar [t] is
+        // false and the class is {t}, whose parents are those of t in
+        // the table.
+        std::vector< std::vector<term_id_t> > _ccpar;
+        std::vector<char> _has_ccpar;
+        std::vector< std::vector<term_id_t> > _members;
         std::vector<equation_t> _eqs;
-        term_set_t _terms;
-        member_map_t _members;
+        std::vector<equation_t> _pending;
+        // the parents of the two classes being merged
+        std::vector<term_id_t> _ps1, _ps2;
+
+        // The table can grow while the solver is alive: terms that
+        // are not known yet are singleton classes. _find gives the
+        // number of terms known. The other vectors may be longer if
+        // the solver was used before: their entries are reused.
+        void ensure (term_id_t t) {
+          unsigned old_sz = _find.size ();
+          if ((unsigned) t < old_sz) return;
+          unsigned sz = std::max ((unsigned) t + 1, 
+                                  std::max ((unsigned) _ttbl->size (), 2*old_sz));
+          _find.resize (sz);
+          _rank.resize (sz, 0);
+          _has_ccpar.resize (sz);
+          if (_ccpar.size () < sz) {
+            _ccpar.resize (sz);
+            _members.resize (sz);
+          }
+          for (unsigned i = old_sz; i < sz; i++) {
+            _find [i] = i;
+            _rank [i] = 0;
+            _has_ccpar [i] = false;
+          }
+        }
+
+        // the parents of the class of representative r
+        std::vector<term_id_t>& ccpar (term_id_t r) {
+          if (!_has_ccpar [r]) {
+            if ((unsigned) r < (unsigned) _ttbl->size ())
+              _ccpar [r] = _ttbl->parents (r);
+            else
+              _ccpar [r].clear ();
+            _members [r].clear ();
+            _members [r].push_back (r);
+            _has_ccpar [r] = true;
+          }
+          return _ccpar [r];
+        }
+
+        // the members of the class of representative r
+        std::vector<term_id_t>& members (term_id_t r) {
+          ccpar (r);
+          return _members [r];
+        }
 
        public:
         
-        congruence_closure_solver (TermTable* ttbl): _ttbl (ttbl) { }
+        congruence_closure_solver (): _ttbl (nullptr) { }
+
+        congruence_closure_solver (TermTable* ttbl) { 
+          reset (ttbl);
+        }
+
+        // Start again from singleton classes over the terms of ttbl,
+        // keeping the memory of the previous run.
+        void reset (TermTable* ttbl) {
+          _ttbl = ttbl;
+          _find.clear ();
+          _rank.clear ();
+          _has_ccpar.clear ();
+          _eqs.clear ();
+          _pending.clear ();
+          if (_ttbl->size () > 0)
+            ensure (_ttbl->size () - 1);
+        }
         
         void operator+=(equation_t eq) {
-          _terms.insert (eq.first);
-          _terms.insert (eq.second);
           _eqs.push_back (eq);
         }
 
         void run () {
           for (auto eq: _eqs) {
-            term_id_t x = eq.first;
-            term_id_t y = eq.second;
-            merge (x, y);
+            merge (eq.first, eq.second);
           }
+          _eqs.clear ();
         }
 
         void run (vector<equation_t>& eqs) {
@@ -576,33 +820,23 @@ namespace crab {
 
         // return the members of an equivalence class of k
         std::vector<term_id_t>& get_members (term_id_t t) {
-          auto it = _members.find (t);
-          if (it != _members.end ())  {
-            return it->second;
-          } else {
-            t = find (t); // find representative of the t's class
-            std::vector<term_id_t> members;
-            for (auto x: _terms) {
-              if (find (x) == t /*find (t)*/)
-                members.push_back (x);
-            }
-            auto res = _members.insert(make_pair (t, members));
-            return (res.first)->second;
-          }
+          std::vector<term_id_t>& members = this->members (find (t));
+          std::sort (members.begin (), members.end ());
+          return members;
         }
 
         // return the size of the equivalence class of k
         size_t get_size (term_id_t t) {
-          return get_members (t).size ();
+          term_id_t r = find (t);
+          return _has_ccpar [r] ? _members [r].size () : 1;
         }
 
         void write (ostream&o) {
-          for (auto t1: _terms) {
+          for (unsigned t1 = 0; t1 < _find.size (); t1++) {
+            if (get_size (t1) == 1) continue;
             o << "t" << t1 << " --> {";
-            for (auto t2: _terms) {
-              if (find (t1) == find (t2))
-                o << "t" << t2 << ";";
-            }
+            for (auto t2: get_members (t1))
+              o << "t" << t2 << ";";
             o << "}\n";
           }
         }
@@ -613,53 +847,41 @@ namespace crab {
 
        private:
         
-        term_set_t& get_ccpar (term_id_t t) {
-          auto it = _ccpar_map.find (t);
-          if (it == _ccpar_map.end ()) {
-            auto res = _ccpar_map.insert (std::make_pair (t, term_set_t ()));
-            return (res.first)->second;
-          } else {
-            return it->second;
-          }
-        }
-        
-        // return the representative of i
+        // return the representative of t
         term_id_t find (term_id_t t) {
-          auto it = _find_map.find (t);
-          if (it == _find_map.end ()) {
-            _find_map.insert (make_pair (t,t));
-            return t;
-          }
-          
-          if (it->second == t) {
-            return it->second;
-          } else {
-            return find (it->second);
+          ensure (t);
+          term_id_t r = t;
+          while (_find [r] != r)
+            r = _find [r];
+          // path compression
+          while (_find [t] != r) {
+            term_id_t next = _find [t];
+            _find [t] = r;
+            t = next;
           }
-        }
-        
-        // i2 is the new representative
-        void do_union (term_id_t t1, term_id_t t2) {
-          _find_map [t1] = _find_map [t2];
-          
-          term_set_t& ccpar1 = get_ccpar (t1);
-          term_set_t& ccpar2 = get_ccpar (t2);
-          ccpar2.insert (ccpar1.begin(), ccpar1.end());
-
-          term_t* t1_ptr = _ttbl->get_term_ptr(t1);
-          assert (t1_ptr);
-          if (t1_ptr->kind () == TERM_APP) {
-            vector<term_id_t>& par1 = get_parents (t1);
-            ccpar2.insert (par1.begin (), par1.end());
-          }
-
-          term_t* t2_ptr = _ttbl->get_term_ptr(t2);
-          assert (t2_ptr);
-          if (t2_ptr->kind () == TERM_APP) {
-            vector<term_id_t>& par2 = get_parents (t2);
-            ccpar2.insert (par2.begin (), par2.end());
-          }
-          ccpar1.clear ();
+          return r;
+        }
+        
+        // pre: r1 and r2 are representatives. 
+        // Return the new representative.
+        term_id_t do_union (term_id_t r1, term_id_t r2) {
+          if (_rank [r1] > _rank [r2])
+            std::swap (r1, r2);
+          else if (_rank [r1] == _rank [r2])
+            _rank [r2]++;
+          // r2 is the new representative
+          _find [r1] = r2;
+          ccpar (r1);
+          ccpar (r2);
+          if (_ccpar [r1].size () > _ccpar [r2].size ())
+            std::swap (_ccpar [r1], _ccpar [r2]);
+          _ccpar [r2].insert (_ccpar [r2].end (), _ccpar [r1].begin (), _ccpar [r1].end ());
+          _ccpar [r1].clear ();
+          if (_members [r1].size () > _members [r2].size ())
+            std::swap (_members [r1], _members [r2]);
+          _members [r2].insert (_members [r2].end (), _members [r1].begin (), _members [r1].end ());
+          _members [r1].clear ();
+          return r2;
         }
        
         // pre: t1 and t2 are TERM_APP
@@ -688,21 +910,63 @@ namespace crab {
         }
         
         void merge (term_id_t t1, term_id_t t2) {
-
-          if (find (t1) == find (t2)) return;
-
-          do_union (t1, t2);
-          auto &ps1 = get_ccpar (t1);
-          auto &ps2 = get_ccpar (t2);
-          for (auto p1 : ps1) {
-            for (auto p2 : ps2) {
-              if ((find (p1) != find (p2)) && is_congruent (p1,p2) )
-                merge (p1,p2);
+          _pending.push_back (std::make_pair (t1, t2));
+          while (!_pending.empty ()) {
+            equation_t eq = _pending.back ();
+            _pending.pop_back ();
+            term_id_t r1 = find (eq.first);
+            term_id_t r2 = find (eq.second);
+            if (r1 == r2) continue;
+
+            _ps1 = ccpar (r1);
+            _ps2 = ccpar (r2);
+            do_union (r1, r2);
+            for (auto p1 : _ps1) {
+              for (auto p2 : _ps2) {
+                if ((find (p1) != find (p2)) && is_congruent (p1,p2))
+                  _pending.push_back (std::make_pair (p1, p2));
+              }
             }
           }
         }
       }; // end congruence_closure_solver
 
+      // A congruence closure solver taken from a pool of the current
+      // thread and given back on destruction, so that operations
+      // reuse the memory of the previous solvers instead of
+      // allocating it for the whole table each time. Nested scopes
+      // get different solvers.
+      template<typename TermTable>
+      class scoped_solver : public boost::noncopyable {
+        typedef congruence_closure_solver<TermTable> solver_t;
+        typedef std::vector<std::unique_ptr<solver_t> > pool_t;
+
+        std::unique_ptr<solver_t> _solver;
+
+        static pool_t& pool () {
+          static thread_local pool_t p;
+          return p;
+        }
+
+       public:
+        scoped_solver (TermTable* ttbl) {
+          pool_t& p = pool ();
+          if (p.empty ()) {
+            _solver.reset (new solver_t (ttbl));
+          } else {
+            _solver = std::move (p.back ());
+            p.pop_back ();
+            _solver->reset (ttbl);
+          }
+        }
+
+        ~scoped_solver () {
+          pool ().push_back (std::move (_solver));
+        }
+
+        solver_t& operator* () { return *_solver; }
+      };
+
    } //end namespace term
  } // end namepsace domains
 } // end namespace crab
@@ -303,6 +303,56 @@ namespace crab {
          }
        }
 
+       // Once the term table has grown enough, keep only the terms
+       // reachable from the variables and renumber them, so the table
+       // stays proportional to the current invariant.
+       void compact_terms()
+       {
+         if(!_ttbl.needs_compaction())
+           return;
+
+         std::vector<term_id_t> roots;
+         for(auto p : _var_map)
+           roots.push_back(p.second);
+         typename ttbl_t::term_map_t ren;
+         _ttbl.compact(roots, ren);
+
+         var_map_t out_vmap;
+         for(auto p : _var_map)
+           out_vmap.insert(std::make_pair(p.first, ren[p.second]));
+         term_map_t out_map;
+         std::vector<dom_varname_t> dropped;
+         for(auto p : _term_map)
+         {
+           auto it = ren.find(p.first);
+           if(it != ren.end())
+             out_map.insert(std::make_pair((*it).second, p.second));
+           else
+             dropped.push_back(p.second.name());
+         }
+         // The dropped terms are not reachable from any variable but
+         // the base domain may still relate them to reachable ones,
+         // e.g., x <= t and t <= y. Normalizing first makes the
+         // constraints they imply between the kept terms explicit so
+         // forgetting them does not lose those.
+         if(!dropped.empty())
+         {
+           domain_traits<dom_t>::normalize(_impl);
+           domain_traits<dom_t>::forget(_impl, dropped.begin(), dropped.end());
+         }
+         term_set_t out_changed;
+         for(term_id_t t : changed_terms)
+         {
+           auto it = ren.find(t);
+           if(it != ren.end())
+             out_changed.insert((*it).second);
+         }
+         std::swap(_var_map, out_vmap);
+         std::swap(_term_map, out_map);
+         std::swap(changed_terms, out_changed);
+         check_terms();
+       }
+
        void rebind_var(variable_t& x, term_id_t tx)
        {
          _ttbl.add_ref(tx);
@@ -324,10 +374,12 @@ namespace crab {
        {
          dom_number dom_n(n);
          optional<term_id_t> opt_n(_ttbl.find_const(dom_n));
-         if(opt_n) {
+         // The term may be left in the table by a meet without its
+         // base-domain variable: its value must be given again.
+         if(opt_n && _term_map.find(*opt_n) != _term_map.end()) {
            return *opt_n;
          } else {
-           term_id_t term_n(_ttbl.make_const(dom_n));
+           term_id_t term_n(opt_n ? *opt_n : _ttbl.make_const(dom_n));
            dom_var_t v = domvar_of_term(term_n);
 
            dom_linexp_t exp(n);
@@ -1000,7 +1052,8 @@ namespace crab {
            }
 
            // compute equivalence classes
-           term::congruence_closure_solver<ttbl_t> solver (&out_ttbl);
+           term::scoped_solver<ttbl_t> scope (&out_ttbl);
+           term::congruence_closure_solver<ttbl_t>& solver (*scope);
            solver.run (eqs);
 
            std::vector<int> stack;
@@ -1122,6 +1175,7 @@ namespace crab {
            rebind_var(x, tx);
 
            check_terms();
+           compact_terms();
 
            CRAB_LOG("term", 
                     crab::outs() << "*** Assign " << x_name << ":=" << e << ":" << *this << "\n");
@@ -1142,6 +1196,7 @@ namespace crab {
            rebind_var(y, tx);
 
            check_terms();
+           compact_terms();
          }
        }
 
@@ -1183,6 +1238,7 @@ namespace crab {
            rebind_var(vx, tx);
          }
          check_terms();
+         compact_terms();
          CRAB_LOG("term", 
                   crab::outs() << "*** " << x << ":=" <<  y <<  " " <<  op <<  " "
                   <<  z <<  ":" <<  *this << "\n");
@@ -1198,6 +1254,7 @@ namespace crab {
            rebind_var(vx, tx);
          }
          check_terms();
+         compact_terms();
          CRAB_LOG("term",
                   crab::outs() << "*** " << x << ":=" << y << " " << op << " " << k <<  ":" << *this << "\n");
          return;
@@ -1241,7 +1298,8 @@ namespace crab {
              if (tx == ty) return; 
              
              // congruence closure to compute equivalence classes
-             term::congruence_closure_solver<ttbl_t> solver (&_ttbl);
+             term::scoped_solver<ttbl_t> scope (&_ttbl);
+             term::congruence_closure_solver<ttbl_t>& solver (*scope);
              vector<pair<term_id_t, term_id_t> > eqs = { make_pair (tx,ty) };
              solver.run (eqs);
              
@@ -1408,6 +1466,7 @@ namespace crab {
            rebind_var(vx, tx);
          }
          check_terms();
+         compact_terms();
          CRAB_LOG("term", 
                   crab::outs() << "*** " << x << ":=" << y << " " << op 
                   << " " << z << ":" << *this << "\n");
@@ -1423,6 +1482,7 @@ namespace crab {
          }
 
          check_terms();
+         compact_terms();
          CRAB_LOG("term", 
                   crab::outs() << "*** " << x << ":=" << y << " "<< op << " " << k 
                   << ":" << *this << "\n");
@@ -1441,6 +1501,7 @@ namespace crab {
          }
 
          check_terms();
+         compact_terms();
          CRAB_LOG("term", 
                   crab::outs() << "*** "<< x<< ":="<< y<< " "<< op<< " "<< z<< ":"<< *this << "\n");
        }
@@ -1455,6 +1516,7 @@ namespace crab {
          }
 
          check_terms();
+         compact_terms();
          CRAB_LOG("term",
                   crab::outs() << "*** "<< x<< ":="<< y<< " "<< op<< " "<< k<< ":"<< *this << "\n");
          return;
@@ -0,0 +1,699 @@
+/*******************************************************************************
+ * Variable packing: run an expensive (relational) numerical domain
+ * on small groups of variables (packs) rather than on all of them.
+ *
+ * Each pack has its own instance of the domain and the variables
+ * that are not in any pack are kept in intervals. Constraints and
+ * assignments whose variables span several packs are split: each
+ * pack gets its own part with the rest of the expression
+ * approximated by intervals. The packs are computed before the
+ * analysis (e.g., by crab::analyzer::VarPacking from a Cfg).
+ ******************************************************************************/
+
+#ifndef VAR_PACKING_DOMAIN_HPP
+#define VAR_PACKING_DOMAIN_HPP
+
+#include <crab/common/types.hpp>
+#include <crab/common/debug.hpp>
+#include <crab/common/stats.hpp>
+#include <crab/domains/numerical_domains_api.hpp>
+#include <crab/domains/bitwise_operators_api.hpp>
+#include <crab/domains/division_operators_api.hpp>
+#include <crab/domains/intervals.hpp>
+#include <crab/domains/domain_traits.hpp>
+
+#include <boost/optional.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/unordered_map.hpp>
+#include <map>
+#include <vector>
+
+using namespace boost;
+using namespace ikos;
+
+namespace crab {
+
+   namespace domains {
+
+      //! An assignment of variables to packs. A variable belongs to
+      //  at most one pack.
+      template<typename VariableName>
+      class var_packs {
+       public:
+        typedef std::vector<VariableName> pack_t;
+
+       private:
+        std::vector<pack_t> m_packs;
+        boost::unordered_map<VariableName, unsigned> m_pack_of;
+
+       public:
+        var_packs () { }
+
+        // Return the id of the new pack
+        unsigned add_pack (const pack_t& vars) {
+          unsigned id = m_packs.size ();
+          for (auto const& v: vars) {
+            if (!m_pack_of.insert (std::make_pair (v, id)).second)
+              CRAB_ERROR ("variable ", v, " is already in a pack");
+          }
+          m_packs.push_back (vars);
+          return id;
+        }
+
+        boost::optional<unsigned> pack_of (const VariableName& v) const {
+          auto it = m_pack_of.find (v);
+          if (it != m_pack_of.end ())
+            return it->second;
+          return boost::optional<unsigned> ();
+        }
+
+        const pack_t& pack (unsigned id) const { return m_packs[id]; }
+
+        std::size_t size () const { return m_packs.size (); }
+
+        void write (std::ostream& o) const {
+          o << "{";
+          for (unsigned i=0; i < m_packs.size (); i++) {
+            if (i > 0) o << ",";
+            o << "{";
+            for (unsigned j=0; j < m_packs[i].size (); j++) {
+              if (j > 0) o << ",";
+              o << m_packs[i][j];
+            }
+            o << "}";
+          }
+          o << "}";
+        }
+      };
+
+      template<typename VariableName>
+      inline std::ostream& operator<<(std::ostream& o, const var_packs<VariableName>& p) {
+        p.write (o);
+        return o;
+      }
+
+      //! NumDomain on each pack, intervals on the other variables.
+      //  The packs are part of the value (see top (packs)). Without
+      //  packs all the variables are in a single instance of
+      //  NumDomain.
+      template<typename NumDomain>
+      class var_packing_domain:
+         public ikos::writeable,
+         public numerical_domain<typename NumDomain::number_t,
+                                 typename NumDomain::varname_t>,
+         public bitwise_operators<typename NumDomain::number_t,
+                                  typename NumDomain::varname_t>,
+         public division_operators<typename NumDomain::number_t,
+                                   typename NumDomain::varname_t> {
+
+       public:
+
+        typedef typename NumDomain::number_t Number;
+        typedef typename NumDomain::varname_t VariableName;
+
+        using typename numerical_domain< Number, VariableName>::linear_expression_t;
+        using typename numerical_domain< Number, VariableName>::linear_constraint_t;
+        using typename numerical_domain< Number, VariableName>::linear_constraint_system_t;
+        using typename numerical_domain< Number, VariableName>::variable_t;
+        using typename numerical_domain< Number, VariableName>::number_t;
+        using typename numerical_domain< Number, VariableName>::varname_t;
+
+        typedef var_packing_domain <NumDomain> var_packing_domain_t;
+        typedef interval <Number> interval_t;
+        typedef interval_domain <Number, VariableName> interval_domain_t;
+        typedef var_packs<VariableName> var_packs_t;
+        typedef boost::shared_ptr<const var_packs_t> var_packs_ptr;
+
+       private:
+
+        // owner of the variables that are not in any pack
+        static const int NO_PACK = -1;
+        // owner of an expression whose variables have different owners
+        static const int MIXED = -2;
+        // packs that are not in the map are top
+        typedef std::map<int, NumDomain> pack_map_t;
+
+        bool _is_bottom;
+        var_packs_ptr _var_packs;
+        pack_map_t _packs;
+        interval_domain_t _intervals;
+
+        var_packing_domain (bool is_bot, var_packs_ptr packs):
+            ikos::writeable (), _is_bottom (is_bot), _var_packs (packs),
+            _intervals (interval_domain_t::top ()) { }
+
+        int owner (const VariableName& v) const {
+          if (!_var_packs) return 0;
+          if (auto id = _var_packs->pack_of (v))
+            return *id;
+          return NO_PACK;
+        }
+
+        // Return MIXED if the variables of e have different owners
+        // and NO_PACK if e has no variables
+        int owner (const linear_expression_t& e) const {
+          boost::optional<int> res;
+          for (auto const& p: e) {
+            int o = owner (p.second.name ());
+            if (res && *res != o) return MIXED;
+            res = o;
+          }
+          return (res ? *res : NO_PACK);
+        }
+
+        NumDomain& get_pack (int id) {
+          auto it = _packs.find (id);
+          if (it == _packs.end ())
+            it = _packs.insert (std::make_pair (id, NumDomain::top ())).first;
+          return it->second;
+        }
+
+        // The values made by top () and bottom () have no packs: they
+        // take the packs of the values they are combined with.
+        void unify_packs (var_packing_domain_t& o) {
+          if (_var_packs == o._var_packs) return;
+          if (!_var_packs && (is_bottom () || is_top ()))
+            _var_packs = o._var_packs;
+          else if (!o._var_packs && (o.is_bottom () || o.is_top ()))
+            o._var_packs = _var_packs;
+          else
+            CRAB_ERROR ("combining values with different variable packs");
+        }
+
+        void set_to_bottom () {
+          _is_bottom = true;
+          _packs.clear ();
+          _intervals = interval_domain_t::top ();
+        }
+
+        // Tell whether some component became bottom
+        void reduce (int id) {
+          if (id == NO_PACK) {
+            if (_intervals.is_bottom ()) set_to_bottom ();
+          } else {
+            auto it = _packs.find (id);
+            if (it != _packs.end () && it->second.is_bottom ()) set_to_bottom ();
+          }
+        }
+
+        // Add e_id + rest op 0 to the component id, where rest is
+        // approximated by the interval r.
+        void add_split_constraint (int id, linear_expression_t e_id, interval_t r,
+                                   typename linear_constraint_t::kind_t kind) {
+          boost::optional<Number> lb = r.lb ().number ();
+          boost::optional<Number> ub = r.ub ().number ();
+          linear_constraint_system_t csts;
+          switch (kind) {
+            case linear_constraint_t::INEQUALITY:
+              // e_id <= -rest <= -lb
+              if (lb) csts += linear_constraint_t (e_id + *lb, linear_constraint_t::INEQUALITY);
+              break;
+            case linear_constraint_t::EQUALITY:
+              // -ub <= e_id <= -lb
+              if (lb) csts += linear_constraint_t (e_id + *lb, linear_constraint_t::INEQUALITY);
+              if (ub) csts += linear_constraint_t (-(e_id + *ub), linear_constraint_t::INEQUALITY);
+              break;
+            default: ;
+          }
+          if (csts.size () == 0) return;
+          if (id == NO_PACK)
+            _intervals += csts;
+          else
+            get_pack (id) += csts;
+          reduce (id);
+        }
+
+        void add_constraint (linear_constraint_t cst) {
+          if (cst.is_tautology ()) return;
+          if (cst.is_contradiction ()) {
+            set_to_bottom ();
+            return;
+          }
+
+          // group the terms by owner
+          std::map<int, linear_expression_t> parts;
+          for (auto const& p: cst) {
+            int o = owner (p.second.name ());
+            parts[o] = parts[o] + p.first * p.second;
+          }
+
+          if (parts.size () == 1) {
+            int id = parts.begin ()->first;
+            if (id == NO_PACK)
+              _intervals += cst;
+            else
+              get_pack (id) += cst;
+            reduce (id);
+            return;
+          }
+
+          crab::CrabStats::count ("Domain.count.packing.split");
+          for (auto const& p: parts) {
+            if (_is_bottom) return;
+            // rest of the constraint evaluated in intervals
+            interval_t rest (cst.expression ().constant ());
+            for (auto const& q: parts) {
+              if (q.first != p.first) rest = rest + eval (q.second);
+            }
+            add_split_constraint (p.first, p.second, rest, cst.kind ());
+          }
+        }
+
+        interval_t eval (const linear_expression_t& e) {
+          interval_t r (e.constant ());
+          for (auto const& p: e)
+            r = r + interval_t (p.first) * operator[] (p.second.name ());
+          return r;
+        }
+
+        template<typename Range, typename Op>
+        void apply_split (VariableName x, const Range& uses, Op op) {
+          // evaluate the operation on intervals
+          interval_domain_t tmp = interval_domain_t::top ();
+          for (auto const& v: uses) tmp.set (v, operator[] (v));
+          op (tmp);
+          set (x, tmp[x]);
+        }
+
+        template<typename Op>
+        void apply_routed (VariableName x, VariableName y, Op op) {
+          if (_is_bottom) return;
+          int id = owner (x);
+          if (id == owner (y)) {
+            if (id == NO_PACK) op (_intervals); else op (get_pack (id));
+            reduce (id);
+          } else {
+            crab::CrabStats::count ("Domain.count.packing.split");
+            std::vector<VariableName> uses { y };
+            apply_split (x, uses, op);
+          }
+        }
+
+        template<typename Op>
+        void apply_routed (VariableName x, VariableName y, VariableName z, Op op) {
+          if (_is_bottom) return;
+          int id = owner (x);
+          if (id == owner (y) && id == owner (z)) {
+            if (id == NO_PACK) op (_intervals); else op (get_pack (id));
+            reduce (id);
+          } else {
+            crab::CrabStats::count ("Domain.count.packing.split");
+            std::vector<VariableName> uses { y, z };
+            apply_split (x, uses, op);
+          }
+        }
+
+        template<typename Op>
+        void apply_routed (VariableName x, Op op) {
+          if (_is_bottom) return;
+          int id = owner (x);
+          if (id == NO_PACK) op (_intervals); else op (get_pack (id));
+          reduce (id);
+        }
+
+       public:
+
+        var_packing_domain ():
+            ikos::writeable (), _is_bottom (false),
+            _intervals (interval_domain_t::top ()) { }
+
+        static var_packing_domain_t top () {
+          return var_packing_domain_t (false, var_packs_ptr ());
+        }
+
+        //! Top over the given packs. The values computed from it keep
+        //! the packs.
+        static var_packing_domain_t top (var_packs_ptr packs) {
+          return var_packing_domain_t (false, packs);
+        }
+
+        static var_packing_domain_t bottom () {
+          return var_packing_domain_t (true, var_packs_ptr ());
+        }
+
+        var_packs_ptr get_packs () const {
+          return _var_packs;
+        }
+
+        var_packing_domain (const var_packing_domain_t& o):
+            ikos::writeable (), _is_bottom (o._is_bottom), _var_packs (o._var_packs),
+            _packs (o._packs), _intervals (o._intervals) {
+          crab::CrabStats::count ("Domain.count.copy");
+          crab::ScopedCrabStats __st__("Domain.copy");
+        }
+
+        var_packing_domain_t& operator=(const var_packing_domain_t& o) {
+          crab::CrabStats::count ("Domain.count.copy");
+          crab::ScopedCrabStats __st__("Domain.copy");
+          if (this != &o) {
+            _is_bottom = o._is_bottom;
+            _var_packs = o._var_packs;
+            _packs = o._packs;
+            _intervals = o._intervals;
+          }
+          return *this;
+        }
+
+        bool is_bottom () {
+          return _is_bottom;
+        }
+
+        bool is_top () {
+          if (_is_bottom || !_intervals.is_top ()) return false;
+          for (auto& p: _packs)
+            if (!p.second.is_top ()) return false;
+          return true;
+        }
+
+        bool operator<= (var_packing_domain_t o) {
+          unify_packs (o);
+          if (is_bottom ()) return true;
+          if (o.is_bottom ()) return false;
+          if (!(_intervals <= o._intervals)) return false;
+          for (auto& p: o._packs) {
+            auto it = _packs.find (p.first);
+            NumDomain x = (it == _packs.end () ? NumDomain::top () : it->second);
+            if (!(x <= p.second)) return false;
+          }
+          return true;
+        }
+
+        void operator|= (var_packing_domain_t o) {
+          *this = *this | o;
+        }
+
+        // join and widening keep the packs that are in both operands
+        var_packing_domain_t operator| (var_packing_domain_t o) {
+          unify_packs (o);
+          if (is_bottom ()) return o;
+          if (o.is_bottom ()) return *this;
+          var_packing_domain_t res (false, _var_packs);
+          res._intervals = _intervals | o._intervals;
+          for (auto& p: _packs) {
+            auto it = o._packs.find (p.first);
+            if (it != o._packs.end ())
+              res._packs.insert (std::make_pair (p.first, p.second | it->second));
+          }
+          return res;
+        }
+
+        var_packing_domain_t operator|| (var_packing_domain_t o) {
+          unify_packs (o);
+          if (is_bottom ()) return o;
+          if (o.is_bottom ()) return *this;
+          var_packing_domain_t res (false, _var_packs);
+          res._intervals = _intervals || o._intervals;
+          for (auto& p: _packs) {
+            auto it = o._packs.find (p.first);
+            if (it != o._packs.end ())
+              res._packs.insert (std::make_pair (p.first, p.second || it->second));
+          }
+          return res;
+        }
+
+        template<typename Thresholds>
+        var_packing_domain_t widening_thresholds (var_packing_domain_t o,
+                                                  const Thresholds &ts) {
+          unify_packs (o);
+          if (is_bottom ()) return o;
+          if (o.is_bottom ()) return *this;
+          var_packing_domain_t res (false, _var_packs);
+          res._intervals = _intervals.widening_thresholds (o._intervals, ts);
+          for (auto& p: _packs) {
+            auto it = o._packs.find (p.first);
+            if (it != o._packs.end ())
+              res._packs.insert (std::make_pair (p.first,
+                                                 p.second.widening_thresholds (it->second, ts)));
+          }
+          return res;
+        }
+
+        // meet and narrowing keep the packs that are in either operand
+        var_packing_domain_t operator& (var_packing_domain_t o) {
+          unify_packs (o);
+          if (is_bottom () || o.is_bottom ())
+            return var_packing_domain_t (true, _var_packs);
+          var_packing_domain_t res (*this);
+          res._intervals = _intervals & o._intervals;
+          res.reduce (NO_PACK);
+          for (auto& p: o._packs) {
+            if (res._is_bottom) break;
+            auto it = res._packs.find (p.first);
+            if (it == res._packs.end ())
+              res._packs.insert (p);
+            else
+              it->second = it->second & p.second;
+            res.reduce (p.first);
+          }
+          return res;
+        }
+
+        var_packing_domain_t operator&& (var_packing_domain_t o) {
+          unify_packs (o);
+          if (is_bottom () || o.is_bottom ())
+            return var_packing_domain_t (true, _var_packs);
+          var_packing_domain_t res (*this);
+          res._intervals = _intervals && o._intervals;
+          res.reduce (NO_PACK);
+          for (auto& p: o._packs) {
+            if (res._is_bottom) break;
+            auto it = res._packs.find (p.first);
+            if (it == res._packs.end ())
+              res._packs.insert (p);
+            else
+              it->second = it->second && p.second;
+            res.reduce (p.first);
+          }
+          return res;
+        }
+
+        void operator-= (VariableName v) {
+          if (_is_bottom) return;
+          int id = owner (v);
+          if (id == NO_PACK) {
+            _intervals -= v;
+          } else {
+            auto it = _packs.find (id);
+            if (it != _packs.end ()) it->second -= v;
+          }
+        }
+
+        // remove all variables [begin,...end)
+        template<typename Iterator>
+        void forget (Iterator begin, Iterator end) {
+          if (_is_bottom) return;
+          std::map<int, std::vector<VariableName> > vars;
+          for (auto v: boost::make_iterator_range (begin, end))
+            vars[owner (v)].push_back (v);
+          for (auto& p: vars) {
+            if (p.first == NO_PACK) {
+              domain_traits<interval_domain_t>::forget (_intervals, p.second.begin (), p.second.end ());
+            } else {
+              auto it = _packs.find (p.first);
+              if (it != _packs.end ())
+                domain_traits<NumDomain>::forget (it->second, p.second.begin (), p.second.end ());
+            }
+          }
+        }
+
+        // dual of forget: remove all variables except [begin,...end)
+        template<typename Iterator>
+        void project (Iterator begin, Iterator end) {
+          if (_is_bottom) return;
+          std::map<int, std::vector<VariableName> > vars;
+          for (auto v: boost::make_iterator_range (begin, end))
+            vars[owner (v)].push_back (v);
+          std::vector<VariableName>& ivars = vars[NO_PACK];
+          domain_traits<interval_domain_t>::project (_intervals, ivars.begin (), ivars.end ());
+          for (auto it = _packs.begin (); it != _packs.end (); ) {
+            auto vit = vars.find (it->first);
+            if (vit == vars.end ()) {
+              it = _packs.erase (it);
+            } else {
+              domain_traits<NumDomain>::project (it->second,
+                                                 vit->second.begin (), vit->second.end ());
+              ++it;
+            }
+          }
+        }
+
+        void operator+= (linear_constraint_system_t csts) {
+          for (auto cst: csts) {
+            if (_is_bottom) return;
+            add_constraint (cst);
+          }
+        }
+
+        void set (VariableName x, interval_t i) {
+          if (_is_bottom) return;
+          if (i.is_bottom ()) {
+            set_to_bottom ();
+            return;
+          }
+          int id = owner (x);
+          if (id == NO_PACK) {
+            _intervals.set (x, i);
+          } else {
+            get_pack (id).set (x, i);
+            reduce (id);
+          }
+        }
+
+        interval_t operator[] (VariableName x) {
+          if (_is_bottom) return interval_t::bottom ();
+          int id = owner (x);
+          if (id == NO_PACK) return _intervals[x];
+          auto it = _packs.find (id);
+          if (it == _packs.end ()) return interval_t::top ();
+          return it->second[x];
+        }
+
+        void assign (VariableName x, linear_expression_t e) {
+          if (_is_bottom) return;
+          int id = owner (x);
+          int e_owner = (e.is_constant () ? id : owner (e));
+          if (e_owner == id) {
+            if (id == NO_PACK) _intervals.assign (x, e); else get_pack (id).assign (x, e);
+            reduce (id);
+          } else {
+            crab::CrabStats::count ("Domain.count.packing.split");
+            // keep the part of e in x's pack relational
+            linear_expression_t e_id (Number (0)), e_rest (e.constant ());
+            for (auto const& p: e) {
+              if (owner (p.second.name ()) == id)
+                e_id = e_id + p.first * p.second;
+              else
+                e_rest = e_rest + p.first * p.second;
+            }
+            interval_t rest = eval (e_rest);
+            if (e_id.is_constant () || !rest.singleton ()) {
+              set (x, eval (e));
+            } else {
+              e_id = e_id + *rest.singleton ();
+              if (id == NO_PACK) _intervals.assign (x, e_id); else get_pack (id).assign (x, e_id);
+              reduce (id);
+            }
+          }
+          CRAB_LOG("packing",
+                   crab::outs() << "apply "<< x<< " := "<< e<< *this <<"\n";);
+        }
+
+        void apply (operation_t op, VariableName x, VariableName y, Number k) {
+          apply_routed (x, y, [&](numerical_domain<Number,VariableName>& inv)
+                        { inv.apply (op, x, y, k); });
+          CRAB_LOG("packing",
+                   crab::outs() << "apply "<< x<< " := "<< y<< " "<< op<< " "<< k<< *this <<"\n";);
+        }
+
+        void apply (operation_t op, VariableName x, VariableName y, VariableName z) {
+          apply_routed (x, y, z, [&](numerical_domain<Number,VariableName>& inv)
+                        { inv.apply (op, x, y, z); });
+          CRAB_LOG("packing",
+                   crab::outs() << "apply "<< x<< " := "<< y<< " "<< op<< " "<< z<< *this <<"\n";);
+        }
+
+        // bitwise_operators_api
+        void apply (conv_operation_t op, VariableName x, VariableName y, unsigned width) {
+          apply_routed (x, y, [&](bitwise_operators<Number,VariableName>& inv)
+                        { inv.apply (op, x, y, width); });
+        }
+
+        void apply (conv_operation_t op, VariableName x, Number k, unsigned width) {
+          apply_routed (x, [&](bitwise_operators<Number,VariableName>& inv)
+                        { inv.apply (op, x, k, width); });
+        }
+
+        void apply (bitwise_operation_t op, VariableName x, VariableName y, VariableName z) {
+          apply_routed (x, y, z, [&](bitwise_operators<Number,VariableName>& inv)
+                        { inv.apply (op, x, y, z); });
+        }
+
+        void apply (bitwise_operation_t op, VariableName x, VariableName y, Number k) {
+          apply_routed (x, y, [&](bitwise_operators<Number,VariableName>& inv)
+                        { inv.apply (op, x, y, k); });
+        }
+
+        // division_operators_api
+        void apply (div_operation_t op, VariableName x, VariableName y, VariableName z) {
+          apply_routed (x, y, z, [&](division_operators<Number,VariableName>& inv)
+                        { inv.apply (op, x, y, z); });
+        }
+
+        void apply (div_operation_t op, VariableName x, VariableName y, Number k) {
+          apply_routed (x, y, [&](division_operators<Number,VariableName>& inv)
+                        { inv.apply (op, x, y, k); });
+        }
+
+        void expand (VariableName x, VariableName new_x) {
+          if (_is_bottom) return;
+          int id = owner (x);
+          if (id != NO_PACK && id == owner (new_x)) {
+            domain_traits<NumDomain>::expand (get_pack (id), x, new_x);
+          } else {
+            set (new_x, operator[] (x));
+          }
+        }
+
+        void normalize () {
+          for (auto& p: _packs)
+            domain_traits<NumDomain>::normalize (p.second);
+        }
+
+        linear_constraint_system_t to_linear_constraint_system () {
+          linear_constraint_system_t csts;
+          if (_is_bottom) {
+            csts += linear_constraint_t::get_false ();
+            return csts;
+          }
+          csts += _intervals.to_linear_constraint_system ();
+          for (auto& p: _packs)
+            csts += p.second.to_linear_constraint_system ();
+          return csts;
+        }
+
+        void write (ostream& o) {
+          if (is_bottom ()) {
+            o << "_|_";
+          } else if (is_top ()) {
+            o << "{}";
+          } else {
+            linear_constraint_system_t csts = to_linear_constraint_system ();
+            o << csts;
+          }
+        }
+
+        static std::string getDomainName () {
+          return "VarPacking(" + NumDomain::getDomainName () + ")";
+        }
+
+      }; // end var_packing_domain
+
+     template<typename NumDomain>
+     class domain_traits <var_packing_domain<NumDomain> > {
+      public:
+
+       typedef var_packing_domain<NumDomain> var_packing_domain_t;
+       typedef typename NumDomain::varname_t VariableName;
+
+       static void normalize (var_packing_domain_t& inv) {
+         inv.normalize ();
+       }
+
+       template <typename Iter>
+       static void forget (var_packing_domain_t& inv, Iter it, Iter end) {
+         inv.forget (it, end);
+       }
+
+       template <typename Iter >
+       static void project (var_packing_domain_t& inv, Iter it, Iter end) {
+         inv.project (it, end);
+       }
+
+       static void expand (var_packing_domain_t& inv, VariableName x, VariableName new_x) {
+         inv.expand (x, new_x);
+       }
+     };
+
+   } // namespace domains
+}// namespace crab
+#endif
@@ -13,17 +13,6 @@
 #include <crab/domains/dbm/util/Heap.h>
 
 // #define NDEBUG // disable assert's
-#define VAR_MAX ((short) ((1<<(8*sizeof(short)-1))-1))
-
-// These are datastructures used by consistency checking and
-// transitive closure. They are global for efficiency.
-static int scratch_sz = 0;
-static val_t* _gamma = NULL;
-static val_t* pi_prime = NULL;
-static val_t* fwd_dist = NULL;
-
-// Always initialized to 0.
-static char* var_flags = NULL;
 
 // Comparator for use with min-heaps.
 typedef struct DistComp {
@@ -39,43 +28,80 @@ public:
 
 static void verify_potentials(dbm abs);
 
+// Sizes and offsets are computed in size_t: with 32-bit vertex ids
+// sz*sz does not fit in an int beyond 46340 vertices.
+static inline size_t mtx_idx(dbm abs, int i, int j)
+{
+  return ((size_t) i)*abs->sz + j;
+}
+
 adjlist* src_list(dbm abs, int i)
 {
-  return (adjlist*) (&(abs->srcs[(2 + abs->sz)*i]));
+  return (adjlist*) (&(abs->srcs[(2 + (size_t) abs->sz)*i]));
 }
 adjlist* dest_list(dbm abs, int j)
 {
-  return (adjlist*) (&(abs->dests[(2 + abs->sz)*j]));
+  return (adjlist*) (&(abs->dests[(2 + (size_t) abs->sz)*j]));
 }
 
 static val_t var_lb(dbm abs, int x);
 static val_t var_ub(dbm abs, int x);
 
-void update_scratch(int sz)
+///
+// Scratch contexts
+///
+
+dbm_ctx dbm_ctx_alloc()
+{
+  dbm_ctx_data* ctx = new dbm_ctx_data;
+  ctx->sz = 0;
+  ctx->gamma = NULL;
+  ctx->pi_prime = NULL;
+  ctx->fwd_dist = NULL;
+  ctx->var_flags = NULL;
+  return ctx;
+}
+
+void dbm_ctx_dealloc(dbm_ctx ctx)
 {
-  if(scratch_sz < sz)
+  if(!ctx)
+    return;
+
+  free(ctx->gamma);
+  free(ctx->pi_prime);
+  free(ctx->fwd_dist);
+  free(ctx->var_flags);
+
+  delete ctx;
+}
+
+// Ensure there's enough scratch space for a dbm of size sz.
+static void update_scratch(dbm_ctx ctx, int sz)
+{
+  assert(ctx);
+  if(ctx->sz < sz)
   {
-    var_flags = (char *) realloc(var_flags, sizeof(char)*sz);
-    fwd_dist = (val_t *) realloc(fwd_dist, sizeof(val_t)*sz);
-    _gamma = (val_t *) realloc(_gamma, sizeof(val_t)*sz);
-    pi_prime = (val_t *) realloc(pi_prime, sizeof(val_t)*sz);
+    ctx->var_flags = (char *) realloc(ctx->var_flags, sizeof(char)*sz);
+    ctx->fwd_dist = (val_t *) realloc(ctx->fwd_dist, sizeof(val_t)*sz);
+    ctx->gamma = (val_t *) realloc(ctx->gamma, sizeof(val_t)*sz);
+    ctx->pi_prime = (val_t *) realloc(ctx->pi_prime, sizeof(val_t)*sz);
 
-    for(; scratch_sz < sz; scratch_sz++)
-      var_flags[scratch_sz] = 0;
+    for(; ctx->sz < sz; ctx->sz++)
+      ctx->var_flags[ctx->sz] = 0;
   }
 }
 
 // Check if a given vertex is the source of some edge.
 bool src_is_live(dbm abs, int i)
 {
-  unsigned short inv = src_list(abs, i)->inv;
-  return inv < abs->num_srcs && abs->live_srcs[inv] == i;
+  unsigned int inv = src_list(abs, i)->inv;
+  return inv < (unsigned int) abs->num_srcs && abs->live_srcs[inv] == i;
 }
 
 bool dest_is_live(dbm abs, int j)
 {
-  unsigned short inv = dest_list(abs, j)->inv;
-  return inv < abs->num_dests && abs->live_dests[inv] == j;
+  unsigned int inv = dest_list(abs, j)->inv;
+  return inv < (unsigned int) abs->num_dests && abs->live_dests[inv] == j;
 }
 
 ///
@@ -93,14 +119,14 @@ edge_iter edge_iterator(dbm d)
 edge_iter src_iterator(dbm d, int i)
 {
   adjlist* ilist = src_list(d, i);
-  edge_iter iter = { d, ilist->inv, 0, ilist };
+  edge_iter iter = { d, (int) ilist->inv, 0, ilist };
   return iter;
 }
 
 edge_iter pred_iterator(dbm d, int j)
 {
   adjlist* jlist = dest_list(d, j);
-  edge_iter iter = { d, jlist->inv, 0, jlist };
+  edge_iter iter = { d, (int) jlist->inv, 0, jlist };
   return iter;
 }
 
@@ -167,8 +193,6 @@ void next_edge(edge_iter& iter)
 // FIXME: Need to add allocation checking.
 dbm dbm_alloc(int sz)
 {
-
-  update_scratch(sz);
   dbm_data* d = new dbm_data;
   
   d->sz = sz;
@@ -182,16 +206,16 @@ dbm dbm_alloc(int sz)
   
   // Live sources & dests
   d->num_srcs = 0;
-  d->live_srcs = new short[sz];
+  d->live_srcs = new dbm_vert_t[sz];
   
   d->num_dests = 0;
-  d->live_dests = new short[sz];
+  d->live_dests = new dbm_vert_t[sz];
   
   // The array of adjacency lists.
-  d->srcs = new short[(sz+2)*sz];
-  d->dests = new short[(sz+2)*sz];
+  d->srcs = new dbm_vert_t[((size_t) sz+2)*sz];
+  d->dests = new dbm_vert_t[((size_t) sz+2)*sz];
   
-  d->mtx = new einfo[sz*sz];
+  d->mtx = new einfo[((size_t) sz)*sz];
   
   return d;
 }
@@ -294,14 +318,14 @@ dbm dbm_copy(dbm abs)
 
   // // Live sources & dests
   // ret->num_srcs = abs->num_srcs;
-  // memcpy(ret->live_srcs, abs->live_srcs, sizeof(short)*sz);
+  // memcpy(ret->live_srcs, abs->live_srcs, sizeof(dbm_vert_t)*sz);
 
   // ret->num_dests = abs->num_dests;
-  // memcpy(ret->live_dests, abs->live_dests, sizeof(short)*sz);
+  // memcpy(ret->live_dests, abs->live_dests, sizeof(dbm_vert_t)*sz);
 
   // // The array of adjacency lists.
-  // memcpy(ret->srcs, abs->srcs, sizeof(short)*(sz+2)*sz);
-  // memcpy(ret->dests, abs->dests, sizeof(short)*(sz+2)*sz);
+  // memcpy(ret->srcs, abs->srcs, sizeof(dbm_vert_t)*(sz+2)*sz);
+  // memcpy(ret->dests, abs->dests, sizeof(dbm_vert_t)*(sz+2)*sz);
 
   // memcpy(ret->mtx, abs->mtx, sizeof(einfo)*sz*sz);
 
@@ -374,11 +398,14 @@ bool check_feasibility(dbm abs)
 
 // Update feasibility when a new constraint is added.
 // Perform an incremental consistency checking.
-bool update_feasibility(dbm x, int i, int j, val_t c)
+bool update_feasibility(dbm_ctx ctx, dbm x, int i, int j, val_t c)
 {
   // Ensure there's enough scratch space. 
   int sz = x->sz;
-  
+  update_scratch(ctx, sz);
+  val_t* _gamma = ctx->gamma;
+  val_t* pi_prime = ctx->pi_prime;
+
   for(int vi = 0; vi < sz; vi++)
   {
     _gamma[vi] = 0;
@@ -445,7 +472,7 @@ void dbm_add_edge(dbm x, int i, int j, val_t val)
   adjlist* jlist = dest_list(x, j);
 
   // Check if i or j is not yet live.
-  if(((unsigned short) ilist->inv) >= x->num_srcs || 
+  if(ilist->inv >= (unsigned int) x->num_srcs || 
      x->live_srcs[ilist->inv] != i)
   {
     ilist->sz = 0;
@@ -454,7 +481,7 @@ void dbm_add_edge(dbm x, int i, int j, val_t val)
     x->num_srcs++;
   }
 
-  if(((unsigned short) jlist->inv) >= x->num_dests || 
+  if(jlist->inv >= (unsigned int) x->num_dests || 
      x->live_dests[jlist->inv] != j)
   {
     jlist->sz = 0;
@@ -467,7 +494,7 @@ void dbm_add_edge(dbm x, int i, int j, val_t val)
   assert(x->num_dests <= x->sz);
 
   // Add i, j to the source/dest lists.
-  int eidx = i*x->sz + j;
+  size_t eidx = mtx_idx(x, i, j);
 
   x->mtx[eidx].val = val;
 
@@ -496,19 +523,19 @@ bool in_graph(dbm abs, int i, int j)
   assert(abs);
   assert(i < abs->sz);
   assert(j < abs->sz);
-  int elt_idx = i*(abs->sz) + j;
+  size_t elt_idx = mtx_idx(abs, i, j);
 
-  unsigned short i_inv = abs->mtx[elt_idx].i_inv;
+  unsigned int i_inv = abs->mtx[elt_idx].i_inv;
   
   adjlist* iadj = src_list(abs, i);
 
-  return (i_inv < iadj->sz) && (iadj->elt[i_inv] == j);
+  return (i_inv < (unsigned int) iadj->sz) && (iadj->elt[i_inv] == j);
 }
 
 val_t edge_val(dbm x, int i, int j)
 {
   assert(x);
-  return x->mtx[i*x->sz + j].val;
+  return x->mtx[mtx_idx(x, i, j)].val;
 }
 
 val_t iter_val(edge_iter& iter)
@@ -521,7 +548,7 @@ val_t rev_iter_val(edge_iter& iter)
   return edge_val(iter.d, pred(iter), iter.d->live_dests[iter.si]);
 }
 
-void dijkstra(dbm abs, int svar, 
+void dijkstra(dbm_ctx ctx, dbm abs, int svar, 
               std::vector< std::pair<int, val_t> >& out)
 {
   // fwd_dist contains the new non-negative weights
@@ -538,6 +565,9 @@ void dijkstra(dbm abs, int svar,
   assert(src_is_live(abs, svar));
   assert(abs->checked && abs->feasible);
   verify_potentials(abs);
+
+  update_scratch(ctx, abs->sz);
+  val_t* fwd_dist = ctx->fwd_dist;
    
   for(int vi = 0; vi < abs->sz; vi++)
   {
@@ -593,8 +623,6 @@ void update_closure(dbm x, int ii, int jj, val_t c)
 {
   assert(x);
   assert(x->checked && x->feasible);
-  // scratch holds the distances so far.
-  assert(scratch_sz >= x->sz);
     
   // There may be a cheaper way to do this.
   if(dest_is_live(x, ii))
@@ -610,7 +638,7 @@ void update_closure(dbm x, int ii, int jj, val_t c)
       {
         if(in_graph(x, se, jj))
         {
-          x->mtx[se*x->sz + jj].val = std::min(edge_val(x, se, jj), sval + c);
+          x->mtx[mtx_idx(x, se, jj)].val = std::min(edge_val(x, se, jj), sval + c);
         } else {
           dbm_add_edge(x, se, jj, sval + c);
         }
@@ -628,7 +656,7 @@ void update_closure(dbm x, int ii, int jj, val_t c)
               val_t val = rev_iter_val(piter) + c + iter_val(siter);
               if(in_graph(x, se, de))
               {
-                x->mtx[se*x->sz + de].val = std::min(edge_val(x, se, de), val);
+                x->mtx[mtx_idx(x, se, de)].val = std::min(edge_val(x, se, de), val);
               } else {
                 dbm_add_edge(x, se, de, val);
               }
@@ -650,7 +678,7 @@ void update_closure(dbm x, int ii, int jj, val_t c)
       {
         if(in_graph(x, ii, de))
         {
-          x->mtx[ii*x->sz + de].val = std::min(edge_val(x, ii, de), val);
+          x->mtx[mtx_idx(x, ii, de)].val = std::min(edge_val(x, ii, de), val);
         } else {
           dbm_add_edge(x, ii, de, val);
         }
@@ -668,7 +696,7 @@ void update_closure(dbm x, int ii, int jj, val_t c)
 // cycles and update the potential functions. Then, we transform the
 // graph using those potential functions to remove negative edges so
 // we can use Dijkstra's algorithm.
-void dbm_canonical(dbm abs)
+void dbm_canonical(dbm_ctx ctx, dbm abs)
 {
   if(!abs)
     return;
@@ -687,7 +715,7 @@ void dbm_canonical(dbm abs)
   for(; !srcs_end(iter); next_src(iter))
   {
     changed.push_back(std::vector< std::pair<int, val_t> >());
-    dijkstra(abs, src(iter), changed.back());
+    dijkstra(ctx, abs, src(iter), changed.back());
   }
   for(int si = 0; si < abs->num_srcs; si++)
   {
@@ -700,7 +728,7 @@ void dbm_canonical(dbm abs)
       if(!in_graph(abs, s, d)) {
         dbm_add_edge(abs, s, d, v);
       } else {
-        abs->mtx[s*abs->sz + d].val = v;
+        abs->mtx[mtx_idx(abs, s, d)].val = v;
       }
     }
   }
@@ -710,7 +738,7 @@ void dbm_canonical(dbm abs)
 }
 
 // out = x /\ y (destructive if out != null)
-dbm dbm_meet(dbm x, dbm y)
+dbm dbm_meet(dbm_ctx ctx, dbm x, dbm y)
 {
   if(!x || !y)
     return NULL;
@@ -719,9 +747,9 @@ dbm dbm_meet(dbm x, dbm y)
   // Collect the min of all edges
   assert(x->sz == y->sz);
   if(!x->checked || !x->closed)
-    dbm_canonical(x);
+    dbm_canonical(ctx, x);
   if(!y->checked || !y->closed)
-    dbm_canonical(y);
+    dbm_canonical(ctx, y);
 
   if(!x->feasible || !y->feasible)
     return NULL;
@@ -750,13 +778,13 @@ dbm dbm_meet(dbm x, dbm y)
 
     if(src_is_live(ret, i) && in_graph(ret, i, j))
     {
-      //ret->mtx[i*ret->sz + j].val = std::min(edge_val(ret, i, j), iter_val(yiter));
+      //ret->mtx[mtx_idx(ret, i, j)].val = std::min(edge_val(ret, i, j), iter_val(yiter));
       val_t vx = edge_val(ret, i, j);
       val_t vy = iter_val(yiter);
       if(vy < vx)
       {
         xchange = true;
-        ret->mtx[i*ret->sz + j].val = vy;
+        ret->mtx[mtx_idx(ret, i, j)].val = vy;
       } else if(vx < vy) {
         ychange = true;
       }
@@ -789,12 +817,12 @@ dbm dbm_meet(dbm x, dbm y)
   return ret;
 }
 
-void dbm_print(dbm x)
+void dbm_print(dbm_ctx ctx, dbm x)
 {
-  return dbm_print_to(std::cout, x);
+  return dbm_print_to(ctx, std::cout, x);
 }
 
-dbm dbm_join(dbm x, dbm y)
+dbm dbm_join(dbm_ctx ctx, dbm x, dbm y)
 {
   if(!x)
     return dbm_copy(y);
@@ -803,9 +831,9 @@ dbm dbm_join(dbm x, dbm y)
 
   assert(x->sz == y->sz);
   if(!x->checked || !x->closed)
-    dbm_canonical(x);
+    dbm_canonical(ctx, x);
   if(!y->checked || !y->closed)
-    dbm_canonical(y);
+    dbm_canonical(ctx, y);
 
   if(!x->feasible)
     return dbm_copy(y);
@@ -850,7 +878,7 @@ dbm dbm_join(dbm x, dbm y)
 // For DBM widening, you can close the left
 // argument, but not the right.
 // x is the previous iteration, y is the current.
-dbm dbm_widen(dbm x, dbm y)
+dbm dbm_widen(dbm_ctx ctx, dbm x, dbm y)
 {
   /*
   if(!x || !y || dbm_is_top(y) || !x->feasible)
@@ -859,7 +887,7 @@ dbm dbm_widen(dbm x, dbm y)
   if(!y)
     return NULL;
   if(!y->checked || !y->closed)
-    dbm_canonical(y);
+    dbm_canonical(ctx, y);
 
   if(!y->feasible)
     return NULL;
@@ -867,7 +895,7 @@ dbm dbm_widen(dbm x, dbm y)
   /*
   // No longer guarantees termination.
   if(!x->checked || !x->closed)
-    dbm_canonical(x);
+    dbm_canonical(ctx, x);
   */
   if(!x || (x->checked && !x->feasible))
     return dbm_copy(y);
@@ -926,19 +954,19 @@ dbm dbm_widen(dbm x, dbm y)
 // Unlike widening, for DBM narrowing we can close both the left and
 // the right arguments.
 // x is the previous iteration, y is the current.
-dbm dbm_narrowing(dbm x, dbm y)
+dbm dbm_narrowing(dbm_ctx ctx, dbm x, dbm y)
 {
   if(!y)
     return NULL;
 
   if(!y->checked || !y->closed)
-    dbm_canonical(y);
+    dbm_canonical(ctx, y);
 
   if(!y->feasible)
     return NULL;
 
   if(!x->checked || !x->closed)
-    dbm_canonical(x);
+    dbm_canonical(ctx, x);
 
   if(!x || (x->checked && !x->feasible))
     return dbm_copy(y);
@@ -983,13 +1011,13 @@ dbm dbm_narrowing(dbm x, dbm y)
 }
 
 // Existentially project a variable.
-dbm dbm_forget(int v, dbm x)
+dbm dbm_forget(dbm_ctx ctx, int v, dbm x)
 {
   if(!x)
     return x;
 
   if(!x->closed)
-    dbm_canonical(x);
+    dbm_canonical(ctx, x);
 
   if(!x->feasible)
     return NULL;   
@@ -1020,7 +1048,7 @@ dbm dbm_forget(int v, dbm x)
       /*
       if(in_graph(ret, s, d))
       {
-        ret->mtx[s*ret->sz + d].val = std::min(edge_val(ret, s, d), iter_val(iter));
+        ret->mtx[mtx_idx(ret, s, d)].val = std::min(edge_val(ret, s, d), iter_val(iter));
       } else {
         dbm_add_edge(ret, s, d, iter_val(iter));
       }
@@ -1031,17 +1059,20 @@ dbm dbm_forget(int v, dbm x)
   return ret;
 }
 
-dbm dbm_forget_array(int* vs, int vs_len, dbm x)
+dbm dbm_forget_array(dbm_ctx ctx, int* vs, int vs_len, dbm x)
 {
   if(!x)
     return x;
 
   if (!x->closed)
-    dbm_canonical(x);
+    dbm_canonical(ctx, x);
 
   if(!x->feasible)
     return NULL;   
 
+  update_scratch(ctx, x->sz);
+  char* var_flags = ctx->var_flags;
+
   // Mark the var flags.
   for(int vi = 0; vi < vs_len; vi++)
     var_flags[vs[vi]] = 1;
@@ -1079,16 +1110,19 @@ dbm dbm_forget_array(int* vs, int vs_len, dbm x)
   return ret;
 }
 
-dbm dbm_extract(int* vs, int vs_len, dbm x)
+dbm dbm_extract(dbm_ctx ctx, int* vs, int vs_len, dbm x)
 {
   if(!x)
     return x;
 
   if (!x->closed)
-    dbm_canonical(x);
+    dbm_canonical(ctx, x);
 
   if(!x->feasible)
     return NULL;   
+
+  update_scratch(ctx, x->sz);
+  char* var_flags = ctx->var_flags;
   
   // Mark the var flags.
   for(int vi = 0; vi < vs_len; vi++) {
@@ -1131,18 +1165,21 @@ dbm dbm_extract(int* vs, int vs_len, dbm x)
 // at most once.
 // If a variable occurs as a destination but not a source,
 // existing constraints are forgotten.
-dbm dbm_rename(rmap* subs, int slen, dbm x)
+dbm dbm_rename(dbm_ctx ctx, rmap* subs, int slen, dbm x)
 {
   if(!x)
     return NULL;
 
   if (!x->closed)
-    dbm_canonical(x); 
+    dbm_canonical(ctx, x); 
 
   if(!x || !x->feasible)
     return NULL;
 
   int sz = x->sz;
+  update_scratch(ctx, sz);
+  char* var_flags = ctx->var_flags;
+
   // Set up the mapping.
   bool changed = false;
   std::vector<int> renmap;
@@ -1210,7 +1247,7 @@ dbm dbm_rename(rmap* subs, int slen, dbm x)
 // (1) Variables which do not occur as destinations are eliminated
 // (2) A variable may occur as a source multiple times. In this case,
 // phi [x -> y, x -> z] == phi [x->y] TT (y = z).
-dbm dbm_rename_strict(rmap* subs, int slen, dbm x)
+dbm dbm_rename_strict(dbm_ctx ctx, rmap* subs, int slen, dbm x)
 {
   // assert(0 && "dbm: dbm_rename_strict not implemented yet"); 
 
@@ -1218,7 +1255,7 @@ dbm dbm_rename_strict(rmap* subs, int slen, dbm x)
     return NULL;
 
   if (!x->closed)
-    dbm_canonical(x); 
+    dbm_canonical(ctx, x); 
 
   if(!x || !x->feasible)
     return NULL;
@@ -1256,13 +1293,13 @@ int dbm_is_top(dbm x)
   return x->num_srcs == 0;
 }
 
-int dbm_is_leq(dbm x, dbm y)
+int dbm_is_leq(dbm_ctx ctx, dbm x, dbm y)
 {
   // FIXME: Need to normalize before doing the cutoff.
   if(!x->checked || !x->closed)
-    dbm_canonical(x);
+    dbm_canonical(ctx, x);
   if(!y->checked || !y->closed)
-    dbm_canonical(y);
+    dbm_canonical(ctx, y);
 
   if(dbm_is_bottom(x) || dbm_is_top(y))
     return true;
@@ -1283,10 +1320,10 @@ int dbm_is_leq(dbm x, dbm y)
 
 // We can also do this without
 // computing the closure.
-int dbm_implies(dbm x, dexpr con)
+int dbm_implies(dbm_ctx ctx, dbm x, dexpr con)
 {
   if (!x->closed)
-    dbm_canonical(x);
+    dbm_canonical(ctx, x);
 
   if(!x || !x->feasible)
     return true;
@@ -1321,10 +1358,10 @@ int dbm_implies(dbm x, dexpr con)
   return src_is_live(x, i) && in_graph(x, i, j) && edge_val(x, i, j) <= w;
 }
 
-void dbm_print_to(std::ostream &o, dbm x)
+void dbm_print_to(dbm_ctx ctx, std::ostream &o, dbm x)
 {
   if (!x->closed)
-    dbm_canonical(x);
+    dbm_canonical(ctx, x);
 
   if(!x || !x->feasible)
   {
@@ -1382,7 +1419,7 @@ static val_t var_ub(dbm x, int i)
   }
 }
 
-void exp_collect_vars(exp_t e, std::vector<int>& vs)
+void exp_collect_vars(char* var_flags, exp_t e, std::vector<int>& vs)
 {
   switch(e->kind)
   {
@@ -1396,8 +1433,8 @@ void exp_collect_vars(exp_t e, std::vector<int>& vs)
     case E_CONST:
       break;
     default:
-      exp_collect_vars((exp_t) e->args[0], vs);
-      exp_collect_vars((exp_t) e->args[1], vs);
+      exp_collect_vars(var_flags, (exp_t) e->args[0], vs);
+      exp_collect_vars(var_flags, (exp_t) e->args[1], vs);
       break;
   }
 }
@@ -1739,17 +1776,20 @@ void post_linterm(dbm x, int v, int y, linterm t)
   }
 }
 
-dbm dbm_assign(int v, exp_t e, dbm x)
+dbm dbm_assign(dbm_ctx ctx, int v, exp_t e, dbm x)
 {
   if (!x || (x->checked && !x->feasible))
     return NULL;
 
-  dbm ret = dbm_forget(v, x);
+  dbm ret = dbm_forget(ctx, v, x);
   if (!ret)
     return NULL;
 
+  update_scratch(ctx, x->sz);
+  char* var_flags = ctx->var_flags;
+
   std::vector<int> ys;
-  exp_collect_vars(e, ys);
+  exp_collect_vars(var_flags, e, ys);
 
   linterm term;
   if (!eval_exp(x, -1, e, term)) {
@@ -1829,7 +1869,7 @@ dbm dbm_assign(int v, exp_t e, dbm x)
               continue;
             if(in_graph(ret, v, d))
             {
-              ret->mtx[v*x->sz + d].val = std::min(edge_val(ret, v, d), kval + dval);
+              ret->mtx[mtx_idx(x, v, d)].val = std::min(edge_val(ret, v, d), kval + dval);
             }
             else 
             {
@@ -1857,7 +1897,7 @@ dbm dbm_assign(int v, exp_t e, dbm x)
             // if(src_is_live(ret, s) && in_graph(ret, s, v))
             if(in_graph(ret, s, v))
             {
-              ret->mtx[s*x->sz + v].val = std::min(edge_val(ret, s, v), kval + sval);
+              ret->mtx[mtx_idx(x, s, v)].val = std::min(edge_val(ret, s, v), kval + sval);
             } 
             else 
             {
@@ -1870,23 +1910,23 @@ dbm dbm_assign(int v, exp_t e, dbm x)
       ret->closed = true;
     }
 #else
-    dbm_canonical(ret);
+    dbm_canonical(ctx, ret);
 #endif 
   }
   return ret;
 }
 
-dbm dbm_store(int a, uterm i, uterm v, dbm x)
+dbm dbm_store(dbm_ctx ctx, int a, uterm i, uterm v, dbm x)
 {
   return dbm_copy(x);
 }
 
-dbm dbm_load(int v, int a, uterm i, dbm x)
+dbm dbm_load(dbm_ctx ctx, int v, int a, uterm i, dbm x)
 {
-  return dbm_forget(v, x);
+  return dbm_forget(ctx, v, x);
 }
 
-dbm dbm_apply_edge(dbm x, int i, int j, val_t w)
+dbm dbm_apply_edge(dbm_ctx ctx, dbm x, int i, int j, val_t w)
 {
   if (!x || (x->checked && !x->feasible))
   {
@@ -1899,7 +1939,7 @@ dbm dbm_apply_edge(dbm x, int i, int j, val_t w)
   if(x->checked)
   {
     verify_potentials(x);
-    if(!update_feasibility(x, i, j, w)){
+    if(!update_feasibility(ctx, x, i, j, w)){
       //assert(!src_is_live(x, i) || !in_graph(x, i, j) || edge_val(x, i, j) > w);
       ///// Updated constraint isn't feasible.
       ///// fprintf(stderr, "PING: B (%d -> %d: %d.\n", i, j, w);
@@ -1909,7 +1949,7 @@ dbm dbm_apply_edge(dbm x, int i, int j, val_t w)
       // Copy x, and update pi.
       ret = dbm_copy(x);
       for(int vi = 0; vi < ret->sz; vi++)
-        ret->pi[vi] = pi_prime[vi];
+        ret->pi[vi] = ctx->pi_prime[vi];
       ret->checked = true;
       ret->feasible = true;
       verify_potentials(ret);
@@ -1927,7 +1967,7 @@ dbm dbm_apply_edge(dbm x, int i, int j, val_t w)
     // Redundant; no need to do anything.
     if(edge_val(ret, i, j) <= w)
       return ret;
-    ret->mtx[i*ret->sz + j].val = w;
+    ret->mtx[mtx_idx(ret, i, j)].val = w;
   } else {
     dbm_add_edge(ret, i, j, w);
   }
@@ -1945,7 +1985,7 @@ dbm dbm_apply_edge(dbm x, int i, int j, val_t w)
   return ret;
 }
 
-dbm dbm_cond(ucon con, dbm x)
+dbm dbm_cond(dbm_ctx ctx, ucon con, dbm x)
 {
   if(!x || (x->checked && !x->feasible))
     return NULL;
@@ -2014,20 +2054,20 @@ dbm dbm_cond(ucon con, dbm x)
   */
   if(con.kind == U_EQ){
     // To avoid leaking x1
-    dbm tmp = dbm_apply_edge(x, i, j, w);
-    dbm res = dbm_apply_edge(tmp, j, i, -w);
+    dbm tmp = dbm_apply_edge(ctx, x, i, j, w);
+    dbm res = dbm_apply_edge(ctx, tmp, j, i, -w);
     dbm_dealloc(tmp);
     return res;
-    //return dbm_apply_edge(dbm_apply_edge(x, i, j, w), j, i, -w);
+    //return dbm_apply_edge(ctx, dbm_apply_edge(ctx, x, i, j, w), j, i, -w);
   } 
   else {
-    return dbm_apply_edge(x, i, j, w);
+    return dbm_apply_edge(ctx, x, i, j, w);
   }
 }
 
-dbm dbm_apply_dexpr(dexpr con, dbm x)
+dbm dbm_apply_dexpr(dbm_ctx ctx, dexpr con, dbm x)
 {
-  dbm_canonical(x);
+  dbm_canonical(ctx, x);
   if(!x || !x->feasible)
     return NULL;
 
@@ -2063,7 +2103,7 @@ dbm dbm_apply_dexpr(dexpr con, dbm x)
       return dbm_copy(x);
   } 
   else {
-    return dbm_apply_edge(x, i, j, w);
+    return dbm_apply_edge(ctx, x, i, j, w);
   }
 }
 
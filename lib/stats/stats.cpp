@@ -3,40 +3,158 @@
 #ifdef HAVE_STATS
 #include "crab/common/stats.hpp"
 
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <vector>
+
 namespace crab
 {
-  std::map<std::string,unsigned> CrabStats::counters;
-  std::map<std::string,Stopwatch> CrabStats::sw;
-  std::map<std::string,Averager> CrabStats::av;
-  std::map<std::string,std::string> CrabStats::ss;
-  
-  void CrabStats::count (const std::string &name) { ++counters[name]; }
+  namespace
+  {
+    // Statistics of one thread
+    struct StatsTable
+    {
+      std::map<std::string,unsigned> counters;
+      std::map<std::string,unsigned> maxima;  // count_max
+      std::map<std::string,Stopwatch> sw;
+      std::map<std::string,Stopwatch> thread_sw;
+      std::map<std::string,Averager> av;
+    };
+
+    // All tables ever created. They are never freed so that the
+    // statistics of a thread are kept after it exits.
+    std::mutex tables_mutex;
+    std::vector<std::unique_ptr<StatsTable> > tables;
+    // uset and sset: the last value of any thread
+    std::map<std::string,unsigned> last;
+    std::map<std::string,std::string> ss;
+
+    typedef std::lock_guard<std::mutex> stats_lock;
+
+    StatsTable& local ()
+    {
+      static thread_local StatsTable* table = nullptr;
+      if (!table) {
+        stats_lock l (tables_mutex);
+        tables.emplace_back (new StatsTable ());
+        table = tables.back ().get ();
+      }
+      return *table;
+    }
+
+    Stopwatch& thread_stopwatch (const std::string &name)
+    {
+      auto &sw = local ().thread_sw;
+      auto it = sw.find (name);
+      if (it == sw.end ())
+        it = sw.insert (std::make_pair (name, Stopwatch (true))).first;
+      return it->second;
+    }
+
+    // Merge the tables of all threads
+    void merge (std::map<std::string,unsigned> &counters,
+                std::map<std::string,long> &times,
+                std::map<std::string,Averager> &av)
+    {
+      for (auto &t : tables) {
+        for (auto &kv : t->counters)
+          counters[kv.first] += kv.second;
+        for (auto &kv : t->sw)
+          times[kv.first] += kv.second.getTimeElapsed ();
+        for (auto &kv : t->thread_sw)
+          times[kv.first] += kv.second.getTimeElapsed ();
+        for (auto &kv : t->av)
+          av[kv.first].merge (kv.second);
+      }
+      for (auto &t : tables) {
+        for (auto &kv : t->maxima)
+          counters[kv.first] = std::max (counters[kv.first], kv.second);
+      }
+      for (auto &kv : last)
+        counters[kv.first] = kv.second;
+    }
+  }
+
+  void CrabStats::count (const std::string &name) {
+      ++local ().counters[name];
+  }
   void CrabStats::count_max (const std::string &name, unsigned v) {
-      counters[name] = std::max (counters[name], v);
+      unsigned &c = local ().maxima[name];
+      c = std::max (c, v);
+  }
+
+  double CrabStats::avg (const std::string &n, double v) {
+      return local ().av[n].add (v);
+  }
+  unsigned CrabStats::uset (const std::string &n, unsigned v) {
+      stats_lock l (tables_mutex);
+      return last [n] = v;
+  }
+  unsigned CrabStats::get (const std::string &n) {
+      stats_lock l (tables_mutex);
+      auto it = last.find (n);
+      if (it != last.end ()) return it->second;
+      unsigned res = 0;
+      for (auto &t : tables) {
+        auto it = t->counters.find (n);
+        if (it != t->counters.end ()) res += it->second;
+      }
+      for (auto &t : tables) {
+        auto it = t->maxima.find (n);
+        if (it != t->maxima.end ()) res = std::max (res, it->second);
+      }
+      return res;
   }
 
-  double CrabStats::avg (const std::string &n, double v) { return av[n].add (v); }
-  unsigned CrabStats::uset (const std::string &n, unsigned v)
-  { return counters [n] = v; }
-  unsigned CrabStats::get (const std::string &n) { return counters [n]; }
+  void CrabStats::sset (const std::string &n, std::string v) {
+      stats_lock l (tables_mutex);
+      ss [n] = v;
+  }
+  std::string CrabStats::sget (const std::string &n) {
+      stats_lock l (tables_mutex);
+      return ss[n];
+  }
+
+  void CrabStats::start (const std::string &name) {
+      local ().sw[name].start ();
+  }
+  void CrabStats::stop (const std::string &name) {
+      local ().sw[name].stop ();
+  }
+  void CrabStats::resume (const std::string &name) {
+      local ().sw[name].resume ();
+  }
 
-  void CrabStats::sset (const std::string &n, std::string v) {ss [n] = v;}
-  std::string& CrabStats::sget (const std::string &n) {return ss[n];}
-  
-  void CrabStats::start (const std::string &name) { sw[name].start (); }
-  void CrabStats::stop (const std::string &name) { sw[name].stop (); }
-  void CrabStats::resume (const std::string &name) { sw[name].resume (); }
+  void CrabStats::start_thread (const std::string &name) {
+      thread_stopwatch (name).start ();
+  }
+  void CrabStats::stop_thread (const std::string &name) {
+      thread_stopwatch (name).stop ();
+  }
+  void CrabStats::resume_thread (const std::string &name) {
+      thread_stopwatch (name).resume ();
+  }
 
   /** Outputs all statistics to std output */
   void CrabStats::Print (std::ostream &OS) {
+    stats_lock l (tables_mutex);
+    std::map<std::string,unsigned> counters;
+    std::map<std::string,long> times;
+    std::map<std::string,Averager> av;
+    merge (counters, times, av);
+
     OS << "\n\n************** STATS ***************** \n";
     for (auto &kv : ss)
       OS << kv.first << ": " << kv.second << "\n";
     for (auto &kv : counters)
       OS << kv.first << ": " << kv.second << "\n";
 
-    for (auto &kv : sw)
-      OS << kv.first << ": " << kv.second << "\n";
+    for (auto &kv : times) {
+      OS << kv.first << ": ";
+      Stopwatch::PrintTime (OS, kv.second);
+      OS << "\n";
+    }
 
     for (auto &kv : av)
       OS << kv.first << ": " << kv.second << "\n";
@@ -47,16 +165,22 @@ namespace crab
 
   void CrabStats::PrintBrunch (std::ostream &OS)
   {
+    stats_lock l (tables_mutex);
+    std::map<std::string,unsigned> counters;
+    std::map<std::string,long> times;
+    std::map<std::string,Averager> av;
+    merge (counters, times, av);
+
     OS << "\n\n************** BRUNCH STATS ***************** \n";
-    for (auto &kv : ss) 
+    for (auto &kv : ss)
       OS << "BRUNCH_STAT " << kv.first << " " << kv.second << "\n";
-    
+
     for (auto &kv : counters)
       OS << "BRUNCH_STAT " << kv.first << " " << kv.second << "\n";
 
-    for (auto &kv : sw)
-      OS << "BRUNCH_STAT " << kv.first << " " 
-         << (kv.second).toSeconds() << "\n";
+    for (auto &kv : times)
+      OS << "BRUNCH_STAT " << kv.first << " "
+         << ((double) kv.second / 1000000) << "\n";
 
     for (auto &kv : av)
       OS << "BRUNCH_STAT " << kv.first << " " << kv.second << "\n";
@@ -67,7 +191,11 @@ namespace crab
 
   void Stopwatch::Print (std::ostream &out) const
   {
-    long time = getTimeElapsed ();
+    PrintTime (out, getTimeElapsed ());
+  }
+
+  void Stopwatch::PrintTime (std::ostream &out, long time)
+  {
     long h = time/3600000000L;
     long m = time/60000000L - h*60;
     float s = ((float)time/1000000L) - m*60 - h*3600;
@@ -75,8 +203,8 @@ namespace crab
     if (h > 0) out << h << "h";
     if (m > 0) out << m << "m";
     out << s << "s";
-  }  
-    
+  }
+
   void Averager::Print (std::ostream &out) const { out << avg; }
 }
-#endif 
+#endif
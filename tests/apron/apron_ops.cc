@@ -0,0 +1,141 @@
+#include "../common.hpp"
+
+using namespace std;
+using namespace crab::analyzer;
+using namespace crab::cfg_impl;
+using namespace crab::domain_impl;
+
+// The dimensions of an apron state follow the order of the variables:
+// a < b < c < d < e here. These operands have different variables,
+// interleaved, so they are aligned before being combined, and the
+// operations that add variables shift the dimensions of the others.
+
+template<typename Dom>
+bool implies (Dom inv, z_lin_cst_t cst) {
+  inv += cst.negate ();
+  return inv.is_bottom ();
+}
+
+template<typename Dom>
+void test_join (VariableFactory& vfac) {
+  z_var a (vfac ["a"]), b (vfac ["b"]), c (vfac ["c"]), e (vfac ["e"]);
+  // {a, c, e} and {b, c, e}
+  Dom inv1 = Dom::top ();
+  inv1.assign (a.name (), z_lin_t (0));
+  inv1.assign (e.name (), z_lin_t (5));
+  inv1 += (c - e <= 0);
+  Dom inv2 = Dom::top ();
+  inv2.assign (b.name (), z_lin_t (1));
+  inv2.assign (e.name (), z_lin_t (6));
+  inv2 += (c - e <= 0);
+  Dom j = inv1 | inv2;
+  crab::outs () << "join " << j << "\n";
+  TEST_CHECK (implies (j, c - e <= 0));
+  TEST_CHECK (implies (j, e >= 5) && implies (j, e <= 6));
+  TEST_CHECK (!implies (j, e <= 5));
+  TEST_CHECK (!implies (j, a <= 0) && !implies (j, b >= 1));
+  TEST_CHECK (inv1 <= j && inv2 <= j);
+  TEST_CHECK (!(j <= inv1) && !(j <= inv2));
+}
+
+template<typename Dom>
+void test_meet (VariableFactory& vfac) {
+  z_var a (vfac ["a"]), b (vfac ["b"]), c (vfac ["c"]), d (vfac ["d"]), e (vfac ["e"]);
+  // {a, c, e} and {b, d}
+  Dom inv1 = Dom::top ();
+  inv1 += (a >= 1);
+  inv1 += (a <= 1);
+  inv1 += (c - a <= 2);
+  inv1 += (e >= 0);
+  Dom inv2 = Dom::top ();
+  inv2 += (b >= 3);
+  inv2 += (b <= 3);
+  inv2 += (d - b <= 1);
+  Dom m = inv1 & inv2;
+  crab::outs () << "meet " << m << "\n";
+  TEST_CHECK (!m.is_bottom ());
+  TEST_CHECK (implies (m, c - a <= 2) && implies (m, c <= 3));
+  TEST_CHECK (implies (m, d - b <= 1) && implies (m, d <= 4));
+  TEST_CHECK (implies (m, a >= 1) && implies (m, b >= 3) && implies (m, e >= 0));
+  TEST_CHECK (!implies (m, d <= 3) && !implies (m, c <= 2));
+  TEST_CHECK (m <= inv1 && m <= inv2);
+  Dom bot = inv2;
+  bot += (a >= 2);
+  TEST_CHECK ((inv1 & bot).is_bottom ());
+}
+
+template<typename Dom>
+void test_widening (VariableFactory& vfac) {
+  z_var a (vfac ["a"]), b (vfac ["b"]), c (vfac ["c"]), d (vfac ["d"]);
+  // {a, c} and {a, b, c, d}, where b and d are unconstrained so that
+  // inv1 <= inv2
+  Dom inv1 = Dom::top ();
+  inv1 += (a >= 0);
+  inv1 += (a <= 0);
+  inv1 += (c - a <= 0);
+  Dom next = Dom::top ();
+  next += (a >= 1);
+  next += (a <= 1);
+  next += (c - a <= 0);
+  next += (b >= 2);
+  next += (d - b <= 0);
+  Dom inv2 = inv1 | next;
+  TEST_CHECK (inv1 <= inv2);
+  Dom w = inv1 || inv2;
+  crab::outs () << "widening " << w << "\n";
+  TEST_CHECK (implies (w, c - a <= 0));
+  TEST_CHECK (implies (w, a >= 0));
+  TEST_CHECK (!implies (w, a <= 1));
+  TEST_CHECK (!implies (w, d - b <= 0));
+  TEST_CHECK (inv1 <= w && inv2 <= w);
+  Dom w2 = w || (w | inv2);
+  TEST_CHECK (w2 <= w && w <= w2);
+}
+
+// c is added before d, which the expression also reads
+template<typename Dom>
+void test_new_vars (VariableFactory& vfac) {
+  z_var b (vfac ["b"]), c (vfac ["c"]), d (vfac ["d"]), e (vfac ["e"]);
+  Dom inv = Dom::top ();
+  inv.assign (b.name (), z_lin_t (1));
+  inv.assign (d.name (), z_lin_t (2));
+  Dom inv1 = inv;
+  inv1.apply (OP_ADDITION, e.name (), d.name (), c.name ());
+  inv1 += (c >= 3);
+  inv1 += (c <= 3);
+  TEST_CHECK (implies (inv1, e <= 5) && implies (inv1, e >= 5));
+  TEST_CHECK (implies (inv1, d <= 2) && implies (inv1, b <= 1));
+
+  Dom inv2 = inv;
+  inv2.assign (e.name (), z_lin_t (d) + z_lin_t (c));
+  inv2 += (c >= 3);
+  inv2 += (c <= 3);
+  TEST_CHECK (implies (inv2, e <= 5) && implies (inv2, e >= 5));
+
+  Dom inv3 = inv;
+  inv3 += (c - d <= 0);
+  inv3 += (e - c <= 1);
+  TEST_CHECK (implies (inv3, c <= 2) && implies (inv3, e <= 3));
+  TEST_CHECK (implies (inv3, b <= 1) && implies (inv3, b >= 1));
+}
+
+template<typename Dom>
+void run (VariableFactory& vfac) {
+  crab::outs () << Dom::getDomainName () << "\n";
+  test_join<Dom> (vfac);
+  test_meet<Dom> (vfac);
+  test_widening<Dom> (vfac);
+  test_new_vars<Dom> (vfac);
+}
+
+int main (int argc, char** argv) {
+  SET_LOGGER(argc,argv)
+  VariableFactory vfac;
+  // create the variables in order
+  for (auto v : { "a", "b", "c", "d", "e" })
+    vfac [v];
+  run<oct_apron_domain_t> (vfac);
+  run<opt_oct_apron_domain_t> (vfac);
+  run<pk_apron_domain_t> (vfac);
+  return TEST_RESULT ();
+}
@@ -0,0 +1,103 @@
+#include "../common.hpp"
+
+using namespace std;
+using namespace crab::analyzer;
+using namespace crab::cfg_impl;
+using namespace crab::domain_impl;
+
+// Join, meet, widening and <= of array graphs whose vertices are
+// not the same: the graphs are first given common vertices
+// (unify_vertices). Copies share their graph, so the operands must
+// not change either.
+
+typedef array_graph_domain_t dom_t;
+
+// inv implies cst iff inv and not cst is bottom
+static bool implies (dom_t inv, z_lin_cst_t cst) {
+  inv += cst.negate ();
+  return inv.is_bottom ();
+}
+
+// the content of a[i] is in [lb,ub]
+static dom_t store (dom_t inv, z_var a, z_var i, z_var x, int lb, int ub) {
+  inv += (x >= lb);
+  inv += (x <= ub);
+  inv.store (a.name (), i.name (), z_lin_t (x));
+  inv -= x.name ();
+  return inv;
+}
+
+static bool read_in (dom_t inv, z_var a, z_var i, z_var t, int lb, int ub) {
+  inv.load (t.name (), a.name (), i.name ());
+  return !inv.is_bottom () && implies (inv, t >= lb) && implies (inv, t <= ub);
+}
+
+static bool read_exactly (dom_t inv, z_var a, z_var i, z_var t, int lb, int ub) {
+  return read_in (inv, a, i, t, lb, ub) &&
+      !read_in (inv, a, i, t, lb + 1, ub) && !read_in (inv, a, i, t, lb, ub - 1);
+}
+
+int main (int argc, char** argv) {
+  SET_LOGGER(argc,argv)
+  VariableFactory vfac;
+  z_var a (vfac ["A"]), i (vfac ["i"]), n (vfac ["n"]), j (vfac ["j"]);
+  z_var x (vfac ["x"]), t (vfac ["t"]);
+
+  // n is a vertex only of inv1 and j only of inv2
+  dom_t inv1 = dom_t::top ();
+  inv1.assign (i.name (), z_lin_t (0));
+  inv1.assign (n.name (), z_lin_t (3));
+  inv1 = store (inv1, a, i, x, 0, 10);
+  inv1 = store (inv1, a, n, x, 1, 1);
+  dom_t inv2 = dom_t::top ();
+  inv2.assign (i.name (), z_lin_t (0));
+  inv2.assign (j.name (), z_lin_t (1));
+  inv2 = store (inv2, a, i, x, 5, 20);
+  inv2 = store (inv2, a, j, x, 2, 2);
+  crab::outs () << "inv1=" << inv1 << "\ninv2=" << inv2 << "\n";
+  dom_t copy1 (inv1), copy2 (inv2);
+
+  dom_t join = inv1 | inv2;
+  crab::outs () << "join=" << join << "\n";
+  TEST_CHECK (read_exactly (join, a, i, t, 0, 20));
+  TEST_CHECK (inv1 <= join);
+  TEST_CHECK (inv2 <= join);
+  TEST_CHECK (!(join <= inv1));
+
+  dom_t meet = inv1 & inv2;
+  crab::outs () << "meet=" << meet << "\n";
+  TEST_CHECK (!meet.is_bottom ());
+  TEST_CHECK (read_exactly (meet, a, i, t, 5, 10));
+  // each of n and j is only constrained by one operand
+  TEST_CHECK (read_exactly (meet, a, n, t, 1, 1));
+  TEST_CHECK (read_exactly (meet, a, j, t, 2, 2));
+  TEST_CHECK (meet <= inv1);
+  TEST_CHECK (meet <= inv2);
+  TEST_CHECK (!(inv1 <= meet));
+
+  TEST_CHECK (!(inv1 <= inv2));
+  TEST_CHECK (!(inv2 <= inv1));
+
+  // a[i] grows from [0,10] to [0,20]
+  dom_t inv3 = inv1;
+  inv3 = store (inv3, a, i, x, 0, 20);
+  inv3.assign (j.name (), z_lin_t (1));
+  dom_t widen = inv1 || inv3;
+  crab::outs () << "widening=" << widen << "\n";
+  dom_t r = widen;
+  r.load (t.name (), a.name (), i.name ());
+  TEST_CHECK (implies (r, t >= 0));
+  TEST_CHECK (!implies (r, t <= 1000000));
+  TEST_CHECK (inv1 <= widen);
+  TEST_CHECK (inv3 <= widen);
+  dom_t widen2 = widen || (widen | inv3);
+  TEST_CHECK (widen2 <= widen && widen <= widen2);
+
+  // the operands did not change
+  TEST_CHECK (read_exactly (inv1, a, i, t, 0, 10));
+  TEST_CHECK (read_exactly (inv2, a, i, t, 5, 20));
+  TEST_CHECK (inv1 <= copy1 && copy1 <= inv1);
+  TEST_CHECK (inv2 <= copy2 && copy2 <= inv2);
+
+  return TEST_RESULT ();
+}
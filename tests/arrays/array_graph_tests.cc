@@ -449,6 +449,23 @@ void test9(){
   delete cfg;
 }
 
+// The scalar domain is relational but its constraints are not closed
+// under difference bounds so the array graph must query it.
+typedef array_graph_domain<num_domain_t, interval_domain_t> array_graph_num_domain_t;
+
+void test10(){
+  VariableFactory vfac;
+  cfg_t* cfg = prog7(vfac);
+  run<array_graph_num_domain_t>(*cfg, "Program 10: a[0] = 89 and for all 1<= i < n. a[i] = a[i-1] (reduced product)", vfac);
+  delete cfg;
+}
+
+void test11(){
+  VariableFactory vfac;
+  cfg_t* cfg = prog5(vfac);
+  run<array_graph_num_domain_t>(*cfg, "Program 11: forall 0<= i < n. a[i] = 123456 (reduced product)", vfac);
+  delete cfg;
+}
 
 int main(int argc, char **argv) 
 {
@@ -463,6 +480,8 @@ int main(int argc, char **argv)
   test7 ();
   test8 ();
   test9 ();
+  test10 ();
+  test11 ();
 
   return 42;
 }
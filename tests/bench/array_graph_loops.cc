@@ -0,0 +1,89 @@
+#include "../common.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <sys/resource.h>
+
+using namespace std;
+using namespace crab::analyzer;
+using namespace crab::cfg_impl;
+using namespace crab::domain_impl;
+
+// Run the array graph domain on loops like the ones in
+// tests/arrays/array_graph_tests.cc, scaled up to many index
+// variables.
+//
+// Usage: array_graph_loops [num indexes ...]
+//
+// For each number of indexes n, the indexes j_0 < ... < j_{n-1} are
+// set before the loop and the loop walks one array from j_0 to
+// j_{n-1}. Output is one CSV line per size:
+//   domain,indexes,time_ms,max_rss_kb
+
+cfg_t* prog (VariableFactory &vfac, unsigned num_idxs)
+{
+  cfg_t* cfg = new cfg_t("entry","ret", ARR);
+  basic_block_t& entry = cfg->insert ("entry");
+  basic_block_t& bb1   = cfg->insert ("bb1");
+  basic_block_t& bb1_t = cfg->insert ("bb1_t");
+  basic_block_t& bb1_f = cfg->insert ("bb1_f");
+  basic_block_t& bb2   = cfg->insert ("bb2");
+  basic_block_t& ret   = cfg->insert ("ret");
+  entry >> bb1;
+  bb1 >> bb1_t; bb1 >> bb1_f;
+  bb1_t >> bb2; bb2 >> bb1; bb1_f >> ret;
+
+  z_var n1(vfac["n1"]);
+  z_var i(vfac["i"]);
+  z_var a(vfac["A"]);
+  entry.assign(n1, 1);
+  for (unsigned k = 0; k < num_idxs; k++) {
+    z_var j(vfac["j" + std::to_string (k)]);
+    entry.assign(j, k);
+  }
+  z_var first(vfac["j0"]);
+  z_var last(vfac["j" + std::to_string (num_idxs - 1)]);
+  entry.assign(i, first);
+  bb1_t.assume(i <= last - 1);
+  bb1_f.assume(i >= last);
+  bb2.array_store(a, i, 1, 1);
+  bb2.add(i, i, n1);
+  return cfg;
+}
+
+static long max_rss_kb (void)
+{
+  struct rusage ru;
+  getrusage (RUSAGE_SELF, &ru);
+  return ru.ru_maxrss;
+}
+
+void run (unsigned num_idxs)
+{
+  VariableFactory vfac;
+  cfg_t* cfg = prog (vfac, num_idxs);
+
+  auto start = std::chrono::steady_clock::now ();
+  typename NumFwdAnalyzer <cfg_ref_t, array_graph_domain_t, VariableFactory>::type a (*cfg,vfac,nullptr);
+  array_graph_domain_t inv = array_graph_domain_t::top ();
+  a.Run (inv);
+  auto end = std::chrono::steady_clock::now ();
+  long ms = std::chrono::duration_cast<std::chrono::milliseconds> (end - start).count ();
+
+  crab::outs() << inv.getDomainName () << "," << num_idxs << ","
+               << ms << "," << max_rss_kb () << "\n";
+  delete cfg;
+}
+
+int main (int argc, char** argv)
+{
+  if (argc > 1) {
+    for (int i = 1; i < argc; i++)
+      run (atoi (argv[i]));
+  } else {
+    run (50);
+    run (100);
+    run (200);
+  }
+  return 0;
+}
@@ -0,0 +1,98 @@
+#include "../common.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <sys/resource.h>
+
+using namespace std;
+using namespace crab::analyzer;
+using namespace crab::cfg_impl;
+using namespace crab::domain_impl;
+
+// Run the liveness analysis on wide functions: a chain of loops where
+// each loop body reads and writes a sliding window of variables, so
+// many variables are live across many blocks.
+//
+// Usage: liveness_wide [num variables ...]
+//
+// The function has one loop per 10 variables. Output is one CSV line
+// per size:
+//   variables,blocks,time_ms,avg_live,max_rss_kb
+
+cfg_t* prog (VariableFactory &vfac, unsigned num_vars)
+{
+  cfg_t* cfg = new cfg_t("entry","ret");
+  basic_block_t& entry = cfg->insert ("entry");
+  basic_block_t& ret   = cfg->insert ("ret");
+
+  vector<z_var> vars;
+  for (unsigned k = 0; k < num_vars; k++) {
+    z_var v (vfac["x" + std::to_string (k)]);
+    entry.assign (v, k);
+    vars.push_back (v);
+  }
+  z_var i (vfac["i"]);
+
+  basic_block_t* prev = &entry;
+  unsigned num_loops = num_vars / 10 + 1;
+  for (unsigned l = 0; l < num_loops; l++) {
+    string s = std::to_string (l);
+    basic_block_t& head = cfg->insert ("head" + s);
+    basic_block_t& body = cfg->insert ("body" + s);
+    basic_block_t& exit = cfg->insert ("exit" + s);
+    *prev >> head;
+    head >> body; head >> exit; body >> head;
+    prev->assign (i, 0);
+    body.assume (i <= 99);
+    exit.assume (i >= 100);
+    for (unsigned k = 0; k < 20; k++) {
+      z_var &x = vars [(l * 10 + k) % num_vars];
+      z_var &y = vars [(l * 10 + k + 1) % num_vars];
+      body.add (x, x, y);
+    }
+    body.add (i, i, 1);
+    prev = &exit;
+  }
+  *prev >> ret;
+  return cfg;
+}
+
+static long max_rss_kb (void)
+{
+  struct rusage ru;
+  getrusage (RUSAGE_SELF, &ru);
+  return ru.ru_maxrss;
+}
+
+void run (unsigned num_vars)
+{
+  VariableFactory vfac;
+  cfg_t* cfg = prog (vfac, num_vars);
+  unsigned num_blks = std::distance (cfg->begin (), cfg->end ());
+
+  auto start = std::chrono::steady_clock::now ();
+  Liveness<cfg_ref_t> live (*cfg);
+  live.exec ();
+  auto end = std::chrono::steady_clock::now ();
+  long ms = std::chrono::duration_cast<std::chrono::milliseconds> (end - start).count ();
+
+  unsigned total_live, max_live, avg_live;
+  live.get_stats (total_live, max_live, avg_live);
+  crab::outs() << num_vars << "," << num_blks << "," << ms << ","
+               << avg_live << "," << max_rss_kb () << "\n";
+  delete cfg;
+}
+
+int main (int argc, char** argv)
+{
+  crab::outs() << "variables,blocks,time_ms,avg_live,max_rss_kb\n";
+  if (argc > 1) {
+    for (int i = 1; i < argc; i++)
+      run (atoi (argv[i]));
+  } else {
+    run (1000);
+    run (2000);
+    run (5000);
+  }
+  return 0;
+}
@@ -0,0 +1,119 @@
+#include "../common.hpp"
+#include <crab/domains/pta.hpp>
+
+#include <chrono>
+#include <cstdlib>
+#include <random>
+#include <sys/resource.h>
+
+using namespace std;
+using namespace ikos;
+
+// Solve random points-to constraint systems shaped like the ones
+// that crab::analyzer::Pointer generates for whole programs:
+// allocation sites, copies between nearby pointers (which form
+// cycles), field offsets, loads and stores, and indirect calls
+// through function pointers.
+//
+// Usage: pta_solve [num pointers ...]
+//
+// Output is one CSV line per size:
+//   pointers,constraints,addresses,time_ms,avg_pts,max_rss_kb
+
+static long max_rss_kb (void)
+{
+  struct rusage ru;
+  getrusage (RUSAGE_SELF, &ru);
+  return ru.ru_maxrss;
+}
+
+void run (unsigned num_ptrs, unsigned seed)
+{
+  std::mt19937 rng (seed);
+  std::uniform_int_distribution<unsigned> any (0, num_ptrs - 1);
+  std::uniform_int_distribution<int> near (-8, 8);
+  auto pick_near = [&](unsigned p) {
+    return (unsigned) ((p + num_ptrs + near (rng)) % num_ptrs);
+  };
+
+  vector<pointer_var> ptrs;
+  for (unsigned k = 0; k < num_ptrs; k++)
+    ptrs.push_back (mk_pointer_var ());
+
+  z_interval zero (z_number (0));
+  pta_system cs;
+  unsigned num_csts = 0;
+  unsigned num_funcs = num_ptrs / 100 + 1;
+  vector<pointer_var> fptrs;
+  for (unsigned k = 0; k < num_funcs; k++) {
+    pointer_var f = mk_pointer_var ();
+    cs += f == mk_function_ref (1000000 + k);
+    fptrs.push_back (f);
+    num_csts++;
+  }
+  std::uniform_int_distribution<unsigned> any_func (0, num_funcs - 1);
+
+  for (unsigned p = 0; p < num_ptrs; p++) {
+    if (p % 10 == 0) {
+      cs += ptrs[p] == mk_object_ref (p, zero);
+      num_csts++;
+    }
+    // two copies from nearby pointers and one from anywhere
+    cs += ptrs[p] == (ptrs[pick_near (p)] + zero);
+    cs += ptrs[p] == (ptrs[pick_near (p)] + zero);
+    cs += ptrs[p] == (ptrs[any (rng)] + zero);
+    num_csts += 3;
+    if (p % 10 == 1) {
+      cs += ptrs[p] == (ptrs[pick_near (p)] + z_interval (z_number (8)));
+      num_csts++;
+    }
+    if (p % 4 == 2) {
+      cs += ptrs[p] *= (ptrs[any (rng)] + zero);
+      num_csts++;
+    }
+    if (p % 4 == 3) {
+      cs += (ptrs[any (rng)] + zero) << ptrs[p];
+      num_csts++;
+    }
+    if (p % 50 == 0) {
+      pointer_var f = fptrs[any_func (rng)];
+      cs += mk_param_ref (f, 0) << ptrs[p];
+      cs += ptrs[pick_near (p)] == mk_return_ref (f);
+      num_csts += 2;
+    }
+  }
+  // callees read their parameter and write their return value
+  for (unsigned k = 0; k < num_funcs; k++) {
+    pointer_var f = fptrs[k];
+    cs += ptrs[any (rng)] == mk_param_ref (f, 0);
+    cs += mk_return_ref (f) << ptrs[any (rng)];
+    num_csts += 2;
+  }
+
+  auto start = std::chrono::steady_clock::now ();
+  cs.solve ();
+  auto end = std::chrono::steady_clock::now ();
+  long ms = std::chrono::duration_cast<std::chrono::milliseconds> (end - start).count ();
+
+  std::size_t total = 0;
+  for (auto p: ptrs)
+    total += cs.get (p).first.size ();
+
+  crab::outs() << num_ptrs << "," << num_csts << ","
+               << (num_ptrs / 10 + num_funcs) << "," << ms << ","
+               << (double) total / num_ptrs << "," << max_rss_kb () << "\n";
+}
+
+int main (int argc, char** argv)
+{
+  crab::outs() << "pointers,constraints,addresses,time_ms,avg_pts,max_rss_kb\n";
+  if (argc > 1) {
+    for (int i = 1; i < argc; i++)
+      run (atoi (argv[i]), 42);
+  } else {
+    run (1000, 42);
+    run (2000, 42);
+    run (5000, 42);
+  }
+  return 0;
+}
@@ -0,0 +1,213 @@
+#include "../common.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <random>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace std;
+using namespace crab::cfg_impl;
+using namespace crab::domain_impl;
+
+// Run SplitDBM on zones made of many small independent clusters of
+// variables, as in large functions where each loop or region only
+// relates a handful of variables.
+//
+// Usage: zone_components [clusters] [cluster size] [touched] [rounds] [seed]
+//
+// Each cluster is a chain x_0 <= x_1 <= ... with bounds and a few
+// random differences. touched is the number of clusters that the
+// second operand of each operation modifies. Each configuration runs
+// in its own process. Only the operation itself is timed, not the
+// copies and assignments that build its operands. Output is CSV, one
+// line per configuration and operation:
+//   graph,clusters,cluster_size,touched,op,ops,ms_per_op,max_rss_kb
+//
+// Operations:
+//   join      a | b
+//   join_all  a | b, where b modifies every cluster
+//   meet      a & b, where b adds constraints to the touched clusters
+//   widen     a || b followed by closure
+//   fixpoint  copy, assign and join, as at a loop head
+
+struct config {
+  unsigned clusters;
+  unsigned cluster_sz;
+  unsigned touched;
+  unsigned rounds;
+  unsigned seed;
+};
+
+static long max_rss_kb (void)
+{
+  struct rusage ru;
+  getrusage (RUSAGE_SELF, &ru);
+  return ru.ru_maxrss;
+}
+
+template<typename Dom>
+class component_bench {
+  typedef std::chrono::steady_clock steady_t;
+
+  const char* graph;
+  const config& c;
+  VariableFactory vfac;
+  vector<vector<z_var> > xs;
+  std::mt19937 rng;
+
+  void report (const char* op, unsigned long ops, steady_t::duration elapsed)
+  {
+    double secs = std::chrono::duration<double> (elapsed).count ();
+    crab::outs() << graph << "," << c.clusters << "," << c.cluster_sz << ","
+                 << c.touched << "," << op << "," << ops << ","
+                 << (ops ? secs * 1000 / ops : 0) << ","
+                 << max_rss_kb () << "\n";
+  }
+
+  Dom clustered_zone (void)
+  {
+    std::uniform_int_distribution<int> cst (0, 100);
+    std::uniform_int_distribution<unsigned> pick (0, c.cluster_sz - 1);
+    Dom d = Dom::top ();
+    for (auto& cl : xs) {
+      d += (cl[0] >= 0);
+      d += (cl[0] <= 1000 + cst (rng));
+      for (unsigned i = 1; i < cl.size (); i++)
+        d += (cl[i-1] - cl[i] <= 0);
+      unsigned i = pick (rng), j = pick (rng);
+      if (i != j)
+        d += (cl[i] - cl[j] <= cst (rng));
+    }
+    return d;
+  }
+
+  // The clusters touched by round r
+  unsigned touched (unsigned r, unsigned k)
+  { return (r * c.touched + k) % c.clusters; }
+
+ public:
+  component_bench (const char* _graph, const config& _c)
+    : graph (_graph), c (_c), rng (_c.seed)
+  {
+    for (unsigned k = 0; k < c.clusters; k++) {
+      xs.push_back (vector<z_var> ());
+      for (unsigned i = 0; i < c.cluster_sz; i++)
+        xs.back ().push_back
+          (z_var (vfac["x" + std::to_string (k) + "_" + std::to_string (i)]));
+    }
+  }
+
+  void run (void)
+  {
+    Dom a = clustered_zone ();
+    {
+      steady_t::duration elapsed (0);
+      for (unsigned r = 0; r < c.rounds; r++) {
+        Dom b = a;
+        for (unsigned k = 0; k < c.touched; k++)
+          b.assign (xs[touched (r, k)][0].name (), xs[touched (r, k)][0] + 1);
+        auto start = steady_t::now ();
+        Dom j = a | b;
+        elapsed += steady_t::now () - start;
+      }
+      report ("join", c.rounds, elapsed);
+    }
+    {
+      steady_t::duration elapsed (0);
+      for (unsigned r = 0; r < c.rounds; r++) {
+        Dom b = a;
+        for (auto& cl : xs)
+          b.assign (cl[0].name (), cl[0] + 1);
+        auto start = steady_t::now ();
+        Dom j = a | b;
+        elapsed += steady_t::now () - start;
+      }
+      report ("join_all", c.rounds, elapsed);
+    }
+    {
+      steady_t::duration elapsed (0);
+      for (unsigned r = 0; r < c.rounds; r++) {
+        Dom b = Dom::top ();
+        for (unsigned k = 0; k < c.touched; k++) {
+          auto& cl = xs[touched (r, k)];
+          b += (cl.back () - cl[0] <= 50);
+        }
+        auto start = steady_t::now ();
+        Dom m = a & b;
+        elapsed += steady_t::now () - start;
+      }
+      report ("meet", c.rounds, elapsed);
+    }
+    {
+      steady_t::duration elapsed (0);
+      for (unsigned r = 0; r < c.rounds; r++) {
+        Dom b = a;
+        for (unsigned k = 0; k < c.touched; k++)
+          b.assign (xs[touched (r, k)][0].name (), xs[touched (r, k)][0] + 1);
+        auto start = steady_t::now ();
+        Dom w = a || b;
+        w.normalize ();
+        elapsed += steady_t::now () - start;
+      }
+      report ("widen", c.rounds, elapsed);
+    }
+    {
+      Dom head = a;
+      auto start = steady_t::now ();
+      for (unsigned r = 0; r < c.rounds; r++) {
+        Dom body = head;
+        for (unsigned k = 0; k < c.touched; k++)
+          body.assign (xs[touched (r, k)][0].name (), xs[touched (r, k)][0] + 1);
+        head = head | body;
+      }
+      report ("fixpoint", c.rounds, steady_t::now () - start);
+    }
+  }
+};
+
+// Run one configuration in a child process.
+template<typename Dom>
+void bench (const char* graph, const config& c)
+{
+  crab::outs().flush ();
+  pid_t pid = fork ();
+  if (pid == 0) {
+    component_bench<Dom> b (graph, c);
+    b.run ();
+    crab::outs().flush ();
+    _exit (0);
+  }
+  int status;
+  waitpid (pid, &status, 0);
+  if (!WIFEXITED (status) || WEXITSTATUS (status) != 0)
+    crab::errs() << graph << " failed\n";
+}
+
+template<SDBM_impl::GraphRep G>
+void bench_split (const char* graph, const config& c)
+{
+  bench<SplitDBM<z_number, varname_t, SDBM_impl::DefaultParams<z_number, G> > >
+    (graph, c);
+}
+
+int main (int argc, char** argv)
+{
+  config c;
+  c.clusters = (argc > 1 ? atoi (argv[1]) : 500);
+  c.cluster_sz = (argc > 2 ? atoi (argv[2]) : 4);
+  c.touched = (argc > 3 ? atoi (argv[3]) : 2);
+  c.rounds = (argc > 4 ? atoi (argv[4]) : 20);
+  c.seed = (argc > 5 ? atoi (argv[5]) : 42);
+  if (c.cluster_sz == 0 || c.clusters == 0) {
+    crab::errs() << "zone_components: empty configuration\n";
+    return 1;
+  }
+
+  crab::outs() << "graph,clusters,cluster_size,touched,op,ops,ms_per_op,max_rss_kb\n";
+
+  bench_split<SDBM_impl::GraphRep::adapt_ss> ("adapt_ss", c);
+  bench_split<SDBM_impl::GraphRep::cow_ss> ("cow_ss", c);
+  return 0;
+}
@@ -0,0 +1,229 @@
+#include "../common.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <new>
+#include <random>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace std;
+using namespace crab::cfg_impl;
+using namespace crab::domain_impl;
+
+// Compare the graph representations of SplitDBM and SparseDBM, with
+// both DefaultParams and SimpleParams, on synthetic zones.
+//
+// Usage: zone_graphs [num vars] [density] [rounds] [seed]
+//
+// density is the fraction of the num vars^2 variable pairs that are
+// constrained in each random zone. Each configuration runs in its own
+// process, so peak RSS is per configuration. Output is CSV, one line
+// per configuration and operation:
+//   domain,graph,params,vars,density,op,ops,ops_per_sec,allocs_per_op,max_rss_kb
+//
+// Operations:
+//   build     add the constraints of a random zone
+//   join      a | b
+//   meet      a & b
+//   widen     a || b followed by closure
+//   fixpoint  copy, assign and join, as at a loop head
+
+// Count allocations made through operator new. Neither operator is
+// inlined, so the compiler does not see malloc paired with delete
+// (or free with new) at each call site.
+static unsigned long num_allocs = 0;
+
+__attribute__((noinline))
+void* operator new (size_t sz)
+{
+  num_allocs++;
+  if (void* p = malloc (sz ? sz : 1))
+    return p;
+  throw std::bad_alloc ();
+}
+
+__attribute__((noinline))
+void operator delete (void* p) noexcept
+{
+  free (p);
+}
+
+struct config {
+  unsigned num_vars;
+  double density;
+  unsigned rounds;
+  unsigned seed;
+};
+
+static long max_rss_kb (void)
+{
+  struct rusage ru;
+  getrusage (RUSAGE_SELF, &ru);
+  return ru.ru_maxrss;
+}
+
+template<typename Dom>
+class zone_bench {
+  typedef std::chrono::steady_clock steady_t;
+
+  const char* dom_name;
+  const char* graph;
+  const char* params;
+  const config& c;
+  VariableFactory vfac;
+  vector<z_var> xs;
+  std::mt19937 rng;
+
+  struct measure {
+    steady_t::time_point start;
+    unsigned long allocs;
+    measure () : start (steady_t::now ()), allocs (num_allocs) { }
+  };
+
+  void report (const char* op, unsigned long ops, const measure& m)
+  {
+    double secs = std::chrono::duration<double> (steady_t::now () - m.start).count ();
+    unsigned long allocs = num_allocs - m.allocs;
+    crab::outs() << dom_name << "," << graph << "," << params << ","
+                 << c.num_vars << "," << c.density << "," << op << ","
+                 << ops << "," << (secs > 0 ? (long) (ops / secs) : 0) << ","
+                 << (ops ? allocs / ops : 0) << "," << max_rss_kb () << "\n";
+  }
+
+  Dom random_zone (void)
+  {
+    std::uniform_real_distribution<double> coin (0.0, 1.0);
+    std::uniform_int_distribution<int> cst (0, 100);
+    Dom d = Dom::top ();
+    for (unsigned i = 0; i < c.num_vars; i++) {
+      d += (xs[i] >= 0);
+      d += (xs[i] <= 1000 + cst (rng));
+      for (unsigned j = 0; j < c.num_vars; j++) {
+        if (i != j && coin (rng) < c.density)
+          d += (xs[i] - xs[j] <= cst (rng));
+      }
+    }
+    return d;
+  }
+
+ public:
+  zone_bench (const char* _dom_name, const char* _graph, const char* _params,
+              const config& _c)
+    : dom_name (_dom_name), graph (_graph), params (_params), c (_c),
+      rng (_c.seed)
+  {
+    for (unsigned k = 0; k < c.num_vars; k++)
+      xs.push_back (z_var (vfac["x" + std::to_string (k)]));
+  }
+
+  void run (void)
+  {
+    vector<Dom> zones;
+    {
+      measure m;
+      for (unsigned r = 0; r < c.rounds + 1; r++)
+        zones.push_back (random_zone ());
+      report ("build", zones.size (), m);
+    }
+    {
+      measure m;
+      for (unsigned r = 0; r < c.rounds; r++) {
+        Dom j = zones[r] | zones[r+1];
+      }
+      report ("join", c.rounds, m);
+    }
+    {
+      measure m;
+      for (unsigned r = 0; r < c.rounds; r++) {
+        Dom j = zones[r] & zones[r+1];
+      }
+      report ("meet", c.rounds, m);
+    }
+    {
+      measure m;
+      for (unsigned r = 0; r < c.rounds; r++) {
+        Dom w = zones[r] || zones[r+1];
+        w.normalize ();
+      }
+      report ("widen", c.rounds, m);
+    }
+    {
+      measure m;
+      Dom head = zones[0];
+      for (unsigned r = 0; r < c.rounds; r++) {
+        Dom body = head;
+        for (unsigned k = 0; k < c.num_vars; k += 4)
+          body.assign (xs[k].name (), xs[k] + 1);
+        head = head | body;
+      }
+      report ("fixpoint", c.rounds, m);
+    }
+  }
+};
+
+// Run one configuration in a child process.
+template<typename Dom>
+void bench (const char* dom_name, const char* graph, const char* params,
+            const config& c)
+{
+  crab::outs().flush ();
+  pid_t pid = fork ();
+  if (pid == 0) {
+    zone_bench<Dom> b (dom_name, graph, params, c);
+    b.run ();
+    crab::outs().flush ();
+    _exit (0);
+  }
+  int status;
+  waitpid (pid, &status, 0);
+  if (!WIFEXITED (status) || WEXITSTATUS (status) != 0)
+    crab::errs() << dom_name << "," << graph << "," << params << " failed\n";
+}
+
+template<SDBM_impl::GraphRep G>
+void bench_split (const char* graph, const config& c)
+{
+  bench<SplitDBM<z_number, varname_t, SDBM_impl::DefaultParams<z_number, G> > >
+    ("SplitDBM", graph, "DefaultParams", c);
+  bench<SplitDBM<z_number, varname_t, SDBM_impl::SimpleParams<z_number, G> > >
+    ("SplitDBM", graph, "SimpleParams", c);
+}
+
+template<SpDBM_impl::GraphRep G>
+void bench_sparse (const char* graph, const config& c)
+{
+  bench<SparseDBM<z_number, varname_t, SpDBM_impl::DefaultParams<z_number, G> > >
+    ("SparseDBM", graph, "DefaultParams", c);
+  bench<SparseDBM<z_number, varname_t, SpDBM_impl::SimpleParams<z_number, G> > >
+    ("SparseDBM", graph, "SimpleParams", c);
+}
+
+int main (int argc, char** argv)
+{
+  config c;
+  c.num_vars = (argc > 1 ? atoi (argv[1]) : 30);
+  c.density = (argc > 2 ? atof (argv[2]) : 0.2);
+  c.rounds = (argc > 3 ? atoi (argv[3]) : 50);
+  c.seed = (argc > 4 ? atoi (argv[4]) : 42);
+
+  crab::outs() << "domain,graph,params,vars,density,op,ops,ops_per_sec,allocs_per_op,max_rss_kb\n";
+
+  bench_split<SDBM_impl::GraphRep::ss> ("ss", c);
+  bench_split<SDBM_impl::GraphRep::adapt_ss> ("adapt_ss", c);
+  bench_split<SDBM_impl::GraphRep::pt> ("pt", c);
+  bench_split<SDBM_impl::GraphRep::ht> ("ht", c);
+  bench_split<SDBM_impl::GraphRep::dense> ("dense", c);
+  bench_split<SDBM_impl::GraphRep::auto_dense> ("auto_dense", c);
+  bench_split<SDBM_impl::GraphRep::cow_ss> ("cow_ss", c);
+
+  bench_sparse<SpDBM_impl::GraphRep::ss> ("ss", c);
+  bench_sparse<SpDBM_impl::GraphRep::adapt_ss> ("adapt_ss", c);
+  bench_sparse<SpDBM_impl::GraphRep::pt> ("pt", c);
+  bench_sparse<SpDBM_impl::GraphRep::ht> ("ht", c);
+  bench_sparse<SpDBM_impl::GraphRep::dense> ("dense", c);
+  bench_sparse<SpDBM_impl::GraphRep::auto_dense> ("auto_dense", c);
+  bench_sparse<SpDBM_impl::GraphRep::cow_ss> ("cow_ss", c);
+  return 0;
+}
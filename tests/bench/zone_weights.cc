@@ -0,0 +1,110 @@
+#include "../common.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <sys/resource.h>
+
+using namespace std;
+using namespace crab::analyzer;
+using namespace crab::cfg_impl;
+using namespace crab::domain_impl;
+
+// Compare the zone domain storing edge weights as long and as
+// int32_t (both with the copy-on-write representation).
+//
+// Usage: zone_weights [long|int32] [num vars] [num loops]
+//
+// Peak RSS is per process, so run one configuration per invocation
+// to compare memory. Output is one CSV line:
+//   domain,weights,vars,loops,time_ms,max_rss_kb
+
+typedef SDBM_impl::DefaultParams<z_number, SDBM_impl::GraphRep::cow_ss, long> SplitDBMLong;
+typedef SplitDBM<z_number, varname_t, SplitDBMLong> sdbm_long_domain_t;
+typedef SDBM_impl::DefaultParams<z_number, SDBM_impl::GraphRep::cow_ss, int32_t> SplitDBMInt32;
+typedef SplitDBM<z_number, varname_t, SplitDBMInt32> sdbm_int32_domain_t;
+
+// A sequence of loops. Each loop increments a counter and keeps
+// num_vars variables related to it, so the zone is dense and is
+// joined and widened at every head.
+cfg_t* prog (VariableFactory &vfac, unsigned num_vars, unsigned num_loops)
+{
+  cfg_t* cfg = new cfg_t("entry","ret");
+  basic_block_t& entry = cfg->insert ("entry");
+
+  z_var n(vfac["n"]);
+  vector<z_var> xs;
+  for (unsigned k = 0; k < num_vars; k++)
+    xs.push_back (z_var (vfac["x" + std::to_string (k)]));
+
+  entry.havoc (n.name ());
+  entry.assume (n >= 1);
+  entry.assume (n <= 1000);
+
+  basic_block_t* prev = &entry;
+  for (unsigned l = 0; l < num_loops; l++) {
+    string suffix = std::to_string (l);
+    z_var i(vfac["i" + suffix]);
+    basic_block_t& head = cfg->insert ("head" + suffix);
+    basic_block_t& body = cfg->insert ("body" + suffix);
+    basic_block_t& exit = cfg->insert ("exit" + suffix);
+    prev->assign (i, 0);
+    for (unsigned k = 0; k < num_vars; k++)
+      prev->assign (xs[k], i + k);
+    *prev >> head;
+    head >> body;
+    head >> exit;
+    body >> head;
+    body.assume (i <= n - 1);
+    body.add (i, i, 1);
+    for (unsigned k = 0; k < num_vars; k++)
+      body.add (xs[k].name (), xs[k].name (), 1);
+    exit.assume (i >= n);
+    prev = &exit;
+  }
+
+  basic_block_t& ret = cfg->insert ("ret");
+  *prev >> ret;
+  // Does not fit in 32 bits: the int32 run must drop it soundly.
+  ret.assume (n <= z_number (5000000000LL));
+  return cfg;
+}
+
+static long max_rss_kb (void)
+{
+  struct rusage ru;
+  getrusage (RUSAGE_SELF, &ru);
+  return ru.ru_maxrss;
+}
+
+template<typename Dom>
+void run (const char* weights, unsigned num_vars, unsigned num_loops)
+{
+  VariableFactory vfac;
+  cfg_t* cfg = prog (vfac, num_vars, num_loops);
+
+  auto start = std::chrono::steady_clock::now ();
+  typename NumFwdAnalyzer <cfg_ref_t, Dom, VariableFactory>::type a (*cfg,vfac,nullptr);
+  Dom inv = Dom::top ();
+  a.Run (inv);
+  auto end = std::chrono::steady_clock::now ();
+  long ms = std::chrono::duration_cast<std::chrono::milliseconds> (end - start).count ();
+
+  crab::outs() << inv.getDomainName () << "," << weights << ","
+               << num_vars << "," << num_loops << ","
+               << ms << "," << max_rss_kb () << "\n";
+  delete cfg;
+}
+
+int main (int argc, char** argv)
+{
+  const char* weights = (argc > 1 ? argv[1] : "long");
+  unsigned num_vars = (argc > 2 ? atoi (argv[2]) : 40);
+  unsigned num_loops = (argc > 3 ? atoi (argv[3]) : 20);
+
+  if (strcmp (weights, "int32") == 0)
+    run<sdbm_int32_domain_t> ("int32", num_vars, num_loops);
+  else
+    run<sdbm_long_domain_t> ("long", num_vars, num_loops);
+  return 0;
+}
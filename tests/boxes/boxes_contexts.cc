@@ -0,0 +1,132 @@
+#include "../common.hpp"
+#include <thread>
+
+using namespace std;
+using namespace crab::analyzer;
+using namespace crab::cfg_impl;
+using namespace crab::domain_impl;
+
+// Boxes values of different ldd contexts: the contexts installed with
+// set_context, the garbage collection of a context, and the binary
+// operations on values computed by different threads.
+
+typedef boxes_domain_t::context_ptr context_ptr;
+using crab::domains::ldd::getLddManager;
+
+// inv implies cst iff inv and not cst is bottom
+static bool implies (boxes_domain_t inv, z_lin_cst_t cst) {
+  inv += cst.negate ();
+  return inv.is_bottom ();
+}
+
+static bool in_context (boxes_domain_t inv, context_ptr ctx) {
+  return getLddManager (inv.getLdd ()) == ctx->ldd_man ();
+}
+
+// x is in [lb,lb+9] or in [lb+100,lb+109]
+static boxes_domain_t two_boxes (z_var x, int lb) {
+  boxes_domain_t inv1 = boxes_domain_t::top ();
+  inv1 += (x >= lb);
+  inv1 += (x <= lb + 9);
+  boxes_domain_t inv2 = boxes_domain_t::top ();
+  inv2 += (x >= lb + 100);
+  inv2 += (x <= lb + 109);
+  return inv1 | inv2;
+}
+
+static void test_set_context (VariableFactory& vfac) {
+  crab::outs () << "set_context\n";
+  z_var x (vfac ["x"]);
+  context_ptr old_ctx = boxes_domain_t::get_context ();
+  boxes_domain_t before = boxes_domain_t::top ();
+  before += (x >= 1);
+
+  context_ptr ctx = boxes_domain_t::make_context (crab::domains::ldd_context_params (50));
+  boxes_domain_t::set_context (ctx);
+  TEST_CHECK (boxes_domain_t::get_context () == ctx);
+  boxes_domain_t after = boxes_domain_t::top ();
+  after += (x <= 5);
+  TEST_CHECK (in_context (after, ctx));
+  TEST_CHECK (in_context (boxes_domain_t::bottom (), ctx));
+  // the values created before keep their context
+  TEST_CHECK (in_context (before, old_ctx));
+  TEST_CHECK (in_context (boxes_domain_t::top (old_ctx), old_ctx));
+
+  boxes_domain_t::set_context (old_ctx);
+  // the value keeps the context alive after set_context drops it
+  ctx.reset ();
+  boxes_domain_t m = before & after;
+  TEST_CHECK (in_context (m, old_ctx));
+  TEST_CHECK (implies (m, x >= 1) && implies (m, x <= 5));
+}
+
+static void test_gc (VariableFactory& vfac) {
+  crab::outs () << "garbage collection\n";
+  z_var x (vfac ["x"]), y (vfac ["y"]);
+  crab::domains::ldd_context_params params (50);
+  params.gc_period = 1;
+  context_ptr old_ctx = boxes_domain_t::get_context ();
+  boxes_domain_t::set_context (boxes_domain_t::make_context (params));
+  unsigned gcs = crab::CrabStats::get ("Boxes.count.gc");
+  // every iteration leaves the ldds of the previous one dead
+  boxes_domain_t inv = boxes_domain_t::top ();
+  for (int i = 0; i < 200; i++) {
+    inv = two_boxes (x, i);
+    inv.assign (y.name (), z_lin_t (x) + i);
+    inv -= x.name ();
+  }
+#ifdef HAVE_STATS
+  TEST_CHECK (crab::CrabStats::get ("Boxes.count.gc") > gcs);
+#endif
+  // the live values survive the collections
+  TEST_CHECK (implies (inv, y >= 398) && implies (inv, y <= 507));
+  TEST_CHECK (!implies (inv, y <= 407));
+  boxes_domain_t::set_context (old_ctx);
+}
+
+static void test_threads (VariableFactory& vfac) {
+  crab::outs () << "values of two threads\n";
+  z_var x (vfac ["x"]);
+  boxes_domain_t inv [2];
+  // each thread has its own context
+  std::thread t1 ([&] { inv [0] = two_boxes (x, 0); });
+  t1.join ();
+  std::thread t2 ([&] { inv [1] = two_boxes (x, 1000); });
+  t2.join ();
+  TEST_CHECK (!in_context (inv [0], boxes_domain_t::get_context ()));
+  TEST_CHECK (getLddManager (inv [0].getLdd ()) != getLddManager (inv [1].getLdd ()));
+
+  // the results are in the context of the left operand, and keep the
+  // disjunctions of the right one
+  boxes_domain_t j = inv [0] | inv [1];
+  TEST_CHECK (getLddManager (j.getLdd ()) == getLddManager (inv [0].getLdd ()));
+  TEST_CHECK (implies (j, x >= 0) && implies (j, x <= 1109));
+  boxes_domain_t gap = j;
+  gap += (x >= 10);
+  gap += (x <= 99);
+  TEST_CHECK (gap.is_bottom ());
+  gap = j;
+  gap += (x >= 1010);
+  gap += (x <= 1099);
+  TEST_CHECK (gap.is_bottom ());
+  TEST_CHECK (inv [0] <= j && inv [1] <= j && !(j <= inv [1]));
+
+  boxes_domain_t here = boxes_domain_t::top ();
+  here += (x >= 5);
+  boxes_domain_t m = here & inv [0];
+  TEST_CHECK (in_context (m, boxes_domain_t::get_context ()));
+  TEST_CHECK (implies (m, x >= 5) && implies (m, x <= 109) && !implies (m, x <= 9));
+  TEST_CHECK ((here & inv [1]) <= inv [1]);
+
+  boxes_domain_t w = inv [0] || j;
+  TEST_CHECK (inv [0] <= w && j <= w);
+}
+
+int main (int argc, char** argv) {
+  SET_LOGGER(argc,argv)
+  VariableFactory vfac;
+  test_set_context (vfac);
+  test_gc (vfac);
+  test_threads (vfac);
+  return TEST_RESULT ();
+}
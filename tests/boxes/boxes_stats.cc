@@ -0,0 +1,63 @@
+#include "../common.hpp"
+
+using namespace std;
+using namespace crab::analyzer;
+using namespace crab::cfg_impl;
+using namespace crab::domain_impl;
+
+// The node counts of the boxes statistics are those of the last
+// record, not the maxima: they go down once the nodes are collected,
+// and a new context reports its own counts.
+
+typedef boxes_domain_t::context_ptr context_ptr;
+
+// x is in one of n disjoint boxes, with y in a different range in each
+static boxes_domain_t boxes (z_var x, z_var y, int n) {
+  boxes_domain_t res = boxes_domain_t::bottom ();
+  for (int i = 0; i < n; i++) {
+    boxes_domain_t b = boxes_domain_t::top ();
+    b += (x >= 10 * i);
+    b += (x <= 10 * i + 5);
+    b += (y >= i);
+    b += (y <= 2 * i);
+    res = res | b;
+  }
+  return res;
+}
+
+int main (int argc, char** argv) {
+  SET_LOGGER(argc,argv)
+#ifdef HAVE_STATS
+  VariableFactory vfac;
+  z_var x (vfac ["x"]), y (vfac ["y"]), z (vfac ["z"]);
+  crab::domains::ldd_context_params params (50);
+  // record the statistics after every operation
+  params.gc_period = 1;
+  params.reorder_method = CUDD_REORDER_NONE;
+  context_ptr ctx = boxes_domain_t::make_context (params);
+  boxes_domain_t::set_context (ctx);
+
+  boxes_domain_t big = boxes (x, y, 200);
+  unsigned live_big = crab::CrabStats::get ("Boxes.nodes.live");
+  unsigned peak_big = crab::CrabStats::get ("Boxes.nodes.peak");
+  crab::outs () << "live " << live_big << " peak " << peak_big << "\n";
+  TEST_CHECK (live_big > 200 && peak_big >= live_big);
+
+  // big is released and collected by the next operations
+  big = boxes_domain_t::top ();
+  boxes_domain_t small = boxes (z, y, 2);
+  unsigned live_small = crab::CrabStats::get ("Boxes.nodes.live");
+  crab::outs () << "live " << live_small << "\n";
+  TEST_CHECK (live_small < live_big / 2);
+  TEST_CHECK (crab::CrabStats::get ("Boxes.nodes.peak") >= peak_big);
+
+  // a new context reports its own peak
+  boxes_domain_t::set_context (boxes_domain_t::make_context (params));
+  boxes_domain_t other = boxes (z, y, 2);
+  unsigned peak_other = crab::CrabStats::get ("Boxes.nodes.peak");
+  crab::outs () << "peak " << peak_other << "\n";
+  TEST_CHECK (peak_other < peak_big);
+  boxes_domain_t::set_context (ctx);
+#endif
+  return TEST_RESULT ();
+}
@@ -0,0 +1,115 @@
+#include "../common.hpp"
+#include <crab/cg/CgBgl.hpp>
+#include <crab/analysis/graphs/SccgBgl.hpp>
+#include <crab/analysis/InterFwdAnalyzer.hpp>
+#include <crab/checkers/BaseProperty.hpp>
+#include <crab/checkers/Assertion.hpp>
+#include <crab/checkers/Checker.hpp>
+
+#include <sstream>
+
+using namespace std;
+using namespace crab::analyzer;
+using namespace crab::cfg_impl;
+using namespace crab::domain_impl;
+using namespace crab::checker;
+
+// The assertions of a function analyzed with several calling contexts
+// are counted once, with the results of all the contexts, so the
+// totals are the same as with a single context.
+
+typedef CallGraph<cfg_ref_t> callgraph_t;
+typedef CallGraph_Ref<callgraph_t> callgraph_ref_t;
+typedef InterFwdAnalyzer<callgraph_ref_t, VariableFactory,
+                         dbm_domain_t, interval_domain_t> inter_analyzer_t;
+typedef InterChecker<inter_analyzer_t> inter_checker_t;
+typedef AssertPropertyChecker<inter_analyzer_t> assert_checker_t;
+
+cfg_t* foo (VariableFactory &vfac) {
+  vector<pair<varname_t,VariableType> > params;
+  params.push_back (make_pair (vfac["x"], INT_TYPE));
+  FunctionDecl<varname_t> decl (INT_TYPE, vfac["foo"], params);
+  z_var x (vfac ["x"]), y (vfac ["y"]);
+  cfg_t* cfg = new cfg_t ("entry", "exit", decl);
+  basic_block_t& entry = cfg->insert ("entry");
+  basic_block_t& some = cfg->insert ("some");
+  basic_block_t& none = cfg->insert ("none");
+  basic_block_t& big = cfg->insert ("big");
+  basic_block_t& exit = cfg->insert ("exit");
+  entry >> some; entry >> none; entry >> big; entry >> exit;
+  some >> exit; none >> exit; big >> exit;
+  // safe in all the contexts
+  entry.assertion (x >= 0);
+  entry.assertion (x <= 10);
+  entry.assign (y, x);
+  // an error only with x = 0. The failing assertions are on paths
+  // of their own so that the summary of foo does not assume them.
+  some.assertion (x >= 1, crab::cfg::DebugInfo ("foo.c", 3, 5));
+  // an error in all the contexts
+  none.assertion (x >= 6, crab::cfg::DebugInfo ("foo.c", 4, 5));
+  // unreachable in all the contexts
+  big.assume (x >= 100);
+  big.assertion (x <= 0);
+  exit.ret (vfac ["y"], INT_TYPE);
+  return cfg;
+}
+
+// calls foo with 1, 5 and 0
+cfg_t* m (VariableFactory &vfac) {
+  vector<pair<varname_t,VariableType> > params;
+  FunctionDecl<varname_t> decl (INT_TYPE, vfac["main"], params);
+  cfg_t* cfg = new cfg_t ("entry", "entry", decl);
+  basic_block_t& entry = cfg->insert ("entry");
+  int args [] = { 1, 5, 0 };
+  for (unsigned i = 0; i < 3; i++) {
+    string a = "a" + std::to_string (i), r = "r" + std::to_string (i);
+    entry.assign (z_var (vfac [a]), args [i]);
+    vector<pair<varname_t,VariableType> > actuals;
+    actuals.push_back (make_pair (vfac [a], INT_TYPE));
+    entry.callsite (make_pair (vfac [r], INT_TYPE), vfac ["foo"], actuals);
+  }
+  entry.ret (vfac ["r0"], INT_TYPE);
+  return cfg;
+}
+
+static string check (callgraph_t& cg, cfg_t* f, unsigned max_ctxs) {
+  VariableFactory vfac;
+  inter_analyzer_t a (cg, vfac, nullptr);
+  a.set_max_contexts (max_ctxs);
+  a.Run ();
+  crab::outs () << "foo analyzed with " << a.get_num_contexts (*f) << " contexts\n";
+  TEST_CHECK (a.get_num_contexts (*f) == std::min (max_ctxs, 3U));
+  typename inter_checker_t::prop_checker_ptr prop (new assert_checker_t (0));
+  inter_checker_t checker (a, {prop});
+  checker.Run ();
+  ostringstream o;
+  checker.Show (o);
+  crab::outs () << o.str ();
+  return o.str ();
+}
+
+int main (int argc, char** argv) {
+  SET_LOGGER(argc,argv)
+  VariableFactory vfac;
+  cfg_t* f = foo (vfac);
+  cfg_t* main_cfg = m (vfac);
+  vector<cfg_ref_t> cfgs;
+  cfgs.push_back (*f);
+  cfgs.push_back (*main_cfg);
+  callgraph_t cg (cfgs);
+
+  string expected =
+      "user-defined assertion checker\n"
+      "2  Number of total safe checks\n"
+      "1  Number of total error checks\n"
+      "1  Number of total warning checks\n"
+      "1  Number of total unreachable checks\n"
+      "error: foo.c   line 4 col 5\n"
+      "warning: foo.c   line 3 col 5\n";
+  TEST_CHECK (check (cg, f, 1) == expected);
+  TEST_CHECK (check (cg, f, 4) == expected);
+
+  delete f;
+  delete main_cfg;
+  return TEST_RESULT ();
+}
@@ -10,6 +10,7 @@
 #include <crab/analysis/FwdAnalyzer.hpp>
 #include <crab/analysis/Pointer.hpp>
 #include <crab/analysis/Liveness.hpp>
+#include <crab/analysis/VarPacking.hpp>
 
 #include <crab/domains/linear_constraints.hpp> 
 #include <crab/domains/intervals.hpp>                      
@@ -22,6 +23,7 @@
 #include <crab/domains/array_graph.hpp>                      
 #include <crab/domains/array_smashing.hpp>
 #include <crab/domains/combined_domains.hpp>                      
+#include <crab/domains/var_packing.hpp>
 
 #include <boost/program_options.hpp>
 
@@ -74,6 +76,8 @@ namespace crab {
     typedef term_domain<term::TDomInfo<z_number, varname_t, sdbm_domain_t> > term_dbm_t;
     typedef term_domain<term::TDomInfo<z_number, varname_t, dis_interval_domain_t> > term_dis_int_t;
     typedef reduced_numerical_domain_product2<term_dis_int_t, sdbm_domain_t> num_domain_t; 
+    typedef reduced_numerical_domain_product2<term_dis_int_t, sdbm_domain_t, true> lazy_num_domain_t; 
+    typedef var_packing_domain<sdbm_domain_t> packed_sdbm_domain_t;
     // Array domains
     typedef array_graph_domain<sdbm_domain_t, interval_domain_t> array_graph_domain_t;
     typedef array_smashing<dis_interval_domain_t> array_smashing_t;
@@ -102,4 +106,24 @@ namespace {
       crab::CrabEnableLog (loggers [i]); }                                                            
 }                           
 
+namespace {
+
+// Checks made by the test programs. A failed check is reported with
+// its line and makes TEST_RESULT() return a non-zero exit code.
+inline unsigned& test_failures () {
+  static unsigned failures = 0;
+  return failures;
+}
+
+#define TEST_CHECK(COND)                                                \
+  do {                                                                  \
+    if (!(COND)) {                                                      \
+      crab::outs() << "FAILED: " << #COND << " (line " << __LINE__ << ")\n"; \
+      test_failures ()++;                                               \
+    }                                                                   \
+  } while (0)
+
+#define TEST_RESULT() (test_failures () == 0 ? 0 : 1)
+}
+
 #endif 
@@ -0,0 +1,164 @@
+#include "../common.hpp"
+
+using namespace std;
+using namespace crab::domains;
+using namespace ikos;
+
+// Checks of the bound on the number of disjuncts and of the meet of
+// dis_interval values.
+
+typedef interval <z_number> interval_t;
+// fewer than 4 disjuncts
+typedef dis_interval <z_number, 4> dis_interval_t;
+// practically unbounded
+typedef dis_interval <z_number, 1000> dis_interval_big_t;
+
+template<typename D>
+static D make (const vector<pair<int,int> >& l) {
+  D r = D::bottom ();
+  for (auto p : l)
+    r = r | D (interval_t (p.first, p.second));
+  return r;
+}
+
+template<typename D>
+static vector<interval_t> intervals (const D& d) {
+  return vector<interval_t> (d.begin (), d.end ());
+}
+
+template<typename D>
+static bool same (const D& d, const vector<pair<int,int> >& l) {
+  vector<interval_t> is = intervals (d);
+  if (!d.is_finite () || is.size () != l.size ())
+    return false;
+  for (unsigned i = 0; i < l.size (); i++)
+    if (!(is [i] == interval_t (l [i].first, l [i].second)))
+      return false;
+  return true;
+}
+
+static void test_merge_closest () {
+  crab::outs () << "merge closest\n";
+  dis_interval_t r = make<dis_interval_t> ({ {0,1}, {10,12}, {14,15} });
+  TEST_CHECK (same (r, { {0,1}, {10,12}, {14,15} }));
+  // a fourth interval reaches the limit: the gap of 1 between
+  // [10,12] and [14,15] is the smallest one
+  r = r | dis_interval_t (interval_t (30,31));
+  TEST_CHECK (same (r, { {0,1}, {10,15}, {30,31} }));
+  r = r | dis_interval_t (interval_t (50,50));
+  TEST_CHECK (same (r, { {0,15}, {30,31}, {50,50} }));
+  // ties are broken towards the left
+  r = make<dis_interval_t> ({ {0,0}, {5,5}, {10,10}, {15,15} });
+  TEST_CHECK (same (r, { {0,5}, {10,10}, {15,15} }));
+  // unbounded extremes are kept
+  r = make<dis_interval_t> ({ {20,20}, {30,30} });
+  r = r | dis_interval_t (interval_t (bound<z_number>::minus_infinity (), 0));
+  r = r | dis_interval_t (interval_t (100, bound<z_number>::plus_infinity ()));
+  TEST_CHECK (r.is_finite () && intervals (r).size () == 3);
+  TEST_CHECK (intervals (r) [0].lb ().is_infinite ());
+  TEST_CHECK (intervals (r) [2].ub ().is_infinite ());
+  TEST_CHECK (intervals (r) [1] == interval_t (20, 30));
+
+  // the result is always an upper bound of the operands
+  dis_interval_t a = make<dis_interval_t> ({ {0,0}, {4,4}, {8,8} });
+  dis_interval_t b = make<dis_interval_t> ({ {2,2}, {6,6}, {10,10} });
+  dis_interval_t j = a | b;
+  TEST_CHECK (intervals (j).size () < 4);
+  TEST_CHECK (a <= j && b <= j);
+}
+
+// the meet of every pair of intervals
+template<typename D>
+static vector<interval_t> pairwise_meet (const D& x, const D& y) {
+  vector<interval_t> res;
+  for (auto i : x)
+    for (auto j : y) {
+      interval_t m = i & j;
+      if (!m.is_bottom ())
+        res.push_back (m);
+    }
+  return res;
+}
+
+static void test_meet () {
+  crab::outs () << "meet\n";
+  dis_interval_big_t x = make<dis_interval_big_t> ({ {0,5}, {10,20}, {30,30}, {40,100} });
+  dis_interval_big_t y = make<dis_interval_big_t> ({ {3,12}, {18,42}, {60,61}, {70,80}, {90,200} });
+  dis_interval_big_t m = x & y;
+  TEST_CHECK (same (m, { {3,5}, {10,12}, {18,20}, {30,30}, {40,42}, {60,61}, {70,80}, {90,100} }));
+  TEST_CHECK (intervals (m) == pairwise_meet (x, y));
+  TEST_CHECK ((y & x) == m);
+  TEST_CHECK (m <= x && m <= y);
+
+  // disjoint values
+  dis_interval_big_t z = make<dis_interval_big_t> ({ {6,9}, {21,29}, {31,39} });
+  TEST_CHECK ((x & z).is_bottom ());
+
+  // compare with the meet of every pair on values built from a
+  // pseudo-random sequence
+  unsigned seed = 12345;
+  auto next = [&seed] () { seed = seed * 1103515245 + 12345; return (seed >> 16) % 100; };
+  for (int round = 0; round < 200; round++) {
+    vector<pair<int,int> > l1, l2;
+    for (int k = 0; k < 6; k++) {
+      int lb = next (), len = next () % 10;
+      l1.push_back (make_pair (lb, lb + len));
+      lb = next (); len = next () % 10;
+      l2.push_back (make_pair (lb, lb + len));
+    }
+    dis_interval_big_t a = make<dis_interval_big_t> (l1);
+    dis_interval_big_t b = make<dis_interval_big_t> (l2);
+    dis_interval_big_t ab = a & b;
+    vector<interval_t> expected = pairwise_meet (a, b);
+    if (expected.empty ())
+      TEST_CHECK (ab.is_bottom ());
+    else
+      TEST_CHECK (intervals (ab) == expected);
+    // every point of both values is in the meet and conversely
+    for (int p = -1; p <= 110; p++) {
+      dis_interval_big_t pt (interval_t (p, p));
+      bool in_both = (pt <= a) && (pt <= b);
+      TEST_CHECK (in_both == (pt <= ab));
+    }
+  }
+}
+
+static void test_widening () {
+  crab::outs () << "widening\n";
+  // the extremes are widened and the intervals between are kept
+  dis_interval_t a = make<dis_interval_t> ({ {0,0}, {5,5}, {10,10} });
+  dis_interval_t b = make<dis_interval_t> ({ {0,0}, {5,5}, {10,11} });
+  dis_interval_t w = a || b;
+  TEST_CHECK (w.is_finite () && intervals (w).size () == 3);
+  TEST_CHECK (intervals (w) [2].ub ().is_infinite ());
+  TEST_CHECK (a <= w && b <= w);
+
+  // at the limit all the intervals are merged
+  dis_interval_t c = make<dis_interval_t> ({ {0,0}, {3,3}, {10,10} });
+  dis_interval_t d = make<dis_interval_t> ({ {0,0}, {7,7}, {10,10} });
+  w = c || d;
+  TEST_CHECK (same (w, { {0,10} }));
+  TEST_CHECK (c <= w && d <= w);
+
+  // an increasing chain that adds a new interval at each step
+  // stabilizes
+  dis_interval_t x = make<dis_interval_t> ({ {0,0}, {1000,1000} });
+  int steps = 0;
+  for (int k = 1; k < 100; k++) {
+    dis_interval_t y = x | dis_interval_t (interval_t (10*k, 10*k));
+    dis_interval_t next = x || y;
+    TEST_CHECK (x <= next && y <= next);
+    if (next <= x) break;
+    x = next;
+    steps++;
+  }
+  TEST_CHECK (steps < 5);
+}
+
+int main (int argc, char** argv) {
+  SET_LOGGER(argc,argv)
+  test_merge_closest ();
+  test_meet ();
+  test_widening ();
+  return TEST_RESULT ();
+}
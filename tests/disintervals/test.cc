@@ -92,6 +92,24 @@ int main (int argc, char**argv){
   //   crab::outs() << r << "\n";
   // }
 
+  {
+    // At most 3 disjuncts (fewer than 4): the closest intervals are
+    // merged first.
+    typedef dis_interval <z_number, 4> dis_interval_t;
+    typedef interval <z_number> interval_t;
+
+    dis_interval_t r = dis_interval_t::bottom ();
+    r = r | dis_interval_t (interval_t (0,1));
+    r = r | dis_interval_t (interval_t (10,12));
+    r = r | dis_interval_t (interval_t (14,15));
+    r = r | dis_interval_t (interval_t (30,31));
+    crab::outs() << r << "\n";
+    r = r | dis_interval_t (interval_t (50,50));
+    crab::outs() << r << "\n";
+    dis_interval_t m = r & dis_interval_t (interval_t (1,40));
+    crab::outs() << m << "\n";
+  }
+
   {
     VariableFactory vfac;
     cfg_t* cfg = prog (vfac);
@@ -0,0 +1,98 @@
+#include "../common.hpp"
+#include <crab/analysis/SummaryDB.hpp>
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <unistd.h>
+
+using namespace std;
+using namespace crab::analyzer;
+using namespace crab::cfg_impl;
+using namespace crab::domain_impl;
+
+// A summary database whose files were truncated or corrupted: loading
+// them is a cache miss, not an error.
+
+typedef SummaryDB<cfg_ref_t, dbm_domain_t> summ_db_t;
+
+static string read_file (const string& path) {
+  ifstream in (path.c_str ());
+  ostringstream o;
+  o << in.rdbuf ();
+  return o.str ();
+}
+
+static void write_file (const string& path, const string& s) {
+  ofstream out (path.c_str ());
+  out << s;
+}
+
+// the contents with the first occurrence of from replaced by to
+static string replace (string s, const string& from, const string& to) {
+  size_t pos = s.find (from);
+  TEST_CHECK (pos != string::npos);
+  if (pos != string::npos)
+    s.replace (pos, from.size (), to);
+  return s;
+}
+
+int main (int argc, char** argv) {
+  SET_LOGGER(argc,argv)
+  VariableFactory vfac;
+  z_var x (vfac ["x"]), y (vfac ["y"]);
+  vector<varname_t> vars = { x.name (), y.name () };
+
+  char dir [] = "/tmp/crab_summ_XXXXXX";
+  if (!mkdtemp (dir)) return 1;
+  summ_db_t db (dir);
+  summ_db_t::key_t key = 0x1234;
+  string path = string (dir) + "/0000000000001234.sum";
+
+  dbm_domain_t sum = dbm_domain_t::top ();
+  sum += (x >= -3);
+  sum += (x <= 5);
+  sum += (y - x <= 2);
+  db.store (key, vars, sum);
+  string good = read_file (path);
+  crab::outs () << good;
+
+  dbm_domain_t loaded;
+  TEST_CHECK (db.load (key, vars, loaded));
+  TEST_CHECK (loaded <= sum && sum <= loaded);
+
+  // the file ends in the middle of a constraint
+  vector<string> corrupted;
+  corrupted.push_back (good.substr (0, good.size () - 4));
+  corrupted.push_back (good.substr (0, good.size () / 2));
+  corrupted.push_back (good.substr (0, good.rfind (' ')));
+  // numbers that are not numbers
+  corrupted.push_back (replace (good, " -3 ", " -x3 "));
+  corrupted.push_back (replace (good, " -3 ", " - "));
+  corrupted.push_back (replace (good, " -5 ", " -5a "));
+  corrupted.push_back (replace (good, " -5 ", " 0x5 "));
+  corrupted.push_back (replace (good, " 1 ", " one "));
+  // a variable out of range and an unknown kind
+  corrupted.push_back (replace (good, " 1\n", " 7\n"));
+  corrupted.push_back (replace (good, "<=", "<<"));
+  corrupted.push_back ("");
+  for (auto const& c: corrupted) {
+    write_file (path, c);
+    dbm_domain_t inv = dbm_domain_t::top ();
+    inv += (x >= 10);
+    if (db.load (key, vars, inv)) {
+      crab::outs () << "loaded a corrupted summary:\n" << c << "\n";
+      TEST_CHECK (false);
+    }
+  }
+  TEST_CHECK (db.num_loaded () == 1);
+
+  write_file (path, good);
+  TEST_CHECK (db.load (key, vars, loaded));
+  TEST_CHECK (loaded <= sum && sum <= loaded);
+
+  std::remove (path.c_str ());
+  rmdir (dir);
+  return TEST_RESULT ();
+}
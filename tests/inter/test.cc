@@ -4,6 +4,12 @@
 #include <crab/analysis/graphs/SccgBgl.hpp>
 
 #include <crab/analysis/InterFwdAnalyzer.hpp>
+#include <crab/analysis/SummaryDB.hpp>
+
+#include <cstdio>
+#include <cstdlib>
+#include <dirent.h>
+#include <unistd.h>
 
 using namespace std;
 using namespace crab::analyzer;
@@ -11,7 +17,20 @@ using namespace crab::cfg_impl;
 using namespace crab::domain_impl;
 using namespace crab::cg;
 
-cfg_t* foo (VariableFactory &vfac) {
+// Remove the directory of a summary database and its files
+void remove_dir (const std::string &dir) {
+  if (DIR* d = opendir (dir.c_str ())) {
+    while (struct dirent* e = readdir (d)) {
+      std::string name (e->d_name);
+      if (name != "." && name != "..")
+        std::remove ((dir + "/" + name).c_str ());
+    }
+    closedir (d);
+  }
+  rmdir (dir.c_str ());
+}
+
+cfg_t* foo (VariableFactory &vfac, int k = 1) {
   vector<pair<varname_t,VariableType> > params;
   params.push_back (make_pair (vfac["x"], INT_TYPE));
   FunctionDecl<varname_t> decl (INT_TYPE, vfac["foo"], params);
@@ -27,7 +46,7 @@ cfg_t* foo (VariableFactory &vfac) {
   // adding control flow
   entry >> exit;
   // adding statements
-  entry.add (y, x, 1);
+  entry.add (y, x, k);
   exit.add (z , y , 2);
   exit.ret (vfac ["z"], INT_TYPE);
   return cfg;
@@ -205,6 +224,158 @@ int main (int argc, char** argv ) {
   }
 
 
+  {
+    // same as above but with two threads
+    InterFwdAnalyzer<callgraph_ref_t, VariableFactory,
+                     dbm_domain_t, interval_domain_t> a (*cg, vfac, nullptr,
+                                                         1, UINT_MAX, 0, 2); 
+    crab::outs() << "Running" 
+         << " summary domain=" << dbm_domain_t::getDomainName () 
+         << " and forward domain=" << interval_domain_t::getDomainName () 
+         << " with 2 threads\n";
+
+    a.Run ();
+    
+    // Print invariants
+    for (auto cfg : cfgs) {
+      auto fdecl_opt = cfg.get_func_decl ();
+      assert (fdecl_opt);
+      crab::outs() << *fdecl_opt << "\n"; 
+      for (auto &b : cfg) {
+        auto inv = a.get_post (cfg, b.label ());
+        crab::outs() << get_label_str (b.label ()) << "=" << inv << "\n";
+      }
+      crab::outs() << "=================================\n";
+    }
+    
+    // Print summaries
+    for (auto cfg : cfgs) {
+      if (a.has_summary (cfg)) {
+        auto fdecl_opt = cfg.get_func_decl ();
+        assert (fdecl_opt);
+        crab::outs() << "Summary for " << *fdecl_opt << ": "; 
+        auto sum = a.get_summary (cfg);
+        crab::outs() << sum << "\n";
+      }
+    }
+  }
+
+  {
+    // same as above but caching the summaries on disk: the second
+    // run loads every summary stored by the first one. The third run
+    // changes foo, so the summaries of foo and of its caller bar are
+    // computed again while those of rec1 and rec2 are loaded.
+    char dir [] = "/tmp/crab_summ_XXXXXX";
+    if (!mkdtemp (dir)) return 1;
+    SummaryDB<cfg_ref_t, dbm_domain_t> db (dir);
+    cfg_t* t1_changed = foo (vfac, 3);
+    vector<cfg_ref_t> cfgs_changed (cfgs);
+    cfgs_changed [0] = *t1_changed;
+    callgraph_t cg_changed (cfgs_changed);
+    for (unsigned run = 0; run < 3; run++) {
+      callgraph_t& run_cg = (run < 2 ? *cg : cg_changed);
+      vector<cfg_ref_t>& run_cfgs = (run < 2 ? cfgs : cfgs_changed);
+      unsigned loaded = db.num_loaded ();
+      unsigned stored = db.num_stored ();
+      InterFwdAnalyzer<callgraph_ref_t, VariableFactory,
+                       dbm_domain_t, interval_domain_t> a (run_cg, vfac, nullptr); 
+      a.set_summary_db (&db);
+      a.Run ();
+      crab::outs() << "Run " << run << " with summary database: " 
+                   << db.num_loaded () - loaded << " loaded, " 
+                   << db.num_stored () - stored << " stored\n";
+      // Print summaries
+      for (auto cfg : run_cfgs) {
+        if (a.has_summary (cfg)) {
+          auto fdecl_opt = cfg.get_func_decl ();
+          assert (fdecl_opt);
+          crab::outs() << "Summary for " << *fdecl_opt << ": "; 
+          auto sum = a.get_summary (cfg);
+          crab::outs() << sum << "\n";
+        }
+      }
+    }
+    // a DBM with other parameters does not load the summaries of
+    // dbm_domain_t, although it has the same name
+    typedef SparseDBM<z_number, varname_t, 
+                      SpDBM_impl::SimpleParams<z_number> > simple_dbm_domain_t;
+    SummaryDB<cfg_ref_t, simple_dbm_domain_t> simple_db (dir);
+    InterFwdAnalyzer<callgraph_ref_t, VariableFactory,
+                     simple_dbm_domain_t, interval_domain_t> a (*cg, vfac, nullptr); 
+    a.set_summary_db (&simple_db);
+    a.Run ();
+    crab::outs() << "Run with summary database and other parameters: " 
+                 << simple_db.num_loaded () << " loaded, " 
+                 << simple_db.num_stored () << " stored\n";
+    delete t1_changed;
+    remove_dir (dir);
+  }
+
+  {
+    // same as above but streaming: the invariants of each function
+    // are printed as soon as they are computed and then released
+    typedef InterFwdAnalyzer<callgraph_ref_t, VariableFactory,
+                             dbm_domain_t, interval_domain_t> inter_analyzer_t;
+    inter_analyzer_t a (*cg, vfac, nullptr); 
+    crab::outs() << "Running" 
+         << " summary domain=" << dbm_domain_t::getDomainName () 
+         << " and forward domain=" << interval_domain_t::getDomainName () 
+         << " in streaming mode\n";
+    a.set_streaming (true);
+    a.add_callback ([&a] (cfg_ref_t cfg) {
+        auto fdecl_opt = cfg.get_func_decl ();
+        assert (fdecl_opt);
+        crab::outs() << *fdecl_opt << "\n"; 
+        for (auto &b : cfg) {
+          auto inv = a.get_post (cfg, b.label ());
+          crab::outs() << get_label_str (b.label ()) << "=" << inv << "\n";
+        }
+        crab::outs() << "=================================\n";
+      });
+    a.Run ();
+    
+    // Invariants have been released
+    for (auto cfg : cfgs) {
+      for (auto &b : cfg) {
+        if (!a.get_post (cfg, b.label ()).is_top ()) 
+          crab::outs() << "Invariants of " << *(cfg.get_func_decl ()) << " were kept\n";
+      }
+    }
+  }
+
+  for (unsigned num_threads = 1; num_threads <= 2; num_threads++) {
+    // same as above but context-sensitive: foo is analyzed once with
+    // x=3 from bar and once with x=8 from main, instead of once with
+    // x in [3,8]. The contexts are the same with any number of
+    // threads.
+    InterFwdAnalyzer<callgraph_ref_t, VariableFactory,
+                     dbm_domain_t, interval_domain_t> a (*cg, vfac, nullptr,
+                                                         1, UINT_MAX, 0, 
+                                                         num_threads); 
+    crab::outs() << "Running" 
+         << " summary domain=" << dbm_domain_t::getDomainName () 
+         << " and forward domain=" << interval_domain_t::getDomainName () 
+         << " with up to 4 calling contexts and " << num_threads 
+         << " threads\n";
+    a.set_max_contexts (4);
+    a.Run ();
+    
+    // Print invariants of each context
+    for (auto cfg : cfgs) {
+      auto fdecl_opt = cfg.get_func_decl ();
+      assert (fdecl_opt);
+      crab::outs() << *fdecl_opt << "\n"; 
+      for (unsigned ctx = 0; ctx < a.get_num_contexts (cfg); ctx++) {
+        crab::outs() << "context " << ctx << ":\n";
+        for (auto &b : cfg) {
+          auto inv = a.get_post (cfg, b.label (), ctx);
+          crab::outs() << get_label_str (b.label ()) << "=" << inv << "\n";
+        }
+      }
+      crab::outs() << "=================================\n";
+    }
+  }
+
 #ifdef HAVE_APRON
   {
     InterFwdAnalyzer<callgraph_ref_t, VariableFactory,
@@ -0,0 +1,161 @@
+#include "../common.hpp"
+#include <crab/domains/nullity.hpp>
+
+#include <sstream>
+
+using namespace std;
+using namespace crab::analyzer;
+using namespace crab::cfg_impl;
+using namespace crab::domain_impl;
+
+// The nullity environment is a bit-vector of 32 variables per word,
+// indexed by variable id: the operands of these operations have
+// vectors of different lengths, and names that are only in one of
+// them.
+
+typedef nullity_domain<varname_t> nullity_domain_t;
+
+static string str (nullity_domain_t inv) {
+  ostringstream o;
+  inv.write (o);
+  return o.str ();
+}
+
+static unsigned size (nullity_domain_t inv) {
+  unsigned n = 0;
+  for (auto it = inv.begin (), et = inv.end (); it != et; ++it) n++;
+  return n;
+}
+
+// x and y are in the first word, z in the second one
+static void test_meet (varname_t x, varname_t y, varname_t z) {
+  crab::outs () << "meet\n";
+  nullity_domain_t a = nullity_domain_t::top ();
+  a.set (x, nullity_value::null ());
+  nullity_domain_t b = nullity_domain_t::top ();
+  b.set (x, nullity_value::non_null ());
+  TEST_CHECK ((a & b).is_bottom ());
+  TEST_CHECK ((b & a).is_bottom ());
+  TEST_CHECK ((a && b).is_bottom ());
+
+  // the conflict is in the word that only the longer vector has
+  nullity_domain_t c = a;
+  c.set (z, nullity_value::null ());
+  nullity_domain_t d = nullity_domain_t::top ();
+  d.set (y, nullity_value::null ());
+  d.set (z, nullity_value::non_null ());
+  TEST_CHECK ((c & d).is_bottom ());
+  TEST_CHECK ((d & c).is_bottom ());
+  nullity_domain_t m = a & d;
+  TEST_CHECK (!m.is_bottom ());
+  TEST_CHECK (m [x].is_null () && m [y].is_null () && m [z].is_non_null ());
+
+  nullity_domain_t e = nullity_domain_t::top ();
+  e.disequality (x, nullity_value::null ());
+  TEST_CHECK (e [x].is_non_null ());
+  TEST_CHECK ((e & a).is_bottom ());
+}
+
+static void test_join (varname_t x, varname_t y, varname_t z) {
+  crab::outs () << "join\n";
+  nullity_domain_t a = nullity_domain_t::top ();
+  a.set (x, nullity_value::null ());
+  a.set (y, nullity_value::non_null ());
+  a.set (z, nullity_value::null ());
+  nullity_domain_t b = nullity_domain_t::top ();
+  b.set (x, nullity_value::null ());
+  b.set (y, nullity_value::null ());
+
+  // y has different values and z is only in a
+  nullity_domain_t j = a | b;
+  TEST_CHECK (j [x].is_null ());
+  TEST_CHECK (j [y].is_top () && j [z].is_top ());
+  TEST_CHECK (size (j) == 1);
+  TEST_CHECK (str (j) == "{x -> N}");
+  TEST_CHECK (str (b | a) == "{x -> N}");
+  TEST_CHECK (a <= j && b <= j && j <= (b || a));
+
+  // the values do not agree on any variable
+  nullity_domain_t c = nullity_domain_t::top ();
+  c.set (x, nullity_value::non_null ());
+  nullity_domain_t t = c | a;
+  TEST_CHECK (t.is_top ());
+  TEST_CHECK (str (t) == "{}");
+  TEST_CHECK (t <= nullity_domain_t::top () && nullity_domain_t::top () <= t);
+
+  nullity_domain_t bot = nullity_domain_t::bottom ();
+  TEST_CHECK (str (bot | a) == str (a) && str (a | bot) == str (a));
+}
+
+static void test_leq (varname_t x, varname_t y, varname_t z) {
+  crab::outs () << "inclusion\n";
+  // one word
+  nullity_domain_t a = nullity_domain_t::top ();
+  a.set (x, nullity_value::null ());
+  // two words
+  nullity_domain_t b = a;
+  b.set (z, nullity_value::non_null ());
+  TEST_CHECK (b <= a);
+  TEST_CHECK (!(a <= b));
+  // only the second word
+  nullity_domain_t c = nullity_domain_t::top ();
+  c.set (z, nullity_value::non_null ());
+  TEST_CHECK (b <= c);
+  TEST_CHECK (!(c <= a) && !(a <= c));
+  TEST_CHECK (a <= nullity_domain_t::top () && c <= nullity_domain_t::top ());
+  TEST_CHECK (!(nullity_domain_t::top () <= c));
+
+  // a variable set back to Top does not leave a longer vector behind
+  nullity_domain_t d = b;
+  d -= z;
+  TEST_CHECK (d <= a && a <= d);
+  d.set (y, nullity_value::non_null ());
+  d.set (y, nullity_value::top ());
+  TEST_CHECK (d <= a && a <= d);
+  TEST_CHECK (nullity_domain_t::bottom () <= c && !(c <= nullity_domain_t::bottom ()));
+}
+
+static void test_names (varname_t x, varname_t y, varname_t z) {
+  crab::outs () << "names\n";
+  nullity_domain_t a = nullity_domain_t::top ();
+  a.set (x, nullity_value::null ());
+  nullity_domain_t b = nullity_domain_t::top ();
+  b.set (z, nullity_value::non_null ());
+  nullity_domain_t m = a & b;
+  // the names of both operands
+  TEST_CHECK (size (m) == 2);
+  TEST_CHECK (str (m) == "{x -> N; z -> NN}");
+  unsigned n = 0;
+  for (auto it = m.begin (), et = m.end (); it != et; ++it, ++n) {
+    auto kv = *it;
+    TEST_CHECK (n == 0 ? (kv.first == x && kv.second.is_null ())
+                       : (kv.first == z && kv.second.is_non_null ()));
+  }
+  // setting a new name in the result leaves the operands alone
+  m.set (y, nullity_value::null ());
+  TEST_CHECK (str (m) == "{x -> N; y -> N; z -> NN}");
+  TEST_CHECK (str (a) == "{x -> N}" && str (b) == "{z -> NN}");
+  // and so does setting one in an operand
+  b.set (y, nullity_value::non_null ());
+  TEST_CHECK (str (m) == "{x -> N; y -> N; z -> NN}");
+  TEST_CHECK (str (b) == "{y -> NN; z -> NN}");
+  // the meet of a value and a join of it keeps its names
+  nullity_domain_t j = m | a;
+  TEST_CHECK (str (j & m) == str (m));
+  TEST_CHECK (str (m & j) == str (m));
+}
+
+int main (int argc, char** argv) {
+  SET_LOGGER(argc,argv)
+  VariableFactory vfac;
+  varname_t x = vfac ["x"];
+  varname_t y = vfac ["y"];
+  for (int i = 0; i < 40; i++)
+    vfac ["v" + std::to_string (i)];
+  varname_t z = vfac ["z"];
+  test_meet (x, y, z);
+  test_join (x, y, z);
+  test_leq (x, y, z);
+  test_names (x, y, z);
+  return TEST_RESULT ();
+}
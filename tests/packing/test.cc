@@ -0,0 +1,79 @@
+#include "../common.hpp"
+
+using namespace std;
+using namespace crab::analyzer;
+using namespace crab::cfg_impl;
+using namespace crab::domain_impl;
+
+cfg_t* prog (VariableFactory &vfac)  {
+
+  // Definining program variables
+  z_var i (vfac ["i"]);
+  z_var k (vfac ["k"]);
+  z_var j (vfac ["j"]);
+  z_var n (vfac ["n"]);
+  z_var x (vfac ["x"]);
+  z_var y (vfac ["y"]);
+  z_var z (vfac ["z"]);
+  z_var w (vfac ["w"]);
+  // entry and exit block
+  cfg_t* cfg = new cfg_t("entry","ret");
+  // adding blocks
+  basic_block_t& entry = cfg->insert ("entry");
+  basic_block_t& bb1   = cfg->insert ("bb1");
+  basic_block_t& bb1_t = cfg->insert ("bb1_t");
+  basic_block_t& bb1_f = cfg->insert ("bb1_f");
+  basic_block_t& bb2   = cfg->insert ("bb2");
+  basic_block_t& ret   = cfg->insert ("ret");
+  // adding control flow
+  entry >> bb1;
+  bb1 >> bb1_t; bb1 >> bb1_f;
+  bb1_t >> bb2; bb2 >> bb1; bb1_f >> ret;
+  // adding statements
+  entry.assign (i, 0);
+  entry.assign (k, i);
+  entry.havoc (n.name ());
+  entry.assume (n >= 1);
+  entry.assign (j, n);
+  entry.assign (x, 5);
+  bb1_t.assume (i <= 99);
+  bb1_f.assume (i >= 100);
+  bb2.add (i, i, 1);
+  bb2.add (k, k, 1);
+  bb2.add (j, j, 1);
+  // spans the packs {i,k} and {j,n}
+  ret.assign (y, i + j);
+  ret.assign (w, j - n);
+  // z is in no pack: both packs are full
+  ret.assign (z, k + n);
+  return cfg;
+}
+
+int main (int argc, char**argv){
+
+  SET_LOGGER(argc,argv)
+
+  VariableFactory vfac;
+  cfg_t* cfg = prog (vfac);
+  crab::outs() << *cfg << "\n";
+
+  VarPacking<cfg_ref_t> packing (*cfg, 3);
+  packing.exec ();
+  crab::outs() << "Packs: " << packing << "\n";
+
+  NumFwdAnalyzer <cfg_ref_t, packed_sdbm_domain_t,VariableFactory>::type
+      a (*cfg, vfac, nullptr, 1, 2, 20);
+  // Run fixpoint
+  a.Run (packed_sdbm_domain_t::top (packing.get_packs ()));
+  // Print invariants
+  crab::outs() << "Invariants using " << packed_sdbm_domain_t::getDomainName () << "\n";
+  for (auto &b : *cfg) {
+    auto inv = a [b.label ()];
+    crab::outs() << get_label_str (b.label ()) << "=" << inv << "\n";
+  }
+  auto exit_inv = a.get_post ("ret");
+  crab::outs() << "exit=" << exit_inv << "\n";
+
+  delete cfg;
+  return 0;
+}
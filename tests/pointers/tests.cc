@@ -192,6 +192,20 @@ void run (vector<cfg_ref_t> cfgs, VariableFactory& vfac)
   crab::outs() << pta << endl; 
 }
 
+template<typename NumAbsDom>
+void run_parallel (vector<cfg_ref_t> cfgs, VariableFactory& vfac)
+{
+
+  Pointer<cfg_ref_t, VariableFactory, NumAbsDom> pta (vfac);
+  for (auto cfg: cfgs)
+    cfg.simplify ();
+  pta.gen_constraints  (cfgs, 2);
+
+  pta.solve ();
+  crab::outs() << "Pointer information (2 threads)\n";
+  crab::outs() << pta << endl; 
+}
+
 
 int main (int argc, char**argv)
 {
@@ -234,6 +248,17 @@ int main (int argc, char**argv)
     delete p4;
     delete p5;
   }
+
+  {
+    // inter-procedural example with one thread per function
+    VariableFactory vfac;
+    auto p4 = foo (vfac);
+    auto p5 = bar (vfac);
+    vector<cfg_ref_t> cfgs = { *p4, *p5};
+    run_parallel<sdbm_domain_t> (cfgs, vfac);
+    delete p4;
+    delete p5;
+  }
   
   return 0;
 }
@@ -0,0 +1,192 @@
+#include "../common.hpp"
+#include <crab/domains/dbm/dbm.h>
+
+#include <sys/mman.h>
+#include <new>
+#include <thread>
+#include <cstdlib>
+
+using namespace std;
+
+// Tests of the C implementation in lib/dbm:
+// - a dbm with more than 32767 vertices, whose ids do not fit in 16
+//   bits, and
+// - several threads operating on their own dbms at the same time,
+//   each with its own scratch context.
+//
+// A dbm allocates its edge matrix and adjacency lists for every pair
+// of vertices, which for 40000 vertices is far more memory than the
+// test touches. Large arrays are therefore reserved with
+// MAP_NORESERVE so that only the pages actually written are backed
+// by memory.
+
+namespace {
+  const size_t large_array = 1 << 20;
+  // keeps the payload 16-byte aligned
+  struct alloc_header { size_t size; size_t mapped; };
+}
+
+void* operator new[] (size_t sz) {
+  size_t total = sz + sizeof(alloc_header);
+  alloc_header* h;
+  if (sz >= large_array) {
+    void* p = mmap (NULL, total, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (p == MAP_FAILED) throw std::bad_alloc ();
+    h = (alloc_header*) p;
+    h->mapped = 1;
+  } else {
+    h = (alloc_header*) malloc (total);
+    if (!h) throw std::bad_alloc ();
+    h->mapped = 0;
+  }
+  h->size = total;
+  return h + 1;
+}
+
+void operator delete[] (void* p) noexcept {
+  if (!p) return;
+  alloc_header* h = ((alloc_header*) p) - 1;
+  if (h->mapped)
+    munmap (h, h->size);
+  else
+    free (h);
+}
+
+void operator delete[] (void* p, size_t) noexcept {
+  operator delete[] (p);
+}
+
+// x_i - x_j <= k
+static bool implies (dbm_ctx ctx, dbm x, int i, int j, val_t k) {
+  dexpr d;
+  d.kind = D_DIFF;
+  d.args[0] = i;
+  d.args[1] = j;
+  d.konst = k;
+  return dbm_implies (ctx, x, d);
+}
+
+// x = cond (c, x)
+static void assume (dbm_ctx ctx, dbm& x, ucon c) {
+  dbm tmp = dbm_cond (ctx, c, x);
+  dbm_dealloc (x);
+  x = tmp;
+}
+
+static void test_large (int sz) {
+  crab::outs () << "dbm with " << sz << " vertices\n";
+  dbm_ctx ctx = dbm_ctx_alloc ();
+  // the last vertex is the zero vertex
+  int zero = sz - 1;
+  int a = 0, b = 32767, c = 32768, d = sz - 2;
+
+  dbm x = dbm_top (sz);
+  assume (ctx, x, mk_ucon (uvar (a), U_LEQ, uvar (b)));
+  assume (ctx, x, mk_ucon (uvar (b), U_LT, uvar (c)));
+  assume (ctx, x, mk_ucon (uvar (c), U_LEQ, uvar (d)));
+  assume (ctx, x, mk_ucon (uvar (d), U_LEQ, uconst (10)));
+  TEST_CHECK (!dbm_is_bottom (x));
+  dbm_canonical (ctx, x);
+
+  TEST_CHECK (implies (ctx, x, b, c, -1));
+  TEST_CHECK (!implies (ctx, x, c, b, 0));
+  TEST_CHECK (implies (ctx, x, a, d, -1));
+  TEST_CHECK (implies (ctx, x, a, zero, 9));
+  TEST_CHECK (!implies (ctx, x, a, zero, 8));
+  TEST_CHECK (implies (ctx, x, c, zero, 10));
+
+  // join with a value where c is bounded by 20 instead
+  dbm y = dbm_top (sz);
+  assume (ctx, y, mk_ucon (uvar (b), U_LT, uvar (c)));
+  assume (ctx, y, mk_ucon (uvar (c), U_LEQ, uconst (20)));
+  dbm j = dbm_join (ctx, x, y);
+  TEST_CHECK (implies (ctx, j, b, c, -1));
+  TEST_CHECK (implies (ctx, j, c, zero, 20));
+  TEST_CHECK (!implies (ctx, j, a, d, 0));
+  TEST_CHECK (dbm_is_leq (ctx, x, j));
+  TEST_CHECK (!dbm_is_leq (ctx, j, x));
+
+  // c <= 10 and c >= 15 is infeasible
+  dbm e = dbm_copy (x);
+  assume (ctx, e, mk_ucon (uconst (15), U_LEQ, uvar (c)));
+  TEST_CHECK (dbm_is_bottom (e));
+
+  dbm_dealloc (e);
+  dbm_dealloc (j);
+  dbm_dealloc (y);
+  dbm_dealloc (x);
+  dbm_ctx_dealloc (ctx);
+}
+
+// Computes the same result for a given n whatever the thread. Each
+// call also grows the context to a different size.
+static dbm chain (dbm_ctx ctx, int n) {
+  dbm x = dbm_top (n + 1);
+  assume (ctx, x, mk_ucon (uconst (0), U_LEQ, uvar (0)));
+  for (int i = 0; i + 1 < n; i++)
+    assume (ctx, x, mk_ucon (uvar (i), U_LT, uvar (i + 1)));
+  // widen x with a value where the last variable grows
+  dbm y = dbm_copy (x);
+  assume (ctx, y, mk_ucon (uvar (n - 1), U_LEQ, uconst (3 * n)));
+  dbm z = dbm_copy (x);
+  assume (ctx, z, mk_ucon (uvar (n - 1), U_LEQ, uconst (4 * n)));
+  dbm w = dbm_widen (ctx, y, z);
+  dbm m = dbm_meet (ctx, w, y);
+  dbm_canonical (ctx, m);
+  dbm_dealloc (x);
+  dbm_dealloc (y);
+  dbm_dealloc (z);
+  dbm_dealloc (w);
+  return m;
+}
+
+static void test_threads () {
+  const int num_threads = 4;
+  const int rounds = 20;
+  crab::outs () << num_threads << " threads with their own contexts\n";
+
+  vector<int> ok (num_threads, 1);
+  vector<dbm> last (num_threads, nullptr);
+  vector<std::thread> threads;
+  for (int t = 0; t < num_threads; t++) {
+    threads.push_back (std::thread ([t, &ok, &last] () {
+      dbm_ctx ctx = dbm_ctx_alloc ();
+      for (int r = 0; r < rounds; r++) {
+        int n = 20 + 10 * ((t + r) % num_threads);
+        dbm m = chain (ctx, n);
+        // n - 1 <= x_{n-1} <= 3n and x_0 - x_{n-1} <= -(n - 1);
+        // vertex n is the zero vertex
+        if (dbm_is_bottom (m) ||
+            !implies (ctx, m, n - 1, n, 3 * n) ||
+            !implies (ctx, m, n, n - 1, -(n - 1)) ||
+            implies (ctx, m, n - 1, n, 3 * n - 1) ||
+            !implies (ctx, m, 0, n - 1, -(n - 1)))
+          ok [t] = 0;
+        dbm_dealloc (last [t]);
+        last [t] = m;
+      }
+      dbm_ctx_dealloc (ctx);
+    }));
+  }
+  for (auto &th : threads)
+    th.join ();
+
+  // the last value of each thread is the one computed sequentially
+  dbm_ctx ctx = dbm_ctx_alloc ();
+  for (int t = 0; t < num_threads; t++) {
+    TEST_CHECK (ok [t]);
+    dbm m = chain (ctx, 20 + 10 * ((t + rounds - 1) % num_threads));
+    TEST_CHECK (dbm_is_leq (ctx, m, last [t]) && dbm_is_leq (ctx, last [t], m));
+    dbm_dealloc (m);
+    dbm_dealloc (last [t]);
+  }
+  dbm_ctx_dealloc (ctx);
+}
+
+int main (int argc, char** argv) {
+  int sz = (argc > 1 ? atoi (argv [1]) : 40000);
+  test_large (sz);
+  test_threads ();
+  return TEST_RESULT ();
+}
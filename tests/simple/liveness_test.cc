@@ -0,0 +1,101 @@
+#include "../common.hpp"
+
+using namespace std;
+using namespace crab::analyzer;
+using namespace crab::cfg_impl;
+using namespace crab::domain_impl;
+
+// The dead variables at the exit of each block: the variables of the
+// block that are not live-out. Blocks with no live-out variables have
+// no dead set.
+
+typedef Liveness<cfg_ref_t> liveness_t;
+
+cfg_t* prog (VariableFactory &vfac) {
+  z_var i (vfac ["i"]), n (vfac ["n"]), x (vfac ["x"]), y (vfac ["y"]);
+  z_var z (vfac ["z"]), t (vfac ["t"]), w (vfac ["w"]), r (vfac ["r"]);
+  z_var a (vfac ["a"]), k (vfac ["k"]), s (vfac ["s"]), q (vfac ["q"]);
+  cfg_t* cfg = new cfg_t ("entry", "ret");
+  basic_block_t& entry = cfg->insert ("entry");
+  basic_block_t& loop = cfg->insert ("loop");
+  basic_block_t& body = cfg->insert ("body");
+  basic_block_t& exit = cfg->insert ("exit");
+  basic_block_t& ret = cfg->insert ("ret");
+  // not reachable from entry
+  basic_block_t& unreach = cfg->insert ("unreach");
+  basic_block_t& spin = cfg->insert ("spin");
+  basic_block_t& orphan = cfg->insert ("orphan");
+  entry >> loop;
+  loop >> body; loop >> exit;
+  body >> loop;
+  exit >> ret;
+  unreach >> exit;
+  spin >> spin;
+
+  entry.assign (i, 0);
+  entry.assign (n, 10);
+  entry.assign (x, 5);
+  entry.assign (w, 3);
+  loop.add (y, x, 1);
+  body.assume (i <= n);
+  body.add (i, i, 1);
+  body.assign (t, y);
+  exit.assume (i >= n + 1);
+  exit.add (z, i, y);
+  ret.assign (r, z);
+  unreach.add (a, i, 1);
+  unreach.assign (i, a);
+  spin.add (k, k, 1);
+  spin.assign (s, k);
+  orphan.assign (q, 1);
+  return cfg;
+}
+
+static vector<string> names (liveness_t::set_t s) {
+  vector<string> res;
+  for (auto v : s)
+    res.push_back (v.str ());
+  std::sort (res.begin (), res.end ());
+  return res;
+}
+
+static void check (const liveness_t& live, string bb, vector<string> expected) {
+  vector<string> dead = names (live.dead_exit (bb));
+  if (dead != expected) {
+    crab::outs () << bb << ": dead at exit {";
+    for (auto v : dead) crab::outs () << v << ";";
+    crab::outs () << "}\n";
+  }
+  TEST_CHECK (dead == expected);
+}
+
+int main (int argc, char** argv) {
+  SET_LOGGER(argc,argv)
+  VariableFactory vfac;
+  cfg_t* cfg = prog (vfac);
+  liveness_t live (*cfg);
+  live.exec ();
+
+  check (live, "entry", { "w" });
+  // x is live around the loop and y is redefined before it is used
+  // again
+  check (live, "loop", { });
+  check (live, "body", { "t", "y" });
+  check (live, "exit", { "i", "n", "y" });
+  // nothing is live-out of the exit block
+  check (live, "ret", { });
+  // blocks that are not reachable from entry: one that flows into
+  // exit, a loop and a block without successors
+  check (live, "unreach", { "a" });
+  check (live, "spin", { "s" });
+  check (live, "orphan", { });
+
+  unsigned total, max, avg;
+  live.get_stats (total, max, avg);
+  // the live-out sets of entry, loop, body, exit, unreach and spin
+  TEST_CHECK (total == 3 + 4 + 3 + 1 + 3 + 1);
+  TEST_CHECK (max == 4);
+
+  delete cfg;
+  return TEST_RESULT ();
+}
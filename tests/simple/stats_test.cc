@@ -0,0 +1,86 @@
+#include "../common.hpp"
+#include <crab/common/stats.hpp>
+
+#include <thread>
+#include <sstream>
+#include <time.h>
+
+using namespace std;
+
+// CrabStats updated from two threads: counters add up, count_max keeps
+// the maximum and uset the last value. The stopwatches measure the
+// process, so the time of a thread that waits for another one includes
+// the work of the other, unless the per-thread stopwatches are used.
+
+#ifdef HAVE_STATS
+static long thread_time () {
+  struct timespec ts;
+  clock_gettime (CLOCK_THREAD_CPUTIME_ID, &ts);
+  return ts.tv_sec * 1000000L + ts.tv_nsec / 1000L;
+}
+
+// spin for about usec microseconds of CPU time of the calling thread
+static unsigned spin (long usec) {
+  long end = thread_time () + usec;
+  unsigned x = 0;
+  while (thread_time () < end)
+    for (int i = 0; i < 1000; i++) x = x * 31 + i;
+  return x;
+}
+
+// the time in seconds of a stopwatch
+static double seconds (const std::string& name) {
+  std::ostringstream out;
+  crab::CrabStats::PrintBrunch (out);
+  std::istringstream in (out.str ());
+  std::string line, prefix = "BRUNCH_STAT " + name + " ";
+  while (std::getline (in, line)) {
+    if (line.compare (0, prefix.size (), prefix) == 0)
+      return std::stod (line.substr (prefix.size ()));
+  }
+  return -1;
+}
+#endif
+
+int main (int argc, char** argv) {
+  SET_LOGGER(argc,argv)
+#ifdef HAVE_STATS
+  crab::CrabStats::count ("t.count");
+  crab::CrabStats::count_max ("t.max", 4);
+  crab::CrabStats::uset ("t.last", 5);
+  std::thread t1 ([] {
+      crab::CrabStats::count ("t.count");
+      crab::CrabStats::count_max ("t.max", 9);
+      crab::CrabStats::uset ("t.last", 7);
+    });
+  t1.join ();
+  TEST_CHECK (crab::CrabStats::get ("t.count") == 2);
+  TEST_CHECK (crab::CrabStats::get ("t.max") == 9);
+  TEST_CHECK (crab::CrabStats::get ("t.last") == 7);
+  crab::CrabStats::uset ("t.last", 3);
+  crab::CrabStats::count_max ("t.max", 1);
+  TEST_CHECK (crab::CrabStats::get ("t.last") == 3);
+  TEST_CHECK (crab::CrabStats::get ("t.max") == 9);
+
+  unsigned x = 0;
+  crab::CrabStats::resume ("t.process");
+  crab::CrabStats::resume_thread ("t.waiting");
+  std::thread t2 ([&x] {
+      crab::ScopedThreadCrabStats __st__("t.worker");
+      x = spin (300000);
+    });
+  t2.join ();
+  crab::CrabStats::stop_thread ("t.waiting");
+  crab::CrabStats::stop ("t.process");
+  double worker = seconds ("t.worker");
+  double process = seconds ("t.process");
+  double waiting = seconds ("t.waiting");
+  crab::outs () << "worker " << worker << "s, process " << process
+                << "s, waiting " << waiting << "s (" << x % 2 << ")\n";
+  TEST_CHECK (worker >= 0.25);
+  // the process time only counts user time, with a coarser clock
+  TEST_CHECK (process >= worker * 0.75);
+  TEST_CHECK (waiting >= 0 && waiting < worker / 2);
+#endif
+  return TEST_RESULT ();
+}
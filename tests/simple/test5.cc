@@ -105,6 +105,18 @@ int main (int argc, char** argv )
     }
   }
 
+  {
+    // Same invariants, reducing only when they are observed
+    NumFwdAnalyzer <cfg_ref_t, lazy_num_domain_t,VariableFactory>::type a (*cfg,vfac,&live, 1, 2, 20);
+    a.Run (lazy_num_domain_t::top ());
+    crab::outs() << "Invariants using " << lazy_num_domain_t::getDomainName () << " (lazy)\n";
+    for (auto &b : *cfg) 
+    {
+      auto inv = a [b.label ()];
+      crab::outs() << get_label_str (b.label ()) << "=" << inv << "\n";
+    }
+  }
+
   delete cfg;
 
   return 0;
@@ -0,0 +1,245 @@
+#include "../common.hpp"
+#include <crab/domains/dbm.hpp>
+
+using namespace std;
+using namespace crab::analyzer;
+using namespace crab::cfg_impl;
+using namespace crab::domain_impl;
+
+// Run the zone domains with the dense and copy-on-write graph
+// representations, the latter also with 32-bit edge weights. The
+// invariants must be the same as with the default (adapt_ss) one,
+// which is checked for the dense and auto representations.
+// The C implementation in lib/dbm is also run; it only supports a
+// constant or a variable on the rhs of assignments so it is less
+// precise.
+
+typedef SDBM_impl::DefaultParams<z_number, SDBM_impl::GraphRep::dense> SplitDBMDense;
+typedef SplitDBM<z_number, varname_t, SplitDBMDense> sdbm_dense_domain_t;
+typedef SDBM_impl::DefaultParams<z_number, SDBM_impl::GraphRep::auto_dense> SplitDBMAuto;
+typedef SplitDBM<z_number, varname_t, SplitDBMAuto> sdbm_auto_domain_t;
+typedef SpDBM_impl::DefaultParams<z_number, SpDBM_impl::GraphRep::dense> SparseDBMDense;
+typedef SparseDBM<z_number, varname_t, SparseDBMDense> dbm_dense_domain_t;
+typedef SpDBM_impl::DefaultParams<z_number, SpDBM_impl::GraphRep::auto_dense> SparseDBMAuto;
+typedef SparseDBM<z_number, varname_t, SparseDBMAuto> dbm_auto_domain_t;
+typedef SDBM_impl::DefaultParams<z_number, SDBM_impl::GraphRep::cow_ss> SplitDBMCow;
+typedef SplitDBM<z_number, varname_t, SplitDBMCow> sdbm_cow_domain_t;
+typedef SDBM_impl::DefaultParams<z_number, SDBM_impl::GraphRep::cow_ss, int32_t> SplitDBMCow32;
+typedef SplitDBM<z_number, varname_t, SplitDBMCow32> sdbm_cow32_domain_t;
+typedef SpDBM_impl::DefaultParams<z_number, SpDBM_impl::GraphRep::cow_ss> SparseDBMCow;
+typedef SparseDBM<z_number, varname_t, SparseDBMCow> dbm_cow_domain_t;
+typedef SpDBM_impl::DefaultParams<z_number, SpDBM_impl::GraphRep::cow_ss, int32_t> SparseDBMCow32;
+typedef SparseDBM<z_number, varname_t, SparseDBMCow32> dbm_cow32_domain_t;
+typedef DBM<z_number, varname_t> c_dbm_domain_t;
+
+// The graph a zone domain actually runs on.
+template<typename Dom> struct graph_of;
+template<typename N, typename V, typename P>
+struct graph_of<SplitDBM_<N,V,P> > { typedef typename P::graph_t type; };
+template<typename N, typename V, typename P>
+struct graph_of<SparseDBM_<N,V,P> > { typedef typename P::graph_t type; };
+template<typename Dom> struct graph_of_domain 
+{ typedef typename graph_of<typename Dom::dbm_impl_t>::type type; };
+
+static_assert(std::is_same<graph_of_domain<sdbm_dense_domain_t>::type, crab::DenseGraph<long> >::value,
+              "SplitDBM does not use the dense graph");
+static_assert(std::is_same<graph_of_domain<sdbm_auto_domain_t>::type, crab::AutoGraph<long> >::value,
+              "SplitDBM does not use the auto graph");
+static_assert(std::is_same<graph_of_domain<dbm_dense_domain_t>::type, crab::DenseGraph<long> >::value,
+              "SparseDBM does not use the dense graph");
+static_assert(std::is_same<graph_of_domain<dbm_auto_domain_t>::type, crab::AutoGraph<long> >::value,
+              "SparseDBM does not use the auto graph");
+
+cfg_t* prog (VariableFactory &vfac)
+{
+  cfg_t* cfg = new cfg_t("entry","ret");
+  basic_block_t& entry      = cfg->insert ("entry");
+  basic_block_t& loop_head  = cfg->insert ("loop_head");
+  basic_block_t& loop_t     = cfg->insert ("loop_t");
+  basic_block_t& loop_f     = cfg->insert ("loop_f");
+  basic_block_t& loop_body  = cfg->insert ("loop_body");
+  basic_block_t& body_t     = cfg->insert ("body_t");
+  basic_block_t& body_f     = cfg->insert ("body_f");
+  basic_block_t& body_x     = cfg->insert ("body_x");
+  basic_block_t& ret        = cfg->insert ("ret");
+
+  entry >> loop_head;
+  loop_head >> loop_t;
+  loop_head >> loop_f;
+  loop_t >> loop_body;
+  loop_body >> body_t;
+  loop_body >> body_f;
+  body_t >> body_x;
+  body_f >> body_x;
+  body_x >> loop_head;
+  loop_f >> ret;
+
+  z_var i(vfac["i"]);
+  z_var j(vfac["j"]);
+  z_var k(vfac["k"]);
+  z_var n(vfac["n"]);
+  z_var m(vfac["m"]);
+  // Not related to the loop: their component is the same in both
+  // operands of the join at loop_head.
+  z_var a(vfac["a"]);
+  z_var b(vfac["b"]);
+
+  entry.havoc (n.name());
+  entry.assume (n >= 1);
+  entry.assign (m, n + 5);
+  entry.assign (i, 0);
+  entry.assign (j, 0);
+  entry.assign (k, 0);
+  entry.havoc (a.name());
+  entry.assume (a >= 2);
+  entry.assign (b, a + 3);
+  loop_t.assume (i <= n - 1);
+  loop_f.assume (i >= n);
+  loop_body.add (i, i, 1);
+  body_t.assign (j, i);
+  body_t.assign (k, j + 1);
+  body_f.assume (j <= i);
+  body_f.assign (k, i);
+  ret.assume (k <= m);
+  ret.assume (b <= k);
+  return cfg;
+}
+
+// Constants near INT32_MAX so that with 32-bit edge weights the
+// closure, join and widening produce weights that do not fit.
+cfg_t* prog_large (VariableFactory &vfac)
+{
+  cfg_t* cfg = new cfg_t("entry","ret");
+  basic_block_t& entry      = cfg->insert ("entry");
+  basic_block_t& bb_t       = cfg->insert ("bb_t");
+  basic_block_t& bb_f       = cfg->insert ("bb_f");
+  basic_block_t& loop_head  = cfg->insert ("loop_head");
+  basic_block_t& loop_body  = cfg->insert ("loop_body");
+  basic_block_t& ret        = cfg->insert ("ret");
+
+  entry >> bb_t;
+  entry >> bb_f;
+  bb_t >> loop_head;
+  bb_f >> loop_head;
+  loop_head >> loop_body;
+  loop_body >> loop_head;
+  loop_head >> ret;
+
+  z_var x(vfac["x"]);
+  z_var y(vfac["y"]);
+  z_var z(vfac["z"]);
+  z_var u(vfac["u"]);
+  z_var v(vfac["v"]);
+
+  entry.havoc (x.name());
+  entry.havoc (y.name());
+  entry.havoc (z.name());
+  entry.havoc (u.name());
+  entry.havoc (v.name());
+  // x - z <= 2^31 + 90 is above INT32_MAX
+  entry.assume (x - y <= 2147483638);
+  entry.assume (y - z <= 100);
+  // v - y <= -2^31 - 1000 is below INT32_MIN
+  entry.assume (u - y <= -2147483000);
+  entry.assume (v - u <= -1000);
+  entry.assume (z <= 2147483600);
+  entry.assume (z >= -2147483600);
+  bb_t.assume (y - z <= 2147483000);
+  bb_t.assign (u, y - 2147483000);
+  bb_f.assume (y - z >= 50);
+  bb_f.assign (u, y - 2147483640);
+  // x - y grows until widening
+  loop_body.sub (y, y, 1);
+  return cfg;
+}
+
+template<typename Dom>
+void run (cfg_t* cfg, VariableFactory& vfac)
+{
+  typename NumFwdAnalyzer <cfg_ref_t, Dom, VariableFactory>::type a (*cfg,vfac,nullptr);
+  Dom inv = Dom::top ();
+  a.Run (inv);
+  crab::outs() << "Invariants using " << inv.getDomainName () << "\n";
+  for (auto &b : *cfg) {
+    auto inv = a [b.label ()];
+    crab::outs() << get_label_str (b.label ()) << "=" << inv << "\n";
+  }
+}
+
+// Run the default representation Ref and Dom, and check that they
+// infer the same invariants.
+template<typename Ref, typename Dom>
+void check_same (cfg_t* cfg, VariableFactory& vfac)
+{
+  typename NumFwdAnalyzer <cfg_ref_t, Ref, VariableFactory>::type a (*cfg,vfac,nullptr);
+  typename NumFwdAnalyzer <cfg_ref_t, Dom, VariableFactory>::type b (*cfg,vfac,nullptr);
+  a.Run (Ref::top ());
+  b.Run (Dom::top ());
+  crab::outs() << "Invariants using " << Dom::getDomainName () << "\n";
+  for (auto &bb : *cfg) {
+    auto ref_inv = a [bb.label ()];
+    auto inv = b [bb.label ()];
+    crab::outs() << get_label_str (bb.label ()) << "=" << inv << "\n";
+    Ref ref_approx = Ref::top ();
+    ref_approx += inv.to_linear_constraint_system ();
+    Dom approx = Dom::top ();
+    approx += ref_inv.to_linear_constraint_system ();
+    TEST_CHECK (ref_inv <= ref_approx);
+    TEST_CHECK (inv <= approx);
+  }
+}
+
+// Run Dom and the same domain with 32-bit edge weights (Dom32) and
+// check that the invariants of Dom32 are implied by those of Dom.
+template<typename Dom, typename Dom32>
+void check_narrow (cfg_t* cfg, VariableFactory& vfac)
+{
+  typename NumFwdAnalyzer <cfg_ref_t, Dom, VariableFactory>::type a (*cfg,vfac,nullptr);
+  typename NumFwdAnalyzer <cfg_ref_t, Dom32, VariableFactory>::type a32 (*cfg,vfac,nullptr);
+  a.Run (Dom::top ());
+  a32.Run (Dom32::top ());
+  crab::outs() << "Invariants using " << Dom::getDomainName () 
+               << " with 32-bit weights\n";
+  for (auto &b : *cfg) {
+    auto inv = a [b.label ()];
+    auto inv32 = a32 [b.label ()];
+    Dom approx = Dom::top ();
+    approx += inv32.to_linear_constraint_system ();
+    crab::outs() << get_label_str (b.label ()) << "=" << inv32 
+                 << (inv <= approx ? " (sound)" : " (UNSOUND)") << "\n";
+  }
+}
+
+int main (int argc, char** argv )
+{
+  SET_LOGGER(argc,argv)
+
+  VariableFactory vfac;
+  cfg_t* cfg = prog (vfac);
+  crab::outs() << *cfg << endl;
+
+  run<sdbm_domain_t> (cfg, vfac);
+  check_same<sdbm_domain_t, sdbm_dense_domain_t> (cfg, vfac);
+  check_same<sdbm_domain_t, sdbm_auto_domain_t> (cfg, vfac);
+  run<sdbm_cow_domain_t> (cfg, vfac);
+  run<sdbm_cow32_domain_t> (cfg, vfac);
+  run<dbm_domain_t> (cfg, vfac);
+  check_same<dbm_domain_t, dbm_dense_domain_t> (cfg, vfac);
+  check_same<dbm_domain_t, dbm_auto_domain_t> (cfg, vfac);
+  run<dbm_cow_domain_t> (cfg, vfac);
+  run<dbm_cow32_domain_t> (cfg, vfac);
+  run<c_dbm_domain_t> (cfg, vfac);
+
+  delete cfg;
+
+  cfg = prog_large (vfac);
+  crab::outs() << *cfg << endl;
+
+  run<sdbm_cow_domain_t> (cfg, vfac);
+  check_narrow<sdbm_cow_domain_t, sdbm_cow32_domain_t> (cfg, vfac);
+  run<dbm_cow_domain_t> (cfg, vfac);
+  check_narrow<dbm_cow_domain_t, dbm_cow32_domain_t> (cfg, vfac);
+
+  delete cfg;
+  return TEST_RESULT ();
+}
@@ -0,0 +1,165 @@
+#include "../common.hpp"
+
+using namespace std;
+using namespace crab::analyzer;
+using namespace crab::cfg_impl;
+using namespace crab::domain_impl;
+
+// SplitDBM keeps its variables in blocks and joins, meets and widens
+// one block at a time. These checks relate variables of different
+// blocks, and cover two bugs:
+// - close_over_edge read the weight of an edge after adding edges
+//   that can move the storage it refers to;
+// - the meet recovered the lower bound implied by a new edge as a
+//   self-loop, which made the normalization after widening loop
+//   forever.
+
+typedef SDBM_impl::DefaultParams<z_number, SDBM_impl::GraphRep::cow_ss> SplitDBMCow;
+typedef SplitDBM<z_number, varname_t, SplitDBMCow> sdbm_cow_domain_t;
+
+template<typename Dom>
+bool implies (Dom inv, z_lin_cst_t cst) {
+  Dom c = Dom::top ();
+  c += cst;
+  return inv <= c;
+}
+
+template<typename Dom>
+void test_join (VariableFactory& vfac) {
+  z_var x (vfac ["x"]), y (vfac ["y"]), a (vfac ["a"]), b (vfac ["b"]);
+  // x and y are in different blocks of both operands, but their
+  // bounds relate them in the join
+  Dom inv1 = Dom::top ();
+  inv1.assign (x.name (), z_lin_t (1));
+  inv1.assign (y.name (), z_lin_t (5));
+  inv1 += (b - a <= 3);
+  Dom inv2 = Dom::top ();
+  inv2.assign (x.name (), z_lin_t (2));
+  inv2.assign (y.name (), z_lin_t (6));
+  inv2 += (b - a <= 3);
+  Dom j = inv1 | inv2;
+  crab::outs () << "join " << j << "\n";
+  TEST_CHECK (implies (j, y - x <= 4));
+  TEST_CHECK (implies (j, x - y <= -4));
+  TEST_CHECK (implies (j, x <= 2));
+  TEST_CHECK (!implies (j, x <= 1));
+  // the block of a and b is the same in both operands
+  TEST_CHECK (implies (j, b - a <= 3));
+  TEST_CHECK (!implies (j, b - a <= 2));
+  TEST_CHECK (!implies (j, a - x <= 100));
+  TEST_CHECK (inv1 <= j && inv2 <= j);
+}
+
+template<typename Dom>
+void test_meet (VariableFactory& vfac) {
+  z_var a (vfac ["a"]), b (vfac ["b"]), c (vfac ["c"]);
+  z_var p (vfac ["p"]), q (vfac ["q"]);
+  // a > b in x and b > c >= 5 in y: the meet relates the blocks
+  // {a,b} and {b,c}, and a >= 7 is recovered from the new edge
+  // between a and c.
+  Dom inv1 = Dom::top ();
+  inv1 += (b - a <= -1);
+  inv1 += (q - p <= 2); // a block that only x constrains
+  Dom inv2 = Dom::top ();
+  inv2 += (c - b <= -1);
+  inv2 += (c >= 5);
+  Dom m = inv1 & inv2;
+  crab::outs () << "meet " << m << "\n";
+  TEST_CHECK (!m.is_bottom ());
+  TEST_CHECK (implies (m, c - a <= -2));
+  TEST_CHECK (implies (m, a >= 7));
+  TEST_CHECK (!implies (m, a >= 8));
+  TEST_CHECK (implies (m, q - p <= 2));
+  TEST_CHECK (m <= inv1 && m <= inv2);
+
+  // The normalization after widening must terminate and keep the
+  // relations that did not change.
+  Dom m2 = m;
+  m2 += (a <= 100);
+  Dom w = m2 || m;
+  crab::outs () << "widening " << w << "\n";
+  TEST_CHECK (implies (w, c - a <= -2));
+  TEST_CHECK (implies (w, a >= 7));
+  TEST_CHECK (!implies (w, a <= 100));
+
+  Dom bot = inv2;
+  bot += (a <= 6);
+  TEST_CHECK ((inv1 & bot).is_bottom ());
+}
+
+template<typename Dom>
+void test_widening (VariableFactory& vfac) {
+  z_var i (vfac ["i"]), j (vfac ["j"]), k (vfac ["k"]), n (vfac ["n"]);
+  Dom inv1 = Dom::top ();
+  inv1.assign (i.name (), z_lin_t (0));
+  inv1 += (j - i <= 0);
+  inv1.assign (k.name (), z_lin_t (5));
+  inv1 += (n >= 1);
+  Dom inv2 = Dom::top ();
+  inv2 += (i >= 0);
+  inv2 += (i <= 1);
+  inv2 += (j - i <= 0);
+  inv2.assign (k.name (), z_lin_t (5));
+  inv2 += (n >= 1);
+  Dom w = inv1 || inv2;
+  crab::outs () << "widening " << w << "\n";
+  TEST_CHECK (implies (w, i >= 0));
+  TEST_CHECK (!implies (w, i <= 1));
+  TEST_CHECK (implies (w, j - i <= 0));
+  TEST_CHECK (implies (w, k == 5));
+  TEST_CHECK (implies (w, n >= 1));
+  TEST_CHECK (inv1 <= w && inv2 <= w);
+}
+
+// y has n predecessors and x n successors, so closing over x - y <=
+// 0 adds enough edges to move the edge storage. Where the storage
+// moves, and whether a stale weight is then wrong, depends on n, so a
+// range of sizes is tried.
+template<typename Dom>
+bool close_over_edge (VariableFactory& vfac, int n) {
+  z_var x (vfac ["x"]), y (vfac ["y"]);
+  vector<z_var> s, d;
+  for (int i = 0; i < n; i++) {
+    s.push_back (z_var (vfac ["s" + std::to_string (i)]));
+    d.push_back (z_var (vfac ["d" + std::to_string (i)]));
+  }
+  Dom inv = Dom::top ();
+  for (int i = 0; i < n; i++) {
+    inv += (y - s [i] <= i);
+    inv += (d [i] - x <= i);
+  }
+  inv += (x - y <= 0);
+  bool ok = true;
+  for (int i = 0; i < n; i++) {
+    ok = ok && implies (inv, x - s [i] <= i) && !implies (inv, x - s [i] <= i - 1);
+    for (int k = 0; k < n; k += 7)
+      ok = ok && implies (inv, d [k] - s [i] <= i + k) &&
+                 !implies (inv, d [k] - s [i] <= i + k - 1);
+  }
+  return ok;
+}
+
+template<typename Dom>
+void test_close_over_edge (VariableFactory& vfac) {
+  crab::outs () << "close over an edge with 1 to 80 predecessors\n";
+  for (int n = 1; n <= 80; n++)
+    TEST_CHECK (close_over_edge<Dom> (vfac, n));
+}
+
+template<typename Dom>
+void run (VariableFactory& vfac) {
+  crab::outs () << Dom::getDomainName () << "\n";
+  test_join<Dom> (vfac);
+  test_meet<Dom> (vfac);
+  test_widening<Dom> (vfac);
+  test_close_over_edge<Dom> (vfac);
+}
+
+int main (int argc, char** argv )
+{
+  SET_LOGGER(argc,argv)
+  VariableFactory vfac;
+  run<sdbm_domain_t> (vfac);
+  run<sdbm_cow_domain_t> (vfac);
+  return TEST_RESULT ();
+}
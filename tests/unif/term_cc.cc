@@ -0,0 +1,175 @@
+#include "../common.hpp"
+
+using namespace std;
+using namespace crab::analyzer;
+using namespace crab::cfg_impl;
+using namespace crab::domain_impl;
+
+// Hash-consing of the term table and congruence closure over it.
+
+typedef term_domain_t::ttbl_t ttbl_t;
+typedef ttbl_t::term_id_t term_id_t;
+typedef crab::domains::term::congruence_closure_solver<ttbl_t> solver_t;
+typedef crab::domains::term::scoped_solver<ttbl_t> scoped_solver_t;
+
+static size_t count (const vector<term_id_t>& v, term_id_t t) {
+  return std::count (v.begin (), v.end (), t);
+}
+
+static void test_hash_consing () {
+  crab::outs () << "hash-consing\n";
+  ttbl_t tbl;
+  term_id_t x = tbl.fresh_var (), y = tbl.fresh_var ();
+  term_id_t f = tbl.apply_ftor (crab::BINOP_ADD, x, y);
+  TEST_CHECK (tbl.apply_ftor (crab::BINOP_ADD, x, y) == f);
+  TEST_CHECK (tbl.apply_ftor (crab::BINOP_ADD, y, x) != f);
+  TEST_CHECK (tbl.apply_ftor (crab::BINOP_MUL, x, y) != f);
+  crab::binary_operation_t add = crab::BINOP_ADD;
+  TEST_CHECK (tbl.find_ftor (add, x, y) && *tbl.find_ftor (add, x, y) == f);
+  z_number five (5);
+  TEST_CHECK (!tbl.find_const (five));
+  term_id_t c = tbl.make_const (five);
+  TEST_CHECK (tbl.make_const (five) == c);
+  TEST_CHECK (tbl.find_const (five) && *tbl.find_const (five) == c);
+  TEST_CHECK (count (tbl.parents (x), f) == 1);
+  TEST_CHECK (count (tbl.parents (y), f) == 1);
+
+  // copies share the table until one of them adds a term
+  ttbl_t copy (tbl);
+  term_id_t g = copy.apply_ftor (crab::BINOP_SUB, x, y);
+  TEST_CHECK (copy.size () == tbl.size () + 1);
+  crab::binary_operation_t sub = crab::BINOP_SUB;
+  TEST_CHECK (!tbl.find_ftor (sub, x, y));
+  TEST_CHECK (count (copy.parents (x), g) == 1 && count (tbl.parents (x), g) == 0);
+}
+
+static void test_congruence () {
+  crab::outs () << "congruence closure\n";
+  ttbl_t tbl;
+  term_id_t a = tbl.fresh_var (), b = tbl.fresh_var ();
+  term_id_t c = tbl.fresh_var (), d = tbl.fresh_var ();
+  term_id_t fa = tbl.apply_ftor (crab::BINOP_ADD, a, c);
+  term_id_t fb = tbl.apply_ftor (crab::BINOP_ADD, b, c);
+  term_id_t fd = tbl.apply_ftor (crab::BINOP_ADD, d, c);
+  term_id_t ga = tbl.apply_ftor (crab::BINOP_MUL, fa, fa);
+  term_id_t gb = tbl.apply_ftor (crab::BINOP_MUL, fb, fb);
+  term_id_t ha = tbl.apply_ftor (crab::BINOP_SUB, fa, c);
+
+  solver_t solver (&tbl);
+  vector<solver_t::equation_t> eqs = { make_pair (a, b) };
+  solver.run (eqs);
+  // a = b implies a+c = b+c and then (a+c)*(a+c) = (b+c)*(b+c)
+  TEST_CHECK (solver.get_class (a) == solver.get_class (b));
+  TEST_CHECK (solver.get_class (fa) == solver.get_class (fb));
+  TEST_CHECK (solver.get_class (ga) == solver.get_class (gb));
+  TEST_CHECK (solver.get_class (fa) != solver.get_class (fd));
+  TEST_CHECK (solver.get_class (c) != solver.get_class (a));
+  TEST_CHECK (solver.get_size (ha) == 1);
+  vector<term_id_t> members = solver.get_members (fb);
+  TEST_CHECK (members.size () == 2 && count (members, fa) && count (members, fb));
+
+  // merging one more class propagates through the parents of the
+  // whole class, not only those of d
+  solver += make_pair (d, a);
+  solver.run ();
+  TEST_CHECK (solver.get_class (fd) == solver.get_class (fb));
+  TEST_CHECK (solver.get_size (a) == 3 && solver.get_size (fa) == 3);
+
+  // terms added after the solver was built are singleton classes
+  term_id_t e = tbl.fresh_var ();
+  TEST_CHECK (solver.get_size (e) == 1);
+  TEST_CHECK (solver.get_class (e) != solver.get_class (a));
+}
+
+static void test_deref () {
+  crab::outs () << "deref\n";
+  ttbl_t tbl;
+  term_id_t a = tbl.fresh_var (), b = tbl.fresh_var (), c = tbl.fresh_var ();
+  term_id_t fa = tbl.apply_ftor (crab::BINOP_ADD, a, c);
+  term_id_t fb = tbl.apply_ftor (crab::BINOP_ADD, b, c);
+  term_id_t ga = tbl.apply_ftor (crab::BINOP_MUL, fa, fa);
+  term_id_t cc = tbl.apply_ftor (crab::BINOP_MUL, c, c);
+  tbl.add_ref (ga);
+  tbl.add_ref (fb);
+  tbl.add_ref (cc);
+  TEST_CHECK (count (tbl.parents (c), cc) == 2);
+
+  // freeing ga frees fa and a, which only ga refers to
+  vector<term_id_t> forgotten;
+  tbl.deref (ga, forgotten);
+  TEST_CHECK (forgotten.size () == 3);
+  TEST_CHECK (count (forgotten, ga) && count (forgotten, fa) && count (forgotten, a));
+  TEST_CHECK (count (tbl.parents (c), fa) == 0);
+  TEST_CHECK (count (tbl.parents (c), fb) == 1);
+  TEST_CHECK (tbl.parents (fa).empty ());
+  crab::binary_operation_t add = crab::BINOP_ADD;
+  TEST_CHECK (!tbl.find_ftor (add, a, c));
+  TEST_CHECK (tbl.find_ftor (add, b, c));
+
+  // a term that occurs twice in the arguments is removed twice
+  forgotten.clear ();
+  tbl.deref (cc, forgotten);
+  TEST_CHECK (forgotten.size () == 1 && count (tbl.parents (c), cc) == 0);
+
+  // the freed slots are reused and dead parents are never seen by
+  // the solver
+  term_id_t d = tbl.fresh_var ();
+  term_id_t fd = tbl.apply_ftor (crab::BINOP_ADD, d, c);
+  TEST_CHECK (count (tbl.parents (c), fd) == 1 && count (tbl.parents (c), fb) == 1);
+  TEST_CHECK (tbl.parents (c).size () == 2);
+  solver_t solver (&tbl);
+  solver += make_pair (b, d);
+  solver.run ();
+  vector<term_id_t> members = solver.get_members (fb);
+  TEST_CHECK (members.size () == 2 && count (members, fb) && count (members, fd));
+}
+
+static void test_reuse () {
+  crab::outs () << "reused solvers\n";
+  ttbl_t t1;
+  term_id_t a = t1.fresh_var (), b = t1.fresh_var (), c = t1.fresh_var ();
+  term_id_t fa = t1.apply_ftor (crab::BINOP_ADD, a, c);
+  term_id_t fb = t1.apply_ftor (crab::BINOP_ADD, b, c);
+  solver_t* first;
+  {
+    scoped_solver_t s (&t1);
+    first = &(*s);
+    (*s) += make_pair (a, b);
+    (*s).run ();
+    TEST_CHECK ((*s).get_class (fa) == (*s).get_class (fb));
+    // a nested scope does not get the same solver
+    scoped_solver_t nested (&t1);
+    TEST_CHECK (&(*nested) != first);
+    TEST_CHECK ((*nested).get_size (fa) == 1);
+  }
+  // the same solver is given back, with nothing left of its last
+  // run, even on a smaller table
+  ttbl_t t2;
+  term_id_t x = t2.fresh_var (), y = t2.fresh_var ();
+  term_id_t fx = t2.apply_ftor (crab::BINOP_ADD, x, y);
+  {
+    scoped_solver_t s (&t2);
+    TEST_CHECK (&(*s) == first);
+    for (term_id_t t : { x, y, fx }) {
+      TEST_CHECK ((*s).get_size (t) == 1);
+      TEST_CHECK ((*s).get_class (t) == t);
+    }
+    (*s) += make_pair (x, y);
+    (*s).run ();
+    TEST_CHECK ((*s).get_size (x) == 2 && (*s).get_size (fx) == 1);
+  }
+  {
+    scoped_solver_t s (&t1);
+    TEST_CHECK ((*s).get_size (a) == 1 && (*s).get_size (fa) == 1);
+    TEST_CHECK ((*s).get_members (fb).size () == 1);
+  }
+}
+
+int main (int argc, char** argv) {
+  SET_LOGGER(argc,argv)
+  test_hash_consing ();
+  test_congruence ();
+  test_deref ();
+  test_reuse ();
+  return TEST_RESULT ();
+}